@@ -58,6 +58,8 @@ GPL-3.0+
 #include <stdio.h>
 #include <float.h>
 
+#include "HTS_engine.h"
+
 #define PI 3.14159265358979323846
 #define DB2EXP 0.11512925464970231
 
@@ -179,18 +181,24 @@ int resamplelogampenv(double f01,double *logaa1,unsigned int K1,double f02,doubl
 
 /********** Funciones de ruido **********/
 
-int gennoisefromlogspectrum(double *X,unsigned int Lp2,double fs) {
+double aho_rand(HTS_AhoCoder *v) {
+	// xorshift64* propio de cada contexto: sin el cerrojo ni el estado global de rand(), devuelve [0,1)
+	v->rng^=v->rng>>12; v->rng^=v->rng<<25; v->rng^=v->rng>>27;
+	return (double)((v->rng*2685821657736338717ULL)>>11)*(1.0/9007199254740992.0);
+}
+
+int gennoisefromlogspectrum(HTS_AhoCoder *v,double *X,unsigned int Lp2,double fs) {
 	// genera trama de ruido a partir del log-espectro, poniendo fase aleatoria e invirtiendo la fft
 	// ATENCION: X DEBE TRAER TAMAO 2Lp2
 	// ojo, en realidad basta que me pasen como entrada slo las primeras Lp2/2 muestras (incluso sin la primera), pero que los buffers tengan tamao para todas, claro
-	double *Xbuff,ph,fact=2.0*PI/(double)RAND_MAX,scale=sqrt(fs/(double)Lp2);
+	double *Xbuff,ph,fact=2.0*PI,scale=sqrt(fs/(double)Lp2);
 	unsigned int n,Lp22=Lp2>>1;
 	Xbuff=X+Lp2;
 	X[0]=0.0; Xbuff[0]=0.0;
 	X[Lp22]=0.0; Xbuff[Lp22]=0.0;
 	for (n=1;n<Lp22;n++) {
 		X[n]=scale*exp(X[n]);
-		ph=fact*(double)rand(); Xbuff[n]=X[n]*sin(ph); X[n]*=cos(ph);
+		ph=fact*aho_rand(v); Xbuff[n]=X[n]*sin(ph); X[n]*=cos(ph);
 		X[Lp2-n]=X[n]; Xbuff[Lp2-n]=-Xbuff[n];
 	}
 	ifftr(Lp2,X,Xbuff);
@@ -265,26 +273,87 @@ int applyantihpfilter(unsigned int K,double f0,double *aa,double fv) {
 	return 0;
 }
 
-int cc2waveform(double *x,unsigned int Lx,double fs,unsigned int Lframe,unsigned int Nframes,double **f0s,double **fvs,unsigned int ord,double **CC,double alfa) {
-	unsigned int k,kk,Kmax,K,Kuv,pm,Lp2;
-	double *Huv,*Hc,*Hs,*aa,*pp,*ee,*cc,*trama,f0min,c0max,c0min,fv,fact,phlin,f0,f0ant;
-	// inicializo la seal a ceros
-	for (k=0;k<Lx;k++) x[k]=0.0;
+/********** Funciones del modo incremental **********/
+
+double peakbound(unsigned int Nframes,double **f0s,double **fvs,double **CC,unsigned int ord,double fs,double alfa,double c0min,double c0max,double *Hc,double *aa) {
+	// cota del pico de la seal sin normalizar: maximo por trama de la suma de amplitudes de los armonicos
+	// (en las voces de aholab el pico real queda entre 0.6 y 0.9 veces la cota, el ruido incluido)
+	unsigned int k,kk,K;
+	double f0,fv,c0,sum,peak=0.0,*cc;
+	for (k=0;k<Nframes;k++) {
+		cc=CC[k]; f0=exp(f0s[k][0]); if (f0<MINGENF0 || f0>MAXGENF0) continue;
+		// mismos pasos que en la sintesis, pero solo amplitudes y sin tocar cc
+		c0=cc[0]; if (ADAPTLEVELS==1) cc[0]-=5.0;
+		if (fvs!=NULL) fv=fvs[k][0]; else fv=DEFFV*(cc[0]-c0min)/(c0max-c0min);
+		if (fv<MINGENFV) fv=MINGENFV;
+		if (fv>f0) {
+			K=hanoharms(fs,fv,f0);
+			ccmatrixcreate(ord,K,f0,fs,alfa,Hc,NULL);
+			prodmat(Hc,cc,aa,K,ord+1);
+			for (kk=0;kk<K;kk++) aa[kk]=2.0*sqrt(f0)*exp(aa[kk]);
+			applyantihpfilter(K,f0,aa,fv);
+			for (sum=0.0,kk=0;kk<K;kk++) sum+=aa[kk];
+			if (sum>peak) peak=sum;
+		}
+		cc[0]=c0;
+	}
+	return peak;
+}
+
+int emitwaveform(HTS_AhoCoder *v,double *x,unsigned int n,unsigned int keep,unsigned int Lwin,double gain) {
+	// entrega las n primeras muestras de la ventana, ya definitivas, y corre al principio las keep siguientes
+	unsigned int k;
+	int go;
+	for (k=0;k<n;k++) x[k]*=gain;
+	wavdouble2short(n,x,(short *)x);
+	go=v->out((short *)x,n,v->out_user);
+	for (k=0;k<keep;k++) x[k]=x[n+k];
+	for (k=keep;k<Lwin;k++) x[k]=0.0;
+	return go;
+}
+
+int cc2waveform(HTS_AhoCoder *v,double *x,unsigned int Lx,double fs,unsigned int Lframe,unsigned int Nframes,double **f0s,double **fvs,unsigned int ord,double **CC,double alfa,volatile HTS_Boolean *stop) {
+	unsigned int k,kk,Kmax,K,Kuv,pm,Lp2,Luv,L,Lwin,base,pend,ready;
+	double *Huv,*Hc,*Hs,*aa,*pp,*ee,*cc,*trama,f0min,c0max=0.0,c0min=0.0,fv,fact,phlin,f0,f0ant,gain=1.0;
+	int go=1;
+	// inicializo la seal a ceros (en modo incremental x es una ventana de out_frames+1 tramas del buffer del contexto)
+	Lwin=(v->out!=NULL)?(v->out_frames+1)*Lframe+1:0;
+	if (v->out==NULL) for (k=0;k<Lx;k++) x[k]=0.0;
 	// miro el pitch minimo encontrado para determinar Kmax y reservar espacio pa la matriz de voiced
 	for (f0min=DBL_MAX,k=0;k<Nframes;k++) if (f0s[k][0]>0.0 && f0s[k][0]<f0min) f0min=f0s[k][0]; f0min=exp(f0min); if (f0min<MINGENF0) f0min=MINGENF0;
+	// con parametros en streaming las tramas aun no estan generadas: reservo para la minima generable
+	if (v->feed!=NULL) f0min=MINGENF0;
 	// calculo los valores maximo y minimo de c0, con los que mapear la maximum voicing frequency si es caso
 	if (fvs==NULL) for (k=0,c0min=DBL_MAX,c0max=-DBL_MAX;k<Nframes;k++) { cc=CC[k]; if (f0s[k][0]>0.0 && cc[0]>c0max) c0max=cc[0]; if (cc[0]<c0min) c0min=cc[0]; }
 	// saco el maximo numero esperable de armonicos para hacer reserva de memoria
 	Kmax=hanoharms(fs,fs,f0min); Kuv=hanoharms(fs,fs,F0UV);
-	// matrices
-	Hc=(double *)malloc(((Kmax<<1)+Kuv)*(ord+1)*sizeof(double)); Hs=Hc+Kmax*(ord+1); Huv=Hs+Kmax*(ord+1);
-	ccmatrixcreate(ord,Kuv,F0UV,fs,alfa,Huv,NULL); // la estocastica la hago como muestrear a 100hz
-	// reservo memoria para las cosillas que ir sacando
-	aa=(double *)malloc(((Kmax<<1)+Kuv)*sizeof(double)); pp=aa+Kmax; ee=pp+Kmax;
 	Lp2=getwinlengthceilpot2(Lframe<<1);
-	trama=(double *)malloc((Lp2<<1)*sizeof(double));
-	// empezamos a operar
-	for (k=0,pm=Lframe,f0ant=0.0;k<Nframes;k++,pm+=Lframe) {
+	// todo sale del buffer del contexto, que solo crece: Huv, Hc, Hs, aa, pp, ee y trama
+	Luv=Kuv*(ord+1);
+	L=Luv+(Kmax<<1)*(ord+1)+(Kmax<<1)+Kuv+(Lp2<<1)+Lwin;
+	if (L>v->buff_size) { v->buff=(double *)realloc(v->buff,L*sizeof(double)); v->buff_size=L; }
+	// matrices (la estocastica va delante y se conserva mientras no cambien ord, fs y alfa)
+	Huv=v->buff; Hc=Huv+Luv; Hs=Hc+Kmax*(ord+1);
+	if (v->huv_ord!=ord || v->huv_fs!=fs || v->huv_alfa!=alfa) {
+		ccmatrixcreate(ord,Kuv,F0UV,fs,alfa,Huv,NULL); // la estocastica la hago como muestrear a 100hz
+		v->huv_ord=ord; v->huv_fs=fs; v->huv_alfa=alfa;
+	}
+	// las cosillas que ir sacando
+	aa=Hs+Kmax*(ord+1); pp=aa+Kmax; ee=pp+Kmax;
+	trama=ee+Kuv;
+	// en modo incremental no se puede normalizar al final: la ganancia sale de la cota del pico
+	if (v->out!=NULL) {
+		x=trama+(Lp2<<1); for (k=0;k<Lwin;k++) x[k]=0.0;
+		fact=(AMPNORMALIZE==1)?peakbound(Nframes,f0s,fvs,CC,ord,fs,alfa,c0min,c0max,Hc,aa):0.0;
+		if (fact>0.0) v->gain=0.99/fact;
+		gain=v->gain;
+	}
+	// la secuencia de fases de ruido empieza siempre en la semilla: misma entrada, misma salida
+	HTS_AhoCoder_set_seed(v,v->seed);
+	// empezamos a operar (si nos piden parar dejamos el resto de la seal a ceros)
+	for (k=0,pm=Lframe,f0ant=0.0,base=0,pend=0,ready=Nframes;k<Nframes && go && (stop==NULL || *stop==FALSE);k++,pm+=Lframe) {
+		// con parametros en streaming pido el siguiente bloque cuando hace falta
+		if (v->feed!=NULL && (k==0 || k>=ready) && (ready=v->feed(v->feed_user,k))<=k) break;
 		// tomo el cc actual y la f0 actual y la limito si es caso
 		cc=CC[k]; f0=exp(f0s[k][0]); if (f0<MINGENF0 || f0>MAXGENF0) f0=0.0;
 		// reescalar c0 si es caso (los coefs restantes ya se reescalan implicitamente en ccmatrixcreate)
@@ -303,7 +372,7 @@ int cc2waveform(double *x,unsigned int Lx,double fs,unsigned int Lframe,unsigned
 		// remuestreo al tamao de la fft de sintesis
 		resamplelogampenv(F0UV,ee,Kuv,fs/(double)Lp2,trama+1,(Lp2>>1)-1);
 		// generacion del trocito de ruido
-		gennoisefromlogspectrum(trama,Lp2,fs);
+		gennoisefromlogspectrum(v,trama,Lp2,fs);
 		// luego ya los armnicos
 		if (f0>0.0) {
 			// numero de armonicos
@@ -324,14 +393,19 @@ int cc2waveform(double *x,unsigned int Lx,double fs,unsigned int Lframe,unsigned
 			genharmonics(trama,Lframe,Lframe,fs,f0,K,aa,pp,phlin,1);
 		}
 		// overlap-add de la trama final
-		olatriang(x,trama,pm-Lframe,pm,pm+Lframe);
+		olatriang(x,trama,pm-Lframe-base,pm-base,pm+Lframe-base);
+		// en modo incremental, cada out_frames tramas entrego lo anterior a pm, que ya no va a cambiar
+		if (v->out!=NULL && ++pend==v->out_frames) { go=emitwaveform(v,x,pm-base,Lframe,Lwin,gain); base=pm; pend=0; }
 		// reescalo inversamente
 		if (ADAPTLEVELS==1) cc[0]+=5.0;
 		// acumulo f0 pa la siguiente
 		f0ant=f0;
 	}
-	// libero memoria (recuerda que haba una sola reserva para varias matrices y vectores)
-	free(Hc); free(aa); free(trama);
+	// en modo incremental queda la cola (si no nos han pedido parar)
+	if (v->out!=NULL) {
+		if (go && k==Nframes) go=emitwaveform(v,x,Lx-base,0,Lwin,gain);
+		return go?0:1;
+	}
 	// normalizar si es caso
 	if (AMPNORMALIZE==1) wavampnormalize(Lx,x);
 	// ya ta
@@ -340,11 +414,45 @@ int cc2waveform(double *x,unsigned int Lx,double fs,unsigned int Lframe,unsigned
 
 /********** Funciones visibles desde fuera **********/
 
-int gen_ahocoder_waveform(short *s,unsigned int Ls,unsigned int sr,unsigned int Lframe,unsigned int Nframes,double **lf0s,double **fv,unsigned int ord,double alfa,double **CC) {
+void HTS_AhoCoder_initialize(HTS_AhoCoder *v) {
+	// contexto vacio, los buffers se reservan en la primera sintesis
+	v->buff=NULL; v->buff_size=0;
+	v->huv_ord=0; v->huv_fs=0.0; v->huv_alfa=0.0;
+	v->out=NULL; v->out_user=NULL; v->out_frames=0; v->gain=1.0;
+	v->feed=NULL; v->feed_user=NULL;
+	HTS_AhoCoder_set_seed(v,AHOCODER_DEFAULT_SEED);
+}
+
+void HTS_AhoCoder_set_output(HTS_AhoCoder *v,unsigned int frames,HTS_AhoCoderOutput out,void *user) {
+	// con out, la seal se entrega cada frames tramas en vez de generarse entera en el buffer de la frase
+	v->out=out; v->out_user=user; v->out_frames=(frames>0)?frames:1;
+}
+
+void HTS_AhoCoder_set_seed(HTS_AhoCoder *v,unsigned long seed) {
+	// semilla de las fases de ruido, pasada por splitmix64 para que el estado nunca sea 0
+	unsigned long long z=(unsigned long long)seed+0x9E3779B97F4A7C15ULL;
+	z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL; z=(z^(z>>27))*0x94D049BB133111EBULL; z^=z>>31;
+	v->seed=seed; v->rng=z?z:0x9E3779B97F4A7C15ULL;
+}
+
+void HTS_AhoCoder_clear(HTS_AhoCoder *v) {
+	// libera los buffers y deja el contexto como recien inicializado
+	free(v->buff);
+	HTS_AhoCoder_initialize(v);
+}
+
+void HTS_AhoCoder_set_feed(HTS_AhoCoder *v,HTS_AhoCoderFeed feed,void *user) {
+	// con feed, antes de sintetizar cada trama que aun no esta lista se le pide (y devuelve hasta donde hay)
+	v->feed=feed; v->feed_user=user;
+}
+
+int gen_ahocoder_waveform(HTS_AhoCoder *v,short *s,unsigned int Ls,unsigned int sr,unsigned int Lframe,unsigned int Nframes,double **lf0s,double **fv,unsigned int ord,double alfa,double **CC,volatile HTS_Boolean *stop) {
 	// descarte de casos patolgicos
-	if (s==NULL || Ls==0 || Lframe==0 || Nframes==0 || lf0s==NULL || CC==NULL) return -1;	
+	if (v==NULL || (s==NULL && v->out==NULL) || Ls==0 || Lframe==0 || Nframes==0 || lf0s==NULL || CC==NULL) return -1;	
+	// en modo incremental las muestras ya han salido por v->out (1 si ha pedido parar)
+	if (v->out!=NULL) return cc2waveform(v,NULL,Ls,(double)sr,Lframe,Nframes,lf0s,fv,ord,CC,alfa,stop);
 	// llamo a la funcion de generacion convirtiendo las entradas
-	cc2waveform((double *)s,Ls,(double)sr,Lframe,Nframes,lf0s,fv,ord,CC,alfa);
+	cc2waveform(v,(double *)s,Ls,(double)sr,Lframe,Nframes,lf0s,fv,ord,CC,alfa,stop);
 	// sobreescribo convirtiendo los doubles en shorts como procede
 	wavdouble2short(Ls,(double *)s,s);
 	// listo
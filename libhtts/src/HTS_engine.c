@@ -93,6 +93,11 @@ void HTS_Engine_initialize(HTS_Engine * engine, int nstream)
 
    /* stop flag */
    engine->global.stop = FALSE;
+   /* streaming parameter generation */
+   engine->global.mlpg_lookahead = 0;
+   /* parameter generation threads */
+   engine->global.mlpg_threads = 1;
+   engine->global.pool = NULL;
    /* volume */
    engine->global.volume = 1.0;
 
@@ -108,6 +113,47 @@ void HTS_Engine_initialize(HTS_Engine * engine, int nstream)
    HTS_PStreamSet_initialize(&engine->pss);
    /* initialize gstream set */
    HTS_GStreamSet_initialize(&engine->gss);
+   /* initialize arena for the stream sets */
+   HTS_Arena_initialize(&engine->arena);
+   /* the model set is ours until it is shared */
+   engine->ms_shared = FALSE;
+   /* initialize vocoder */
+   HTS_AhoCoder_initialize(&engine->vocoder);
+}
+
+/* HTS_Engine_share_model: use (read only) the model set loaded by another engine */
+HTS_Boolean HTS_Engine_share_model(HTS_Engine * engine, HTS_Engine * source)
+{
+   int i, j, n;
+   int nstream = HTS_ModelSet_get_nstream(&source->ms);
+
+   /* engine must be just initialized with the same number of streams */
+   if (HTS_ModelSet_get_nstream(&engine->ms) != nstream || engine->global.duration_iw != NULL) {
+      HTS_error(1, "HTS_Engine_share_model: Engine is not compatible with the source model set.\n");
+      return FALSE;
+   }
+   engine->ms = source->ms;
+   engine->ms_shared = TRUE;
+
+   /* interpolation weights are per engine, start from the source values */
+   n = HTS_ModelSet_get_duration_interpolation_size(&engine->ms);
+   engine->global.duration_iw = (double *) HTS_calloc(n, sizeof(double));
+   for (j = 0; j < n; j++)
+      engine->global.duration_iw[j] = source->global.duration_iw[j];
+   for (i = 0; i < nstream; i++) {
+      n = HTS_ModelSet_get_parameter_interpolation_size(&engine->ms, i);
+      engine->global.parameter_iw[i] = (double *) HTS_calloc(n, sizeof(double));
+      for (j = 0; j < n; j++)
+         engine->global.parameter_iw[i][j] = source->global.parameter_iw[i][j];
+      if (source->global.gv_iw[i]) {
+         n = HTS_ModelSet_get_gv_interpolation_size(&engine->ms, i);
+         engine->global.gv_iw[i] = (double *) HTS_calloc(n, sizeof(double));
+         for (j = 0; j < n; j++)
+            engine->global.gv_iw[i][j] = source->global.gv_iw[i][j];
+      }
+   }
+
+   return TRUE;
 }
 
 /* HTS_Engine_load_duratin_from_fn: load duration pdfs, trees and number of state from file names */
@@ -261,6 +307,45 @@ HTS_Boolean HTS_Engine_load_gv_switch_from_fp(HTS_Engine * engine, HTS_File * fp
    return HTS_ModelSet_load_gv_switch(&engine->ms, fp);
 }
 
+/* HTS_Engine_get_image_nstream: get number of stream of a voice image (-1: not a valid voice image) */
+int HTS_Engine_get_image_nstream(const char *fn)
+{
+   return HTS_ModelSet_get_image_nstream(fn);
+}
+
+/* HTS_Engine_load_image_from_fn: load every model from a voice image written by HTS_Engine_save_image */
+HTS_Boolean HTS_Engine_load_image_from_fn(HTS_Engine * engine, const char *fn)
+{
+   int i, j, n;
+
+   if (HTS_ModelSet_load_image(&engine->ms, fn) == FALSE)
+      return FALSE;
+   n = HTS_ModelSet_get_duration_interpolation_size(&engine->ms);
+   engine->global.duration_iw = (double *) HTS_calloc(n, sizeof(double));
+   for (j = 0; j < n; j++)
+      engine->global.duration_iw[j] = 1.0 / n;
+   for (i = 0; i < HTS_ModelSet_get_nstream(&engine->ms); i++) {
+      n = HTS_ModelSet_get_parameter_interpolation_size(&engine->ms, i);
+      engine->global.parameter_iw[i] = (double *) HTS_calloc(n, sizeof(double));
+      for (j = 0; j < n; j++)
+         engine->global.parameter_iw[i][j] = 1.0 / n;
+      if (HTS_ModelSet_use_gv(&engine->ms, i)) {
+         n = HTS_ModelSet_get_gv_interpolation_size(&engine->ms, i);
+         engine->global.gv_iw[i] = (double *) HTS_calloc(n, sizeof(double));
+         for (j = 0; j < n; j++)
+            engine->global.gv_iw[i][j] = 1.0 / n;
+      }
+   }
+
+   return TRUE;
+}
+
+/* HTS_Engine_save_image: write the loaded models as a voice image */
+HTS_Boolean HTS_Engine_save_image(HTS_Engine * engine, HTS_File * fp)
+{
+   return HTS_ModelSet_save_image(&engine->ms, fp);
+}
+
 /* HTS_Engine_set_sampling_rate: set sampling rate */
 void HTS_Engine_set_sampling_rate(HTS_Engine * engine, int i)
 {
@@ -389,6 +474,39 @@ void HTS_Engine_set_stop_flag(HTS_Engine * engine, HTS_Boolean b)
    engine->global.stop = b;
 }
 
+/* HTS_Engine_get_stop_flag: get stop flag */
+HTS_Boolean HTS_Engine_get_stop_flag(HTS_Engine * engine)
+{
+   return engine->global.stop;
+}
+
+/* HTS_Engine_set_vocoder_seed: set seed of the vocoder noise (same seed, same output) */
+void HTS_Engine_set_vocoder_seed(HTS_Engine * engine, unsigned long seed)
+{
+   HTS_AhoCoder_set_seed(&engine->vocoder, seed);
+}
+
+/* HTS_Engine_set_mlpg_lookahead: generate the parameters in blocks solved lookahead frames ahead, as the vocoder needs them (0: whole utterance) */
+void HTS_Engine_set_mlpg_lookahead(HTS_Engine * engine, int lookahead)
+{
+   engine->global.mlpg_lookahead = lookahead > 0 ? lookahead : 0;
+}
+
+/* HTS_Engine_set_mlpg_threads: generate the streams and dimensions of the parameters with nthread threads, the caller and nthread - 1 from the shared pool (<= 1: sequential) */
+void HTS_Engine_set_mlpg_threads(HTS_Engine * engine, int nthread)
+{
+   if (engine->global.pool != NULL)
+      HTS_Pool_release(engine->global.pool);
+   engine->global.mlpg_threads = nthread > 1 ? nthread : 1;
+   engine->global.pool = nthread > 1 ? HTS_Pool_share(nthread - 1) : NULL;
+}
+
+/* HTS_Engine_set_vocoder_output: deliver the speech to out every frames frames instead of into gspeech (out=NULL: back to whole utterances) */
+void HTS_Engine_set_vocoder_output(HTS_Engine * engine, int frames, HTS_AhoCoderOutput out, void *user)
+{
+   HTS_AhoCoder_set_output(&engine->vocoder, frames > 0 ? (unsigned int) frames : 1, out, user);
+}
+
 /* HTS_Engine_set_volume: set volume */
 void HTS_Engine_set_volume(HTS_Engine * engine, double f)
 {
@@ -460,19 +578,19 @@ void HTS_Engine_load_label_from_string_list(HTS_Engine * engine, char **data, in
 /* HTS_Engine_create_sstream: parse label and determine state duration */
 HTS_Boolean HTS_Engine_create_sstream(HTS_Engine * engine)
 {
-   return HTS_SStreamSet_create(&engine->sss, &engine->ms, &engine->label, engine->global.duration_iw, engine->global.parameter_iw, engine->global.gv_iw);
+   return HTS_SStreamSet_create(&engine->sss, &engine->ms, &engine->label, engine->global.duration_iw, engine->global.parameter_iw, engine->global.gv_iw, &engine->arena, &engine->global.stop);
 }
 
 /* HTS_Engine_create_pstream: generate speech parameter vector sequence */
 HTS_Boolean HTS_Engine_create_pstream(HTS_Engine * engine)
 {
-   return HTS_PStreamSet_create(&engine->pss, &engine->sss, engine->global.msd_threshold, engine->global.gv_weight);
+   return HTS_PStreamSet_create(&engine->pss, &engine->sss, engine->global.msd_threshold, engine->global.gv_weight, engine->global.mlpg_lookahead, engine->global.mlpg_threads, engine->global.pool, &engine->arena, &engine->global.stop);
 }
 
 /* HTS_Engine_create_gstream: synthesis speech */
 HTS_Boolean HTS_Engine_create_gstream(HTS_Engine * engine)
 {
-   return HTS_GStreamSet_create(&engine->gss, &engine->pss, engine->global.stage, engine->global.use_log_gain, engine->global.sampling_rate, engine->global.fperiod, engine->global.alpha, engine->global.beta, &engine->global.stop, engine->global.volume, engine->global.audio_buff_size > 0 ? &engine->audio : NULL);
+   return HTS_GStreamSet_create(&engine->gss, &engine->pss, engine->global.stage, engine->global.use_log_gain, engine->global.sampling_rate, engine->global.fperiod, engine->global.alpha, engine->global.beta, &engine->arena, &engine->global.stop, engine->global.volume, engine->global.audio_buff_size > 0 ? &engine->audio : NULL, &engine->vocoder);
 }
 
 /* HTS_Engine_save_information: output trace information */
@@ -485,6 +603,7 @@ void HTS_Engine_save_information(HTS_Engine * engine, HTS_File * fp)
    HTS_Label *label = &engine->label;
    HTS_SStreamSet *sss = &engine->sss;
    HTS_PStreamSet *pss = &engine->pss;
+   HTS_LabelMatch match;
 
    /* global parameter */
    fprintf(fp, "[Global parameter]\n");
@@ -575,10 +694,11 @@ void HTS_Engine_save_information(HTS_Engine * engine, HTS_File * fp)
    for (i = 0; i < HTS_Label_get_size(label); i++) {
       fprintf(fp, "HMM[%2d]\n", i);
       fprintf(fp, "  Name                                 -> %s\n", HTS_Label_get_string(label, i));
+      HTS_ModelSet_match_label(ms, HTS_Label_get_string(label, i), &match);
       fprintf(fp, "  Duration\n");
       for (j = 0; j < HTS_ModelSet_get_duration_interpolation_size(ms); j++) {
          fprintf(fp, "    Interpolation[%2d]\n", j);
-         HTS_ModelSet_get_duration_index(ms, HTS_Label_get_string(label, i), &k, &l, j);
+         HTS_ModelSet_get_duration_index(ms, &match, &k, &l, j);
          fprintf(fp, "      Tree index                       -> %8d\n", k);
          fprintf(fp, "      PDF index                        -> %8d\n", l);
       }
@@ -595,12 +715,15 @@ void HTS_Engine_save_information(HTS_Engine * engine, HTS_File * fp)
             }
             for (l = 0; l < HTS_ModelSet_get_parameter_interpolation_size(ms, k); l++) {
                fprintf(fp, "      Interpolation[%2d]\n", l);
-               HTS_ModelSet_get_parameter_index(ms, HTS_Label_get_string(label, i), &m, &n, k, j + 2, l);
+               HTS_ModelSet_get_parameter_index(ms, &match, &m, &n, k, j + 2, l);
                fprintf(fp, "        Tree index                     -> %8d\n", m);
                fprintf(fp, "        PDF index                      -> %8d\n", n);
             }
          }
       }
+      fprintf(fp, "  Questions evaluated                  -> %8d\n", match.evaluated);
+      fprintf(fp, "  Questions reused                     -> %8d\n", match.reused);
+      HTS_LabelMatch_clear(&match);
    }
 }
 
@@ -704,10 +827,20 @@ void HTS_Engine_refresh(HTS_Engine * engine)
    HTS_SStreamSet_clear(&engine->sss);
    /* free label list */
    HTS_Label_clear(&engine->label);
+   /* take the buffers of the stream sets back */
+   HTS_Arena_reset(&engine->arena);
    /* stop flag */
    engine->global.stop = FALSE;
 }
 
+/* HTS_Engine_get_alloc_stats: get buffers, heap allocations and bytes taken by the stream sets of the last refreshed utterance */
+void HTS_Engine_get_alloc_stats(HTS_Engine * engine, int *nalloc, int *nheap, size_t * bytes)
+{
+   *nalloc = engine->arena.last_nalloc;
+   *nheap = engine->arena.last_nheap;
+   *bytes = engine->arena.last_used;
+}
+
 /* HTS_Engine_clear: free engine */
 void HTS_Engine_clear(HTS_Engine * engine)
 {
@@ -723,9 +856,16 @@ void HTS_Engine_clear(HTS_Engine * engine)
    HTS_free(engine->global.parameter_iw);
    HTS_free(engine->global.gv_iw);
    HTS_free(engine->global.gv_weight);
+   if (engine->global.pool != NULL)
+      HTS_Pool_release(engine->global.pool);
 
-   HTS_ModelSet_clear(&engine->ms);
+   if (engine->ms_shared)
+      HTS_ModelSet_initialize(&engine->ms, -1);
+   else
+      HTS_ModelSet_clear(&engine->ms);
    HTS_Audio_clear(&engine->audio);
+   HTS_AhoCoder_clear(&engine->vocoder);
+   HTS_Arena_clear(&engine->arena);
 }
 
 /* HTS_get_copyright: write copyright to string */
@@ -176,31 +176,34 @@ typedef struct _HTS_Window {
 /* HTS_Pattern: List of patterns in a question and a tree. */
 typedef struct _HTS_Pattern {
    char *string;                /* pattern string */
+   int type;                    /* kind of pattern, by the position of its wildcards */
+   const char *text;            /* pattern string without leading and trailing '*' */
+   int length;                  /* length of text */
+   int literal;                 /* index of text in the substring matcher (-1: none) */
    struct _HTS_Pattern *next;   /* pointer to the next pattern */
 } HTS_Pattern;
 
-/* HTS_Question: List of questions in a tree. */
+/* HTS_Question: Question of the trees of a model. */
 typedef struct _HTS_Question {
    char *string;                /* name of this question */
    HTS_Pattern *head;           /* pointer to the head of pattern list */
-   struct _HTS_Question *next;  /* pointer to the next question */
+   int index;                   /* index of this question in the model set, shared by equal questions (-1: none) */
 } HTS_Question;
 
-/* HTS_Node: List of tree nodes in a tree. */
+/* HTS_Node: Internal node of a tree, node number -i is the i-th of the array. */
 typedef struct _HTS_Node {
-   int index;                   /* index of this node */
-   int pdf;                     /* index of PDF for this node  ( leaf node only ) */
-   struct _HTS_Node *yes;       /* pointer to its child node (yes) */
-   struct _HTS_Node *no;        /* pointer to its child node (no) */
-   struct _HTS_Node *next;      /* pointer to the next node */
-   HTS_Question *quest;         /* question applied at this node */
+   int quest;                   /* index of the question applied at this node in the model */
+   int yes;                     /* child node (yes): node number (<= 0) or index of PDF (> 0) */
+   int no;                      /* child node (no): node number (<= 0) or index of PDF (> 0) */
 } HTS_Node;
 
 /* HTS_Tree: List of decision trees in a model. */
 typedef struct _HTS_Tree {
    HTS_Pattern *head;           /* pointer to the head of pattern list for this tree */
    struct _HTS_Tree *next;      /* pointer to next tree */
-   HTS_Node *root;              /* root node of this tree */
+   HTS_Node *node;              /* internal nodes, the root first (NULL: the tree is a leaf) */
+   int nnode;                   /* # of internal nodes */
+   int pdf;                     /* index of PDF of a tree without internal nodes */
    int state;                   /* state index of this tree */
 } HTS_Tree;
 
@@ -209,9 +212,11 @@ typedef struct _HTS_Model {
    int vector_length;           /* vector length (include static and dynamic features) */
    int ntree;                   /* # of trees */
    int *npdf;                   /* # of PDFs at each tree */
-   double ***pdf;               /* PDFs */
+   double ***pdf;               /* PDFs, those of each tree in a contiguous table */
    HTS_Tree *tree;              /* pointer to the list of trees */
-   HTS_Question *question;      /* pointer to the list of questions */
+   HTS_Question *question;      /* questions */
+   int nquestion;               /* # of questions */
+   HTS_Boolean mapped;          /* npdf, PDF tables and tree nodes are in a voice image */
 } HTS_Model;
 
 /* HTS_Stream: Set of models and a window. */
@@ -223,6 +228,36 @@ typedef struct _HTS_Stream {
    int interpolation_size;      /* # of models for interpolation */
 } HTS_Stream;
 
+/* HTS_Matcher: Aho-Corasick automaton of the substring patterns of a model set. */
+typedef struct _HTS_Matcher {
+   int nliteral;                /* # of different substrings */
+   int nclass;                  /* # of byte classes (class 0: bytes in no substring) */
+   unsigned char byte_class[256];       /* class of each byte */
+   int nstate;                  /* # of states */
+   int size;                    /* # of allocated states */
+   int *next;                   /* transitions (nstate x nclass) */
+   int *literal;                /* substring ending at each state (-1: none) */
+   int *suffix;                 /* longest proper suffix state ending a substring (-1: none) */
+   int nquestion;               /* # of different questions */
+   HTS_Question **question;     /* questions by index */
+} HTS_Matcher;
+
+/* HTS_LabelMatch: Label string and the substring patterns it contains. */
+typedef struct _HTS_LabelMatch {
+   const char *string;          /* label string */
+   int length;                  /* length of label string */
+   unsigned char *found;        /* bit set of the substrings found (NULL: generic matching) */
+   unsigned char *known;        /* bit set of the questions already answered */
+   unsigned char *answer;       /* bit set of their answers */
+   int evaluated;               /* # of questions matched against the label */
+   int reused;                  /* # of answers taken from known */
+   int *index;                  /* tree and pdf indices of every lookup, for the label cache (NULL: no cache) */
+   HTS_Boolean cached;          /* index comes from the label cache */
+} HTS_LabelMatch;
+
+/* HTS_LabelCache: LRU cache from label string to tree and pdf indices, shared by the engines using a model set */
+typedef struct _HTS_LabelCache HTS_LabelCache;
+
 /* HTS_ModelSet: Set of duration models, HMMs and GV models. */
 typedef struct _HTS_ModelSet {
    HTS_Stream duration;         /* duration PDFs and trees */
@@ -231,6 +266,10 @@ typedef struct _HTS_ModelSet {
    HTS_Model gv_switch;         /* GV switch */
    int nstate;                  /* # of HMM states */
    int nstream;                 /* # of stream */
+   HTS_Matcher *matcher;        /* compiled questions (read only after loading) */
+   HTS_LabelCache *cache;       /* label cache (NULL: none), emptied when models are loaded */
+   const void *image;           /* voice image the models were loaded from (NULL: text files) */
+   size_t image_size;           /* bytes of the mapped voice image */
 } HTS_ModelSet;
 
 /*  ----------------------- model method --------------------------  */
@@ -256,6 +295,15 @@ HTS_Boolean HTS_ModelSet_load_gv_switch(HTS_ModelSet * ms, HTS_File * fp);
 /* HTS_ModelSet_have_gv_switch: if GV switch is used, return true */
 HTS_Boolean HTS_ModelSet_have_gv_switch(HTS_ModelSet * ms);
 
+/* HTS_ModelSet_get_image_nstream: get number of stream of a voice image (-1: not a valid voice image) */
+int HTS_ModelSet_get_image_nstream(const char *fn);
+
+/* HTS_ModelSet_load_image: load every model from a voice image, mapped read only */
+HTS_Boolean HTS_ModelSet_load_image(HTS_ModelSet * ms, const char *fn);
+
+/* HTS_ModelSet_save_image: write the loaded models as a voice image */
+HTS_Boolean HTS_ModelSet_save_image(HTS_ModelSet * ms, HTS_File * fp);
+
 /* HTS_ModelSet_get_nstate: get number of state */
 int HTS_ModelSet_get_nstate(HTS_ModelSet * ms);
 
@@ -295,23 +343,47 @@ int HTS_ModelSet_get_gv_interpolation_size(HTS_ModelSet * ms, int stream_index);
 /* HTS_ModelSet_use_gv: get GV flag */
 HTS_Boolean HTS_ModelSet_use_gv(HTS_ModelSet * ms, int index);
 
+/* HTS_ModelSet_set_label_cache: keep the tree and pdf indices of the last labels, up to max_bytes (0: no cache) */
+void HTS_ModelSet_set_label_cache(HTS_ModelSet * ms, size_t max_bytes);
+
+/* HTS_ModelSet_clear_label_cache: drop every cached label */
+void HTS_ModelSet_clear_label_cache(HTS_ModelSet * ms);
+
+/* HTS_ModelSet_get_label_cache_stats: get hits, misses, evictions, entries and bytes of the label cache */
+HTS_Boolean HTS_ModelSet_get_label_cache_stats(HTS_ModelSet * ms, unsigned long *hits, unsigned long *misses, unsigned long *evictions, int *entries, size_t * bytes);
+
+/* HTS_ModelSet_find_label: get the indices of the label from the cache, or prepare them to be stored */
+HTS_Boolean HTS_ModelSet_find_label(HTS_ModelSet * ms, HTS_LabelMatch * label);
+
+/* HTS_ModelSet_cache_label: store the indices of a label not found in the cache, once every lookup has been done */
+void HTS_ModelSet_cache_label(HTS_ModelSet * ms, HTS_LabelMatch * label);
+
+/* HTS_ModelSet_match_label: find every substring pattern contained in the label, scanning it once */
+void HTS_ModelSet_match_label(HTS_ModelSet * ms, const char *string, HTS_LabelMatch * label);
+
+/* HTS_LabelMatch_initialize: prepare label for generic pattern matching */
+void HTS_LabelMatch_initialize(HTS_LabelMatch * label, const char *string);
+
+/* HTS_LabelMatch_clear: free label match */
+void HTS_LabelMatch_clear(HTS_LabelMatch * label);
+
 /* HTS_ModelSet_get_duration_index: get index of duration tree and PDF */
-void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index, int interpolation_index);
+void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index, int interpolation_index);
 
 /* HTS_ModelSet_get_duration: get duration using interpolation weight */
-void HTS_ModelSet_get_duration(HTS_ModelSet * ms, char *string, double *mean, double *vari, double *iw);
+void HTS_ModelSet_get_duration(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, double *iw);
 
 /* HTS_ModelSet_get_parameter_index: get index of parameter tree and PDF */
-void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index, int stream_index, int state_index, int interpolation_index);
+void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index, int stream_index, int state_index, int interpolation_index);
 
 /* HTS_ModelSet_get_parameter: get parameter using interpolation weight */
-void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, char *string, double *mean, double *vari, double *msd, int stream_index, int state_index, double *iw);
+void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, double *msd, int stream_index, int state_index, double *iw);
 
 /* HTS_ModelSet_get_gv: get GV using interpolation weight */
-void HTS_ModelSet_get_gv(HTS_ModelSet * ms, char *string, double *mean, double *vari, int stream_index, double *iw);
+void HTS_ModelSet_get_gv(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, int stream_index, double *iw);
 
 /* HTS_ModelSet_get_gv_switch: get GV switch */
-HTS_Boolean HTS_ModelSet_get_gv_switch(HTS_ModelSet * ms, char *string);
+HTS_Boolean HTS_ModelSet_get_gv_switch(HTS_ModelSet * ms, HTS_LabelMatch * label);
 
 /* HTS_ModelSet_clear: free model set */
 void HTS_ModelSet_clear(HTS_ModelSet * ms);
@@ -378,6 +450,32 @@ double HTS_Label_get_speech_speed(HTS_Label * label);
 /* HTS_Label_clear: free label */
 void HTS_Label_clear(HTS_Label * label);
 
+/*  -------------------------- arena ------------------------------  */
+
+/* HTS_Arena: buffers of the utterance being synthesized, carved from a few large blocks that are reset, not freed, after every utterance */
+typedef struct _HTS_Arena {
+   struct _HTS_ArenaBlock *block;       /* blocks, the one in use first */
+   size_t reserve;              /* size of the next block */
+   size_t used;                 /* bytes handed out since the last reset */
+   int nalloc;                  /* buffers handed out since the last reset */
+   int nheap;                   /* blocks allocated from the heap since the last reset */
+   int nsmall;                  /* utterances in a row that used much less than the block */
+   size_t last_used;            /* used, nalloc and nheap of the utterance before the last reset */
+   int last_nalloc;
+   int last_nheap;
+} HTS_Arena;
+
+/*  ----------------------- arena method --------------------------  */
+
+/* HTS_Arena_initialize: initialize arena */
+void HTS_Arena_initialize(HTS_Arena * arena);
+
+/* HTS_Arena_reset: take every buffer back, keeping a single block with room for the utterance just finished */
+void HTS_Arena_reset(HTS_Arena * arena);
+
+/* HTS_Arena_clear: free arena */
+void HTS_Arena_clear(HTS_Arena * arena);
+
 /*  -------------------------- sstream ----------------------------  */
 
 /* HTS_SStream: individual state stream */
@@ -412,7 +510,7 @@ typedef struct _HTS_SStreamSet {
 void HTS_SStreamSet_initialize(HTS_SStreamSet * sss);
 
 /* HTS_SStreamSet_create: parse label and determine state duration */
-HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms, HTS_Label * label, double *duration_iw, double **parameter_iw, double **gv_iw);
+HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms, HTS_Label * label, double *duration_iw, double **parameter_iw, double **gv_iw, HTS_Arena * arena, volatile HTS_Boolean * stop);
 
 /* HTS_SStreamSet_get_nstream: get number of stream */
 int HTS_SStreamSet_get_nstream(HTS_SStreamSet * sss);
@@ -477,9 +575,31 @@ void HTS_SStreamSet_set_gv_switch(HTS_SStreamSet * sss, int stream_index, int st
 /* HTS_SStreamSet_get_gv_switch: get GV switch */
 HTS_Boolean HTS_SStreamSet_get_gv_switch(HTS_SStreamSet * sss, int stream_index, int state_index);
 
-/* HTS_SStreamSet_clear: free state stream set */
+/* HTS_SStreamSet_clear: drop state stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_SStreamSet_clear(HTS_SStreamSet * sss);
 
+/*  --------------------------- pool ------------------------------  */
+
+/* HTS_Pool: worker threads shared by the engines of a process, for parameter generation */
+typedef struct _HTS_Pool HTS_Pool;
+
+/* HTS_PoolTask: task run by HTS_Pool_run(); tasks running at once never share slot */
+typedef void (*HTS_PoolTask) (void *user, int index, int slot);
+
+/*  ------------------------ pool method --------------------------  */
+
+/* HTS_Pool_share: get the pool shared by the process, with at least nthread worker threads */
+HTS_Pool *HTS_Pool_share(int nthread);
+
+/* HTS_Pool_get_nthread: get number of worker threads */
+int HTS_Pool_get_nthread(HTS_Pool * pool);
+
+/* HTS_Pool_run: run task(user, index, slot) for index = 0..ntasks-1 with up to nslots threads (the caller included) and wait for them */
+void HTS_Pool_run(HTS_Pool * pool, int ntasks, int nslots, HTS_PoolTask task, void *user);
+
+/* HTS_Pool_release: release the pool, the last user stops its threads */
+void HTS_Pool_release(HTS_Pool * pool);
+
 /*  -------------------------- pstream ----------------------------  */
 
 /* HTS_SMatrices: Matrices/Vectors used in the speech parameter generation algorithm. */
@@ -508,6 +628,10 @@ typedef struct _HTS_PStream {
    double *gv_vari;             /* variance vector of GV */
    HTS_Boolean *gv_switch;      /* GV flag sequence */
    int gv_length;               /* frame length for GV calculation */
+   double **tail;               /* streaming: values before GV of the last width-1 generated frames */
+   double *gv_center;           /* streaming: mean of the GV approximation */
+   double *gv_ratio;            /* streaming: scale of the GV approximation */
+   int ready;                   /* streaming: frames already generated */
 } HTS_PStream;
 
 /* HTS_PStreamSet: Set of PDF streams. */
@@ -515,6 +639,8 @@ typedef struct _HTS_PStreamSet {
    HTS_PStream *pstream;        /* PDF streams */
    int nstream;                 /* # of PDF streams */
    int total_frame;             /* total frame */
+   int lookahead;               /* streaming: frames solved past each block (0: whole utterance at once) */
+   int ready;                   /* frames already generated */
 } HTS_PStreamSet;
 
 /*  ----------------------- pstream method ------------------------  */
@@ -523,7 +649,10 @@ typedef struct _HTS_PStreamSet {
 void HTS_PStreamSet_initialize(HTS_PStreamSet * pss);
 
 /* HTS_PStreamSet_create: parameter generation using GV weight */
-HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, double *msd_threshold, double *gv_weight);
+HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, double *msd_threshold, double *gv_weight, int lookahead, int nthread, HTS_Pool * pool, HTS_Arena * arena, volatile HTS_Boolean * stop);
+
+/* HTS_PStreamSet_generate: streaming, generate the parameters of the frames before frame; returns the number of frames ready */
+int HTS_PStreamSet_generate(HTS_PStreamSet * pss, int frame, volatile HTS_Boolean * stop);
 
 /* HTS_PStreamSet_get_nstream: get number of stream */
 int HTS_PStreamSet_get_nstream(HTS_PStreamSet * pss);
@@ -546,7 +675,7 @@ HTS_Boolean HTS_PStreamSet_get_msd_flag(HTS_PStreamSet * pss, int stream_index,
 /* HTS_PStreamSet_is_msd: get MSD flag */
 HTS_Boolean HTS_PStreamSet_is_msd(HTS_PStreamSet * pss, int stream_index);
 
-/* HTS_PStreamSet_clear: free parameter stream set */
+/* HTS_PStreamSet_clear: drop parameter stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_PStreamSet_clear(HTS_PStreamSet * pss);
 
 /*  -------------------------- gstream ----------------------------  */
@@ -566,13 +695,39 @@ typedef struct _HTS_GStreamSet {
    short *gspeech;              /* generated speech */
 } HTS_GStreamSet;
 
+/* HTS_AhoCoderOutput: receives the incremental output of the vocoder, returns FALSE to stop */
+typedef HTS_Boolean (*HTS_AhoCoderOutput) (const short *s, unsigned int n, void *user);
+
+/* HTS_AhoCoderFeed: asked for the parameters of frame, returns the number of frames ready (not more than frame: stop) */
+typedef unsigned int (*HTS_AhoCoderFeed) (void *user, unsigned int frame);
+
+/* HTS_AhoCoder: AhoCoder context, one per engine (reentrant) */
+typedef struct _HTS_AhoCoder {
+   unsigned long seed;          /* seed of the noise phases, restarted at every utterance */
+   unsigned long long rng;      /* random number generator state */
+   double *buff;                /* scratch buffers (grow only) */
+   unsigned int buff_size;      /* size of buff */
+   unsigned int huv_ord;        /* order, sampling rate and alpha of the */
+   double huv_fs;               /*  unvoiced matrix kept at the start of buff */
+   double huv_alfa;
+   HTS_AhoCoderOutput out;      /* incremental output (NULL: whole utterance into gspeech) */
+   void *out_user;              /* user data for out */
+   unsigned int out_frames;     /* frames vocoded between calls to out */
+   double gain;                 /* gain of the last incremental utterance */
+   HTS_AhoCoderFeed feed;       /* streaming parameters (NULL: all frames ready) */
+   void *feed_user;             /* user data for feed */
+} HTS_AhoCoder;
+
+/* AHOCODER_DEFAULT_SEED: seed used until HTS_AhoCoder_set_seed() is called */
+#define AHOCODER_DEFAULT_SEED 1
+
 /*  ----------------------- gstream method ------------------------  */
 
 /* HTS_GStreamSet_initialize: initialize generated parameter stream set */
 void HTS_GStreamSet_initialize(HTS_GStreamSet * gss);
 
 /* HTS_GStreamSet_create: generate speech */
-HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, int stage, HTS_Boolean use_log_gain, int sampling_rate, int fperiod, double alpha, double beta, HTS_Boolean * stop, double volume, HTS_Audio * audio);
+HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, int stage, HTS_Boolean use_log_gain, int sampling_rate, int fperiod, double alpha, double beta, HTS_Arena * arena, volatile HTS_Boolean * stop, double volume, HTS_Audio * audio, HTS_AhoCoder * vocoder);
 
 /* HTS_GStreamSet_get_total_nsample: get total number of sample */
 int HTS_GStreamSet_get_total_nsample(HTS_GStreamSet * gss);
@@ -589,7 +744,7 @@ short HTS_GStreamSet_get_speech(HTS_GStreamSet * gss, int sample_index);
 /* HTS_GStreamSet_get_parameter: get generated parameter */
 double HTS_GStreamSet_get_parameter(HTS_GStreamSet * gss, int stream_index, int frame_index, int vector_index);
 
-/* HTS_GStreamSet_clear: free generated parameter stream set */
+/* HTS_GStreamSet_clear: drop generated parameter stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_GStreamSet_clear(HTS_GStreamSet * gss);
 
 /*  -------------------------- engine -----------------------------  */
@@ -608,8 +763,11 @@ typedef struct _HTS_Global {
    double **parameter_iw;       /* weights for parameter interpolation */
    double **gv_iw;              /* weights for GV interpolation */
    double *gv_weight;           /* GV weights */
-   HTS_Boolean stop;            /* stop flag */
+   volatile HTS_Boolean stop;   /* stop flag, may be set from another thread */
    double volume;               /* volume */
+   int mlpg_lookahead;          /* streaming parameter generation lookahead (0: whole utterance) */
+   int mlpg_threads;            /* threads generating the parameters, the caller included (<= 1: sequential) */
+   HTS_Pool *pool;              /* shared pool the other mlpg_threads - 1 threads come from */
 } HTS_Global;
 
 /* HTS_Engine: Engine itself. */
@@ -621,6 +779,9 @@ typedef struct _HTS_Engine {
    HTS_SStreamSet sss;          /* set of state streams */
    HTS_PStreamSet pss;          /* set of PDF streams */
    HTS_GStreamSet gss;          /* set of generated parameter streams */
+   HTS_Arena arena;             /* buffers of sss, pss and gss */
+   HTS_Boolean ms_shared;       /* model set owned by another engine */
+   HTS_AhoCoder vocoder;        /* vocoder context */
 } HTS_Engine;
 
 /*  ----------------------- engine method -------------------------  */
@@ -628,6 +789,9 @@ typedef struct _HTS_Engine {
 /* HTS_Engine_initialize: initialize engine */
 void HTS_Engine_initialize(HTS_Engine * engine, int nstream);
 
+/* HTS_Engine_share_model: use (read only) the model set loaded by another engine */
+HTS_Boolean HTS_Engine_share_model(HTS_Engine * engine, HTS_Engine * source);
+
 /* HTS_engine_load_duration_from_fn: load duration pdfs ,trees and number of state from file names */
 HTS_Boolean HTS_Engine_load_duration_from_fn(HTS_Engine * engine, char **pdf_fn, char **tree_fn, int interpolation_size);
 
@@ -652,6 +816,15 @@ HTS_Boolean HTS_Engine_load_gv_switch_from_fn(HTS_Engine * engine, char *fn);
 /* HTS_Engine_load_gv_switch_from_fp: load GV switch from file pointers */
 HTS_Boolean HTS_Engine_load_gv_switch_from_fp(HTS_Engine * engine, HTS_File * fp);
 
+/* HTS_Engine_get_image_nstream: get number of stream of a voice image (-1: not a valid voice image) */
+int HTS_Engine_get_image_nstream(const char *fn);
+
+/* HTS_Engine_load_image_from_fn: load every model from a voice image written by HTS_Engine_save_image */
+HTS_Boolean HTS_Engine_load_image_from_fn(HTS_Engine * engine, const char *fn);
+
+/* HTS_Engine_save_image: write the loaded models as a voice image */
+HTS_Boolean HTS_Engine_save_image(HTS_Engine * engine, HTS_File * fp);
+
 /* HTS_Engine_set_sampling_rate: set sampling rate */
 void HTS_Engine_set_sampling_rate(HTS_Engine * engine, int i);
 
@@ -697,9 +870,24 @@ void HTS_Engine_set_gv_interpolation_weight(HTS_Engine * engine, int stream_inde
 /* HTS_Engine_set_gv_weight: set GV weight */
 void HTS_Engine_set_gv_weight(HTS_Engine * engine, int stream_index, double f);
 
-/* HTS_Engine_set_stop_flag: set stop flag */
+/* HTS_Engine_set_vocoder_seed: set seed of the vocoder noise (same seed, same output) */
+void HTS_Engine_set_vocoder_seed(HTS_Engine * engine, unsigned long seed);
+
+/* HTS_Engine_set_mlpg_lookahead: generate the parameters in blocks solved lookahead frames ahead, as the vocoder needs them (0: whole utterance) */
+void HTS_Engine_set_mlpg_lookahead(HTS_Engine * engine, int lookahead);
+
+/* HTS_Engine_set_mlpg_threads: generate the streams and dimensions of the parameters with nthread threads, the caller and nthread - 1 from the shared pool (<= 1: sequential) */
+void HTS_Engine_set_mlpg_threads(HTS_Engine * engine, int nthread);
+
+/* HTS_Engine_set_vocoder_output: deliver the speech to out every frames frames instead of into gspeech (out=NULL: back to whole utterances) */
+void HTS_Engine_set_vocoder_output(HTS_Engine * engine, int frames, HTS_AhoCoderOutput out, void *user);
+
+/* HTS_Engine_set_stop_flag: set stop flag (safe from another thread: the running synthesis stops early) */
 void HTS_Engine_set_stop_flag(HTS_Engine * engine, HTS_Boolean b);
 
+/* HTS_Engine_get_stop_flag: get stop flag */
+HTS_Boolean HTS_Engine_get_stop_flag(HTS_Engine * engine);
+
 /* HTS_Engine_set_volume: set volume */
 void HTS_Engine_set_volume(HTS_Engine * engine, double f);
 
@@ -760,6 +948,9 @@ void HTS_Engine_save_riff(HTS_Engine * engine, HTS_File * wavfp);
 /* HTS_Engine_refresh: free memory per one time synthesis */
 void HTS_Engine_refresh(HTS_Engine * engine);
 
+/* HTS_Engine_get_alloc_stats: get buffers, heap allocations and bytes taken by the stream sets of the last refreshed utterance */
+void HTS_Engine_get_alloc_stats(HTS_Engine * engine, int *nalloc, int *nheap, size_t * bytes);
+
 /* HTS_Engine_clear: free engine */
 void HTS_Engine_clear(HTS_Engine * engine);
 
@@ -822,8 +1013,19 @@ void HTS_Vocoder_clear(HTS_Vocoder * v);
 // número de muestras de la waveform, dado el frame shift y el número de frames
 unsigned int get_ahocoder_waveform_length(unsigned int Lframe,unsigned int Nframes);
 
+// contexto del vocoder: semilla propia del ruido y buffers que se reutilizan entre frases
+void HTS_AhoCoder_initialize(HTS_AhoCoder *v);
+void HTS_AhoCoder_set_seed(HTS_AhoCoder *v,unsigned long seed);
+void HTS_AhoCoder_clear(HTS_AhoCoder *v);
+
+// modo incremental: la señal sale por out cada frames tramas, con solo una ventana de frames+1 tramas en memoria
+void HTS_AhoCoder_set_output(HTS_AhoCoder *v,unsigned int frames,HTS_AhoCoderOutput out,void *user);
+
+// parametros en streaming: antes de cada trama que aun no esta lista se pide a feed
+void HTS_AhoCoder_set_feed(HTS_AhoCoder *v,HTS_AhoCoderFeed feed,void *user);
+
 // generación de la waveform a partir de los parámetros f0, MFCC y opcionalmente fvoicing
-int gen_ahocoder_waveform(short *s,unsigned int Ls,unsigned int sr,unsigned int Lframe,unsigned int Nframes,double **lf0s,double **fv,unsigned int ord,double alfa,double **CC);
+int gen_ahocoder_waveform(HTS_AhoCoder *v,short *s,unsigned int Ls,unsigned int sr,unsigned int Lframe,unsigned int Nframes,double **lf0s,double **fv,unsigned int ord,double alfa,double **CC,volatile HTS_Boolean *stop);
 
 
 HTS_ENGINE_H_END;
@@ -68,12 +68,60 @@ void HTS_GStreamSet_initialize(HTS_GStreamSet * gss)
    gss->gspeech = NULL;
 }
 
-/* HTS_GStreamSet_create: generate speech */
-/* (stream[0] == spectrum && stream[1] == lf0) */
-HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, int stage, HTS_Boolean use_log_gain, int sampling_rate, int fperiod, double alpha, double beta, HTS_Boolean * stop, double volume, HTS_Audio * audio)
+/* HTS_GStreamSet_copy: copy the generated parameters of frames from..to-1 */
+static void HTS_GStreamSet_copy(HTS_GStreamSet * gss, HTS_PStreamSet * pss, int from, int to)
 {
    int i, j, k;
    int msd_frame;
+
+   for (i = 0; i < gss->nstream; i++) {
+      if (HTS_PStreamSet_is_msd(pss, i)) {      /* for MSD */
+         for (j = 0, msd_frame = 0; j < from; j++)
+            if (HTS_PStreamSet_get_msd_flag(pss, i, j))
+               msd_frame++;
+         for (j = from; j < to; j++)
+            if (HTS_PStreamSet_get_msd_flag(pss, i, j)) {
+               for (k = 0; k < gss->gstream[i].static_length; k++)
+                  gss->gstream[i].par[j][k] = HTS_PStreamSet_get_parameter(pss, i, msd_frame, k);
+               msd_frame++;
+            } else
+               for (k = 0; k < gss->gstream[i].static_length; k++)
+                  gss->gstream[i].par[j][k] = LZERO;
+      } else {                  /* for non MSD */
+         for (j = from; j < to; j++)
+            for (k = 0; k < gss->gstream[i].static_length; k++)
+               gss->gstream[i].par[j][k] = HTS_PStreamSet_get_parameter(pss, i, j, k);
+      }
+   }
+}
+
+/* HTS_GStreamFeed: streaming parameters handed to the vocoder as it needs them */
+typedef struct _HTS_GStreamFeed {
+   HTS_GStreamSet *gss;
+   HTS_PStreamSet *pss;
+   volatile HTS_Boolean *stop;
+   int ready;                   /* frames already copied */
+} HTS_GStreamFeed;
+
+/* HTS_GStreamSet_feed: generate the block of parameters that starts at frame and copy it */
+static unsigned int HTS_GStreamSet_feed(void *user, unsigned int frame)
+{
+   HTS_GStreamFeed *feed = (HTS_GStreamFeed *) user;
+   int ready = HTS_PStreamSet_generate(feed->pss, (int) frame + feed->pss->lookahead, feed->stop);
+
+   if (ready > feed->ready) {
+      HTS_GStreamSet_copy(feed->gss, feed->pss, feed->ready, ready);
+      feed->ready = ready;
+   }
+   return (unsigned int) feed->ready;
+}
+
+/* HTS_GStreamSet_create: generate speech */
+/* (stream[0] == spectrum && stream[1] == lf0) */
+HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, int stage, HTS_Boolean use_log_gain, int sampling_rate, int fperiod, double alpha, double beta, HTS_Arena * arena, volatile HTS_Boolean * stop, double volume, HTS_Audio * audio, HTS_AhoCoder * vocoder)
+{
+   int i;
+   HTS_GStreamFeed feed;
    // DERRO: quito el vocoder porque voy a usar el mo propio
    //HTS_Vocoder v;
    int nlpf = 0;
@@ -91,36 +139,21 @@ HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, in
    // DERRO: reemplazo el nmero de muestras por el que calculo yo con mi funcion de ahocoder
    //gss->total_nsample = fperiod * gss->total_frame;
    gss->total_nsample = (int)get_ahocoder_waveform_length((unsigned int)fperiod, (unsigned int)gss->total_frame);
-   gss->gstream = (HTS_GStream *) HTS_calloc(gss->nstream, sizeof(HTS_GStream));
+   gss->gstream = (HTS_GStream *) HTS_Arena_alloc(arena, gss->nstream, sizeof(HTS_GStream));
    for (i = 0; i < gss->nstream; i++) {
       gss->gstream[i].static_length = HTS_PStreamSet_get_static_length(pss, i);
-      gss->gstream[i].par = (double **) HTS_calloc(gss->total_frame, sizeof(double *));
-      for (j = 0; j < gss->total_frame; j++)
-         gss->gstream[i].par[j] = (double *) HTS_calloc(gss->gstream[i].static_length, sizeof(double));
+      gss->gstream[i].par = HTS_Arena_alloc_matrix(arena, gss->total_frame, gss->gstream[i].static_length);
    }
    // DERRO: debido a la implementacion de ahocoder, voy a reservar a tamao double, que es
    //        el que usa ahocoder al generar, y luego lo sobreescribire con shorts dentro del
    //        propio ahocoder, ahorrando as tener que reservar distintos bloques de memoria
    //gss->gspeech = (short *) HTS_calloc(gss->total_nsample, sizeof(short));
-   gss->gspeech = (short *) HTS_calloc(gss->total_nsample, sizeof(double));
+   //        (en modo incremental las muestras salen por vocoder->out y no hace falta)
+   if (vocoder->out == NULL)
+      gss->gspeech = (short *) HTS_Arena_alloc(arena, gss->total_nsample, sizeof(double));
 
-   /* copy generated parameter */
-   for (i = 0; i < gss->nstream; i++) {
-      if (HTS_PStreamSet_is_msd(pss, i)) {      /* for MSD */
-         for (j = 0, msd_frame = 0; j < gss->total_frame; j++)
-            if (HTS_PStreamSet_get_msd_flag(pss, i, j)) {
-               for (k = 0; k < gss->gstream[i].static_length; k++)
-                  gss->gstream[i].par[j][k] = HTS_PStreamSet_get_parameter(pss, i, msd_frame, k);
-               msd_frame++;
-            } else
-               for (k = 0; k < gss->gstream[i].static_length; k++)
-                  gss->gstream[i].par[j][k] = LZERO;
-      } else {                  /* for non MSD */
-         for (j = 0; j < gss->total_frame; j++)
-            for (k = 0; k < gss->gstream[i].static_length; k++)
-               gss->gstream[i].par[j][k] = HTS_PStreamSet_get_parameter(pss, i, j, k);
-      }
-   }
+   /* copy generated parameter (streaming: the static means until the vocoder asks for each block) */
+   HTS_GStreamSet_copy(gss, pss, 0, gss->total_frame);
 
    /* check */
    if (gss->nstream != 2 && gss->nstream != 3) {
@@ -140,15 +173,22 @@ HTS_Boolean HTS_GStreamSet_create(HTS_GStreamSet * gss, HTS_PStreamSet * pss, in
       return FALSE;
    }*/
 
-   /* synthesize speech waveform */
+   /* synthesize speech waveform (streaming: the vocoder asks for the parameters block by block) */
+   feed.gss = gss;
+   feed.pss = pss;
+   feed.stop = stop;
+   feed.ready = 0;
+   if (pss->lookahead > 0)
+      HTS_AhoCoder_set_feed(vocoder, HTS_GStreamSet_feed, &feed);
    // DERRO: desactivo el vocoder tradicional y lo reemplazo por ahocoder, con o sin excitacin
    if (gss->nstream == 2)
-	   gen_ahocoder_waveform(gss->gspeech, gss->total_nsample, (unsigned int)sampling_rate, (unsigned int)fperiod, (unsigned int)gss->total_frame, gss->gstream[1].par, NULL, (unsigned int)gss->gstream[0].static_length-1, alpha, gss->gstream[0].par);
+	   i = gen_ahocoder_waveform(vocoder, gss->gspeech, gss->total_nsample, (unsigned int)sampling_rate, (unsigned int)fperiod, (unsigned int)gss->total_frame, gss->gstream[1].par, NULL, (unsigned int)gss->gstream[0].static_length-1, alpha, gss->gstream[0].par, stop);
    else
-	   gen_ahocoder_waveform(gss->gspeech, gss->total_nsample, (unsigned int)sampling_rate, (unsigned int)fperiod, (unsigned int)gss->total_frame, gss->gstream[1].par, gss->gstream[2].par, (unsigned int)gss->gstream[0].static_length-1, alpha, gss->gstream[0].par);
+	   i = gen_ahocoder_waveform(vocoder, gss->gspeech, gss->total_nsample, (unsigned int)sampling_rate, (unsigned int)fperiod, (unsigned int)gss->total_frame, gss->gstream[1].par, gss->gstream[2].par, (unsigned int)gss->gstream[0].static_length-1, alpha, gss->gstream[0].par, stop);
 	// if (audio)
       //HTS_Audio_flush(audio);
-	return TRUE;
+	HTS_AhoCoder_set_feed(vocoder, NULL, NULL);
+	return i != 1 && (*stop) == FALSE;   /* 1: vocoder->out asked to stop */
 /*HTS_Vocoder_initialize(&v, gss->gstream[0].static_length - 1, stage, use_log_gain, sampling_rate, fperiod);
    if (gss->nstream >= 3)
       nlpf = (gss->gstream[2].static_length - 1) / 2;
@@ -194,21 +234,9 @@ double HTS_GStreamSet_get_parameter(HTS_GStreamSet * gss, int stream_index, int
    return gss->gstream[stream_index].par[frame_index][vector_index];
 }
 
-/* HTS_GStreamSet_clear: free generated parameter stream set */
+/* HTS_GStreamSet_clear: drop generated parameter stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_GStreamSet_clear(HTS_GStreamSet * gss)
 {
-   int i, j;
-
-   if (gss->gstream) {
-      for (i = 0; i < gss->nstream; i++) {
-         for (j = 0; j < gss->total_frame; j++)
-            HTS_free(gss->gstream[i].par[j]);
-         HTS_free(gss->gstream[i].par);
-      }
-      HTS_free(gss->gstream);
-   }
-   if (gss->gspeech)
-      HTS_free(gss->gspeech);
    HTS_GStreamSet_initialize(gss);
 }
 
@@ -58,6 +58,12 @@ HTS_MISC_C_START;
 #include <stdlib.h>             /* for exit(),calloc(),free() */
 #include <stdarg.h>             /* for va_list */
 #include <string.h>             /* for strcpy(),strlen() */
+#ifndef _WIN32
+#include <fcntl.h>              /* for open() */
+#include <unistd.h>             /* for close() */
+#include <sys/mman.h>           /* for mmap(),munmap() */
+#include <sys/stat.h>           /* for fstat() */
+#endif                          /* !_WIN32 */
 
 /* hts_engine libraries */
 #include "HTS_hidden.h"
@@ -324,6 +330,53 @@ char *HTS_strdup(const char *string)
 #endif                          /* FESTIVAL */
 }
 
+/* HTS_map_file: map a whole file read only, the pages are shared with every other mapping of the file */
+const void *HTS_map_file(const char *name, size_t * size)
+{
+   void *data = NULL;
+#ifdef _WIN32
+   LARGE_INTEGER length;
+   HANDLE map;
+   HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+   if (file == INVALID_HANDLE_VALUE)
+      return NULL;
+   if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && (map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL) {
+      data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+      if (data != NULL)
+         *size = (size_t) length.QuadPart;
+      CloseHandle(map);
+   }
+   CloseHandle(file);
+#else
+   struct stat st;
+   int fd = open(name, O_RDONLY);
+
+   if (fd < 0)
+      return NULL;
+   if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED)
+         data = NULL;
+      else
+         *size = (size_t) st.st_size;
+   }
+   close(fd);
+#endif                          /* _WIN32 */
+
+   return data;
+}
+
+/* HTS_unmap_file: unmap file mapped by HTS_map_file */
+void HTS_unmap_file(const void *data, size_t size)
+{
+#ifdef _WIN32
+   UnmapViewOfFile(data);
+#else
+   munmap((void *) data, size);
+#endif                          /* _WIN32 */
+}
+
 /* HTS_alloc_matrix: allocate double matrix */
 double **HTS_alloc_matrix(const int x, const int y)
 {
@@ -345,6 +398,117 @@ void HTS_free_matrix(double **p, const int x)
    HTS_free(p);
 }
 
+/* HTS_ArenaBlock: block of an arena, its buffers follow the header */
+typedef struct _HTS_ArenaBlock {
+   struct _HTS_ArenaBlock *next;        /* block allocated before */
+   size_t size;                 /* bytes for buffers */
+   size_t used;                 /* bytes handed out */
+} HTS_ArenaBlock;
+
+/* header of a block, rounded up to keep the buffers aligned */
+#define HTS_ARENA_HEADER ((sizeof(HTS_ArenaBlock) + HTS_ARENA_ALIGN - 1) / HTS_ARENA_ALIGN * HTS_ARENA_ALIGN)
+
+/* HTS_Arena_initialize: initialize arena */
+void HTS_Arena_initialize(HTS_Arena * arena)
+{
+   arena->block = NULL;
+   arena->reserve = HTS_ARENA_BLOCK;
+   arena->used = 0;
+   arena->nalloc = 0;
+   arena->nheap = 0;
+   arena->nsmall = 0;
+   arena->last_used = 0;
+   arena->last_nalloc = 0;
+   arena->last_nheap = 0;
+}
+
+/* HTS_Arena_free_blocks: give every block back to the heap */
+static void HTS_Arena_free_blocks(HTS_Arena * arena)
+{
+   HTS_ArenaBlock *block, *next;
+
+   for (block = arena->block; block; block = next) {
+      next = block->next;
+      HTS_free(block);
+   }
+   arena->block = NULL;
+}
+
+/* HTS_Arena_alloc: get zeroed buffer from the arena, valid until HTS_Arena_reset */
+void *HTS_Arena_alloc(HTS_Arena * arena, const size_t num, const size_t size)
+{
+   size_t bytes = (num * size + HTS_ARENA_ALIGN - 1) / HTS_ARENA_ALIGN * HTS_ARENA_ALIGN;
+   size_t block_size;
+   HTS_ArenaBlock *block = arena->block;
+   char *p;
+
+   if (block == NULL || block->size - block->used < bytes) {
+      /* new block, twice the last one so that an utterance takes a few */
+      block_size = block ? 2 * block->size : arena->reserve;
+      if (block_size < bytes)
+         block_size = bytes;
+      block = (HTS_ArenaBlock *) HTS_calloc(1, HTS_ARENA_HEADER + block_size);
+      block->next = arena->block;
+      block->size = block_size;
+      block->used = 0;
+      arena->block = block;
+      arena->nheap++;
+   }
+   p = (char *) block + HTS_ARENA_HEADER + block->used;
+   block->used += bytes;
+   arena->used += bytes;
+   arena->nalloc++;
+   memset(p, 0, bytes);
+
+   return p;
+}
+
+/* HTS_Arena_alloc_matrix: get zeroed double matrix from the arena, its rows one after another */
+double **HTS_Arena_alloc_matrix(HTS_Arena * arena, const int x, const int y)
+{
+   int i;
+   double **p = (double **) HTS_Arena_alloc(arena, x, sizeof(double *));
+   double *row = (double *) HTS_Arena_alloc(arena, (size_t) x * y, sizeof(double));
+
+   for (i = 0; i < x; i++)
+      p[i] = row + (size_t) i * y;
+   return p;
+}
+
+/* HTS_Arena_reset: take every buffer back, keeping a single block with room for the utterance just finished */
+void HTS_Arena_reset(HTS_Arena * arena)
+{
+   size_t need = arena->used + arena->used / 4;
+
+   if (need < HTS_ARENA_BLOCK)
+      need = HTS_ARENA_BLOCK;
+   if (arena->block != NULL && arena->block->next == NULL && arena->block->size > 4 * need)
+      arena->nsmall++;
+   else
+      arena->nsmall = 0;
+   if (arena->block != NULL && (arena->block->next != NULL || arena->nsmall >= HTS_ARENA_SHRINK)) {
+      /* several blocks, or a much bigger one for a while: the next utterance starts with one of the right size */
+      HTS_Arena_free_blocks(arena);
+      arena->reserve = need;
+      arena->nsmall = 0;
+   } else if (arena->block != NULL) {
+      arena->block->used = 0;
+   }
+   arena->last_used = arena->used;
+   arena->last_nalloc = arena->nalloc;
+   arena->last_nheap = arena->nheap;
+   arena->used = 0;
+   arena->nalloc = 0;
+   arena->nheap = 0;
+}
+
+/* HTS_Arena_clear: free arena */
+void HTS_Arena_clear(HTS_Arena * arena)
+{
+   HTS_Arena_free_blocks(arena);
+   HTS_Arena_initialize(arena);
+}
+
 HTS_MISC_C_END;
 
 #endif                          /* !HTS_MISC_C */
@@ -55,8 +55,8 @@
 
 HTS_MODEL_C_START;
 
-#include <stdlib.h>             /* for atoi(),abs() */
-#include <string.h>             /* for strlen(),strstr(),strrchr(),strcmp() */
+#include <stdlib.h>             /* for atoi(),abs(),qsort() */
+#include <string.h>             /* for strlen(),strstr(),strrchr(),strcmp(),memcmp() */
 #include <ctype.h>              /* for isdigit() */
 
 /* hts_engine libraries */
@@ -118,6 +118,67 @@ static HTS_Boolean HTS_pattern_match(const char *string, const char *pattern)
       return HTS_dp_match(string, pattern, 0, (int) (strlen(string) - max));
 }
 
+/* kinds of pattern, by the position of its wildcards */
+#define HTS_PATTERN_GENERIC   0 /* '?' or inner '*': HTS_pattern_match() */
+#define HTS_PATTERN_ANY       1 /* "*" */
+#define HTS_PATTERN_SUBSTRING 2 /* "*text*" */
+#define HTS_PATTERN_PREFIX    3 /* "text*" */
+#define HTS_PATTERN_SUFFIX    4 /* "*text" */
+#define HTS_PATTERN_EXACT     5 /* "text" */
+
+/* HTS_Pattern_compile: classify pattern and keep the text between its leading and trailing '*' */
+static void HTS_Pattern_compile(HTS_Pattern * pattern)
+{
+   int i;
+   const char *string = pattern->string;
+   const int length = strlen(string);
+   const int lead = (length > 0 && string[0] == '*');
+   const int trail = (length > lead && string[length - 1] == '*');
+
+   pattern->text = string + lead;
+   pattern->length = length - lead - trail;
+   pattern->literal = -1;
+   for (i = 0; i < pattern->length; i++)
+      if (pattern->text[i] == '*' || pattern->text[i] == '?') {
+         pattern->type = HTS_PATTERN_GENERIC;
+         return;
+      }
+   if (pattern->length == 0 && (lead || trail))
+      pattern->type = HTS_PATTERN_ANY;
+   else if (lead && trail)
+      pattern->type = HTS_PATTERN_SUBSTRING;
+   else if (lead)
+      pattern->type = HTS_PATTERN_SUFFIX;
+   else if (trail)
+      pattern->type = HTS_PATTERN_PREFIX;
+   else
+      pattern->type = HTS_PATTERN_EXACT;
+}
+
+/* HTS_Pattern_match: check given label match given pattern, without scanning the label for compiled patterns */
+static HTS_Boolean HTS_Pattern_match(const HTS_Pattern * pattern, const HTS_LabelMatch * label)
+{
+   if (label->found == NULL)
+      return HTS_pattern_match(label->string, pattern->string);
+
+   switch (pattern->type) {
+   case HTS_PATTERN_ANY:
+      return TRUE;
+   case HTS_PATTERN_SUBSTRING:
+      if (pattern->literal >= 0)
+         return (label->found[pattern->literal >> 3] >> (pattern->literal & 7)) & 1;
+      break;
+   case HTS_PATTERN_PREFIX:
+      return label->length >= pattern->length && memcmp(label->string, pattern->text, pattern->length) == 0;
+   case HTS_PATTERN_SUFFIX:
+      return label->length >= pattern->length && memcmp(label->string + label->length - pattern->length, pattern->text, pattern->length) == 0;
+   case HTS_PATTERN_EXACT:
+      return label->length == pattern->length && memcmp(label->string, pattern->text, pattern->length) == 0;
+   }
+
+   return HTS_pattern_match(label->string, pattern->string);
+}
+
 /* HTS_is_num: check given buffer is number or not */
 static HTS_Boolean HTS_is_num(const char *buff)
 {
@@ -172,6 +233,7 @@ static HTS_Boolean HTS_Question_load(HTS_Question * question, HTS_File * fp)
       return FALSE;
    question->string = HTS_strdup(buff);
    question->head = NULL;
+   question->index = -1;
    /* get pattern list */
    if (HTS_get_pattern_token(fp, buff) == FALSE) {
       free(question->string);
@@ -192,6 +254,7 @@ static HTS_Boolean HTS_Question_load(HTS_Question * question, HTS_File * fp)
             question->head = pattern;
          pattern->string = HTS_strdup(buff);
          pattern->next = NULL;
+         HTS_Pattern_compile(pattern);
          if (HTS_get_pattern_token(fp, buff) == FALSE) {
             HTS_Question_clear(question);
             return FALSE;
@@ -204,28 +267,62 @@ static HTS_Boolean HTS_Question_load(HTS_Question * question, HTS_File * fp)
    return TRUE;
 }
 
-/* HTS_Question_match: check given string match given question */
-static HTS_Boolean HTS_Question_match(const HTS_Question * question, const char *string)
+/* HTS_Question_match: check given label match given question, answering each question of the model set once per label */
+static HTS_Boolean HTS_Question_match(const HTS_Question * question, HTS_LabelMatch * label)
 {
    HTS_Pattern *pattern;
+   HTS_Boolean answer = FALSE;
+   const int byte = question->index >> 3;
+   const unsigned char bit = 1 << (question->index & 7);
 
+   if (label->known != NULL && question->index >= 0 && (label->known[byte] & bit)) {
+      label->reused++;
+      return (label->answer[byte] & bit) ? TRUE : FALSE;
+   }
+
+   label->evaluated++;
    for (pattern = question->head; pattern; pattern = pattern->next)
-      if (HTS_pattern_match(string, pattern->string))
-         return TRUE;
+      if (HTS_Pattern_match(pattern, label)) {
+         answer = TRUE;
+         break;
+      }
+   if (label->known != NULL && question->index >= 0) {
+      label->known[byte] |= bit;
+      if (answer)
+         label->answer[byte] |= bit;
+   }
 
-   return FALSE;
+   return answer;
 }
 
-/* HTS_Question_find_question: find question from question list */
-static HTS_Question *HTS_Question_find_question(HTS_Question * question, const char *buff)
+/* HTS_Question_compare: order questions by name and patterns, for qsort() */
+static int HTS_Question_compare(const void *a, const void *b)
 {
+   int result;
+   const HTS_Question *qa = *(const HTS_Question * const *) a;
+   const HTS_Question *qb = *(const HTS_Question * const *) b;
+   const HTS_Pattern *pa, *pb;
+
+   if ((result = strcmp(qa->string, qb->string)) != 0)
+      return result;
+   for (pa = qa->head, pb = qb->head; pa && pb; pa = pa->next, pb = pb->next)
+      if ((result = strcmp(pa->string, pb->string)) != 0)
+         return result;
+
+   return (pa != NULL) - (pb != NULL);
+}
+
+/* HTS_Question_find_question: find question from question table */
+static int HTS_Question_find_question(HTS_Model * model, const char *buff)
+{
+   int i;
 
-   for (; question; question = question->next)
-      if (strcmp(buff, question->string) == 0)
-         return question;
+   for (i = 0; i < model->nquestion; i++)
+      if (strcmp(buff, model->question[i].string) == 0)
+         return i;
 
    HTS_error(1, "HTS_Question_find_question: Cannot find question %s.\n", buff);
-   return NULL;                 /* make compiler happy */
+   return -1;                   /* make compiler happy */
 }
 
 /* HTS_Question_clear: clear loaded question */
@@ -241,27 +338,6 @@ static void HTS_Question_clear(HTS_Question * question)
    }
 }
 
-/* HTS_Node_find: find node for given number */
-static HTS_Node *HTS_Node_find(HTS_Node * node, const int num)
-{
-   for (; node; node = node->next)
-      if (node->index == num)
-         return node;
-
-   HTS_error(1, "HTS_Node_find: Cannot find node %d.\n", num);
-   return NULL;                 /* make compiler happy */
-}
-
-/* HTS_Node_clear: recursive function to free Node */
-static void HTS_Node_clear(HTS_Node * node)
-{
-   if (node->yes != NULL)
-      HTS_Node_clear(node->yes);
-   if (node->no != NULL)
-      HTS_Node_clear(node->no);
-   HTS_free(node);
-}
-
 /* HTS_Tree_parse_pattern: parse pattern specified for each tree */
 static void HTS_Tree_parse_pattern(HTS_Tree * tree, char *string)
 {
@@ -293,101 +369,129 @@ static void HTS_Tree_parse_pattern(HTS_Tree * tree, char *string)
          pattern->string = HTS_strdup(string);
          string = left + 1;
          pattern->next = NULL;
+         HTS_Pattern_compile(pattern);
          last_pattern = pattern;
       }
    }
 }
 
-static void HTS_Tree_clear(HTS_Tree * tree);
+static void HTS_Tree_clear(HTS_Tree * tree, HTS_Boolean mapped);
+
+/* HTS_Tree_find_node: get node number num, making room for it in the node array */
+static HTS_Node *HTS_Tree_find_node(HTS_Tree * tree, const int num, int *size)
+{
+   int i;
+   HTS_Node *node;
+
+   if (num > 0) {
+      HTS_error(1, "HTS_Tree_find_node: Cannot find node %d.\n", num);
+      return NULL;              /* make compiler happy */
+   }
+   if (-num >= *size) {
+      *size = (-num >= 2 * (*size)) ? -num + 1 : 2 * (*size);
+      node = (HTS_Node *) HTS_calloc(*size, sizeof(HTS_Node));
+      if (tree->nnode > 0)
+         memcpy(node, tree->node, tree->nnode * sizeof(HTS_Node));
+      HTS_free(tree->node);
+      tree->node = node;
+   }
+   for (i = tree->nnode; i <= -num; i++)
+      tree->node[i].quest = -1;
+   if (-num >= tree->nnode)
+      tree->nnode = -num + 1;
+
+   return &tree->node[-num];
+}
+
+/* HTS_Tree_load_child: read child of a node, node number (<= 0) or index of PDF (> 0) */
+static HTS_Boolean HTS_Tree_load_child(HTS_Tree * tree, HTS_File * fp, int *child, int *size)
+{
+   char buff[HTS_MAXBUFLEN];
+
+   if (HTS_get_pattern_token(fp, buff) == FALSE)
+      return FALSE;
+   if (HTS_is_num(buff)) {
+      *child = atoi(buff);
+      HTS_Tree_find_node(tree, *child, size);
+   } else {
+      *child = HTS_name2num(buff);
+      if (*child <= 0) {
+         HTS_error(1, "HTS_Tree_load_child: Cannot find PDF %s.\n", buff);
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
 
 /* HTS_Tree_load: Load trees */
-static HTS_Boolean HTS_Tree_load(HTS_Tree * tree, HTS_File * fp, HTS_Question * question)
+static HTS_Boolean HTS_Tree_load(HTS_Tree * tree, HTS_File * fp, HTS_Model * model)
 {
    char buff[HTS_MAXBUFLEN];
-   HTS_Node *node, *last_node;
+   HTS_Node *node;
+   int i, quest, yes, no, size = 0;
 
    if (tree == NULL || fp == NULL)
       return FALSE;
 
+   tree->node = NULL;
+   tree->nnode = 0;
+   tree->pdf = 0;
    if (HTS_get_pattern_token(fp, buff) == FALSE) {
-      HTS_Tree_clear(tree);
+      HTS_Tree_clear(tree, FALSE);
       return FALSE;
    }
-   node = (HTS_Node *) HTS_calloc(1, sizeof(HTS_Node));
-   node->index = 0;
-   tree->root = last_node = node;
 
    if (strcmp(buff, "{") == 0) {
+      HTS_Tree_find_node(tree, 0, &size);
       while (HTS_get_pattern_token(fp, buff) == TRUE && strcmp(buff, "}") != 0) {
-         node = HTS_Node_find(last_node, atoi(buff));
-         if (node == NULL) {
-            HTS_Tree_clear(tree);
+         i = atoi(buff);
+         if (i > 0 || -i >= tree->nnode) {
+            HTS_error(1, "HTS_Tree_load: Cannot find node %d.\n", i);
+            HTS_Tree_clear(tree, FALSE);
             return FALSE;
          }
          if (HTS_get_pattern_token(fp, buff) == FALSE) {
-            HTS_Tree_clear(tree);
+            HTS_Tree_clear(tree, FALSE);
             return FALSE;
          }
-         node->quest = HTS_Question_find_question(question, buff);
-         if (node->quest == NULL) {
-            HTS_Tree_clear(tree);
+         /* children may move the node array */
+         quest = HTS_Question_find_question(model, buff);
+         if (quest < 0 || HTS_Tree_load_child(tree, fp, &no, &size) == FALSE || HTS_Tree_load_child(tree, fp, &yes, &size) == FALSE) {
+            HTS_Tree_clear(tree, FALSE);
             return FALSE;
          }
-         node->yes = (HTS_Node *) HTS_calloc(1, sizeof(HTS_Node));
-         node->no = (HTS_Node *) HTS_calloc(1, sizeof(HTS_Node));
-
-         if (HTS_get_pattern_token(fp, buff) == FALSE) {
-            node->quest = NULL;
-            free(node->yes);
-            free(node->no);
-            HTS_Tree_clear(tree);
-            return FALSE;
-         }
-         if (HTS_is_num(buff))
-            node->no->index = atoi(buff);
-         else
-            node->no->pdf = HTS_name2num(buff);
-         node->no->next = last_node;
-         last_node = node->no;
-
-         if (HTS_get_pattern_token(fp, buff) == FALSE) {
-            node->quest = NULL;
-            free(node->yes);
-            free(node->no);
-            HTS_Tree_clear(tree);
+         node = &tree->node[-i];
+         node->quest = quest;
+         node->yes = yes;
+         node->no = no;
+      }
+      for (i = 0, node = tree->node; i < tree->nnode; i++, node++)
+         if (node->quest < 0) {
+            HTS_error(1, "HTS_Tree_load: Node %d is not defined.\n", -i);
+            HTS_Tree_clear(tree, FALSE);
             return FALSE;
          }
-         if (HTS_is_num(buff))
-            node->yes->index = atoi(buff);
-         else
-            node->yes->pdf = HTS_name2num(buff);
-         node->yes->next = last_node;
-         last_node = node->yes;
-      }
    } else {
-      node->pdf = HTS_name2num(buff);
+      tree->pdf = HTS_name2num(buff);
    }
 
    return TRUE;
 }
 
 /* HTS_Node_search: tree search */
-static int HTS_Tree_search_node(HTS_Tree * tree, const char *string)
+static int HTS_Tree_search_node(HTS_Model * model, HTS_Tree * tree, HTS_LabelMatch * label)
 {
-   HTS_Node *node = tree->root;
+   int i, next;
+   const HTS_Node *node = tree->node;
 
-   while (node != NULL) {
-      if (node->quest == NULL)
-         return node->pdf;
-      if (HTS_Question_match(node->quest, string)) {
-         if (node->yes->pdf > 0)
-            return node->yes->pdf;
-         node = node->yes;
-      } else {
-         if (node->no->pdf > 0)
-            return node->no->pdf;
-         node = node->no;
-      }
+   if (node == NULL)
+      return tree->pdf;
+   for (i = 0; i < tree->nnode; i++) {
+      next = HTS_Question_match(&model->question[node->quest], label) ? node->yes : node->no;
+      if (next > 0)
+         return next;
+      node = &tree->node[-next];
    }
 
    HTS_error(1, "HTS_Tree_search_node: Cannot find node.\n");
@@ -395,7 +499,7 @@ static int HTS_Tree_search_node(HTS_Tree * tree, const char *string)
 }
 
 /* HTS_Tree_clear: clear given tree */
-static void HTS_Tree_clear(HTS_Tree * tree)
+static void HTS_Tree_clear(HTS_Tree * tree, HTS_Boolean mapped)
 {
    HTS_Pattern *pattern, *next_pattern;
 
@@ -405,7 +509,10 @@ static void HTS_Tree_clear(HTS_Tree * tree)
       HTS_free(pattern);
    }
 
-   HTS_Node_clear(tree->root);
+   if (tree->node != NULL && !mapped)
+      HTS_free(tree->node);
+   tree->node = NULL;
+   tree->nnode = 0;
 }
 
 /* HTS_Window_initialize: initialize dynamic window */
@@ -511,6 +618,8 @@ static void HTS_Model_initialize(HTS_Model * model)
    model->pdf = NULL;
    model->tree = NULL;
    model->question = NULL;
+   model->nquestion = 0;
+   model->mapped = FALSE;
 }
 
 static void HTS_Model_clear(HTS_Model * model);
@@ -520,7 +629,8 @@ static HTS_Boolean HTS_Model_load_pdf(HTS_Model * model, HTS_File * fp, int ntre
 {
    int i, j, k, l, m;
    float temp;
-   int ssize;
+   int ssize, width;
+   double *table;
    HTS_Boolean result = TRUE;
 
    /* check */
@@ -571,13 +681,19 @@ static HTS_Boolean HTS_Model_load_pdf(HTS_Model * model, HTS_File * fp, int ntre
    }
    model->pdf = (double ***) HTS_calloc(ntree, sizeof(double **));
    model->pdf -= 2;
+   /* PDFs of each tree in one table */
+   width = msd_flag ? 2 * model->vector_length + 1 : 2 * model->vector_length;
+   for (j = 2; j <= ntree + 1; j++) {
+      model->pdf[j] = (double **) HTS_calloc(model->npdf[j], sizeof(double *));
+      model->pdf[j]--;
+      table = (double *) HTS_calloc((size_t) model->npdf[j] * width, sizeof(double));
+      for (k = 1; k <= model->npdf[j]; k++)
+         model->pdf[j][k] = table + (size_t) (k - 1) * width;
+   }
    /* read means and variances */
    if (msd_flag) {              /* for MSD */
       for (j = 2; j <= ntree + 1; j++) {
-         model->pdf[j] = (double **) HTS_calloc(model->npdf[j], sizeof(double *));
-         model->pdf[j]--;
          for (k = 1; k <= model->npdf[j]; k++) {
-            model->pdf[j][k] = (double *) HTS_calloc(2 * model->vector_length + 1, sizeof(double));
             for (l = 0; l < ssize; l++) {
                for (m = 0; m < model->vector_length / ssize; m++) {
                   if (HTS_fread_big_endian(&temp, sizeof(float), 1, fp) != 1)
@@ -603,10 +719,7 @@ static HTS_Boolean HTS_Model_load_pdf(HTS_Model * model, HTS_File * fp, int ntre
       }
    } else {                     /* for non MSD */
       for (j = 2; j <= ntree + 1; j++) {
-         model->pdf[j] = (double **) HTS_calloc(model->npdf[j], sizeof(double *));
-         model->pdf[j]--;
          for (k = 1; k <= model->npdf[j]; k++) {
-            model->pdf[j][k] = (double *) HTS_calloc(2 * model->vector_length, sizeof(double));
             for (l = 0; l < model->vector_length; l++) {
                if (HTS_fread_big_endian(&temp, sizeof(float), 1, fp) != 1)
                   result = FALSE;
@@ -629,9 +742,9 @@ static HTS_Boolean HTS_Model_load_pdf(HTS_Model * model, HTS_File * fp, int ntre
 static HTS_Boolean HTS_Model_load_tree(HTS_Model * model, HTS_File * fp)
 {
    char buff[HTS_MAXBUFLEN];
-   HTS_Question *question, *last_question;
+   HTS_Question *question;
    HTS_Tree *tree, *last_tree;
-   int state;
+   int state, size = 0;
 
    /* check */
    if (model == NULL || fp == NULL) {
@@ -640,35 +753,35 @@ static HTS_Boolean HTS_Model_load_tree(HTS_Model * model, HTS_File * fp)
    }
 
    model->ntree = 0;
-   last_question = NULL;
    last_tree = NULL;
    while (!HTS_feof(fp)) {
       HTS_get_pattern_token(fp, buff);
       /* parse questions */
       if (strcmp(buff, "QS") == 0) {
-         question = (HTS_Question *) HTS_calloc(1, sizeof(HTS_Question));
-         if (HTS_Question_load(question, fp) == FALSE) {
-            free(question);
+         if (model->nquestion == size) {
+            size = size > 0 ? 2 * size : 256;
+            question = (HTS_Question *) HTS_calloc(size, sizeof(HTS_Question));
+            if (model->nquestion > 0)
+               memcpy(question, model->question, model->nquestion * sizeof(HTS_Question));
+            HTS_free(model->question);
+            model->question = question;
+         }
+         if (HTS_Question_load(&model->question[model->nquestion], fp) == FALSE) {
             HTS_Model_clear(model);
             return FALSE;
          }
-         if (model->question)
-            last_question->next = question;
-         else
-            model->question = question;
-         question->next = NULL;
-         last_question = question;
+         model->nquestion++;
       }
       /* parse trees */
       state = HTS_get_state_num(buff);
       if (state != 0) {
          tree = (HTS_Tree *) HTS_calloc(1, sizeof(HTS_Tree));
          tree->next = NULL;
-         tree->root = NULL;
+         tree->node = NULL;
          tree->head = NULL;
          tree->state = state;
          HTS_Tree_parse_pattern(tree, buff);
-         if (HTS_Tree_load(tree, fp, model->question) == FALSE) {
+         if (HTS_Tree_load(tree, fp, model) == FALSE) {
             free(tree);
             HTS_Model_clear(model);
             return FALSE;
@@ -693,32 +806,31 @@ static HTS_Boolean HTS_Model_load_tree(HTS_Model * model, HTS_File * fp)
 /* HTS_Model_clear: free pdfs and trees */
 static void HTS_Model_clear(HTS_Model * model)
 {
-   int i, j;
-   HTS_Question *question, *next_question;
+   int i;
    HTS_Tree *tree, *next_tree;
 
-   for (question = model->question; question; question = next_question) {
-      next_question = question->next;
-      HTS_Question_clear(question);
-      HTS_free(question);
-   }
+   for (i = 0; i < model->nquestion; i++)
+      HTS_Question_clear(&model->question[i]);
+   if (model->question)
+      HTS_free(model->question);
    for (tree = model->tree; tree; tree = next_tree) {
       next_tree = tree->next;
-      HTS_Tree_clear(tree);
+      HTS_Tree_clear(tree, model->mapped);
       HTS_free(tree);
    }
    if (model->pdf) {
       for (i = 2; i <= model->ntree + 1; i++) {
-         for (j = 1; j <= model->npdf[i]; j++) {
-            HTS_free(model->pdf[i][j]);
-         }
+         if (model->pdf[i] == NULL)
+            continue;
+         if (!model->mapped)
+            HTS_free(model->pdf[i][1]);
          model->pdf[i]++;
          HTS_free(model->pdf[i]);
       }
       model->pdf += 2;
       HTS_free(model->pdf);
    }
-   if (model->npdf) {
+   if (model->npdf && !model->mapped) {
       model->npdf += 2;
       HTS_free(model->npdf);
    }
@@ -838,6 +950,636 @@ static void HTS_Stream_clear(HTS_Stream * stream)
    HTS_Stream_initialize(stream);
 }
 
+/* HTS_ImageWriter: voice image being written */
+typedef struct _HTS_ImageWriter {
+   HTS_File *fp;                /* output file */
+   size_t size;                 /* bytes written */
+   HTS_Boolean error;           /* a write failed */
+} HTS_ImageWriter;
+
+/* HTS_ImageWriter_put: write bytes */
+static void HTS_ImageWriter_put(HTS_ImageWriter * w, const void *buf, size_t size)
+{
+   if (size > 0 && HTS_fwrite(buf, 1, size, w->fp) != size)
+      w->error = TRUE;
+   w->size += size;
+}
+
+/* HTS_ImageWriter_put_int: write int */
+static void HTS_ImageWriter_put_int(HTS_ImageWriter * w, int i)
+{
+   HTS_ImageWriter_put(w, &i, sizeof(int));
+}
+
+/* HTS_ImageWriter_put_array: write array aligned to HTS_IMAGE_ALIGN bytes, so it can be used in place */
+static void HTS_ImageWriter_put_array(HTS_ImageWriter * w, const void *buf, size_t num, size_t size)
+{
+   static const char zero[HTS_IMAGE_ALIGN] = { 0 };
+
+   HTS_ImageWriter_put(w, zero, (HTS_IMAGE_ALIGN - w->size % HTS_IMAGE_ALIGN) % HTS_IMAGE_ALIGN);
+   HTS_ImageWriter_put(w, buf, num * size);
+}
+
+/* HTS_ImageWriter_put_string: write length and string with its '\0' */
+static void HTS_ImageWriter_put_string(HTS_ImageWriter * w, const char *string)
+{
+   int length = strlen(string);
+
+   HTS_ImageWriter_put_int(w, length);
+   HTS_ImageWriter_put(w, string, length + 1);
+}
+
+/* HTS_ImageWriter_put_patterns: write pattern list */
+static void HTS_ImageWriter_put_patterns(HTS_ImageWriter * w, const HTS_Pattern * head)
+{
+   int n = 0;
+   const HTS_Pattern *pattern;
+
+   for (pattern = head; pattern; pattern = pattern->next)
+      n++;
+   HTS_ImageWriter_put_int(w, n);
+   for (pattern = head; pattern; pattern = pattern->next)
+      HTS_ImageWriter_put_string(w, pattern->string);
+}
+
+/* HTS_ImageWriter_put_model: write PDF tables, questions and trees of a model */
+static void HTS_ImageWriter_put_model(HTS_ImageWriter * w, const HTS_Model * model, HTS_Boolean msd_flag)
+{
+   int i, n;
+   const int width = msd_flag ? 2 * model->vector_length + 1 : 2 * model->vector_length;
+   const HTS_Tree *tree;
+
+   HTS_ImageWriter_put_int(w, model->vector_length);
+   HTS_ImageWriter_put_int(w, model->ntree);
+   HTS_ImageWriter_put_int(w, model->npdf != NULL);
+   if (model->npdf != NULL) {
+      HTS_ImageWriter_put_array(w, &model->npdf[2], model->ntree, sizeof(int));
+      for (i = 2; i <= model->ntree + 1; i++)
+         HTS_ImageWriter_put_array(w, model->pdf[i][1], (size_t) model->npdf[i] * width, sizeof(double));
+   }
+   HTS_ImageWriter_put_int(w, model->nquestion);
+   for (i = 0; i < model->nquestion; i++) {
+      HTS_ImageWriter_put_string(w, model->question[i].string);
+      HTS_ImageWriter_put_patterns(w, model->question[i].head);
+   }
+   for (n = 0, tree = model->tree; tree; tree = tree->next)
+      n++;
+   HTS_ImageWriter_put_int(w, n);
+   for (tree = model->tree; tree; tree = tree->next) {
+      HTS_ImageWriter_put_int(w, tree->state);
+      HTS_ImageWriter_put_patterns(w, tree->head);
+      HTS_ImageWriter_put_int(w, tree->nnode);
+      HTS_ImageWriter_put_int(w, tree->pdf);
+      HTS_ImageWriter_put_array(w, tree->node, tree->nnode, sizeof(HTS_Node));
+   }
+}
+
+/* HTS_ImageWriter_put_stream: write models and window of a stream */
+static void HTS_ImageWriter_put_stream(HTS_ImageWriter * w, const HTS_Stream * stream)
+{
+   int i;
+   const HTS_Window *win = &stream->window;
+
+   HTS_ImageWriter_put_int(w, stream->model != NULL);
+   if (stream->model == NULL)
+      return;
+   HTS_ImageWriter_put_int(w, stream->vector_length);
+   HTS_ImageWriter_put_int(w, stream->msd_flag);
+   HTS_ImageWriter_put_int(w, stream->interpolation_size);
+   for (i = 0; i < stream->interpolation_size; i++)
+      HTS_ImageWriter_put_model(w, &stream->model[i], stream->msd_flag);
+   HTS_ImageWriter_put_int(w, win->size);
+   for (i = 0; i < win->size; i++) {
+      HTS_ImageWriter_put_int(w, win->l_width[i]);
+      HTS_ImageWriter_put_int(w, win->r_width[i]);
+      HTS_ImageWriter_put_array(w, win->coefficient[i] + win->l_width[i], win->r_width[i] - win->l_width[i] + 1, sizeof(double));
+   }
+}
+
+/* HTS_ImageReader: mapped voice image being read */
+typedef struct _HTS_ImageReader {
+   const char *data;            /* mapped image */
+   size_t size;                 /* bytes of the image */
+   size_t pos;                  /* bytes read */
+   HTS_Boolean error;           /* the image is damaged */
+} HTS_ImageReader;
+
+/* HTS_ImageReader_get: get pointer to the next bytes (NULL: past the end) */
+static const void *HTS_ImageReader_get(HTS_ImageReader * r, size_t size)
+{
+   const void *p;
+
+   if (r->error || size > r->size - r->pos) {
+      r->error = TRUE;
+      return NULL;
+   }
+   p = r->data + r->pos;
+   r->pos += size;
+
+   return p;
+}
+
+/* HTS_ImageReader_get_int: read int (0: past the end) */
+static int HTS_ImageReader_get_int(HTS_ImageReader * r)
+{
+   int i = 0;
+   const void *p = HTS_ImageReader_get(r, sizeof(int));
+
+   if (p != NULL)
+      memcpy(&i, p, sizeof(int));
+
+   return i;
+}
+
+/* HTS_ImageReader_get_array: get array written by HTS_ImageWriter_put_array, in place */
+static const void *HTS_ImageReader_get_array(HTS_ImageReader * r, int num, size_t size)
+{
+   const size_t pos = (r->pos + HTS_IMAGE_ALIGN - 1) / HTS_IMAGE_ALIGN * HTS_IMAGE_ALIGN;
+
+   if (r->error || num < 0 || pos > r->size || (size > 0 && (size_t) num > (r->size - pos) / size)) {
+      r->error = TRUE;
+      return NULL;
+   }
+   r->pos = pos;
+
+   return HTS_ImageReader_get(r, (size_t) num * size);
+}
+
+/* HTS_ImageReader_get_string: read string written by HTS_ImageWriter_put_string (NULL: damaged) */
+static char *HTS_ImageReader_get_string(HTS_ImageReader * r)
+{
+   const int length = HTS_ImageReader_get_int(r);
+   const char *string;
+
+   if (length < 0 || (string = (const char *) HTS_ImageReader_get(r, (size_t) length + 1)) == NULL || string[length] != '\0') {
+      r->error = TRUE;
+      return NULL;
+   }
+
+   return HTS_strdup(string);
+}
+
+/* HTS_ImageReader_get_patterns: read pattern list */
+static HTS_Boolean HTS_ImageReader_get_patterns(HTS_ImageReader * r, HTS_Pattern ** head)
+{
+   int i;
+   const int n = HTS_ImageReader_get_int(r);
+   char *string;
+   HTS_Pattern *pattern, *last_pattern = NULL;
+
+   *head = NULL;
+   for (i = 0; i < n; i++) {
+      if ((string = HTS_ImageReader_get_string(r)) == NULL)
+         return FALSE;
+      pattern = (HTS_Pattern *) HTS_calloc(1, sizeof(HTS_Pattern));
+      if (last_pattern)
+         last_pattern->next = pattern;
+      else
+         *head = pattern;
+      pattern->string = string;
+      pattern->next = NULL;
+      HTS_Pattern_compile(pattern);
+      last_pattern = pattern;
+   }
+
+   return n >= 0 && !r->error;
+}
+
+/* HTS_ImageReader_get_model: read model, its PDF tables and tree nodes stay in the image */
+static HTS_Boolean HTS_ImageReader_get_model(HTS_ImageReader * r, HTS_Model * model, HTS_Boolean msd_flag)
+{
+   int i, j, k, n, width;
+   const int *npdf;
+   const double *table;
+   HTS_Tree *tree, *last_tree = NULL;
+   HTS_Node *node;
+
+   HTS_Model_initialize(model);
+   model->mapped = TRUE;
+   model->vector_length = HTS_ImageReader_get_int(r);
+   model->ntree = HTS_ImageReader_get_int(r);
+   if (model->vector_length < 0 || (size_t) model->vector_length > r->size || model->ntree < 0)
+      return FALSE;
+   width = msd_flag ? 2 * model->vector_length + 1 : 2 * model->vector_length;
+
+   /* PDFs */
+   if (HTS_ImageReader_get_int(r)) {
+      if (model->ntree <= 0 || (npdf = (const int *) HTS_ImageReader_get_array(r, model->ntree, sizeof(int))) == NULL)
+         return FALSE;
+      model->npdf = (int *) npdf - 2;
+      model->pdf = (double ***) HTS_calloc(model->ntree, sizeof(double **));
+      model->pdf -= 2;
+      for (i = 2; i <= model->ntree + 1; i++) {
+         if (model->npdf[i] <= 0 || (table = (const double *) HTS_ImageReader_get_array(r, model->npdf[i], width * sizeof(double))) == NULL)
+            return FALSE;
+         model->pdf[i] = (double **) HTS_calloc(model->npdf[i], sizeof(double *));
+         model->pdf[i]--;
+         for (k = 1; k <= model->npdf[i]; k++)
+            model->pdf[i][k] = (double *) table + (size_t) (k - 1) * width;
+      }
+   }
+
+   /* questions */
+   n = HTS_ImageReader_get_int(r);
+   if (n < 0 || (size_t) n > r->size)
+      return FALSE;
+   model->question = (HTS_Question *) HTS_calloc(n > 0 ? n : 1, sizeof(HTS_Question));
+   for (i = 0; i < n; i++) {
+      if ((model->question[i].string = HTS_ImageReader_get_string(r)) == NULL)
+         return FALSE;
+      model->question[i].index = -1;
+      model->nquestion++;
+      if (HTS_ImageReader_get_patterns(r, &model->question[i].head) == FALSE)
+         return FALSE;
+   }
+
+   /* trees */
+   n = HTS_ImageReader_get_int(r);
+   if (n < 0 || (n > 0 && n != model->ntree))
+      return FALSE;
+   for (i = 0; i < n; i++) {
+      tree = (HTS_Tree *) HTS_calloc(1, sizeof(HTS_Tree));
+      if (last_tree)
+         last_tree->next = tree;
+      else
+         model->tree = tree;
+      last_tree = tree;
+      tree->state = HTS_ImageReader_get_int(r);
+      if (HTS_ImageReader_get_patterns(r, &tree->head) == FALSE)
+         return FALSE;
+      tree->nnode = HTS_ImageReader_get_int(r);
+      tree->pdf = HTS_ImageReader_get_int(r);
+      if ((node = (HTS_Node *) HTS_ImageReader_get_array(r, tree->nnode, sizeof(HTS_Node))) == NULL)
+         return FALSE;
+      tree->node = tree->nnode > 0 ? node : NULL;
+      for (j = 0; j < tree->nnode; j++, node++)
+         if (node->quest < 0 || node->quest >= model->nquestion || -node->yes >= tree->nnode || -node->no >= tree->nnode)
+            return FALSE;
+   }
+
+   return !r->error;
+}
+
+/* HTS_ImageReader_get_stream: read models and window of a stream */
+static HTS_Boolean HTS_ImageReader_get_stream(HTS_ImageReader * r, HTS_Stream * stream)
+{
+   int i, fsize;
+   const double *coefficient;
+   HTS_Window *win = &stream->window;
+
+   HTS_Stream_initialize(stream);
+   if (HTS_ImageReader_get_int(r) == 0)
+      return !r->error;
+   stream->vector_length = HTS_ImageReader_get_int(r);
+   stream->msd_flag = HTS_ImageReader_get_int(r) ? TRUE : FALSE;
+   stream->interpolation_size = HTS_ImageReader_get_int(r);
+   if (stream->interpolation_size <= 0 || (size_t) stream->interpolation_size > r->size) {
+      stream->interpolation_size = 0;
+      return FALSE;
+   }
+   stream->model = (HTS_Model *) HTS_calloc(stream->interpolation_size, sizeof(HTS_Model));
+   for (i = 0; i < stream->interpolation_size; i++)
+      HTS_Model_initialize(&stream->model[i]);
+   for (i = 0; i < stream->interpolation_size; i++)
+      if (HTS_ImageReader_get_model(r, &stream->model[i], stream->msd_flag) == FALSE || stream->model[i].vector_length != stream->vector_length)
+         return FALSE;
+
+   /* window, copied as HTS_Window_load leaves it */
+   fsize = HTS_ImageReader_get_int(r);
+   if (fsize < 0 || (size_t) fsize > r->size)
+      return FALSE;
+   if (fsize == 0)
+      return !r->error;
+   win->l_width = (int *) HTS_calloc(fsize, sizeof(int));
+   win->r_width = (int *) HTS_calloc(fsize, sizeof(int));
+   win->coefficient = (double **) HTS_calloc(fsize, sizeof(double *));
+   for (i = 0; i < fsize; i++) {
+      win->l_width[i] = HTS_ImageReader_get_int(r);
+      win->r_width[i] = HTS_ImageReader_get_int(r);
+      if (win->l_width[i] > 0 || win->r_width[i] < 0 || (coefficient = (const double *) HTS_ImageReader_get_array(r, win->r_width[i] - win->l_width[i] + 1, sizeof(double))) == NULL)
+         return FALSE;
+      win->coefficient[i] = (double *) HTS_calloc(win->r_width[i] - win->l_width[i] + 1, sizeof(double));
+      memcpy(win->coefficient[i], coefficient, (win->r_width[i] - win->l_width[i] + 1) * sizeof(double));
+      win->coefficient[i] -= win->l_width[i];
+      win->size = i + 1;
+      if (win->max_width < -win->l_width[i])
+         win->max_width = -win->l_width[i];
+      if (win->max_width < win->r_width[i])
+         win->max_width = win->r_width[i];
+   }
+
+   return !r->error;
+}
+
+/* HTS_ModelSet_check_image: get number of stream from the header of a voice image (-1: not a voice image of this version and machine) */
+static int HTS_ModelSet_check_image(const char *data, size_t size)
+{
+   int header[6];
+
+   if (size < sizeof(HTS_IMAGE_MAGIC) + sizeof(header) || memcmp(data, HTS_IMAGE_MAGIC, sizeof(HTS_IMAGE_MAGIC)) != 0)
+      return -1;
+   memcpy(header, data + sizeof(HTS_IMAGE_MAGIC), sizeof(header));
+   if (header[0] != HTS_IMAGE_VERSION || header[1] != 0x01020304 || header[2] != (int) sizeof(int) || header[3] != (int) sizeof(double) || header[4] != (int) sizeof(HTS_Node) || header[5] <= 0)
+      return -1;
+
+   return header[5];
+}
+
+/* HTS_Matcher_add_state: append a state without transitions to the automaton */
+static int HTS_Matcher_add_state(HTS_Matcher * matcher)
+{
+   int *next, *literal;
+
+   if (matcher->nstate == matcher->size) {
+      matcher->size = (matcher->size > 0) ? 2 * matcher->size : 256;
+      next = (int *) HTS_calloc(matcher->size * matcher->nclass, sizeof(int));
+      literal = (int *) HTS_calloc(matcher->size, sizeof(int));
+      if (matcher->nstate > 0) {
+         memcpy(next, matcher->next, matcher->nstate * matcher->nclass * sizeof(int));
+         memcpy(literal, matcher->literal, matcher->nstate * sizeof(int));
+         HTS_free(matcher->next);
+         HTS_free(matcher->literal);
+      }
+      matcher->next = next;
+      matcher->literal = literal;
+   }
+   matcher->literal[matcher->nstate] = -1;
+
+   return matcher->nstate++;
+}
+
+/* HTS_Matcher_add_patterns: give a class to the bytes of the substring patterns (pass 0) or add them to the trie (pass 1) */
+static void HTS_Matcher_add_patterns(HTS_Matcher * matcher, HTS_Pattern * pattern, int pass)
+{
+   int i, c, state, next;
+
+   for (; pattern; pattern = pattern->next) {
+      if (pattern->type != HTS_PATTERN_SUBSTRING)
+         continue;
+      if (pass == 0) {
+         for (i = 0; i < pattern->length; i++)
+            if (matcher->byte_class[(unsigned char) pattern->text[i]] == 0)
+               matcher->byte_class[(unsigned char) pattern->text[i]] = matcher->nclass++;
+         continue;
+      }
+      for (i = 0, state = 0; i < pattern->length; i++) {
+         c = matcher->byte_class[(unsigned char) pattern->text[i]];
+         if (matcher->next[state * matcher->nclass + c] == 0) {
+            next = HTS_Matcher_add_state(matcher);      /* may move the transitions */
+            matcher->next[state * matcher->nclass + c] = next;
+         }
+         state = matcher->next[state * matcher->nclass + c];
+      }
+      if (matcher->literal[state] < 0)
+         matcher->literal[state] = matcher->nliteral++;
+      pattern->literal = matcher->literal[state];
+   }
+}
+
+/* HTS_Matcher_add_model: add the patterns of the questions and trees of a model (pass 0 and 1), count its questions (pass 2) or list them (pass 3) */
+static void HTS_Matcher_add_model(HTS_Matcher * matcher, HTS_Model * model, int pass)
+{
+   int i;
+   HTS_Tree *tree;
+
+   for (i = 0; i < model->nquestion; i++)
+      if (pass == 2)
+         matcher->nquestion++;
+      else if (pass == 3)
+         matcher->question[matcher->nquestion++] = &model->question[i];
+      else
+         HTS_Matcher_add_patterns(matcher, model->question[i].head, pass);
+   if (pass < 2)
+      for (tree = model->tree; tree; tree = tree->next)
+         HTS_Matcher_add_patterns(matcher, tree->head, pass);
+}
+
+/* HTS_Matcher_add_stream: add the patterns of the models of a stream */
+static void HTS_Matcher_add_stream(HTS_Matcher * matcher, HTS_Stream * stream, int pass)
+{
+   int i;
+
+   if (stream->model)
+      for (i = 0; i < stream->interpolation_size; i++)
+         HTS_Matcher_add_model(matcher, &stream->model[i], pass);
+}
+
+/* HTS_Matcher_add_model_set: add the patterns of every model of a model set */
+static void HTS_Matcher_add_model_set(HTS_Matcher * matcher, HTS_ModelSet * ms, int pass)
+{
+   int i;
+
+   HTS_Matcher_add_stream(matcher, &ms->duration, pass);
+   for (i = 0; ms->stream && i < ms->nstream; i++)
+      HTS_Matcher_add_stream(matcher, &ms->stream[i], pass);
+   for (i = 0; ms->gv && i < ms->nstream; i++)
+      HTS_Matcher_add_stream(matcher, &ms->gv[i], pass);
+   HTS_Matcher_add_model(matcher, &ms->gv_switch, pass);
+}
+
+/* HTS_Matcher_clear: free automaton */
+static void HTS_Matcher_clear(HTS_Matcher * matcher)
+{
+   HTS_free(matcher->next);
+   HTS_free(matcher->literal);
+   HTS_free(matcher->suffix);
+   HTS_free(matcher->question);
+   HTS_free(matcher);
+}
+
+/* HTS_LabelCacheEntry: tree and pdf indices of a label */
+typedef struct _HTS_LabelCacheEntry {
+   struct _HTS_LabelCacheEntry *chain;  /* next entry in the same bucket */
+   struct _HTS_LabelCacheEntry *newer;  /* next entry in the LRU list */
+   struct _HTS_LabelCacheEntry *older;  /* previous entry in the LRU list */
+   unsigned long hash;          /* hash of string */
+   size_t size;                 /* bytes taken by the entry */
+   int *index;                  /* tree and pdf indices (nindex) */
+   char *string;                /* label string */
+} HTS_LabelCacheEntry;
+
+/* HTS_LabelCache: LRU cache of labels, shared by the engines using a model set */
+struct _HTS_LabelCache {
+   HTS_Mutex mutex;             /* protects everything below */
+   size_t max_bytes;            /* memory cap */
+   size_t bytes;                /* bytes taken by the entries */
+   int nentry;                  /* # of entries */
+   int nbucket;                 /* # of hash buckets (power of two) */
+   HTS_LabelCacheEntry **bucket;        /* hash buckets */
+   HTS_LabelCacheEntry *newest; /* most recently used entry */
+   HTS_LabelCacheEntry *oldest; /* least recently used entry, evicted first */
+   int nindex;                  /* # of indices of each label */
+   int *stream_offset;          /* first index of each stream */
+   int gv_switch_offset;        /* index of the GV switch */
+   unsigned long hits;          /* labels found */
+   unsigned long misses;        /* labels not found */
+   unsigned long evictions;     /* entries evicted by the memory cap */
+};
+
+/* HTS_LabelCache_hash: hash of a label string */
+static unsigned long HTS_LabelCache_hash(const char *string)
+{
+   unsigned long hash = 5381;
+
+   while (*string != '\0')
+      hash = hash * 33 + (unsigned char) *string++;
+
+   return hash;
+}
+
+/* HTS_LabelCache_unlink: take entry out of its bucket and of the LRU list */
+static void HTS_LabelCache_unlink(HTS_LabelCache * cache, HTS_LabelCacheEntry * entry)
+{
+   HTS_LabelCacheEntry **p;
+
+   for (p = &cache->bucket[entry->hash & (cache->nbucket - 1)]; *p != entry; p = &(*p)->chain);
+   *p = entry->chain;
+   if (entry->newer)
+      entry->newer->older = entry->older;
+   else
+      cache->newest = entry->older;
+   if (entry->older)
+      entry->older->newer = entry->newer;
+   else
+      cache->oldest = entry->newer;
+   cache->bytes -= entry->size;
+   cache->nentry--;
+}
+
+/* HTS_LabelCache_drop: free every entry (the mutex must be locked) */
+static void HTS_LabelCache_drop(HTS_LabelCache * cache)
+{
+   HTS_LabelCacheEntry *entry, *older;
+
+   for (entry = cache->newest; entry; entry = older) {
+      older = entry->older;
+      HTS_free(entry);
+   }
+   memset(cache->bucket, 0, cache->nbucket * sizeof(HTS_LabelCacheEntry *));
+   cache->newest = cache->oldest = NULL;
+   cache->bytes = 0;
+   cache->nentry = 0;
+}
+
+/* HTS_LabelCache_layout: place the indices of every lookup of a label: duration, each stream and state, and GV switch */
+static void HTS_LabelCache_layout(HTS_LabelCache * cache, HTS_ModelSet * ms)
+{
+   int i, n;
+
+   HTS_free(cache->stream_offset);
+   cache->stream_offset = (int *) HTS_calloc(ms->nstream > 0 ? ms->nstream : 1, sizeof(int));
+   n = 2 * ms->duration.interpolation_size;
+   for (i = 0; i < ms->nstream; i++) {
+      cache->stream_offset[i] = n;
+      if (ms->stream && ms->nstate > 0)
+         n += 2 * ms->nstate * ms->stream[i].interpolation_size;
+   }
+   cache->gv_switch_offset = n;
+   if (ms->gv_switch.tree != NULL)
+      n += 2;
+   cache->nindex = n;
+}
+
+/* HTS_LabelCache_clear: free cache */
+static void HTS_LabelCache_clear(HTS_LabelCache * cache)
+{
+   HTS_LabelCache_drop(cache);
+   HTS_mutex_destroy(&cache->mutex);
+   HTS_free(cache->bucket);
+   HTS_free(cache->stream_offset);
+   HTS_free(cache);
+}
+
+/* HTS_LabelMatch_get_cached: get tree and pdf indices of a lookup, if the label was found in the cache */
+static HTS_Boolean HTS_LabelMatch_get_cached(const HTS_LabelMatch * label, int offset, int *tree_index, int *pdf_index)
+{
+   if (label->index == NULL || label->cached == FALSE)
+      return FALSE;
+   *tree_index = label->index[offset];
+   *pdf_index = label->index[offset + 1];
+   return TRUE;
+}
+
+/* HTS_LabelMatch_set_cached: keep tree and pdf indices of a lookup for the cache */
+static void HTS_LabelMatch_set_cached(HTS_LabelMatch * label, int offset, int tree_index, int pdf_index)
+{
+   if (label->index == NULL || label->cached == TRUE)
+      return;
+   label->index[offset] = tree_index;
+   label->index[offset + 1] = pdf_index;
+}
+
+/* HTS_ModelSet_compile: build the Aho-Corasick automaton of the substring patterns of the model set and index its questions */
+static void HTS_ModelSet_compile(HTS_ModelSet * ms)
+{
+   int i, c, state, next, head, tail, n;
+   int *fail, *queue;
+   HTS_Matcher *matcher;
+   HTS_Question *question, *last;
+
+   if (ms->matcher != NULL)
+      HTS_Matcher_clear(ms->matcher);
+   matcher = ms->matcher = (HTS_Matcher *) HTS_calloc(1, sizeof(HTS_Matcher));
+
+   /* byte classes, class 0 for the bytes in no pattern */
+   matcher->nclass = 1;
+   HTS_Matcher_add_model_set(matcher, ms, 0);
+
+   /* trie */
+   HTS_Matcher_add_state(matcher);
+   HTS_Matcher_add_model_set(matcher, ms, 1);
+
+   /* failure links in breadth-first order, completing the transitions of each state with those of its failure state */
+   fail = (int *) HTS_calloc(matcher->nstate, sizeof(int));
+   queue = (int *) HTS_calloc(matcher->nstate, sizeof(int));
+   matcher->suffix = (int *) HTS_calloc(matcher->nstate, sizeof(int));
+   matcher->suffix[0] = -1;
+   head = tail = 0;
+   for (c = 0; c < matcher->nclass; c++)
+      if ((next = matcher->next[c]) != 0) {
+         fail[next] = 0;
+         matcher->suffix[next] = -1;
+         queue[tail++] = next;
+      }
+   while (head < tail) {
+      state = queue[head++];
+      for (c = 0; c < matcher->nclass; c++) {
+         i = state * matcher->nclass + c;
+         if ((next = matcher->next[i]) != 0) {
+            fail[next] = matcher->next[fail[state] * matcher->nclass + c];
+            matcher->suffix[next] = (matcher->literal[fail[next]] >= 0) ? fail[next] : matcher->suffix[fail[next]];
+            queue[tail++] = next;
+         } else {
+            matcher->next[i] = matcher->next[fail[state] * matcher->nclass + c];
+         }
+      }
+   }
+   HTS_free(fail);
+   HTS_free(queue);
+
+   /* questions, equal questions of different models share their index */
+   HTS_Matcher_add_model_set(matcher, ms, 2);
+   n = matcher->nquestion;
+   matcher->question = (HTS_Question **) HTS_calloc(n > 0 ? n : 1, sizeof(HTS_Question *));
+   matcher->nquestion = 0;
+   HTS_Matcher_add_model_set(matcher, ms, 3);
+   qsort(matcher->question, n, sizeof(HTS_Question *), HTS_Question_compare);
+   for (i = 0, last = NULL, matcher->nquestion = 0; i < n; i++) {
+      question = matcher->question[i];
+      if (last == NULL || HTS_Question_compare(&last, &question) != 0)
+         last = matcher->question[matcher->nquestion++] = question;
+      question->index = matcher->nquestion - 1;
+   }
+
+   /* cached indices are not valid for the new models */
+   if (ms->cache != NULL) {
+      HTS_mutex_lock(&ms->cache->mutex);
+      HTS_LabelCache_drop(ms->cache);
+      HTS_LabelCache_layout(ms->cache, ms);
+      HTS_mutex_unlock(&ms->cache->mutex);
+   }
+}
+
 /* HTS_ModelSet_initialize: initialize model set */
 void HTS_ModelSet_initialize(HTS_ModelSet * ms, int nstream)
 {
@@ -847,6 +1589,10 @@ void HTS_ModelSet_initialize(HTS_ModelSet * ms, int nstream)
    HTS_Model_initialize(&ms->gv_switch);
    ms->nstate = -1;
    ms->nstream = nstream;
+   ms->matcher = NULL;
+   ms->cache = NULL;
+   ms->image = NULL;
+   ms->image_size = 0;
 }
 
 /* HTS_ModelSet_load_duration: load duration model and number of state */
@@ -876,6 +1622,7 @@ HTS_Boolean HTS_ModelSet_load_duration(HTS_ModelSet * ms, HTS_File ** pdf_fp, HT
       return FALSE;
    }
    ms->nstate = ms->duration.vector_length;
+   HTS_ModelSet_compile(ms);
 
    return TRUE;
 }
@@ -923,6 +1670,7 @@ HTS_Boolean HTS_ModelSet_load_parameter(HTS_ModelSet * ms, HTS_File ** pdf_fp, H
       HTS_ModelSet_clear(ms);
       return FALSE;
    }
+   HTS_ModelSet_compile(ms);
 
    return TRUE;
 }
@@ -962,6 +1710,7 @@ HTS_Boolean HTS_ModelSet_load_gv(HTS_ModelSet * ms, HTS_File ** pdf_fp, HTS_File
          return FALSE;
       }
    }
+   HTS_ModelSet_compile(ms);
 
    return TRUE;
 }
@@ -980,9 +1729,10 @@ HTS_Boolean HTS_ModelSet_have_gv_tree(HTS_ModelSet * ms, int stream_index)
 /* HTS_ModelSet_load_gv_switch: load GV switch */
 HTS_Boolean HTS_ModelSet_load_gv_switch(HTS_ModelSet * ms, HTS_File * fp)
 {
-   if (fp != NULL)
-      return HTS_Model_load_tree(&ms->gv_switch, fp);
-   return FALSE;
+   if (fp == NULL || HTS_Model_load_tree(&ms->gv_switch, fp) == FALSE)
+      return FALSE;
+   HTS_ModelSet_compile(ms);
+   return TRUE;
 }
 
 /* HTS_ModelSet_have_gv_switch: if GV switch is used, return true */
@@ -994,6 +1744,117 @@ HTS_Boolean HTS_ModelSet_have_gv_switch(HTS_ModelSet * ms)
       return FALSE;
 }
 
+/* HTS_ModelSet_get_image_nstream: get number of stream of a voice image (-1: not a valid voice image) */
+int HTS_ModelSet_get_image_nstream(const char *fn)
+{
+   char header[sizeof(HTS_IMAGE_MAGIC) + 6 * sizeof(int)];
+   size_t size;
+   FILE *fp;
+
+   if (fn == NULL || (fp = fopen(fn, "rb")) == NULL)
+      return -1;
+   size = fread(header, 1, sizeof(header), fp);
+   fclose(fp);
+
+   return HTS_ModelSet_check_image(header, size);
+}
+
+/* HTS_ModelSet_load_image: load every model from a voice image, mapped read only */
+HTS_Boolean HTS_ModelSet_load_image(HTS_ModelSet * ms, const char *fn)
+{
+   int i;
+   HTS_Boolean result = TRUE;
+   HTS_ImageReader r;
+
+   /* check */
+   if (ms == NULL || fn == NULL || ms->duration.model != NULL)
+      return FALSE;
+   r.size = 0;
+   r.pos = 0;
+   r.error = FALSE;
+   r.data = (const char *) HTS_map_file(fn, &r.size);
+   if (r.data == NULL) {
+      HTS_error(0, "HTS_ModelSet_load_image: Cannot map %s.\n", fn);
+      return FALSE;
+   }
+   if (HTS_ModelSet_check_image(r.data, r.size) != ms->nstream) {
+      HTS_error(0, "HTS_ModelSet_load_image: %s is not a voice image of this version with %d streams.\n", fn, ms->nstream);
+      HTS_unmap_file(r.data, r.size);
+      return FALSE;
+   }
+   ms->image = r.data;
+   ms->image_size = r.size;
+
+   /* load */
+   r.pos = sizeof(HTS_IMAGE_MAGIC) + 6 * sizeof(int);
+   ms->nstate = HTS_ImageReader_get_int(&r);
+   result = HTS_ImageReader_get_stream(&r, &ms->duration) && ms->duration.model != NULL && ms->nstate == ms->duration.vector_length;
+   if (result && HTS_ImageReader_get_int(&r)) {
+      ms->stream = (HTS_Stream *) HTS_calloc(ms->nstream, sizeof(HTS_Stream));
+      for (i = 0; i < ms->nstream; i++)
+         HTS_Stream_initialize(&ms->stream[i]);
+      for (i = 0; result && i < ms->nstream; i++)
+         result = HTS_ImageReader_get_stream(&r, &ms->stream[i]) && ms->stream[i].model != NULL;
+   } else {
+      result = FALSE;
+   }
+   if (result && HTS_ImageReader_get_int(&r)) {
+      ms->gv = (HTS_Stream *) HTS_calloc(ms->nstream, sizeof(HTS_Stream));
+      for (i = 0; i < ms->nstream; i++)
+         HTS_Stream_initialize(&ms->gv[i]);
+      for (i = 0; result && i < ms->nstream; i++)
+         result = HTS_ImageReader_get_stream(&r, &ms->gv[i]);
+   }
+   if (result && HTS_ImageReader_get_int(&r))
+      result = HTS_ImageReader_get_model(&r, &ms->gv_switch, FALSE);
+   if (result == FALSE || r.error) {
+      HTS_error(0, "HTS_ModelSet_load_image: %s is damaged.\n", fn);
+      HTS_ModelSet_clear(ms);
+      return FALSE;
+   }
+   HTS_ModelSet_compile(ms);
+
+   return TRUE;
+}
+
+/* HTS_ModelSet_save_image: write the loaded models as a voice image */
+HTS_Boolean HTS_ModelSet_save_image(HTS_ModelSet * ms, HTS_File * fp)
+{
+   int i;
+   HTS_ImageWriter w;
+
+   /* check */
+   if (ms == NULL || fp == NULL || ms->duration.model == NULL || ms->stream == NULL)
+      return FALSE;
+   w.fp = fp;
+   w.size = 0;
+   w.error = FALSE;
+
+   /* header */
+   HTS_ImageWriter_put(&w, HTS_IMAGE_MAGIC, sizeof(HTS_IMAGE_MAGIC));
+   HTS_ImageWriter_put_int(&w, HTS_IMAGE_VERSION);
+   HTS_ImageWriter_put_int(&w, 0x01020304);
+   HTS_ImageWriter_put_int(&w, sizeof(int));
+   HTS_ImageWriter_put_int(&w, sizeof(double));
+   HTS_ImageWriter_put_int(&w, sizeof(HTS_Node));
+   HTS_ImageWriter_put_int(&w, ms->nstream);
+
+   /* models */
+   HTS_ImageWriter_put_int(&w, ms->nstate);
+   HTS_ImageWriter_put_stream(&w, &ms->duration);
+   HTS_ImageWriter_put_int(&w, 1);
+   for (i = 0; i < ms->nstream; i++)
+      HTS_ImageWriter_put_stream(&w, &ms->stream[i]);
+   HTS_ImageWriter_put_int(&w, ms->gv != NULL);
+   for (i = 0; ms->gv && i < ms->nstream; i++)
+      HTS_ImageWriter_put_stream(&w, &ms->gv[i]);
+   HTS_ImageWriter_put_int(&w, ms->gv_switch.tree != NULL);
+   if (ms->gv_switch.tree != NULL)
+      HTS_ImageWriter_put_model(&w, &ms->gv_switch, FALSE);
+
+   return !w.error;
+}
+
 /* HTS_ModelSet_get_nstate: get number of state */
 int HTS_ModelSet_get_nstate(HTS_ModelSet * ms)
 {
@@ -1076,13 +1937,210 @@ HTS_Boolean HTS_ModelSet_use_gv(HTS_ModelSet * ms, int stream_index)
    return FALSE;
 }
 
+/* HTS_ModelSet_set_label_cache: keep the tree and pdf indices of the last labels, up to max_bytes (0: no cache) */
+void HTS_ModelSet_set_label_cache(HTS_ModelSet * ms, size_t max_bytes)
+{
+   HTS_LabelCache *cache;
+
+   if (ms->cache != NULL) {
+      HTS_LabelCache_clear(ms->cache);
+      ms->cache = NULL;
+   }
+   if (max_bytes == 0)
+      return;
+   cache = (HTS_LabelCache *) HTS_calloc(1, sizeof(HTS_LabelCache));
+   HTS_mutex_init(&cache->mutex);
+   cache->max_bytes = max_bytes;
+   for (cache->nbucket = 64; (size_t) cache->nbucket < max_bytes / 512; cache->nbucket *= 2);
+   cache->bucket = (HTS_LabelCacheEntry **) HTS_calloc(cache->nbucket, sizeof(HTS_LabelCacheEntry *));
+   HTS_LabelCache_layout(cache, ms);
+   ms->cache = cache;
+}
+
+/* HTS_ModelSet_clear_label_cache: drop every cached label */
+void HTS_ModelSet_clear_label_cache(HTS_ModelSet * ms)
+{
+   if (ms->cache == NULL)
+      return;
+   HTS_mutex_lock(&ms->cache->mutex);
+   HTS_LabelCache_drop(ms->cache);
+   HTS_mutex_unlock(&ms->cache->mutex);
+}
+
+/* HTS_ModelSet_get_label_cache_stats: get hits, misses, evictions, entries and bytes of the label cache */
+HTS_Boolean HTS_ModelSet_get_label_cache_stats(HTS_ModelSet * ms, unsigned long *hits, unsigned long *misses, unsigned long *evictions, int *entries, size_t * bytes)
+{
+   if (ms->cache == NULL)
+      return FALSE;
+   HTS_mutex_lock(&ms->cache->mutex);
+   *hits = ms->cache->hits;
+   *misses = ms->cache->misses;
+   *evictions = ms->cache->evictions;
+   *entries = ms->cache->nentry;
+   *bytes = ms->cache->bytes;
+   HTS_mutex_unlock(&ms->cache->mutex);
+   return TRUE;
+}
+
+/* HTS_ModelSet_find_label: get the indices of the label from the cache, or prepare them to be stored */
+HTS_Boolean HTS_ModelSet_find_label(HTS_ModelSet * ms, HTS_LabelMatch * label)
+{
+   int i;
+   unsigned long hash;
+   HTS_LabelCache *cache = ms->cache;
+   HTS_LabelCacheEntry *entry;
+
+   if (cache == NULL || cache->nindex == 0)
+      return FALSE;
+   hash = HTS_LabelCache_hash(label->string);
+   label->index = (int *) HTS_calloc(cache->nindex, sizeof(int));
+   label->cached = FALSE;
+
+   HTS_mutex_lock(&cache->mutex);
+   for (entry = cache->bucket[hash & (cache->nbucket - 1)]; entry; entry = entry->chain)
+      if (entry->hash == hash && strcmp(entry->string, label->string) == 0)
+         break;
+   if (entry != NULL) {
+      memcpy(label->index, entry->index, cache->nindex * sizeof(int));
+      label->cached = TRUE;
+      cache->hits++;
+      /* most recently used */
+      if (entry != cache->newest) {
+         if (entry->older)
+            entry->older->newer = entry->newer;
+         else
+            cache->oldest = entry->newer;
+         entry->newer->older = entry->older;
+         entry->older = cache->newest;
+         entry->newer = NULL;
+         cache->newest->newer = entry;
+         cache->newest = entry;
+      }
+   } else {
+      cache->misses++;
+   }
+   HTS_mutex_unlock(&cache->mutex);
+
+   if (label->cached == FALSE)
+      for (i = 0; i < cache->nindex; i++)
+         label->index[i] = -1;
+
+   return label->cached;
+}
+
+/* HTS_ModelSet_cache_label: store the indices of a label not found in the cache, once every lookup has been done */
+void HTS_ModelSet_cache_label(HTS_ModelSet * ms, HTS_LabelMatch * label)
+{
+   int i;
+   size_t size;
+   HTS_LabelCache *cache = ms->cache;
+   HTS_LabelCacheEntry *entry, *other, **bucket;
+
+   if (cache == NULL || label->index == NULL || label->cached == TRUE)
+      return;
+   for (i = 0; i < cache->nindex; i++)
+      if (label->index[i] < 0)
+         return;
+   size = sizeof(HTS_LabelCacheEntry) + cache->nindex * sizeof(int) + label->length + 1;
+   if (size > cache->max_bytes)
+      return;
+
+   entry = (HTS_LabelCacheEntry *) HTS_calloc(1, size);
+   entry->hash = HTS_LabelCache_hash(label->string);
+   entry->size = size;
+   entry->index = (int *) (entry + 1);
+   entry->string = (char *) (entry->index + cache->nindex);
+   memcpy(entry->index, label->index, cache->nindex * sizeof(int));
+   memcpy(entry->string, label->string, label->length + 1);
+   bucket = &cache->bucket[entry->hash & (cache->nbucket - 1)];
+
+   HTS_mutex_lock(&cache->mutex);
+   /* another engine may have stored it meanwhile */
+   for (other = *bucket; other; other = other->chain)
+      if (other->hash == entry->hash && strcmp(other->string, entry->string) == 0)
+         break;
+   if (other != NULL) {
+      HTS_mutex_unlock(&cache->mutex);
+      HTS_free(entry);
+      return;
+   }
+   entry->chain = *bucket;
+   *bucket = entry;
+   entry->older = cache->newest;
+   if (cache->newest)
+      cache->newest->newer = entry;
+   else
+      cache->oldest = entry;
+   cache->newest = entry;
+   cache->bytes += size;
+   cache->nentry++;
+   /* memory cap */
+   while (cache->bytes > cache->max_bytes) {
+      other = cache->oldest;
+      HTS_LabelCache_unlink(cache, other);
+      HTS_free(other);
+      cache->evictions++;
+   }
+   HTS_mutex_unlock(&cache->mutex);
+}
+
+/* HTS_ModelSet_match_label: find every substring pattern contained in the label, scanning it once */
+void HTS_ModelSet_match_label(HTS_ModelSet * ms, const char *string, HTS_LabelMatch * label)
+{
+   int state, literal;
+   const unsigned char *c;
+   const HTS_Matcher *matcher = ms->matcher;
+
+   HTS_LabelMatch_initialize(label, string);
+   if (ms->cache != NULL && HTS_ModelSet_find_label(ms, label) == TRUE)
+      return;                   /* the cached lookups walk no tree, any other one uses generic matching */
+   if (matcher == NULL)
+      return;
+   /* one block for the substrings found and the questions answered */
+   label->found = (unsigned char *) HTS_calloc(matcher->nliteral / 8 + 1 + 2 * (matcher->nquestion / 8 + 1), sizeof(unsigned char));
+   label->known = label->found + matcher->nliteral / 8 + 1;
+   label->answer = label->known + matcher->nquestion / 8 + 1;
+   for (c = (const unsigned char *) string, state = 0; *c != '\0'; c++) {
+      state = matcher->next[state * matcher->nclass + matcher->byte_class[*c]];
+      for (literal = (matcher->literal[state] >= 0) ? state : matcher->suffix[state]; literal >= 0; literal = matcher->suffix[literal])
+         label->found[matcher->literal[literal] >> 3] |= 1 << (matcher->literal[literal] & 7);
+   }
+}
+
+/* HTS_LabelMatch_initialize: prepare label for generic pattern matching */
+void HTS_LabelMatch_initialize(HTS_LabelMatch * label, const char *string)
+{
+   label->string = string;
+   label->length = strlen(string);
+   label->found = NULL;
+   label->known = NULL;
+   label->answer = NULL;
+   label->evaluated = 0;
+   label->reused = 0;
+   label->index = NULL;
+   label->cached = FALSE;
+}
+
+/* HTS_LabelMatch_clear: free label match */
+void HTS_LabelMatch_clear(HTS_LabelMatch * label)
+{
+   HTS_free(label->found);
+   HTS_free(label->index);
+   label->found = NULL;
+   label->known = NULL;
+   label->answer = NULL;
+   label->index = NULL;
+}
+
 /* HTS_ModelSet_get_duration_index: get index of duration tree and PDF */
-void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index, int interpolation_index)
+void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index, int interpolation_index)
 {
    HTS_Tree *tree;
    HTS_Pattern *pattern;
    HTS_Boolean find;
 
+   if (HTS_LabelMatch_get_cached(label, 2 * interpolation_index, tree_index, pdf_index))
+      return;
    find = FALSE;
    (*tree_index) = 2;
    (*pdf_index) = 1;
@@ -1091,7 +2149,7 @@ void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, char *string, int *tree_
       if (!pattern)
          find = TRUE;
       for (; pattern; pattern = pattern->next)
-         if (HTS_pattern_match(string, pattern->string)) {
+         if (HTS_Pattern_match(pattern, label)) {
             find = TRUE;
             break;
          }
@@ -1101,14 +2159,15 @@ void HTS_ModelSet_get_duration_index(HTS_ModelSet * ms, char *string, int *tree_
    }
 
    if (tree == NULL) {
-      HTS_error(1, "HTS_ModelSet_get_duration_index: Cannot find model %s.\n", string);
+      HTS_error(1, "HTS_ModelSet_get_duration_index: Cannot find model %s.\n", label->string);
       return;
    }
-   (*pdf_index) = HTS_Tree_search_node(tree, string);
+   (*pdf_index) = HTS_Tree_search_node(&ms->duration.model[interpolation_index], tree, label);
+   HTS_LabelMatch_set_cached(label, 2 * interpolation_index, *tree_index, *pdf_index);
 }
 
 /* HTS_ModelSet_get_duration: get duration using interpolation weight */
-void HTS_ModelSet_get_duration(HTS_ModelSet * ms, char *string, double *mean, double *vari, double *iw)
+void HTS_ModelSet_get_duration(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, double *iw)
 {
    int i, j;
    int tree_index, pdf_index;
@@ -1119,7 +2178,7 @@ void HTS_ModelSet_get_duration(HTS_ModelSet * ms, char *string, double *mean, do
       vari[i] = 0.0;
    }
    for (i = 0; i < ms->duration.interpolation_size; i++) {
-      HTS_ModelSet_get_duration_index(ms, string, &tree_index, &pdf_index, i);
+      HTS_ModelSet_get_duration_index(ms, label, &tree_index, &pdf_index, i);
       for (j = 0; j < ms->nstate; j++) {
          mean[j] += iw[i] * ms->duration.model[i].pdf[tree_index][pdf_index][j];
          vari[j] += iw[i] * iw[i] * ms->duration.model[i].pdf[tree_index][pdf_index][j + vector_length];
@@ -1128,12 +2187,18 @@ void HTS_ModelSet_get_duration(HTS_ModelSet * ms, char *string, double *mean, do
 }
 
 /* HTS_ModelSet_get_parameter_index: get index of parameter tree and PDF */
-void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index, int stream_index, int state_index, int interpolation_index)
+void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index, int stream_index, int state_index, int interpolation_index)
 {
    HTS_Tree *tree;
    HTS_Pattern *pattern;
    HTS_Boolean find;
+   int offset = 0;
 
+   if (label->index != NULL) {
+      offset = ms->cache->stream_offset[stream_index] + 2 * ((state_index - 2) * ms->stream[stream_index].interpolation_size + interpolation_index);
+      if (HTS_LabelMatch_get_cached(label, offset, tree_index, pdf_index))
+         return;
+   }
    find = FALSE;
    (*tree_index) = 2;
    (*pdf_index) = 1;
@@ -1143,7 +2208,7 @@ void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, char *string, int *tree
          if (!pattern)
             find = TRUE;
          for (; pattern; pattern = pattern->next)
-            if (HTS_pattern_match(string, pattern->string)) {
+            if (HTS_Pattern_match(pattern, label)) {
                find = TRUE;
                break;
             }
@@ -1154,14 +2219,16 @@ void HTS_ModelSet_get_parameter_index(HTS_ModelSet * ms, char *string, int *tree
    }
 
    if (tree == NULL) {
-      HTS_error(1, "HTS_ModelSet_get_parameter_index: Cannot find model %s.\n", string);
+      HTS_error(1, "HTS_ModelSet_get_parameter_index: Cannot find model %s.\n", label->string);
       return;
    }
-   (*pdf_index) = HTS_Tree_search_node(tree, string);
+   (*pdf_index) = HTS_Tree_search_node(&ms->stream[stream_index].model[interpolation_index], tree, label);
+   if (label->index != NULL)
+      HTS_LabelMatch_set_cached(label, offset, *tree_index, *pdf_index);
 }
 
 /* HTS_ModelSet_get_parameter: get parameter using interpolation weight */
-void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, char *string, double *mean, double *vari, double *msd, int stream_index, int state_index, double *iw)
+void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, double *msd, int stream_index, int state_index, double *iw)
 {
    int i, j;
    int tree_index, pdf_index;
@@ -1174,7 +2241,7 @@ void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, char *string, double *mean, d
    if (msd)
       *msd = 0.0;
    for (i = 0; i < ms->stream[stream_index].interpolation_size; i++) {
-      HTS_ModelSet_get_parameter_index(ms, string, &tree_index, &pdf_index, stream_index, state_index, i);
+      HTS_ModelSet_get_parameter_index(ms, label, &tree_index, &pdf_index, stream_index, state_index, i);
       for (j = 0; j < vector_length; j++) {
          mean[j] += iw[i] * ms->stream[stream_index].model[i].pdf[tree_index][pdf_index][j];
          vari[j] += iw[i] * iw[i] * ms->stream[stream_index].model[i]
@@ -1188,7 +2255,7 @@ void HTS_ModelSet_get_parameter(HTS_ModelSet * ms, char *string, double *mean, d
 }
 
 /* HTS_ModelSet_get_gv_index: get index of GV tree and PDF */
-void HTS_ModelSet_get_gv_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index, int stream_index, int interpolation_index)
+void HTS_ModelSet_get_gv_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index, int stream_index, int interpolation_index)
 {
    HTS_Tree *tree;
    HTS_Pattern *pattern;
@@ -1205,7 +2272,7 @@ void HTS_ModelSet_get_gv_index(HTS_ModelSet * ms, char *string, int *tree_index,
       if (!pattern)
          find = TRUE;
       for (; pattern; pattern = pattern->next)
-         if (HTS_pattern_match(string, pattern->string)) {
+         if (HTS_Pattern_match(pattern, label)) {
             find = TRUE;
             break;
          }
@@ -1215,14 +2282,14 @@ void HTS_ModelSet_get_gv_index(HTS_ModelSet * ms, char *string, int *tree_index,
    }
 
    if (tree == NULL) {
-      HTS_error(1, "HTS_ModelSet_get_gv_index: Cannot find model %s.\n", string);
+      HTS_error(1, "HTS_ModelSet_get_gv_index: Cannot find model %s.\n", label->string);
       return;
    }
-   (*pdf_index) = HTS_Tree_search_node(tree, string);
+   (*pdf_index) = HTS_Tree_search_node(&ms->gv[stream_index].model[interpolation_index], tree, label);
 }
 
 /* HTS_ModelSet_get_gv: get GV using interpolation weight */
-void HTS_ModelSet_get_gv(HTS_ModelSet * ms, char *string, double *mean, double *vari, int stream_index, double *iw)
+void HTS_ModelSet_get_gv(HTS_ModelSet * ms, HTS_LabelMatch * label, double *mean, double *vari, int stream_index, double *iw)
 {
    int i, j;
    int tree_index, pdf_index;
@@ -1233,7 +2300,7 @@ void HTS_ModelSet_get_gv(HTS_ModelSet * ms, char *string, double *mean, double *
       vari[i] = 0.0;
    }
    for (i = 0; i < ms->gv[stream_index].interpolation_size; i++) {
-      HTS_ModelSet_get_gv_index(ms, string, &tree_index, &pdf_index, stream_index, i);
+      HTS_ModelSet_get_gv_index(ms, label, &tree_index, &pdf_index, stream_index, i);
       for (j = 0; j < vector_length; j++) {
          mean[j] += iw[i] * ms->gv[stream_index].model[i].pdf[tree_index][pdf_index][j];
          vari[j] += iw[i] * iw[i] * ms->gv[stream_index].model[i]
@@ -1243,12 +2310,14 @@ void HTS_ModelSet_get_gv(HTS_ModelSet * ms, char *string, double *mean, double *
 }
 
 /* HTS_ModelSet_get_gv_switch_index: get index of GV switch tree and PDF */
-void HTS_ModelSet_get_gv_switch_index(HTS_ModelSet * ms, char *string, int *tree_index, int *pdf_index)
+void HTS_ModelSet_get_gv_switch_index(HTS_ModelSet * ms, HTS_LabelMatch * label, int *tree_index, int *pdf_index)
 {
    HTS_Tree *tree;
    HTS_Pattern *pattern;
    HTS_Boolean find;
 
+   if (label->index != NULL && HTS_LabelMatch_get_cached(label, ms->cache->gv_switch_offset, tree_index, pdf_index))
+      return;
    find = FALSE;
    (*tree_index) = 2;
    (*pdf_index) = 1;
@@ -1257,7 +2326,7 @@ void HTS_ModelSet_get_gv_switch_index(HTS_ModelSet * ms, char *string, int *tree
       if (!pattern)
          find = TRUE;
       for (; pattern; pattern = pattern->next)
-         if (HTS_pattern_match(string, pattern->string)) {
+         if (HTS_Pattern_match(pattern, label)) {
             find = TRUE;
             break;
          }
@@ -1267,20 +2336,22 @@ void HTS_ModelSet_get_gv_switch_index(HTS_ModelSet * ms, char *string, int *tree
    }
 
    if (tree == NULL) {
-      HTS_error(1, "HTS_ModelSet_get_gv_switch_index: Cannot find model %s.\n", string);
+      HTS_error(1, "HTS_ModelSet_get_gv_switch_index: Cannot find model %s.\n", label->string);
       return;
    }
-   (*pdf_index) = HTS_Tree_search_node(tree, string);
+   (*pdf_index) = HTS_Tree_search_node(&ms->gv_switch, tree, label);
+   if (label->index != NULL)
+      HTS_LabelMatch_set_cached(label, ms->cache->gv_switch_offset, *tree_index, *pdf_index);
 }
 
 /* HTS_ModelSet_get_gv_switch: get GV switch */
-HTS_Boolean HTS_ModelSet_get_gv_switch(HTS_ModelSet * ms, char *string)
+HTS_Boolean HTS_ModelSet_get_gv_switch(HTS_ModelSet * ms, HTS_LabelMatch * label)
 {
    int tree_index, pdf_index;
 
    if (ms->gv_switch.tree == NULL)
       return TRUE;
-   HTS_ModelSet_get_gv_switch_index(ms, string, &tree_index, &pdf_index);
+   HTS_ModelSet_get_gv_switch_index(ms, label, &tree_index, &pdf_index);
    if (pdf_index == 1)
       return FALSE;
    else
@@ -1304,6 +2375,12 @@ void HTS_ModelSet_clear(HTS_ModelSet * ms)
       HTS_free(ms->gv);
    }
    HTS_Model_clear(&ms->gv_switch);
+   if (ms->matcher != NULL)
+      HTS_Matcher_clear(ms->matcher);
+   if (ms->cache != NULL)
+      HTS_LabelCache_clear(ms->cache);
+   if (ms->image != NULL)
+      HTS_unmap_file(ms->image, ms->image_size);
    HTS_ModelSet_initialize(ms, -1);
 }
 
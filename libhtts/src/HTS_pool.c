@@ -0,0 +1,265 @@
+/* ----------------------------------------------------------------- */
+/*           The HMM-Based Speech Synthesis Engine "hts_engine API"  */
+/*           developed by HTS Working Group                          */
+/*           http://hts-engine.sourceforge.net/                      */
+/* ----------------------------------------------------------------- */
+/*                                                                   */
+/*  Copyright (c) 2001-2011  Nagoya Institute of Technology          */
+/*                           Department of Computer Science          */
+/*                                                                   */
+/*                2001-2008  Tokyo Institute of Technology           */
+/*                           Interdisciplinary Graduate School of    */
+/*                           Science and Engineering                 */
+/*                                                                   */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/* - Redistributions of source code must retain the above copyright  */
+/*   notice, this list of conditions and the following disclaimer.   */
+/* - Redistributions in binary form must reproduce the above         */
+/*   copyright notice, this list of conditions and the following     */
+/*   disclaimer in the documentation and/or other materials provided */
+/*   with the distribution.                                          */
+/* - Neither the name of the HTS working group nor the names of its  */
+/*   contributors may be used to endorse or promote products derived */
+/*   from this software without specific prior written permission.   */
+/*                                                                   */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND            */
+/* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,       */
+/* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF          */
+/* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE          */
+/* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS */
+/* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,          */
+/* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED   */
+/* TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,   */
+/* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY    */
+/* OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           */
+/* POSSIBILITY OF SUCH DAMAGE.                                       */
+/* ----------------------------------------------------------------- */
+
+#ifndef HTS_POOL_C
+#define HTS_POOL_C
+
+#ifdef __cplusplus
+#define HTS_POOL_C_START extern "C" {
+#define HTS_POOL_C_END   }
+#else
+#define HTS_POOL_C_START
+#define HTS_POOL_C_END
+#endif                          /* __CPLUSPLUS */
+
+HTS_POOL_C_START;
+
+/* hts_engine libraries */
+#include "HTS_hidden.h"
+
+/* HTS_PoolJob: tasks of one HTS_Pool_run() call */
+typedef struct _HTS_PoolJob {
+   struct _HTS_PoolJob *next;   /* next job in the queue */
+   HTS_PoolTask task;           /* function run for every task */
+   void *user;                  /* user data for task */
+   int ntasks;                  /* # of tasks */
+   int started;                 /* tasks already taken */
+   int done;                    /* tasks finished */
+   int nslots;                  /* max. # of threads working on the job at once */
+   int joined;                  /* threads that have joined the job (each one takes a slot) */
+} HTS_PoolJob;
+
+/* HTS_Pool: worker threads */
+struct _HTS_Pool {
+   HTS_Thread *thread;          /* worker threads */
+   int nthread;                 /* # of worker threads */
+   int refs;                    /* # of users of the pool */
+   HTS_Boolean quit;            /* workers must exit */
+   HTS_Mutex mutex;             /* protects everything below and the jobs */
+   HTS_Cond work;               /* a job has been queued (or quit) */
+   HTS_Cond done;               /* a job has been finished */
+   HTS_PoolJob *queue;          /* jobs with tasks not taken yet */
+};
+
+/* the pool shared by every engine of the process */
+static HTS_Pool *HTS_pool_shared = NULL;
+static HTS_Mutex HTS_pool_shared_mutex = HTS_MUTEX_INITIALIZER;
+
+/* HTS_PoolJob_work: run the tasks of job with slot, until every task is taken (called and returns with the mutex locked) */
+static void HTS_PoolJob_work(HTS_Pool * pool, HTS_PoolJob * job, int slot)
+{
+   int index;
+   HTS_PoolJob **p;
+
+   while (job->started < job->ntasks) {
+      index = job->started++;
+      if (job->started == job->ntasks) {
+         for (p = &pool->queue; *p != job; p = &(*p)->next);
+         *p = job->next;
+      }
+      HTS_mutex_unlock(&pool->mutex);
+      job->task(job->user, index, slot);
+      HTS_mutex_lock(&pool->mutex);
+      if (++job->done == job->ntasks)
+         HTS_cond_broadcast(&pool->done);
+   }
+}
+
+/* HTS_Pool_worker: worker thread, joins queued jobs while it has free slots */
+#ifdef _WIN32
+static DWORD WINAPI HTS_Pool_worker(LPVOID arg)
+#else
+static void *HTS_Pool_worker(void *arg)
+#endif                          /* _WIN32 */
+{
+   HTS_Pool *pool = (HTS_Pool *) arg;
+   HTS_PoolJob *job;
+
+   HTS_mutex_lock(&pool->mutex);
+   while (pool->quit == FALSE) {
+      for (job = pool->queue; job != NULL && job->joined >= job->nslots; job = job->next);
+      if (job == NULL) {
+         HTS_cond_wait(&pool->work, &pool->mutex);
+         continue;
+      }
+      HTS_PoolJob_work(pool, job, job->joined++);
+   }
+   HTS_mutex_unlock(&pool->mutex);
+   return 0;
+}
+
+/* HTS_Pool_grow: start worker threads until there are nthread (called with the mutex locked) */
+static void HTS_Pool_grow(HTS_Pool * pool, int nthread)
+{
+   int i;
+   HTS_Thread *thread;
+
+   if (nthread <= pool->nthread)
+      return;
+   thread = (HTS_Thread *) HTS_calloc(nthread, sizeof(HTS_Thread));
+   for (i = 0; i < pool->nthread; i++)
+      thread[i] = pool->thread[i];
+   HTS_free(pool->thread);
+   pool->thread = thread;
+   for (; pool->nthread < nthread; pool->nthread++) {
+#ifdef _WIN32
+      pool->thread[pool->nthread] = CreateThread(NULL, 0, HTS_Pool_worker, pool, 0, NULL);
+      if (pool->thread[pool->nthread] == NULL)
+         break;
+#else
+      if (pthread_create(&pool->thread[pool->nthread], NULL, HTS_Pool_worker, pool) != 0)
+         break;
+#endif                          /* _WIN32 */
+   }
+}
+
+/* HTS_Pool_share: get the pool shared by the process, with at least nthread worker threads */
+HTS_Pool *HTS_Pool_share(int nthread)
+{
+   HTS_Pool *pool;
+
+   HTS_mutex_lock(&HTS_pool_shared_mutex);
+   if (HTS_pool_shared == NULL) {
+      pool = (HTS_Pool *) HTS_calloc(1, sizeof(HTS_Pool));
+      pool->thread = NULL;
+      pool->nthread = 0;
+      pool->refs = 0;
+      pool->quit = FALSE;
+      pool->queue = NULL;
+      HTS_mutex_init(&pool->mutex);
+      HTS_cond_init(&pool->work);
+      HTS_cond_init(&pool->done);
+      HTS_pool_shared = pool;
+   }
+   pool = HTS_pool_shared;
+   pool->refs++;
+   HTS_mutex_lock(&pool->mutex);
+   HTS_Pool_grow(pool, nthread);
+   HTS_mutex_unlock(&pool->mutex);
+   HTS_mutex_unlock(&HTS_pool_shared_mutex);
+
+   return pool;
+}
+
+/* HTS_Pool_release: release the pool, the last user stops its threads */
+void HTS_Pool_release(HTS_Pool * pool)
+{
+   int i;
+
+   HTS_mutex_lock(&HTS_pool_shared_mutex);
+   if (--pool->refs > 0) {
+      HTS_mutex_unlock(&HTS_pool_shared_mutex);
+      return;
+   }
+   HTS_pool_shared = NULL;
+   HTS_mutex_unlock(&HTS_pool_shared_mutex);
+
+   HTS_mutex_lock(&pool->mutex);
+   pool->quit = TRUE;
+   HTS_cond_broadcast(&pool->work);
+   HTS_mutex_unlock(&pool->mutex);
+   for (i = 0; i < pool->nthread; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(pool->thread[i], INFINITE);
+      CloseHandle(pool->thread[i]);
+#else
+      pthread_join(pool->thread[i], NULL);
+#endif                          /* _WIN32 */
+   }
+   HTS_cond_destroy(&pool->done);
+   HTS_cond_destroy(&pool->work);
+   HTS_mutex_destroy(&pool->mutex);
+   HTS_free(pool->thread);
+   HTS_free(pool);
+}
+
+/* HTS_Pool_get_nthread: get number of worker threads */
+int HTS_Pool_get_nthread(HTS_Pool * pool)
+{
+   int nthread;
+
+   if (pool == NULL)
+      return 0;
+   HTS_mutex_lock(&pool->mutex);
+   nthread = pool->nthread;
+   HTS_mutex_unlock(&pool->mutex);
+
+   return nthread;
+}
+
+/* HTS_Pool_run: run task(user, index, slot) for index = 0..ntasks-1 and wait until all have finished */
+/* (the caller works too, always with slot 0; at most nslots threads work on the tasks at once, */
+/*  each with its own slot below nslots, so per slot scratch memory is never shared) */
+void HTS_Pool_run(HTS_Pool * pool, int ntasks, int nslots, HTS_PoolTask task, void *user)
+{
+   int i;
+   HTS_PoolJob job, **p;
+
+   if (pool == NULL || nslots <= 1 || ntasks <= 1) {
+      for (i = 0; i < ntasks; i++)
+         task(user, i, 0);
+      return;
+   }
+   job.next = NULL;
+   job.task = task;
+   job.user = user;
+   job.ntasks = ntasks;
+   job.started = 0;
+   job.done = 0;
+   job.nslots = nslots;
+   job.joined = 1;
+
+   HTS_mutex_lock(&pool->mutex);
+   for (p = &pool->queue; *p != NULL; p = &(*p)->next);
+   *p = &job;
+   HTS_cond_broadcast(&pool->work);
+   HTS_PoolJob_work(pool, &job, 0);
+   while (job.done < job.ntasks)
+      HTS_cond_wait(&pool->done, &pool->mutex);
+   HTS_mutex_unlock(&pool->mutex);
+}
+
+HTS_POOL_C_END;
+
+#endif                          /* !HTS_POOL_C */
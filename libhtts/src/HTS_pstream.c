@@ -75,72 +75,74 @@ static double HTS_finv(const double x)
    return (1.0 / x);
 }
 
-/* HTS_PStream_calc_wuw_and_wum: calcurate W'U^{-1}W and W'U^{-1}M */
-static void HTS_PStream_calc_wuw_and_wum(HTS_PStream * pst, const int m)
+/* HTS_PStream_calc_wuw_and_wum: calcurate W'U^{-1}W and W'U^{-1}M for frames s..e-1 */
+/* (streaming: if e is not the end of the stream, the dynamic windows crossing e are left out) */
+static void HTS_PStream_calc_wuw_and_wum(HTS_PStream * pst, HTS_SMatrices * sm, const int m, const int s, const int e)
 {
    int t, i, j, k;
    double wu;
 
-   for (t = 0; t < pst->length; t++) {
+   for (t = s; t < e; t++) {
       /* initialize */
-      pst->sm.wum[t] = 0.0;
+      sm->wum[t] = 0.0;
       for (i = 0; i < pst->width; i++)
-         pst->sm.wuw[t][i] = 0.0;
+         sm->wuw[t][i] = 0.0;
 
       /* calc WUW & WUM */
       for (i = 0; i < pst->win_size; i++)
          for (j = pst->win_l_width[i]; j <= pst->win_r_width[i]; j++)
             if ((t + j >= 0) && (t + j < pst->length)
+                && (e == pst->length || t + j + pst->win_r_width[i] < e)
                 && (pst->win_coefficient[i][-j] != 0.0)) {
-               wu = pst->win_coefficient[i][-j] * pst->sm.ivar[t + j][i * pst->static_length + m];
-               pst->sm.wum[t] += wu * pst->sm.mean[t + j][i * pst->static_length + m];
-               for (k = 0; (k < pst->width) && (t + k < pst->length); k++)
+               wu = pst->win_coefficient[i][-j] * sm->ivar[t + j][i * pst->static_length + m];
+               sm->wum[t] += wu * sm->mean[t + j][i * pst->static_length + m];
+               for (k = 0; (k < pst->width) && (t + k < e); k++)
                   if ((k - j <= pst->win_r_width[i])
                       && (pst->win_coefficient[i][k - j] != 0.0))
-                     pst->sm.wuw[t][k] += wu * pst->win_coefficient[i][k - j];
+                     sm->wuw[t][k] += wu * pst->win_coefficient[i][k - j];
             }
    }
 }
 
 
-/* HTS_PStream_ldl_factorization: Factorize W'*U^{-1}*W to L*D*L' (L: lower triangular, D: diagonal) */
-static void HTS_PStream_ldl_factorization(HTS_PStream * pst)
+/* HTS_PStream_ldl_factorization: Factorize W'*U^{-1}*W to L*D*L' (L: lower triangular, D: diagonal) for frames s..e-1 */
+static void HTS_PStream_ldl_factorization(HTS_PStream * pst, HTS_SMatrices * sm, const int s, const int e)
 {
    int t, i, j;
 
-   for (t = 0; t < pst->length; t++) {
-      for (i = 1; (i < pst->width) && (t >= i); i++)
-         pst->sm.wuw[t][0] -= pst->sm.wuw[t - i][i] * pst->sm.wuw[t - i][i] * pst->sm.wuw[t - i][0];
+   for (t = s; t < e; t++) {
+      for (i = 1; (i < pst->width) && (t - s >= i); i++)
+         sm->wuw[t][0] -= sm->wuw[t - i][i] * sm->wuw[t - i][i] * sm->wuw[t - i][0];
 
       for (i = 1; i < pst->width; i++) {
-         for (j = 1; (i + j < pst->width) && (t >= j); j++)
-            pst->sm.wuw[t][i] -= pst->sm.wuw[t - j][j] * pst->sm.wuw[t - j][i + j] * pst->sm.wuw[t - j][0];
-         pst->sm.wuw[t][i] /= pst->sm.wuw[t][0];
+         for (j = 1; (i + j < pst->width) && (t - s >= j); j++)
+            sm->wuw[t][i] -= sm->wuw[t - j][j] * sm->wuw[t - j][i + j] * sm->wuw[t - j][0];
+         sm->wuw[t][i] /= sm->wuw[t][0];
       }
    }
 }
 
-/* HTS_PStream_forward_substitution: forward subtitution for mlpg */
-static void HTS_PStream_forward_substitution(HTS_PStream * pst)
+/* HTS_PStream_forward_substitution: forward subtitution for mlpg (frames s..e-1) */
+static void HTS_PStream_forward_substitution(HTS_PStream * pst, HTS_SMatrices * sm, const int s, const int e)
 {
    int t, i;
 
-   for (t = 0; t < pst->length; t++) {
-      pst->sm.g[t] = pst->sm.wum[t];
-      for (i = 1; (i < pst->width) && (t >= i); i++)
-         pst->sm.g[t] -= pst->sm.wuw[t - i][i] * pst->sm.g[t - i];
+   for (t = s; t < e; t++) {
+      sm->g[t] = sm->wum[t];
+      for (i = 1; (i < pst->width) && (t - s >= i); i++)
+         sm->g[t] -= sm->wuw[t - i][i] * sm->g[t - i];
    }
 }
 
-/* HTS_PStream_backward_substitution: backward subtitution for mlpg */
-static void HTS_PStream_backward_substitution(HTS_PStream * pst, const int m)
+/* HTS_PStream_backward_substitution: backward subtitution for mlpg (frames s..e-1) */
+static void HTS_PStream_backward_substitution(HTS_PStream * pst, HTS_SMatrices * sm, const int m, const int s, const int e)
 {
    int t, i;
 
-   for (t = pst->length - 1; t >= 0; t--) {
-      pst->par[t][m] = pst->sm.g[t] / pst->sm.wuw[t][0];
-      for (i = 1; (i < pst->width) && (t + i < pst->length); i++)
-         pst->par[t][m] -= pst->sm.wuw[t][i] * pst->par[t + i][m];
+   for (t = e - 1; t >= s; t--) {
+      pst->par[t][m] = sm->g[t] / sm->wuw[t][0];
+      for (i = 1; (i < pst->width) && (t + i < e); i++)
+         pst->par[t][m] -= sm->wuw[t][i] * pst->par[t + i][m];
    }
 }
 
@@ -177,7 +179,7 @@ static void HTS_PStream_conv_gv(HTS_PStream * pst, const int m)
 }
 
 /* HTS_PStream_calc_derivative: subfunction for mlpg using GV */
-static double HTS_PStream_calc_derivative(HTS_PStream * pst, const int m)
+static double HTS_PStream_calc_derivative(HTS_PStream * pst, HTS_SMatrices * sm, const int m)
 {
    int t, i;
    double mean;
@@ -193,29 +195,29 @@ static double HTS_PStream_calc_derivative(HTS_PStream * pst, const int m)
    dv = -2.0 * pst->gv_vari[m] * (vari - pst->gv_mean[m]) / pst->length;
 
    for (t = 0; t < pst->length; t++) {
-      pst->sm.g[t] = pst->sm.wuw[t][0] * pst->par[t][m];
+      sm->g[t] = sm->wuw[t][0] * pst->par[t][m];
       for (i = 1; i < pst->width; i++) {
          if (t + i < pst->length)
-            pst->sm.g[t] += pst->sm.wuw[t][i] * pst->par[t + i][m];
+            sm->g[t] += sm->wuw[t][i] * pst->par[t + i][m];
          if (t + 1 > i)
-            pst->sm.g[t] += pst->sm.wuw[t - i][i] * pst->par[t - i][m];
+            sm->g[t] += sm->wuw[t - i][i] * pst->par[t - i][m];
       }
    }
 
    for (t = 0, hmmobj = 0.0; t < pst->length; t++) {
-      hmmobj += W1 * w * pst->par[t][m] * (pst->sm.wum[t] - 0.5 * pst->sm.g[t]);
-      h = -W1 * w * pst->sm.wuw[t][1 - 1] - W2 * 2.0 / (pst->length * pst->length) * ((pst->length - 1) * pst->gv_vari[m] * (vari - pst->gv_mean[m]) + 2.0 * pst->gv_vari[m] * (pst->par[t][m] - mean) * (pst->par[t][m] - mean));
+      hmmobj += W1 * w * pst->par[t][m] * (sm->wum[t] - 0.5 * sm->g[t]);
+      h = -W1 * w * sm->wuw[t][1 - 1] - W2 * 2.0 / (pst->length * pst->length) * ((pst->length - 1) * pst->gv_vari[m] * (vari - pst->gv_mean[m]) + 2.0 * pst->gv_vari[m] * (pst->par[t][m] - mean) * (pst->par[t][m] - mean));
       if (pst->gv_switch[t])
-         pst->sm.g[t] = 1.0 / h * (W1 * w * (-pst->sm.g[t] + pst->sm.wum[t]) + W2 * dv * (pst->par[t][m] - mean));
+         sm->g[t] = 1.0 / h * (W1 * w * (-sm->g[t] + sm->wum[t]) + W2 * dv * (pst->par[t][m] - mean));
       else
-         pst->sm.g[t] = 1.0 / h * (W1 * w * (-pst->sm.g[t] + pst->sm.wum[t]));
+         sm->g[t] = 1.0 / h * (W1 * w * (-sm->g[t] + sm->wum[t]));
    }
 
    return (-(hmmobj + gvobj));
 }
 
 /* HTS_PStream_gv_parmgen: function for mlpg using GV */
-static void HTS_PStream_gv_parmgen(HTS_PStream * pst, const int m)
+static void HTS_PStream_gv_parmgen(HTS_PStream * pst, HTS_SMatrices * sm, const int m)
 {
    int t, i;
    double step = STEPINIT;
@@ -227,36 +229,161 @@ static void HTS_PStream_gv_parmgen(HTS_PStream * pst, const int m)
 
    HTS_PStream_conv_gv(pst, m);
    if (GV_MAX_ITERATION > 0) {
-      HTS_PStream_calc_wuw_and_wum(pst, m);
+      HTS_PStream_calc_wuw_and_wum(pst, sm, m, 0, pst->length);
       for (i = 1; i <= GV_MAX_ITERATION; i++) {
-         obj = HTS_PStream_calc_derivative(pst, m);
+         obj = HTS_PStream_calc_derivative(pst, sm, m);
          if (obj > prev)
             step *= STEPDEC;
          if (obj < prev)
             step *= STEPINC;
          for (t = 0; t < pst->length; t++)
-            pst->par[t][m] += step * pst->sm.g[t];
+            pst->par[t][m] += step * sm->g[t];
          prev = obj;
       }
    }
 }
 
+/* HTS_PStream_mlpg_dim: generate dimension m of the static features, with the work vectors of sm */
+static void HTS_PStream_mlpg_dim(HTS_PStream * pst, HTS_SMatrices * sm, const int m)
+{
+   HTS_PStream_calc_wuw_and_wum(pst, sm, m, 0, pst->length);
+   HTS_PStream_ldl_factorization(pst, sm, 0, pst->length);       /* LDL factorization */
+   HTS_PStream_forward_substitution(pst, sm, 0, pst->length);    /* forward substitution   */
+   HTS_PStream_backward_substitution(pst, sm, m, 0, pst->length);        /* backward substitution  */
+   if (pst->gv_length > 0)
+      HTS_PStream_gv_parmgen(pst, sm, m);
+}
+
 /* HTS_PStream_mlpg: generate sequence of speech parameter vector maximizing its output probability for given pdf sequence */
-static void HTS_PStream_mlpg(HTS_PStream * pst)
+static void HTS_PStream_mlpg(HTS_PStream * pst, volatile HTS_Boolean * stop)
 {
    int m;
 
    if (pst->length == 0)
       return;
 
+   for (m = 0; m < pst->static_length && (*stop) == FALSE; m++)
+      HTS_PStream_mlpg_dim(pst, &pst->sm, m);
+}
+
+/* HTS_PStream_gv_model: streaming, GV approximation from the model statistics */
+/* (the mean and variance of the static means over the GV frames stand for those of the whole trajectory, */
+/*  which is not known until the last frame; the trajectory is then scaled frame by frame as in HTS_PStream_conv_gv) */
+static void HTS_PStream_gv_model(HTS_PStream * pst)
+{
+   int t, m;
+   double mean, vari;
+
    for (m = 0; m < pst->static_length; m++) {
-      HTS_PStream_calc_wuw_and_wum(pst, m);
-      HTS_PStream_ldl_factorization(pst);       /* LDL factorization */
-      HTS_PStream_forward_substitution(pst);    /* forward substitution   */
-      HTS_PStream_backward_substitution(pst, m);        /* backward substitution  */
+      mean = 0.0;
+      for (t = 0; t < pst->length; t++)
+         if (pst->gv_switch[t])
+            mean += pst->sm.mean[t][m];
+      mean /= pst->gv_length;
+      vari = 0.0;
+      for (t = 0; t < pst->length; t++)
+         if (pst->gv_switch[t])
+            vari += (pst->sm.mean[t][m] - mean) * (pst->sm.mean[t][m] - mean);
+      vari /= pst->gv_length;
+      pst->gv_center[m] = mean;
+      pst->gv_ratio[m] = vari > 0.0 ? sqrt(pst->gv_mean[m] / vari) : 1.0;
+   }
+}
+
+/* HTS_PStream_mlpg_block: streaming, generate frames ready..f-1 solving up to lookahead frames beyond f */
+/* (the frames already generated are fixed and only enter through the right hand side) */
+static void HTS_PStream_mlpg_block(HTS_PStream * pst, const int f, const int lookahead, volatile HTS_Boolean * stop)
+{
+   int m, t, i;
+   int s = pst->ready;
+   int e = f + lookahead < pst->length ? f + lookahead : pst->length;
+   int w = pst->width - 1;
+   HTS_SMatrices *sm = &pst->sm;
+
+   for (m = 0; m < pst->static_length && (*stop) == FALSE; m++) {
+      HTS_PStream_calc_wuw_and_wum(pst, sm, m, s - w > 0 ? s - w : 0, e);
+      for (t = s; t < s + w && t < e; t++)
+         for (i = t - s + 1; i <= w && t - i >= 0; i++)
+            sm->wum[t] -= sm->wuw[t - i][i] * pst->tail[(t - i) % w][m];
+      HTS_PStream_ldl_factorization(pst, sm, s, e);
+      HTS_PStream_forward_substitution(pst, sm, s, e);
+      HTS_PStream_backward_substitution(pst, sm, m, s, e);
+      for (t = f - w > s ? f - w : s; t < f; t++)
+         pst->tail[t % w][m] = pst->par[t][m];
       if (pst->gv_length > 0)
-         HTS_PStream_gv_parmgen(pst, m);
+         for (t = s; t < f; t++)
+            if (pst->gv_switch[t])
+               pst->par[t][m] = pst->gv_ratio[m] * (pst->par[t][m] - pst->gv_center[m]) + pst->gv_center[m];
+   }
+   if ((*stop) == FALSE)
+      pst->ready = f;
+}
+
+/* HTS_MLPGJob: parallel parameter generation, one task per group of dimensions of a stream */
+typedef struct _HTS_MLPGJob {
+   HTS_PStreamSet *pss;         /* streams to generate */
+   int group;                   /* dimensions per task */
+   HTS_SMatrices *sm;           /* work vectors of each slot (mean and ivar come from the stream) */
+   volatile HTS_Boolean *stop;  /* stop flag */
+} HTS_MLPGJob;
+
+/* HTS_PStreamSet_mlpg_task: generate the index-th group of dimensions (HTS_PoolTask) */
+/* (every dimension is solved exactly as in HTS_PStream_mlpg, so the result does not depend on the threads) */
+static void HTS_PStreamSet_mlpg_task(void *user, int index, int slot)
+{
+   HTS_MLPGJob *job = (HTS_MLPGJob *) user;
+   HTS_PStream *pst;
+   HTS_SMatrices sm;
+   int i, m, n;
+
+   for (i = 0;; i++) {
+      pst = &job->pss->pstream[i];
+      n = pst->length > 0 ? (pst->static_length + job->group - 1) / job->group : 0;
+      if (index < n)
+         break;
+      index -= n;
    }
+   sm = job->sm[slot];
+   sm.mean = pst->sm.mean;
+   sm.ivar = pst->sm.ivar;
+   for (m = index * job->group; m < (index + 1) * job->group && m < pst->static_length && (*job->stop) == FALSE; m++)
+      HTS_PStream_mlpg_dim(pst, &sm, m);
+}
+
+/* HTS_PStreamSet_mlpg: generate every stream with nthread threads of pool */
+static void HTS_PStreamSet_mlpg(HTS_PStreamSet * pss, int nthread, HTS_Pool * pool, HTS_Arena * arena, volatile HTS_Boolean * stop)
+{
+   int i, ntasks, ndims, length, width;
+   HTS_MLPGJob job;
+   HTS_PStream *pst;
+
+   for (i = 0, ndims = 0, length = 0, width = 0; i < pss->nstream; i++) {
+      pst = &pss->pstream[i];
+      if (pst->length == 0)
+         continue;
+      ndims += pst->static_length;
+      if (pst->length > length)
+         length = pst->length;
+      if (pst->width > width)
+         width = pst->width;
+   }
+   if (nthread > ndims)
+      nthread = ndims;
+   job.pss = pss;
+   job.group = ndims / (MLPG_TASKS_PER_THREAD * nthread);
+   if (job.group < 1)
+      job.group = 1;
+   job.stop = stop;
+   for (i = 0, ntasks = 0; i < pss->nstream; i++)
+      if (pss->pstream[i].length > 0)
+         ntasks += (pss->pstream[i].static_length + job.group - 1) / job.group;
+   job.sm = (HTS_SMatrices *) HTS_Arena_alloc(arena, nthread, sizeof(HTS_SMatrices));
+   for (i = 0; i < nthread; i++) {
+      job.sm[i].wum = (double *) HTS_Arena_alloc(arena, length, sizeof(double));
+      job.sm[i].wuw = HTS_Arena_alloc_matrix(arena, length, width);
+      job.sm[i].g = (double *) HTS_Arena_alloc(arena, length, sizeof(double));
+   }
+   HTS_Pool_run(pool, ntasks, nthread, HTS_PStreamSet_mlpg_task, &job);
 }
 
 /* HTS_PStreamSet_initialize: initialize parameter stream set */
@@ -265,16 +392,19 @@ void HTS_PStreamSet_initialize(HTS_PStreamSet * pss)
    pss->pstream = NULL;
    pss->nstream = 0;
    pss->total_frame = 0;
+   pss->lookahead = 0;
+   pss->ready = 0;
 }
 
 /* HTS_PStreamSet_create: parameter generation using GV weight */
-HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, double *msd_threshold, double *gv_weight)
+HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, double *msd_threshold, double *gv_weight, int lookahead, int nthread, HTS_Pool * pool, HTS_Arena * arena, volatile HTS_Boolean * stop)
 {
    int i, j, k, l, m;
    int frame, msd_frame, state;
 
    HTS_PStream *pst;
    HTS_Boolean not_bound;
+   HTS_Boolean stopped = FALSE;
 
    if (pss->nstream) {
       HTS_error(1, "HTS_PstreamSet_create: HTS_PStreamSet should be clear.\n");
@@ -283,8 +413,9 @@ HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, do
 
    /* initialize */
    pss->nstream = HTS_SStreamSet_get_nstream(sss);
-   pss->pstream = (HTS_PStream *) HTS_calloc(pss->nstream, sizeof(HTS_PStream));
+   pss->pstream = (HTS_PStream *) HTS_Arena_alloc(arena, pss->nstream, sizeof(HTS_PStream));
    pss->total_frame = HTS_SStreamSet_get_total_frame(sss);
+   pss->lookahead = lookahead > 0 ? lookahead : 0;
 
    /* create */
    for (i = 0; i < pss->nstream; i++) {
@@ -294,7 +425,7 @@ HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, do
          for (state = 0; state < HTS_SStreamSet_get_total_state(sss); state++)
             if (HTS_SStreamSet_get_msd(sss, i, state) > msd_threshold[i])
                pst->length += HTS_SStreamSet_get_duration(sss, state);
-         pst->msd_flag = (HTS_Boolean *) HTS_calloc(pss->total_frame, sizeof(HTS_Boolean));
+         pst->msd_flag = (HTS_Boolean *) HTS_Arena_alloc(arena, pss->total_frame, sizeof(HTS_Boolean));
          for (state = 0, frame = 0; state < HTS_SStreamSet_get_total_state(sss); state++)
             if (HTS_SStreamSet_get_msd(sss, i, state) > msd_threshold[i])
                for (j = 0; j < HTS_SStreamSet_get_duration(sss, state); j++) {
@@ -313,38 +444,38 @@ HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, do
       pst->width = HTS_SStreamSet_get_window_max_width(sss, i) * 2 + 1; /* band width of R */
       pst->win_size = HTS_SStreamSet_get_window_size(sss, i);
       pst->static_length = pst->vector_length / pst->win_size;
-      pst->sm.mean = HTS_alloc_matrix(pst->length, pst->vector_length);
-      pst->sm.ivar = HTS_alloc_matrix(pst->length, pst->vector_length);
-      pst->sm.wum = (double *) HTS_calloc(pst->length, sizeof(double));
-      pst->sm.wuw = HTS_alloc_matrix(pst->length, pst->width);
-      pst->sm.g = (double *) HTS_calloc(pst->length, sizeof(double));
-      pst->par = HTS_alloc_matrix(pst->length, pst->static_length);
+      pst->sm.mean = HTS_Arena_alloc_matrix(arena, pst->length, pst->vector_length);
+      pst->sm.ivar = HTS_Arena_alloc_matrix(arena, pst->length, pst->vector_length);
+      pst->sm.wum = (double *) HTS_Arena_alloc(arena, pst->length, sizeof(double));
+      pst->sm.wuw = HTS_Arena_alloc_matrix(arena, pst->length, pst->width);
+      pst->sm.g = (double *) HTS_Arena_alloc(arena, pst->length, sizeof(double));
+      pst->par = HTS_Arena_alloc_matrix(arena, pst->length, pst->static_length);
       /* copy dynamic window */
-      pst->win_l_width = (int *) HTS_calloc(pst->win_size, sizeof(int));
-      pst->win_r_width = (int *) HTS_calloc(pst->win_size, sizeof(int));
-      pst->win_coefficient = (double **) HTS_calloc(pst->win_size, sizeof(double));
+      pst->win_l_width = (int *) HTS_Arena_alloc(arena, pst->win_size, sizeof(int));
+      pst->win_r_width = (int *) HTS_Arena_alloc(arena, pst->win_size, sizeof(int));
+      pst->win_coefficient = (double **) HTS_Arena_alloc(arena, pst->win_size, sizeof(double *));
       for (j = 0; j < pst->win_size; j++) {
          pst->win_l_width[j] = HTS_SStreamSet_get_window_left_width(sss, i, j);
          pst->win_r_width[j] = HTS_SStreamSet_get_window_right_width(sss, i, j);
          if (pst->win_l_width[j] + pst->win_r_width[j] == 0)
             pst->win_coefficient[j] = (double *)
-                HTS_calloc(-2 * pst->win_l_width[j] + 1, sizeof(double));
+                HTS_Arena_alloc(arena, -2 * pst->win_l_width[j] + 1, sizeof(double));
          else
             pst->win_coefficient[j] = (double *)
-                HTS_calloc(-2 * pst->win_l_width[j], sizeof(double));
+                HTS_Arena_alloc(arena, -2 * pst->win_l_width[j], sizeof(double));
          pst->win_coefficient[j] -= pst->win_l_width[j];
          for (k = pst->win_l_width[j]; k <= pst->win_r_width[j]; k++)
             pst->win_coefficient[j][k] = HTS_SStreamSet_get_window_coefficient(sss, i, j, k);
       }
       /* copy GV */
       if (HTS_SStreamSet_use_gv(sss, i)) {
-         pst->gv_mean = (double *) HTS_calloc(pst->static_length, sizeof(double));
-         pst->gv_vari = (double *) HTS_calloc(pst->static_length, sizeof(double));
+         pst->gv_mean = (double *) HTS_Arena_alloc(arena, pst->static_length, sizeof(double));
+         pst->gv_vari = (double *) HTS_Arena_alloc(arena, pst->static_length, sizeof(double));
          for (j = 0; j < pst->static_length; j++) {
             pst->gv_mean[j] = HTS_SStreamSet_get_gv_mean(sss, i, j) * gv_weight[i];
             pst->gv_vari[j] = HTS_SStreamSet_get_gv_vari(sss, i, j);
          }
-         pst->gv_switch = (HTS_Boolean *) HTS_calloc(pst->length, sizeof(HTS_Boolean));
+         pst->gv_switch = (HTS_Boolean *) HTS_Arena_alloc(arena, pst->length, sizeof(HTS_Boolean));
          if (HTS_SStreamSet_is_msd(sss, i)) {   /* for MSD */
             for (state = 0, frame = 0, msd_frame = 0; state < HTS_SStreamSet_get_total_state(sss); state++)
                for (j = 0; j < HTS_SStreamSet_get_duration(sss, state); j++, frame++)
@@ -364,6 +495,10 @@ HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, do
          pst->gv_mean = NULL;
          pst->gv_vari = NULL;
       }
+      pst->tail = NULL;
+      pst->gv_center = NULL;
+      pst->gv_ratio = NULL;
+      pst->ready = 0;
       /* copy pdfs */
       if (HTS_SStreamSet_is_msd(sss, i)) {      /* for MSD */
          for (state = 0, frame = 0, msd_frame = 0; state < HTS_SStreamSet_get_total_state(sss); state++)
@@ -413,11 +548,70 @@ HTS_Boolean HTS_PStreamSet_create(HTS_PStreamSet * pss, HTS_SStreamSet * sss, do
             }
          }
       }
-      /* parameter generation */
-      HTS_PStream_mlpg(pst);
+      if (pss->lookahead > 0) {
+         /* streaming: frames are generated on demand by HTS_PStreamSet_generate(); until then they hold the static means */
+         /* (scaled by the GV approximation, so that they have the range of the final trajectory) */
+         if (pst->width > 1)
+            pst->tail = HTS_Arena_alloc_matrix(arena, pst->width - 1, pst->static_length);
+         for (j = 0; j < pst->length; j++)
+            for (k = 0; k < pst->static_length; k++)
+               pst->par[j][k] = pst->sm.mean[j][k];
+         if (pst->gv_length > 0) {
+            pst->gv_center = (double *) HTS_Arena_alloc(arena, pst->static_length, sizeof(double));
+            pst->gv_ratio = (double *) HTS_Arena_alloc(arena, pst->static_length, sizeof(double));
+            HTS_PStream_gv_model(pst);
+            for (j = 0; j < pst->length; j++)
+               if (pst->gv_switch[j])
+                  for (k = 0; k < pst->static_length; k++)
+                     pst->par[j][k] = pst->gv_ratio[k] * (pst->par[j][k] - pst->gv_center[k]) + pst->gv_center[k];
+         }
+         continue;
+      }
+      /* with threads, every stream is generated at once below */
+      if (nthread > 1 && pool != NULL)
+         continue;
+      /* parameter generation (skipped once stopped; the stream is still allocated so it can be cleared) */
+      if (stopped == FALSE)
+         HTS_PStream_mlpg(pst, stop);
+      if ((*stop) == TRUE)
+         stopped = TRUE;
+   }
+   if (pss->lookahead == 0 && nthread > 1 && pool != NULL) {
+      if ((*stop) == FALSE)
+         HTS_PStreamSet_mlpg(pss, nthread, pool, arena, stop);
+      if ((*stop) == TRUE)
+         stopped = TRUE;
+   }
+   pss->ready = pss->lookahead > 0 ? 0 : pss->total_frame;
+
+   return stopped == FALSE;
+}
+
+/* HTS_PStreamSet_generate: streaming, generate the parameters of the frames before frame; returns the number of frames ready */
+int HTS_PStreamSet_generate(HTS_PStreamSet * pss, int frame, volatile HTS_Boolean * stop)
+{
+   int i, j, f;
+   HTS_PStream *pst;
+
+   if (frame > pss->total_frame)
+      frame = pss->total_frame;
+   if (frame <= pss->ready)
+      return pss->ready;
+   for (i = 0; i < pss->nstream && (*stop) == FALSE; i++) {
+      pst = &pss->pstream[i];
+      if (pst->msd_flag) {      /* for MSD */
+         for (j = 0, f = 0; j < frame; j++)
+            if (pst->msd_flag[j])
+               f++;
+      } else                    /* for non MSD */
+         f = frame;
+      if (f > pst->ready)
+         HTS_PStream_mlpg_block(pst, f, pss->lookahead, stop);
    }
+   if ((*stop) == FALSE)
+      pss->ready = frame;
 
-   return TRUE;
+   return pss->ready;
 }
 
 /* HTS_PStreamSet_get_nstream: get number of stream */
@@ -462,39 +656,9 @@ HTS_Boolean HTS_PStreamSet_is_msd(HTS_PStreamSet * pss, int stream_index)
    return pss->pstream[stream_index].msd_flag ? TRUE : FALSE;
 }
 
-/* HTS_PStreamSet_clear: free parameter stream set */
+/* HTS_PStreamSet_clear: drop parameter stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_PStreamSet_clear(HTS_PStreamSet * pss)
 {
-   int i, j;
-   HTS_PStream *pstream;
-
-   if (pss->pstream) {
-      for (i = 0; i < pss->nstream; i++) {
-         pstream = &pss->pstream[i];
-         HTS_free(pstream->sm.wum);
-         HTS_free(pstream->sm.g);
-         HTS_free_matrix(pstream->sm.wuw, pstream->length);
-         HTS_free_matrix(pstream->sm.ivar, pstream->length);
-         HTS_free_matrix(pstream->sm.mean, pstream->length);
-         HTS_free_matrix(pstream->par, pstream->length);
-         if (pstream->msd_flag)
-            HTS_free(pstream->msd_flag);
-         for (j = pstream->win_size - 1; j >= 0; j--) {
-            pstream->win_coefficient[j] += pstream->win_l_width[j];
-            HTS_free(pstream->win_coefficient[j]);
-         }
-         if (pstream->gv_mean)
-            HTS_free(pstream->gv_mean);
-         if (pstream->gv_vari)
-            HTS_free(pstream->gv_vari);
-         HTS_free(pstream->win_coefficient);
-         HTS_free(pstream->win_l_width);
-         HTS_free(pstream->win_r_width);
-         if (pstream->gv_switch)
-            HTS_free(pstream->gv_switch);
-      }
-      HTS_free(pss->pstream);
-   }
    HTS_PStreamSet_initialize(pss);
 }
 
@@ -114,7 +114,8 @@ void HTS_SStreamSet_initialize(HTS_SStreamSet * sss)
 /* HTS_SStreamSet_create: parse label and determine state duration */
 HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
                            HTS_Label * label, double *duration_iw,
-                           double **parameter_iw, double **gv_iw)
+                           double **parameter_iw, double **gv_iw,
+                           HTS_Arena * arena, volatile HTS_Boolean * stop)
 {
    int i, j, k;
    double temp1, temp2;
@@ -126,31 +127,27 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
    int next_time;
    int next_state;
    int FUSION = 0; //Inaki, para fusionar duraciones
+   HTS_Boolean stopped = FALSE;
+   HTS_LabelMatch *match;
 
    /* initialize state sequence */
    sss->nstate = HTS_ModelSet_get_nstate(ms);
    sss->nstream = HTS_ModelSet_get_nstream(ms);
    sss->total_frame = 0;
    sss->total_state = HTS_Label_get_size(label) * sss->nstate;
-   sss->duration = (int *) HTS_calloc(sss->total_state, sizeof(int));
-   sss->sstream = (HTS_SStream *) HTS_calloc(sss->nstream, sizeof(HTS_SStream));
+   sss->duration = (int *) HTS_Arena_alloc(arena, sss->total_state, sizeof(int));
+   sss->sstream = (HTS_SStream *) HTS_Arena_alloc(arena, sss->nstream, sizeof(HTS_SStream));
    for (i = 0; i < sss->nstream; i++) {
       sst = &sss->sstream[i];
       sst->vector_length = HTS_ModelSet_get_vector_length(ms, i);
-      sst->mean = (double **) HTS_calloc(sss->total_state, sizeof(double *));
-      sst->vari = (double **) HTS_calloc(sss->total_state, sizeof(double *));
+      sst->mean = HTS_Arena_alloc_matrix(arena, sss->total_state, sst->vector_length);
+      sst->vari = HTS_Arena_alloc_matrix(arena, sss->total_state, sst->vector_length);
       if (HTS_ModelSet_is_msd(ms, i))
-         sst->msd = (double *) HTS_calloc(sss->total_state, sizeof(double));
+         sst->msd = (double *) HTS_Arena_alloc(arena, sss->total_state, sizeof(double));
       else
          sst->msd = NULL;
-      for (j = 0; j < sss->total_state; j++) {
-         sst->mean[j] =
-             (double *) HTS_calloc(sst->vector_length, sizeof(double));
-         sst->vari[j] =
-             (double *) HTS_calloc(sst->vector_length, sizeof(double));
-      }
       sst->gv_switch =
-          (HTS_Boolean *) HTS_calloc(sss->total_state, sizeof(HTS_Boolean));
+          (HTS_Boolean *) HTS_Arena_alloc(arena, sss->total_state, sizeof(HTS_Boolean));
       for (j = 0; j < sss->total_state; j++)
          sst->gv_switch[j] = TRUE;
    }
@@ -179,16 +176,21 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
       }
    }
 
+   /* scan each label once for the questions of every tree */
+   match = (HTS_LabelMatch *) HTS_Arena_alloc(arena, HTS_Label_get_size(label), sizeof(HTS_LabelMatch));
+   for (i = 0; i < HTS_Label_get_size(label); i++)
+      HTS_ModelSet_match_label(ms, HTS_Label_get_string(label, i), &match[i]);
+
    /* determine state duration */
    duration_mean =
-       (double *) HTS_calloc(sss->nstate * HTS_Label_get_size(label),
-                             sizeof(double));
+       (double *) HTS_Arena_alloc(arena, sss->nstate * HTS_Label_get_size(label),
+                                  sizeof(double));
    duration_vari =
-       (double *) HTS_calloc(sss->nstate * HTS_Label_get_size(label),
-                             sizeof(double));
+       (double *) HTS_Arena_alloc(arena, sss->nstate * HTS_Label_get_size(label),
+                                  sizeof(double));
    duration_remain = 0.0;
    for (i = 0; i < HTS_Label_get_size(label); i++)
-      HTS_ModelSet_get_duration(ms, HTS_Label_get_string(label, i),
+      HTS_ModelSet_get_duration(ms, &match[i],
                                 &duration_mean[i * sss->nstate],
                                 &duration_vari[i * sss->nstate], duration_iw);
    if (HTS_Label_get_frame_specified_flag(label)) {
@@ -269,22 +271,22 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
                        &duration_remain,
                        HTS_Label_get_size(label) * sss->nstate, frame_length);
    }
-   HTS_free(duration_mean);
-   HTS_free(duration_vari);
 
-   /* get parameter */
+   /* get parameter (the rest stays zero if stopped, but the frames are counted anyway) */
    for (i = 0, state = 0; i < HTS_Label_get_size(label); i++) {
+      if (stopped == FALSE && (*stop) == TRUE)
+         stopped = TRUE;
       for (j = 2; j <= sss->nstate + 1; j++) {
          sss->total_frame += sss->duration[state];
-         for (k = 0; k < sss->nstream; k++) {
+         for (k = 0; k < sss->nstream && stopped == FALSE; k++) {
             sst = &sss->sstream[k];
             if (sst->msd)
-               HTS_ModelSet_get_parameter(ms, HTS_Label_get_string(label, i),
+               HTS_ModelSet_get_parameter(ms, &match[i],
                                           sst->mean[state], sst->vari[state],
                                           &sst->msd[state], k, j,
                                           parameter_iw[k]);
             else
-               HTS_ModelSet_get_parameter(ms, HTS_Label_get_string(label, i),
+               HTS_ModelSet_get_parameter(ms, &match[i],
                                           sst->mean[state], sst->vari[state],
                                           NULL, k, j, parameter_iw[k]);
          }
@@ -297,20 +299,20 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
       sst = &sss->sstream[i];
       sst->win_size = HTS_ModelSet_get_window_size(ms, i);
       sst->win_max_width = HTS_ModelSet_get_window_max_width(ms, i);
-      sst->win_l_width = (int *) HTS_calloc(sst->win_size, sizeof(int));
-      sst->win_r_width = (int *) HTS_calloc(sst->win_size, sizeof(int));
+      sst->win_l_width = (int *) HTS_Arena_alloc(arena, sst->win_size, sizeof(int));
+      sst->win_r_width = (int *) HTS_Arena_alloc(arena, sst->win_size, sizeof(int));
       sst->win_coefficient =
-          (double **) HTS_calloc(sst->win_size, sizeof(double));
+          (double **) HTS_Arena_alloc(arena, sst->win_size, sizeof(double *));
       for (j = 0; j < sst->win_size; j++) {
          sst->win_l_width[j] = HTS_ModelSet_get_window_left_width(ms, i, j);
          sst->win_r_width[j] = HTS_ModelSet_get_window_right_width(ms, i, j);
          if (sst->win_l_width[j] + sst->win_r_width[j] == 0)
             sst->win_coefficient[j] =
-                (double *) HTS_calloc(-2 * sst->win_l_width[j] + 1,
-                                      sizeof(double));
+                (double *) HTS_Arena_alloc(arena, -2 * sst->win_l_width[j] + 1,
+                                           sizeof(double));
          else
             sst->win_coefficient[j] =
-                (double *) HTS_calloc(-2 * sst->win_l_width[j], sizeof(double));
+                (double *) HTS_Arena_alloc(arena, -2 * sst->win_l_width[j], sizeof(double));
          sst->win_coefficient[j] -= sst->win_l_width[j];
          for (k = sst->win_l_width[j]; k <= sst->win_r_width[j]; k++)
             sst->win_coefficient[j][k] =
@@ -323,12 +325,12 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
       sst = &sss->sstream[i];
       if (HTS_ModelSet_use_gv(ms, i)) {
          sst->gv_mean =
-             (double *) HTS_calloc(sst->vector_length / sst->win_size,
-                                   sizeof(double));
+             (double *) HTS_Arena_alloc(arena, sst->vector_length / sst->win_size,
+                                        sizeof(double));
          sst->gv_vari =
-             (double *) HTS_calloc(sst->vector_length / sst->win_size,
-                                   sizeof(double));
-         HTS_ModelSet_get_gv(ms, HTS_Label_get_string(label, 0), sst->gv_mean,
+             (double *) HTS_Arena_alloc(arena, sst->vector_length / sst->win_size,
+                                        sizeof(double));
+         HTS_ModelSet_get_gv(ms, &match[0], sst->gv_mean,
                              sst->gv_vari, i, gv_iw[i]);
       } else {
          sst->gv_mean = NULL;
@@ -338,13 +340,17 @@ HTS_Boolean HTS_SStreamSet_create(HTS_SStreamSet * sss, HTS_ModelSet * ms,
 
    if (HTS_ModelSet_have_gv_switch(ms) == TRUE)
       for (i = 0; i < HTS_Label_get_size(label); i++)
-         if (HTS_ModelSet_get_gv_switch(ms, HTS_Label_get_string(label, i)) ==
-             FALSE)
+         if (HTS_ModelSet_get_gv_switch(ms, &match[i]) == FALSE)
             for (j = 0; j < sss->nstream; j++)
                for (k = 0; k < sss->nstate; k++)
                   sss->sstream[j].gv_switch[i * sss->nstate + k] = FALSE;
 
-   return TRUE;
+   for (i = 0; i < HTS_Label_get_size(label); i++) {
+      HTS_ModelSet_cache_label(ms, &match[i]);
+      HTS_LabelMatch_clear(&match[i]);
+   }
+
+   return stopped == FALSE;
 }
 
 /* HTS_SStreamSet_get_nstream: get number of stream */
@@ -490,41 +496,9 @@ HTS_Boolean HTS_SStreamSet_get_gv_switch(HTS_SStreamSet * sss, int stream_index,
    return sss->sstream[stream_index].gv_switch[state_index];
 }
 
-/* HTS_SStreamSet_clear: free state stream set */
+/* HTS_SStreamSet_clear: drop state stream set, its buffers go back to the arena with HTS_Arena_reset */
 void HTS_SStreamSet_clear(HTS_SStreamSet * sss)
 {
-   int i, j;
-   HTS_SStream *sst;
-
-   if (sss->sstream) {
-      for (i = 0; i < sss->nstream; i++) {
-         sst = &sss->sstream[i];
-         for (j = 0; j < sss->total_state; j++) {
-            HTS_free(sst->mean[j]);
-            HTS_free(sst->vari[j]);
-         }
-         if (sst->msd)
-            HTS_free(sst->msd);
-         HTS_free(sst->mean);
-         HTS_free(sst->vari);
-         for (j = sst->win_size - 1; j >= 0; j--) {
-            sst->win_coefficient[j] += sst->win_l_width[j];
-            HTS_free(sst->win_coefficient[j]);
-         }
-         HTS_free(sst->win_coefficient);
-         HTS_free(sst->win_l_width);
-         HTS_free(sst->win_r_width);
-         if (sst->gv_mean)
-            HTS_free(sst->gv_mean);
-         if (sst->gv_vari)
-            HTS_free(sst->gv_vari);
-         HTS_free(sst->gv_switch);
-      }
-      HTS_free(sss->sstream);
-   }
-   if (sss->duration)
-      HTS_free(sss->duration);
-
    HTS_SStreamSet_initialize(sss);
 }
 
@@ -68,6 +68,15 @@ Codigo condicional........... -
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+0.1.1    16/10/26	Jonny     Buffers de los streams en el arena del motor, get("alloc_stats")
+0.1.0    16/10/26	Jonny     Imagen binaria de la voz (voice_image, voice_compile) mapeada en memoria
+0.0.9    16/10/26	Jonny     Parametro label_cache: cache de indices de pdf por etiqueta en la voz
+0.0.8    16/10/26	Jonny     Parametro mlpg_threads: generacion de parametros en paralelo
+0.0.7    16/10/26	Jonny     Parametro mlpg_lookahead: generacion de parametros en streaming
+0.0.6    16/10/26	Jonny     Parametro vocoder_frames: AhoCoder incremental en xinput_labels_stream
+0.0.5    16/10/26	Jonny     xinput_labels_stream: entrega las muestras desde el buffer del vocoder
+0.0.4    16/10/26	Jonny     Parametro seed: semilla del ruido de AhoCoder por motor
+0.0.3    16/10/26	Jonny     Modelos compartidos entre sesiones a traves de HTTS_DB
 0.0.2    08/11/11	Inaki     Funcion xinput_labels para sintetizar a partir de labels
 0.0.1    12/02/11	Inaki     Añadir stream para Frequency Voicing del Ahocoder
 0.0.0    15/12/10	Inaki     Codificacion inicial.
@@ -81,6 +90,7 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 /**********************************************************/
 
 /************************************************************************************************************************/
+#include <sys/stat.h>
 #include "hts.hpp"
 #ifdef HTTS_METHOD_HTS
 #ifdef WIN32
@@ -108,6 +118,11 @@ HTS_U2W::HTS_U2W(VOID )
    half_tone = 0.0;
    phoneme_alignment = FALSE;
    speech_speed = 1.0;
+   vocoder_seed = AHOCODER_DEFAULT_SEED;
+   vocoder_frames = 0;
+   mlpg_lookahead = 0;
+   mlpg_threads = 1;
+   label_cache = 0;
    use_log_gain = FALSE;
    fn_ms_gvl = NULL;
    fn_ms_gve = NULL;
@@ -116,6 +131,7 @@ HTS_U2W::HTS_U2W(VOID )
    fn_ts_gve = NULL;
    fn_ts_gvm = NULL;
    fn_gv_switch = NULL;
+   fn_voice_image = NULL;
    fn_ws_lf0 = NULL;
    fn_ws_mcp = NULL;
    fn_ws_exc = NULL;
@@ -153,6 +169,10 @@ HTS_U2W::HTS_U2W(VOID )
    /* delta window handler for mel-cepstrum */
 	fn_ws_exc = (char **) calloc(num_ws_exc , sizeof(char *));
 	HTS_ENGINE_INITIALIZED = FALSE;
+	db = NULL;
+	fbuf = NULL;
+	fbuf_len = 0;
+	cancelled = FALSE;
 
 #ifdef HTTS_INTERFACE_WAVEMARKS
     markMode="";
@@ -171,7 +191,9 @@ HTS_U2W::~HTS_U2W( VOID )
    //liberar memoria
 	free(Language);
 	 // free memory
-	HTS_Engine_clear(&engine);
+	if (HTS_ENGINE_INITIALIZED)
+		HTS_Engine_clear(&engine);
+	free(fbuf);
 	//free(rate_interp);
 	if(fn_ws_mcp)
 		free(*fn_ws_mcp);
@@ -193,6 +215,7 @@ HTS_U2W::~HTS_U2W( VOID )
 	free(*fn_ts_gvm);
 	free(*fn_ts_gvl);
 	free(*fn_ts_gve);
+	free(fn_voice_image);
 	// close files
 #ifndef HTS_EMBEDDED
    if (mcpfp != NULL)
@@ -428,6 +451,41 @@ BOOL HTS_U2W::set( const CHAR* param, const CHAR* val )
 		fn_gv_switch=strdup(val);
 		return TRUE;
 	}
+	else if (!strcmp(param,"voice_image")){		//voice image written by voice_compile, used instead of the model files if it is up to date
+		free(fn_voice_image);
+		fn_voice_image=strdup(val);
+		return TRUE;
+	}
+	else if (!strcmp(param, "seed")){		//seed of the vocoder noise: same seed and text, same samples
+		vocoder_seed=strtoul(val, NULL, 10);
+		if (HTS_ENGINE_INITIALIZED)
+			HTS_Engine_set_vocoder_seed(&engine, vocoder_seed);
+		return TRUE;
+	}
+	else if (!strcmp(param, "mlpg_lookahead")){		//streaming parameter generation, frames solved ahead of each block (0: whole utterance)
+		str2i(val, &mlpg_lookahead);
+		if (HTS_ENGINE_INITIALIZED)
+			HTS_Engine_set_mlpg_lookahead(&engine, mlpg_lookahead);
+		return TRUE;
+	}
+	else if (!strcmp(param, "mlpg_threads")){		//threads generating the parameters of an utterance, from a pool shared by every session (1: sequential)
+		str2i(val, &mlpg_threads);
+		if (HTS_ENGINE_INITIALIZED)
+			HTS_Engine_set_mlpg_threads(&engine, mlpg_threads);
+		return TRUE;
+	}
+	else if (!strcmp(param, "label_cache")){		//kB of the label -> pdf indices cache of the voice, shared by every session using it (0: no cache)
+		/* load-time option: applied by loadModels, so it is refused once the
+		voice is loaded. With an HTTS_DB the session that loads the voice sets it */
+		if (HTS_ENGINE_INITIALIZED)
+			return FALSE;
+		str2i(val, &label_cache);
+		return TRUE;
+	}
+	else if (!strcmp(param, "vocoder_frames")){		//frames vocoded between deliveries in xinput_labels_stream (0: whole utterance)
+		str2i(val, &vocoder_frames);
+		return TRUE;
+	}
 	else if (!strcmp(param, "z")){		//Audio buffer size
 		str2i(val, &audio_buff_size);
 		return TRUE;
@@ -488,6 +546,11 @@ BOOL HTS_U2W::set( const CHAR* param, const CHAR* val )
 
 		strcpy(tmp+len, "gv-switch.inf");
 		fn_gv_switch=strdup(tmp);
+
+		strcpy(tmp+len, "voice.htsimg");
+		free(fn_voice_image);
+		fn_voice_image=strdup(tmp);
+
 		strcpy(tmp+len, "lf0.win1");
 		fn_ws_lf0[0]=strdup(tmp);
 
@@ -563,8 +626,28 @@ const CHAR* HTS_U2W::get( const CHAR* param )
 	else if(!strcmp(param,"je")){ VALRET(gv_weight_exc);}
 
 	else if (!strcmp(param,"k")) return (const char*)fn_gv_switch;
+	else if (!strcmp(param,"voice_image")) return (const char*)fn_voice_image;
 	else if (!strcmp(param,"z")) { VALRET(audio_buff_size); }
 	else if (!strcmp(param,"vp")) return bool2str(phoneme_alignment);
+	else if (!strcmp(param,"label_cache_stats")) {
+		unsigned long hits, misses, evictions;
+		int entries;
+		size_t bytes;
+		if (!HTS_ENGINE_INITIALIZED || !HTS_ModelSet_get_label_cache_stats(&engine.ms, &hits, &misses, &evictions, &entries, &bytes))
+			return NULL;
+		sprintf(label_cache_stats, "hits=%lu misses=%lu evictions=%lu entries=%d bytes=%lu",
+				hits, misses, evictions, entries, (unsigned long)bytes);
+		return label_cache_stats;
+	}
+	else if (!strcmp(param,"alloc_stats")) {	//buffers, reservas del heap y bytes de los streams de la ultima frase
+		int nalloc, nheap;
+		size_t bytes;
+		if (!HTS_ENGINE_INITIALIZED)
+			return NULL;
+		HTS_Engine_get_alloc_stats(&engine, &nalloc, &nheap, &bytes);
+		sprintf(alloc_stats, "buffers=%d heap=%d bytes=%lu", nalloc, nheap, (unsigned long)bytes);
+		return alloc_stats;
+	}
 
     //if (!strcmp(param,"ModifDur")) return bool2str(MODIF_DUR);
 
@@ -572,82 +655,210 @@ const CHAR* HTS_U2W::get( const CHAR* param )
 }
 /**********************************************************/
 
+/************************************************************************************************************************/
+/* Carga los modelos de la voz: de su imagen si la hay y esta al dia, si no
+de los ficheros de modelos */
+BOOL HTS_U2W::loadModels(HTS_Engine *e){
+	BOOL ok = loadImage(e) || loadModelFiles(e);
+	/* cache de etiquetas, la comparten las sesiones que usen estos modelos */
+	if (ok && label_cache > 0)
+		HTS_ModelSet_set_label_cache(&e->ms, (size_t)label_cache * 1024);
+	return ok;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Carga la imagen de la voz escrita por voice_compile. Se mapea en memoria de
+solo lectura: no se interpreta ningun fichero de texto y sus paginas las
+comparten todos los procesos que usen la voz */
+BOOL HTS_U2W::loadImage(HTS_Engine *e){
+	int nstream;
+
+	if (!imageIsCurrent())
+		return FALSE;
+	nstream = HTS_Engine_get_image_nstream(fn_voice_image);
+	if (nstream <= 0) {
+		fprintf(stderr, "Warning: %s is not a voice image of this version, the voice is loaded from the model files\n", fn_voice_image);
+		return FALSE;
+	}
+	HTS_Engine_initialize(e, nstream);
+	if (HTS_Engine_load_image_from_fn(e, fn_voice_image))
+		return TRUE;
+	HTS_Engine_clear(e);
+	return FALSE;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* La imagen vale si existe y no es anterior a ninguno de los ficheros de
+modelos que haya */
+BOOL HTS_U2W::imageIsCurrent(VOID){
+	struct stat image, model;
+	const CHAR *files[64];
+	INT i, n;
+
+	if (fn_voice_image == NULL || stat(fn_voice_image, &image) != 0)
+		return FALSE;
+	n = modelFiles(files, 64);
+	for (i = 0; i < n; i++)
+		if (files[i] && stat(files[i], &model) == 0 && model.st_mtime > image.st_mtime) {
+			fprintf(stderr, "Warning: %s is older than %s, the voice is loaded from the model files\n", fn_voice_image, files[i]);
+			return FALSE;
+		}
+	return TRUE;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Carga en {e} los modelos de la voz (duracion, parametros, GV y GV switch)
+a partir de los nombres de fichero configurados. Con el fichero de arboles
+de excitacion se usan 3 streams, si no 2 */
+BOOL HTS_U2W::loadModelFiles(HTS_Engine *e){
+	BOOL ok=TRUE;
+	 /* initialize (stream[0] = spectrum , stream[1] = lf0) */
+	int with_excitation = 0;
+	FILE *tmp;
+	tmp=fopen(fn_ts_exc[0], "rb");
+	if ( tmp != NULL){
+		fclose(tmp);
+		with_excitation = 1;
+		HTS_Engine_initialize(e, 3);
+	}
+	else{
+		HTS_Engine_initialize(e, 2);
+	}
+	/* load duration model */
+	ok = ok && HTS_Engine_load_duration_from_fn(e, fn_ms_dur, fn_ts_dur, num_interp);
+	/* load stream[0] (spectrum model) */
+	ok = ok && HTS_Engine_load_parameter_from_fn(e, fn_ms_mcp, fn_ts_mcp, fn_ws_mcp,
+									 0, FALSE, num_ws_mcp, num_interp);
+	/* load stream[1] (lf0 model) */
+	ok = ok && HTS_Engine_load_parameter_from_fn(e, fn_ms_lf0, fn_ts_lf0, fn_ws_lf0,
+									 1, TRUE, num_ws_lf0, num_interp);
+	/* load gv[0] (GV for spectrum) */
+	HTS_Engine_load_gv_from_fn(e, fn_ms_gvm, fn_ts_gvm, 0,
+									num_interp);
+	/* load gv[1] (GV for lf0) */
+	HTS_Engine_load_gv_from_fn(e, fn_ms_gvl, fn_ts_gvl, 1,
+									num_interp);
+	if ( with_excitation == 1 ){
+		/* load stream[2] (excitation model) */
+		ok = ok && HTS_Engine_load_parameter_from_fn(e, fn_ms_exc, fn_ts_exc, fn_ws_exc, 2, FALSE, num_ws_exc, num_interp);
+		HTS_Engine_load_gv_from_fn(e, fn_ms_gve, fn_ts_gve, 2, num_interp);
+	}
+	/* load GV switch */
+	if (fn_gv_switch != NULL)
+		HTS_Engine_load_gv_switch_from_fn(e, fn_gv_switch);
+	return ok;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Ficheros de modelos de la voz, como mucho {max}; NULL los que no se usan.
+Devuelve cuantos hay */
+INT HTS_U2W::modelFiles(const CHAR **files, INT max){
+	char **fn[] = { fn_ms_dur, fn_ts_dur, fn_ms_mcp, fn_ts_mcp, fn_ms_lf0, fn_ts_lf0,
+		fn_ms_exc, fn_ts_exc, fn_ms_gvm, fn_ts_gvm, fn_ms_gvl, fn_ts_gvl, fn_ms_gve, fn_ts_gve };
+	char **ws[] = { fn_ws_mcp, fn_ws_lf0, fn_ws_exc };
+	int nws[] = { num_ws_mcp, num_ws_lf0, num_ws_exc };
+	unsigned int i;
+	int j, n = 0;
+
+	for (i = 0; i < sizeof(fn)/sizeof(fn[0]) && n < max; i++)
+		files[n++] = fn[i][0];
+	for (i = 0; i < sizeof(ws)/sizeof(ws[0]); i++)
+		for (j = 0; j < nws[i] && n < max; j++)
+			files[n++] = ws[i][j];
+	if (n < max)
+		files[n++] = fn_gv_switch;
+	return n;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Identifica la voz por los ficheros de los que se carga */
+VOID HTS_U2W::voiceKey(String &key){
+	const CHAR *files[64];
+	INT i, n = modelFiles(files, 64);
+
+	key="";
+	for (i = 0; i < n; i++) {
+		if (files[i]) key += files[i];
+		key += "\n";
+	}
+	if (fn_voice_image) key += fn_voice_image;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Prepara el motor antes de la primera sintesis. Si hay una HTTS_DB, los
+modelos se cargan una sola vez en ella y este motor solo los lee; los
+parametros de sintesis y los pesos de interpolacion son siempre propios */
+VOID HTS_U2W::initEngine(VOID){
+	HTS_Engine *voice = NULL;
+	int with_excitation;
+
+	if (db) {
+		String key;
+		voiceKey(key);
+		voice = db->getVoice(fn_ms_dur[0] ? (const CHAR *)key : NULL, this);
+	}
+	if (voice) {
+		HTS_Engine_initialize(&engine, HTS_ModelSet_get_nstream(&voice->ms));
+		HTS_Engine_share_model(&engine, voice);
+	}
+	else
+		loadModels(&engine);
+	with_excitation = (HTS_ModelSet_get_nstream(&engine.ms) == 3);
+
+	/* set parameter */
+	HTS_Engine_set_sampling_rate(&engine, sampling_rate);
+	HTS_Engine_set_fperiod(&engine, fperiod);
+	HTS_Engine_set_alpha(&engine, alpha);
+	HTS_Engine_set_gamma(&engine, stage);
+	HTS_Engine_set_log_gain(&engine, use_log_gain);
+	HTS_Engine_set_beta(&engine, beta);
+	HTS_Engine_set_audio_buff_size(&engine, audio_buff_size);
+	HTS_Engine_set_msd_threshold(&engine, 1, uv_threshold);      /* set voiced/unvoiced threshold for stream[1] */
+	HTS_Engine_set_gv_weight(&engine, 0, gv_weight_mcp);
+	HTS_Engine_set_gv_weight(&engine, 1, gv_weight_lf0);
+	if ( with_excitation == 1 )
+		HTS_Engine_set_gv_weight(&engine, 2, gv_weight_exc);
+	HTS_Engine_set_vocoder_seed(&engine, vocoder_seed);
+	HTS_Engine_set_mlpg_lookahead(&engine, mlpg_lookahead);
+	HTS_Engine_set_mlpg_threads(&engine, mlpg_threads);
+
+	//int i;
+	//for (i = 0; i < num_interp; i++) {
+		HTS_Engine_set_duration_interpolation_weight(&engine, 0, 1.0);
+		HTS_Engine_set_parameter_interpolation_weight(&engine, 0, 0,
+													1.0);
+		HTS_Engine_set_parameter_interpolation_weight(&engine, 1, 0,
+													1.0);
+		if ( with_excitation == 1 )
+			HTS_Engine_set_parameter_interpolation_weight(&engine, 2, 0, 1.0);
+	//}
+	if (num_interp == num_ms_gvm)
+		//for (i = 0; i < num_interp; i++)
+			HTS_Engine_set_gv_interpolation_weight(&engine, 0, 0, 1.0);
+	if (num_interp == num_ms_gvl)
+		//for (i = 0; i < num_interp; i++)
+			HTS_Engine_set_gv_interpolation_weight(&engine, 1, 0, 1.0);
+	if (with_excitation == 1)
+		HTS_Engine_set_gv_interpolation_weight(&engine, 2, 0, 1.0);
+
+	HTS_ENGINE_INITIALIZED = TRUE;
+}
+/************************************************************************************************************************/
+
 /************************************************************************************************************************/
 BOOL HTS_U2W::xinput (Utt *u) {
 	//fprintf(stderr,"HTS_U2W::xinput()\n");
     if (ut) {
 		return FALSE; //si ya tenemos una frase, no se aceptan mas
     }
-	if (!HTS_ENGINE_INITIALIZED ){
-		 /* initialize (stream[0] = spectrum , stream[1] = lf0) */
-		int with_excitation = 0;
-		FILE *tmp;
-		tmp=fopen(fn_ts_exc[0], "rb");
-		if ( tmp != NULL){
-			fclose(tmp);
-			with_excitation = 1;
-			HTS_Engine_initialize(&engine, 3);
-		}
-		else{
-			HTS_Engine_initialize(&engine, 2);
-		}
-		/* load duration model */
-		HTS_Engine_load_duration_from_fn(&engine, fn_ms_dur, fn_ts_dur, num_interp);
-		/* load stream[0] (spectrum model) */
-		HTS_Engine_load_parameter_from_fn(&engine, fn_ms_mcp, fn_ts_mcp, fn_ws_mcp,
-										 0, FALSE, num_ws_mcp, num_interp);
-		/* load stream[1] (lf0 model) */
-		HTS_Engine_load_parameter_from_fn(&engine, fn_ms_lf0, fn_ts_lf0, fn_ws_lf0,
-										 1, TRUE, num_ws_lf0, num_interp);
-		/* load gv[0] (GV for spectrum) */
-		HTS_Engine_load_gv_from_fn(&engine, fn_ms_gvm, fn_ts_gvm, 0,
-										num_interp);
-		/* load gv[1] (GV for lf0) */
-		HTS_Engine_load_gv_from_fn(&engine, fn_ms_gvl, fn_ts_gvl, 1,
-										num_interp);
-		if ( with_excitation == 1 ){
-			/* load stream[2] (excitation model) */
-			HTS_Engine_load_parameter_from_fn(&engine, fn_ms_exc, fn_ts_exc, fn_ws_exc, 2, FALSE, num_ws_exc, num_interp);
-			HTS_Engine_load_gv_from_fn(&engine, fn_ms_gve, fn_ts_gve, 2, num_interp);
-		}
-		/* load GV switch */
-		if (fn_gv_switch != NULL)
-			HTS_Engine_load_gv_switch_from_fn(&engine, fn_gv_switch);
-		/* set parameter */
-		HTS_Engine_set_sampling_rate(&engine, sampling_rate);
-		HTS_Engine_set_fperiod(&engine, fperiod);
-		HTS_Engine_set_alpha(&engine, alpha);
-		HTS_Engine_set_gamma(&engine, stage);
-		HTS_Engine_set_log_gain(&engine, use_log_gain);
-		HTS_Engine_set_beta(&engine, beta);
-		HTS_Engine_set_audio_buff_size(&engine, audio_buff_size);
-		HTS_Engine_set_msd_threshold(&engine, 1, uv_threshold);      /* set voiced/unvoiced threshold for stream[1] */
-		HTS_Engine_set_gv_weight(&engine, 0, gv_weight_mcp);
-		HTS_Engine_set_gv_weight(&engine, 1, gv_weight_lf0);
-		if ( with_excitation == 1 )
-			HTS_Engine_set_gv_weight(&engine, 2, gv_weight_exc);
-
-		//int i;
-		//for (i = 0; i < num_interp; i++) {
-			HTS_Engine_set_duration_interpolation_weight(&engine, 0, 1.0);
-			HTS_Engine_set_parameter_interpolation_weight(&engine, 0, 0,
-														1.0);
-			HTS_Engine_set_parameter_interpolation_weight(&engine, 1, 0,
-														1.0);
-			if ( with_excitation == 1 )
-				HTS_Engine_set_parameter_interpolation_weight(&engine, 2, 0, 1.0);
-		//}
-		if (num_interp == num_ms_gvm)
-			//for (i = 0; i < num_interp; i++)
-				HTS_Engine_set_gv_interpolation_weight(&engine, 0, 0, 1.0);
-		if (num_interp == num_ms_gvl)
-			//for (i = 0; i < num_interp; i++)
-				HTS_Engine_set_gv_interpolation_weight(&engine, 1, 0, 1.0);
-		if (with_excitation == 1)
-			HTS_Engine_set_gv_interpolation_weight(&engine, 2, 0, 1.0);
-
-		HTS_ENGINE_INITIALIZED = TRUE;
-	}
+	if (!HTS_ENGINE_INITIALIZED)
+		initEngine();
 
     assert (u->isKindOf("UttPh"));
     ut=(UttPh*)u;
@@ -723,78 +934,25 @@ BOOL HTS_U2W::xinput (Utt *u) {
 /************************************************************************************************************************/
 
 /************************************************************************************************************************/
-short int * HTS_U2W::xinput_labels(String labels, int  *num_muestras){
-	//fprintf(stderr,"HTS_U2W::xinput()\n");
-	if (!HTS_ENGINE_INITIALIZED ){
-		 /* initialize (stream[0] = spectrum , stream[1] = lf0) */
-		int with_excitation = 0;
-		FILE *tmp;
-		tmp=fopen(fn_ts_exc[0], "rb");
-		if ( tmp != NULL){
-			fclose(tmp);
-			with_excitation = 1;
-			HTS_Engine_initialize(&engine, 3);
-		}
-		else{
-			HTS_Engine_initialize(&engine, 2);
-		}
-		/* load duration model */
-		HTS_Engine_load_duration_from_fn(&engine, fn_ms_dur, fn_ts_dur, num_interp);
-		/* load stream[0] (spectrum model) */
-		HTS_Engine_load_parameter_from_fn(&engine, fn_ms_mcp, fn_ts_mcp, fn_ws_mcp,
-										 0, FALSE, num_ws_mcp, num_interp);
-		/* load stream[1] (lf0 model) */
-		HTS_Engine_load_parameter_from_fn(&engine, fn_ms_lf0, fn_ts_lf0, fn_ws_lf0,
-										 1, TRUE, num_ws_lf0, num_interp);
-		/* load gv[0] (GV for spectrum) */
-		HTS_Engine_load_gv_from_fn(&engine, fn_ms_gvm, fn_ts_gvm, 0,
-										num_interp);
-		/* load gv[1] (GV for lf0) */
-		HTS_Engine_load_gv_from_fn(&engine, fn_ms_gvl, fn_ts_gvl, 1,
-										num_interp);
-		if ( with_excitation == 1 ){
-			/* load stream[2] (excitation model) */
-			HTS_Engine_load_parameter_from_fn(&engine, fn_ms_exc, fn_ts_exc, fn_ws_exc, 2, FALSE, num_ws_exc, num_interp);
-			HTS_Engine_load_gv_from_fn(&engine, fn_ms_gve, fn_ts_gve, 2, num_interp);
-		}
-		/* load GV switch */
-		if (fn_gv_switch != NULL)
-			HTS_Engine_load_gv_switch_from_fn(&engine, fn_gv_switch);
-		/* set parameter */
-		HTS_Engine_set_sampling_rate(&engine, sampling_rate);
-		HTS_Engine_set_fperiod(&engine, fperiod);
-		HTS_Engine_set_alpha(&engine, alpha);
-		HTS_Engine_set_gamma(&engine, stage);
-		HTS_Engine_set_log_gain(&engine, use_log_gain);
-		HTS_Engine_set_beta(&engine, beta);
-		HTS_Engine_set_audio_buff_size(&engine, audio_buff_size);
-		HTS_Engine_set_msd_threshold(&engine, 1, uv_threshold);      /* set voiced/unvoiced threshold for stream[1] */
-		HTS_Engine_set_gv_weight(&engine, 0, gv_weight_mcp);
-		HTS_Engine_set_gv_weight(&engine, 1, gv_weight_lf0);
-		if ( with_excitation == 1 )
-			HTS_Engine_set_gv_weight(&engine, 2, gv_weight_exc);
-
-		//int i;
-		//for (i = 0; i < num_interp; i++) {
-			HTS_Engine_set_duration_interpolation_weight(&engine, 0, 1.0);
-			HTS_Engine_set_parameter_interpolation_weight(&engine, 0, 0,
-														1.0);
-			HTS_Engine_set_parameter_interpolation_weight(&engine, 1, 0,
-														1.0);
-			if ( with_excitation == 1 )
-				HTS_Engine_set_parameter_interpolation_weight(&engine, 2, 0, 1.0);
-		//}
-		if (num_interp == num_ms_gvm)
-			//for (i = 0; i < num_interp; i++)
-				HTS_Engine_set_gv_interpolation_weight(&engine, 0, 0, 1.0);
-		if (num_interp == num_ms_gvl)
-			//for (i = 0; i < num_interp; i++)
-				HTS_Engine_set_gv_interpolation_weight(&engine, 1, 0, 1.0);
-		if (with_excitation == 1)
-			HTS_Engine_set_gv_interpolation_weight(&engine, 2, 0, 1.0);
-
-		HTS_ENGINE_INITIALIZED = TRUE;
-	}
+/* Pide ({on}=TRUE) o retira la cancelacion de la sintesis. Se puede llamar
+desde otro thread: la frase en curso se corta en el siguiente label de
+sstream, dimension de MLPG o trama del vocoder, y las siguientes no se
+sintetizan hasta que se retire */
+VOID HTS_U2W::cancel(BOOL on){
+	cancelled = on;
+	if (HTS_ENGINE_INITIALIZED)
+		HTS_Engine_set_stop_flag(&engine, on);
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Sintetiza la frase descrita por {labels}. Las muestras quedan en el
+buffer de salida del vocoder (engine.gss.gspeech) hasta release_labels(),
+al que hay que llamar siempre.
+{devuelve} el numero de muestras, o -1 si se ha cancelado */
+int HTS_U2W::generate_labels(String &labels){
+	if (!HTS_ENGINE_INITIALIZED)
+		initEngine();
 
 	BOOL setdur=TRUE;//TRUE;
     //convertir de pho a formato de label adecuado para HTS-engine
@@ -808,7 +966,10 @@ short int * HTS_U2W::xinput_labels(String labels, int  *num_muestras){
 		HTS_Label_set_frame_specified_flag(&engine.label, TRUE);
 	if (speech_speed != 1.0)     /* modify label */
 		HTS_Label_set_speech_speed(&engine.label, speech_speed);
-	HTS_Engine_create_sstream(&engine);  /* parse label and determine state duration */
+	if (cancelled)  // cancel() antes de tener el motor, o tras el refresh de la frase anterior
+		HTS_Engine_set_stop_flag(&engine, TRUE);
+	if (!HTS_Engine_create_sstream(&engine))  /* parse label and determine state duration */
+		return -1;
 	double f;
 	int i;
 	if (half_tone != 0.0) {      /* modify f0 */
@@ -820,39 +981,24 @@ short int * HTS_U2W::xinput_labels(String labels, int  *num_muestras){
 			HTS_SStreamSet_set_mean(&engine.sss, 1, i, 0, f);
 		}
 	}
-	HTS_Engine_create_pstream(&engine);  /* generate speech parameter vector sequence */
-	HTS_Engine_create_gstream(&engine);  /* synthesize speech */
-
-
-		//HTS_GStreamSet_create
-			//HTS_Vocoder_synthesize --> gss->gspeech[] --> aquí se almacenan las muestras y con HTS_Engine_save_generated_speech se guardan en wav
-				//para ello usan HTS_GStreamSet_get_speech que va devolviendo muestra a muestra hasta HTS_GStreamSet_get_total_nsample(gss). Las guardan en short, habrá que convertir a double
-					// double(muestra_short / 32767.0);
-	//escribir en nuestro wav
-	short temp;
-	//reservar memoria
-	//wav_nready=0;
-    //wav_nused=0;
-    *num_muestras= HTS_GStreamSet_get_total_nsample(&(engine.gss));
-    short *wav_buffer = (short *)malloc(sizeof(short) * (*num_muestras) );
+	if (!HTS_Engine_create_pstream(&engine))  /* generate speech parameter vector sequence */
+		return -1;
+	if (!HTS_Engine_create_gstream(&engine))  /* synthesize speech */
+		return -1;
+	return HTS_GStreamSet_get_total_nsample(&(engine.gss));
+}
+/************************************************************************************************************************/
 
-	//setBufSize(HTS_GStreamSet_get_total_nsample(&(engine.gss)) , 0);
-	for(i = 0; i < HTS_GStreamSet_get_total_nsample(&(engine.gss)); ++i){
-		temp = HTS_GStreamSet_get_speech(&(engine.gss), i);
-	//	wav_buf[ i ] = double ( temp / 32768.0 );
-		wav_buffer[ i ] = temp ;
-		//fprintf(stderr,"%f ", wav_buf[i]);
-	}
-	//fprintf(stderr,"\n");
-	//wav_nready=HTS_GStreamSet_get_total_nsample(&(engine.gss)) ;
-    //wav_nused=HTS_GStreamSet_get_total_nsample(&(engine.gss)) ;
-    //wav_nlen=0;
+/************************************************************************************************************************/
+/* Libera la frase sintetizada con generate_labels(), tras volcar la informacion
+pedida a ficheros de traza */
+void HTS_U2W::release_labels(void){
 	  /* output */
 	if (tracefp != NULL)
 		HTS_Engine_save_information(&engine, tracefp);
 	if (durfp != NULL)
 		HTS_Engine_save_label(&engine, durfp);
-	if (rawfp)
+	if (rawfp && engine.gss.gspeech)  //con el vocoder incremental no queda la frase entera
 		HTS_Engine_save_generated_speech(&engine, rawfp);
 	//if (wavfp)
 		//HTS_Engine_save_riff(&engine, wavfp);
@@ -866,9 +1012,101 @@ short int * HTS_U2W::xinput_labels(String labels, int  *num_muestras){
 #endif
 	/* free */
 	HTS_Engine_refresh(&engine); //borra los labels y los streams generados
-	//return wav_buf;
+}
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+short int * HTS_U2W::xinput_labels(String labels, int  *num_muestras){
+	//fprintf(stderr,"HTS_U2W::xinput()\n");
+	*num_muestras = generate_labels(labels);
+	if (*num_muestras < 0)  //cancelada: frase vacia
+		*num_muestras = 0;
+	//copia para el llamador, que la libera con free()
+	short *wav_buffer = (short *)malloc(sizeof(short) * (*num_muestras) );
+	memcpy(wav_buffer, engine.gss.gspeech, sizeof(short) * (*num_muestras));
+	release_labels();
 	return wav_buffer;
 }
+/************************************************************************************************************************/
+
+/************************************************************************************************************************/
+/* Entrega a {sink} las {n} muestras de {speech} en trozos de como mucho
+{chunk_ms} milisegundos (0: todas de una vez). En formato HTTS_SAMPLES_F32
+cada trozo se convierte a float en un buffer propio que se reutiliza.
+{devuelve} FALSE si {sink} ha pedido parar */
+BOOL HTS_U2W::deliver(const short *speech, int n, HTTSSink sink, VOID *user, INT chunk_ms, INT format){
+	int len, pos, i;
+	BOOL go = TRUE;
+
+	len = chunk_ms > 0 ? (int)((long)chunk_ms * engine.global.sampling_rate / 1000) : n;
+	if (len < 1)
+		len = 1;
+	if (format == HTTS_SAMPLES_F32 && (len < n ? len : n) > fbuf_len) {
+		fbuf_len = len < n ? len : n;
+		fbuf = (float *)realloc(fbuf, fbuf_len * sizeof(float));
+	}
+	for (pos = 0; pos < n && go; pos += len) {
+		int m = n - pos < len ? n - pos : len;
+		if (format == HTTS_SAMPLES_F32) {
+			for (i = 0; i < m; i++)
+				fbuf[i] = speech[pos + i] * (1.0f / 32768.0f);
+			go = sink(NULL, fbuf, m, user);
+		}
+		else
+			go = sink(speech + pos, NULL, m, user);
+	}
+	return go;
+}
+/************************************************************************************************************************/
+
+//destino de la salida incremental de AhoCoder durante xinput_labels_stream
+struct VocoderOut {
+	HTS_U2W *u2w;
+	HTTSSink sink;
+	VOID *user;
+	INT chunk_ms, format;
+	int n;
+};
+
+HTS_Boolean HTS_U2W::vocoder_out(const short *s, unsigned int n, void *user){
+	VocoderOut *o = (VocoderOut *)user;
+	o->n += n;
+	return o->u2w->deliver(s, n, o->sink, o->user, o->chunk_ms, o->format) ? TRUE : FALSE;
+}
+
+/************************************************************************************************************************/
+/* Sintetiza la frase descrita por {labels} y entrega las muestras a {sink}
+en trozos de como mucho {chunk_ms} milisegundos (0: tal como salen). Si se ha
+dado vocoder_frames, AhoCoder las entrega cada tantas tramas segun las va
+generando, sin esperar al final de la frase ni guardarla entera (el nivel
+sale entonces de una cota del pico en vez de normalizar la frase, y puede
+quedar unos dB por debajo); si no, salen directamente del buffer de la frase.
+Con mlpg_lookahead los parametros los genera el vocoder bajo demanda.
+{devuelve} el numero de muestras entregadas, o -1 si {sink} ha pedido parar
+o se ha cancelado la sintesis */
+int HTS_U2W::xinput_labels_stream(String labels, HTTSSink sink, VOID *user, INT chunk_ms, INT format){
+	int n;
+	BOOL go;
+
+	if (vocoder_frames > 0) {
+		VocoderOut o = { this, sink, user, chunk_ms, format, 0 };
+		if (!HTS_ENGINE_INITIALIZED)
+			initEngine();
+		HTS_Engine_set_vocoder_output(&engine, vocoder_frames, vocoder_out, &o);
+		n = generate_labels(labels);
+		HTS_Engine_set_vocoder_output(&engine, 0, NULL, NULL);
+		release_labels();
+		return n < 0 ? -1 : o.n;
+	}
+	n = generate_labels(labels);
+	if (n < 0) {
+		release_labels();
+		return -1;
+	}
+	go = deliver(engine.gss.gspeech, n, sink, user, chunk_ms, format);
+	release_labels();
+	return go ? n : -1;
+}
 
 /**********************************************************/
 // SINTETIZA UN FONEMA
@@ -70,6 +70,15 @@ Codigo condicional........... -
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+0.1.1    16/10/26	Jonny     Buffers de los streams en el arena del motor, get("alloc_stats")
+0.1.0    16/10/26	Jonny     Imagen binaria de la voz (voice_image, voice_compile) mapeada en memoria
+0.0.9    16/10/26	Jonny     Parametro label_cache: cache de indices de pdf por etiqueta en la voz
+0.0.8    16/10/26	Jonny     Parametro mlpg_threads: generacion de parametros en paralelo
+0.0.7    16/10/26	Jonny     Parametro mlpg_lookahead: generacion de parametros en streaming
+0.0.6    16/10/26	Jonny     Parametro vocoder_frames: AhoCoder incremental en xinput_labels_stream
+0.0.5    16/10/26	Jonny     xinput_labels_stream: entrega las muestras desde el buffer del vocoder
+0.0.4    16/10/26	Jonny     Parametro seed: semilla del ruido de AhoCoder por motor
+0.0.3    16/10/26	Jonny     Modelos compartidos entre sesiones a traves de HTTS_DB
 0.0.2    08/11/11	Inaki     Funcion xinput_labels para sintetizar a partir de labels
 0.0.1    10/02/11	Inaki     Añadir stream de Frequency Voicing para AhoCoder
 0.0.0    15/12/10	Inaki     Codificacion inicial.
@@ -111,6 +120,8 @@ extern "C"{
 //#include "str2win.h"
 //#include "aholib.hpp"
 #include "uti.h"
+#include "httsdb.hpp"
+#include "htts.hpp"
 class HTS_U2W : public Utt2Wav {
 protected:
 	char *Language;
@@ -140,6 +151,13 @@ protected:
    HTS_Boolean phoneme_alignment;
    double speech_speed;
    HTS_Boolean use_log_gain;
+   unsigned long vocoder_seed;   /* semilla del ruido de AhoCoder */
+   int vocoder_frames;           /* tramas entre entregas de AhoCoder en xinput_labels_stream (0: frase entera) */
+   int mlpg_lookahead;           /* tramas por delante en la generacion de parametros en streaming (0: frase entera) */
+   int mlpg_threads;             /* hilos que generan los parametros de una frase (1: secuencial) */
+   int label_cache;              /* kB de la cache de indices de pdf por etiqueta de la voz (0: sin cache), solo al cargarla */
+   char label_cache_stats[128];  /* respuesta de get("label_cache_stats") */
+   char alloc_stats[128];        /* respuesta de get("alloc_stats") */
 
 
    #ifndef HTS_EMBEDDED
@@ -158,6 +176,8 @@ protected:
 
 	/* file name of global variance switch */
    char *fn_gv_switch;
+	/* file name of the voice image (voice_compile), used instead of the model files if it is up to date */
+   char *fn_voice_image;
 	/* file names of models */
    char **fn_ms_lf0;
    char **fn_ms_mcp;
@@ -183,6 +203,7 @@ protected:
    char **fn_ts_gve;
 
 	BOOL HTS_ENGINE_INITIALIZED; //cuando está deshabilitado cargamos toda la configuración
+	HTTS_DB *db; //si no es NULL, los modelos se comparten a traves de db
 #ifdef HTTS_INTERFACE_WAVEMARKS
   String markMode;
   BOOL mrkUsePrefix; // prefijos de tipo a cada marca
@@ -194,6 +215,11 @@ protected:
 #endif
 	String labels_string;
 	HTS_Engine engine;
+	float *fbuf; //trozo convertido a float para xinput_labels_stream, solo crece
+	int fbuf_len;
+	volatile BOOL cancelled; //cancel() pendiente, se aplica a cada frase
+	BOOL deliver (const short *speech, int n, HTTSSink sink, VOID *user, INT chunk_ms, INT format);
+	static HTS_Boolean vocoder_out (const short *s, unsigned int n, void *user);
 protected:
 
 
@@ -201,6 +227,12 @@ protected:
   virtual VOID reset (VOID);
   BOOL xinput (Utt *u);
   virtual BOOL doNext (BOOL flush);
+  VOID initEngine (VOID);
+  VOID voiceKey (String &key);
+  INT modelFiles (const CHAR **files, INT max);
+  BOOL imageIsCurrent (VOID);
+  BOOL loadImage (HTS_Engine *e);
+  BOOL loadModelFiles (HTS_Engine *e);
   //virtual VOID shiftedWav (INT n);
 
   //funciones HTS_engine
@@ -210,8 +242,14 @@ public:
    HTS_U2W ( VOID );
   ~HTS_U2W ( );
    virtual BOOL create (const char * lang);
+   VOID setDB (HTTS_DB *db) { this->db=db; }
+   BOOL loadModels (HTS_Engine *e);
 	//FUNCIONES
   short * xinput_labels (String labels, int * num_samples);
+  int xinput_labels_stream (String labels, HTTSSink sink, VOID *user, INT chunk_ms, INT format);
+  int generate_labels (String &labels);
+  void release_labels (void);
+  VOID cancel (BOOL on);
   void pho2hts(UttPh *u, String &labels, BOOL setdur); //devuelve la salida en labels
    virtual BOOL set (const CHAR * param, const CHAR* val);
   const CHAR* get (const CHAR * param);
@@ -67,6 +67,12 @@ Codificacion................. Borja Etxebarria
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.0.7    16/10/26  Jonny     skip_sentence
+1.0.6    16/10/26  Jonny     Documentado Pipeline (analisis en otro thread) en synthesize_stream
+1.0.5    16/10/26  Jonny     Documentado mlpg_lookahead (parametros en streaming) en synthesize_stream
+1.0.4    16/10/26  Jonny     Documentado vocoder_frames (AhoCoder incremental) en synthesize_stream
+1.0.3    16/10/26  Jonny     API de streaming con sink y trozos (synthesize_stream/output_stream)
+1.0.2    16/10/26  Jonny     create(db) con HTTS_DB compartida y con cuenta de referencias
 1.0.1    02/10/11  inaki     add synthesize API
 1.0.0    31/01/00  borja     codefreeze aHoTTS v1.0
 0.0.0    06/02/98  borja     Codificacion inicial.
@@ -147,10 +153,15 @@ Este metodo recibe una base de datos externa {db} obtenida
 de otro modulo HTTS previamente creado, para permitir asi
 que varios modulos HTTS compartan una misma base de datos.
 
-Los objetos HTTS inicializados con este metodo solo leen la base
-de datos. El objeto inicial del que se ha obtenido la base de
-datos debe existir siempre mientras exista algun otro objeto que
-utilice su base de datos. */
+La base de datos fija el idioma, el metodo y el diccionario, y
+guarda los modelos de la voz, que se cargan una sola vez (en la
+primera sintesis de cualquiera de los objetos) y despues solo se
+leen, por lo que los objetos que la comparten pueden usarse a la
+vez desde hilos distintos. Cada objeto solo tiene su estado de
+sintesis. Si no se configura voice_path, se usa la voz ya cargada.
+
+La base de datos tiene una cuenta de referencias: se libera al
+destruirse el ultimo objeto HTTS que la usa, sea o no el inicial. */
 
 BOOL HTTS::create( HTTS_DB *db )
 /*</DOC>*/
@@ -164,7 +175,8 @@ BOOL HTTS::create( HTTS_DB *db )
 un modulo HTTS. El objeto debe estar ya inicializado
 (el metodo create() ya tiene que haberse ejecutado. Esta
 base de datos puede ser utilizada/compartida por otros
-modulos HTTS (ver metodos create()). */
+modulos HTTS (ver metodos create()). El puntero es valido mientras
+exista algun objeto HTTS que la use. */
 
 HTTS_DB *HTTS::getDB(VOID)
 /*</DOC>*/
@@ -248,10 +260,88 @@ BOOL HTTS::input_multilingual( const CHAR * str, const CHAR *lang , const CHAR *
     return data->synthesize_do_input( str, lang, InputIsFile, data_path);
 }
 
+/* Sintetiza la siguiente frase pendiente. {devuelve} su numero de muestras
+(0 si no quedan frases) y las deja en {samples}, que el llamador libera con
+free(). Es un envoltorio de output_stream() */
 int HTTS::output_multilingual(const char * lang, short **samples){
 		return data->synthesize_do_next_sentence(lang, samples);
 }
 
+/*<DOC>*/
+/**********************************************************/
+/* Interfaz de streaming. Sintetiza el texto {str} completo y va
+entregando el audio de cada frase a {sink} en cuanto esta generado, en
+trozos contiguos de como mucho {chunk_ms} milisegundos (0: cada frase de
+una vez), en enteros de 16 bits (HTTS_SAMPLES_S16) o en float
+(HTTS_SAMPLES_F32). Las muestras de 16 bits se entregan directamente desde
+el buffer de salida del vocoder, sin copias. Con set("vocoder_frames","N")
+el vocoder entrega la frase cada N tramas segun la genera, sin esperar a
+que acabe ni guardarla entera; el nivel sale entonces de una cota del pico
+y no de normalizar la frase completa, por lo que queda unos dB por debajo.
+Con set("mlpg_lookahead","M") ademas los parametros se generan por bloques
+segun los pide el vocoder, mirando solo M tramas por delante, y la primera
+muestra sale antes; la varianza global se aproxima con las medias del
+modelo, asi que el resultado se aparta un poco del de la frase entera.
+Con set("Pipeline","N") el analisis del texto (T2U, LingP y etiquetas) de
+hasta N frases va por delante en otro thread mientras se sintetiza la
+actual; el audio es el mismo y sale en el mismo orden.
+Si {sink} devuelve FALSE se descarta el resto del texto sin sintetizarlo.
+La funcion {devuelve} el numero total de muestras, o -1 si {sink}
+detuvo la sintesis. */
+
+INT HTTS::synthesize_stream( const CHAR *str, const CHAR *lang, const CHAR *data_path, HTTSSink sink, VOID *user, INT chunk_ms, INT format )
+/*</DOC>*/
+{
+	return data->synthesize_do_stream(str, lang, data_path, sink, user, chunk_ms, format);
+}
+
+/*<DOC>*/
+/**********************************************************/
+/* Como output_multilingual(), pero entrega la siguiente frase
+pendiente a {sink} con la misma division en trozos que
+synthesize_stream(). {devuelve} su numero de muestras, 0 si no quedan
+frases o -1 si {sink} detuvo la sintesis (las frases pendientes
+siguen pendientes). */
+
+INT HTTS::output_stream( const CHAR *lang, HTTSSink sink, VOID *user, INT chunk_ms, INT format )
+/*</DOC>*/
+{
+	return data->synthesize_do_next_sentence_stream(lang, sink, user, chunk_ms, format);
+}
+
+/*<DOC>*/
+/**********************************************************/
+/* Salta la siguiente frase pendiente sin sintetizarla; solo se
+normaliza el texto, sin analisis linguistico ni acustica. Las frases
+que siguen salen igual que si se hubiera sintetizado, de modo que
+varios HTTS con el mismo texto pueden repartirse sus frases.
+{devuelve} FALSE si no quedan frases. */
+
+BOOL HTTS::skip_sentence( VOID )
+/*</DOC>*/
+{
+	return data->synthesize_do_skip_sentence();
+}
+
+/*<DOC>*/
+/**********************************************************/
+/* Cancela la sintesis en curso. Esta pensada para llamarse desde
+otro thread mientras el del motor esta dentro de synthesize_stream(),
+output_stream() u output_multilingual() (barge-in): la frase en curso
+se corta en milisegundos (se mira entre T2U, LingP y la acustica, y
+dentro de esta en cada label, dimension de MLPG y trama del vocoder),
+el texto pendiente se descarta sin sintetizarlo y la llamada devuelve
+-1 (0 en output_multilingual()).
+La cancelacion se retira sola al volver esa llamada. Si puede llegar
+cuando ya no hay sintesis en curso, el llamador la retira con
+cancel(FALSE) antes de la siguiente. */
+
+VOID HTTS::cancel( BOOL on )
+/*</DOC>*/
+{
+	data->cancel(on);
+}
+
 
 /*<DOC>*/
 /**********************************************************/
@@ -0,0 +1,198 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+*AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    *2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	GPL-3.0+
+	*GPL-3.0+
+	'Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/**********************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/*
+(C) 1997 TSR/Aholab - ETSII/IT Bilbao (UPV/EHU)
+
+Nombre fuente................ httsdb.cpp
+Nombre paquete............... aHoTTS
+Lenguaje fuente.............. C++
+Estado....................... -
+Dependencia Hard/OS.......... pthreads (UNIX) / mutex Win32
+Codigo condicional........... HTTS_METHOD_HTS
+
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+0.0.0    16/10/26  Jonny     Codificacion inicial.
+
+======================== Contenido ========================
+<DOC>
+Base de datos compartida HTTS_DB (ver httsdb.hpp).
+</DOC>
+===========================================================
+*/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/**********************************************************/
+
+#include <assert.h>
+#include "httsdb.hpp"
+#include "httsmsg.h"
+
+#ifdef HTTS_METHOD_HTS
+#include "hts.hpp"
+#endif
+
+/**********************************************************/
+
+HTTS_DB::HTTS_DB( const CHAR *lang, const CHAR *smethod, const CHAR *hdicdbname )
+{
+	refs=1;
+#ifdef __OS_UNIX__
+	pthread_mutex_init(&mutex,NULL);
+#endif
+#ifdef __OS_WINDOWS__
+	mutex=CreateMutex(NULL,FALSE,NULL);
+#endif
+	this->lang=lang;
+	this->smethod=smethod;
+	this->hdicdbname=hdicdbname;
+#ifdef HTTS_METHOD_HTS
+	voiceloaded=FALSE;
+#endif
+}
+
+/**********************************************************/
+
+HTTS_DB::~HTTS_DB()
+{
+#ifdef HTTS_METHOD_HTS
+	if (voiceloaded) HTS_Engine_clear(&voice);
+#endif
+#ifdef __OS_UNIX__
+	pthread_mutex_destroy(&mutex);
+#endif
+#ifdef __OS_WINDOWS__
+	CloseHandle(mutex);
+#endif
+}
+
+/**********************************************************/
+
+VOID HTTS_DB::lock( VOID )
+{
+#ifdef __OS_UNIX__
+	pthread_mutex_lock(&mutex);
+#endif
+#ifdef __OS_WINDOWS__
+	WaitForSingleObject(mutex,INFINITE);
+#endif
+}
+
+/**********************************************************/
+
+VOID HTTS_DB::unlock( VOID )
+{
+#ifdef __OS_UNIX__
+	pthread_mutex_unlock(&mutex);
+#endif
+#ifdef __OS_WINDOWS__
+	ReleaseMutex(mutex);
+#endif
+}
+
+/**********************************************************/
+/* Cada modulo HTTS que usa la base de datos toma una referencia */
+
+VOID HTTS_DB::ref( VOID )
+{
+	lock();
+	assert(refs>0);
+	refs++;
+	unlock();
+}
+
+/**********************************************************/
+/* ...y la libera al destruirse. La ultima borra la base de datos */
+
+VOID HTTS_DB::unref( VOID )
+{
+	lock();
+	assert(refs>0);
+	BOOL last=(--refs==0);
+	unlock();
+	if (last) delete this;
+}
+
+/**********************************************************/
+
+#ifdef HTTS_METHOD_HTS
+/* {devuelve} el motor con los modelos de la voz {key}. El primero
+que la pide la carga con {loader}, los demas esperan y la comparten.
+Con {key} NULL (sesion sin ficheros de voz configurados) se devuelve la
+voz ya cargada, si la hay. {devuelve} NULL si la base de datos tiene otra
+voz o si no se ha podido cargar; en ese caso {loader} carga sus propios
+modelos. */
+
+HTS_Engine *HTTS_DB::getVoice( const CHAR *key, HTS_U2W *loader )
+{
+	HTS_Engine *ret=NULL;
+
+	lock();
+	if (!voiceloaded && key) {
+		if (loader->loadModels(&voice)) {
+			voiceloaded=TRUE;
+			voicekey=key;
+		}
+		else HTS_Engine_clear(&voice);
+	}
+	if (voiceloaded) {
+		if (!key || !strcmp(voicekey,key)) ret=&voice;
+		else htts_warn("HTTS_DB: voice differs from the shared one, loading a private copy");
+	}
+	unlock();
+
+	return ret;
+}
+#endif
+
+/**********************************************************/
@@ -65,6 +65,10 @@ Codificacion................. Borja Etxebarria
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+2.0.7	 16/10/26  Jonny     synthesize_do_skip_sentence: salta una frase sin sintetizarla
+2.0.6	 16/10/26  Jonny     sintesis en cadena: analisis de la frase siguiente en otro thread
+2.0.5	 16/10/26  Jonny     sintesis por frases hacia un sink, sin copia de muestras
+2.0.4	 16/10/26  Jonny     HTTS_DB real, compartida y con cuenta de referencias
 2.0.3	 02/10/11  Inaki     add synthesize API (y soporte para idiomas festival)
 2.0.2	 15/12/10  Inaki     integrate HTS Synthesis Method
 2.0.1	 03/10/07  Inaki     integrate Corpus Synthesis Method
@@ -140,6 +144,7 @@ BOOL __htts_lang_eu=FALSE;
 HTTSDo::HTTSDo( VOID )
 {
 	created=FALSE;
+	cancelreq=FALSE;
 	flushbuf=0;
 	hdic=NULL;
 	t2u=NULL;
@@ -147,8 +152,22 @@ HTTSDo::HTTSDo( VOID )
 	utt=NULL;
 	u2w=NULL;
 
+	db=NULL;
 	localdb=TRUE;
 
+	pipeline=0;
+	plabels=NULL;
+	phead=pcount=0;
+	prunning=pend=pstop=pdiscard=FALSE;
+#ifdef __OS_UNIX__
+	pthread_mutex_init(&pmutex,NULL);
+	pthread_cond_init(&pcond,NULL);
+#endif
+#ifdef __OS_WINDOWS__
+	InitializeCriticalSection(&pmutex);
+	InitializeConditionVariable(&pcond);
+#endif
+
 /* El primero definido sera el idioma por defecto */
 #if defined(HTTS_LANG_EU)
 	lang = "eu";
@@ -176,18 +195,30 @@ HTTSDo::HTTSDo( VOID )
 HTTSDo::~HTTSDo( )
 {
 	destroy();
+	delete [] plabels;
+#ifdef __OS_UNIX__
+	pthread_cond_destroy(&pcond);
+	pthread_mutex_destroy(&pmutex);
+#endif
+#ifdef __OS_WINDOWS__
+	DeleteCriticalSection(&pmutex);
+#endif
 }
 
 /**********************************************************/
 
 VOID HTTSDo::destroy( VOID )
 {
+	pipeline_stop();
+	pcount=0;
 #define DELIT(x) if (x) { delete x; x=NULL; }
 	DELIT(hdic);
 	DELIT(t2u);
 	DELIT(lingp);
 	DELIT(utt);
 	DELIT(u2w);
+	// la base de datos se libera cuando no la usa ningun modulo
+	if (db) { db->unref(); db=NULL; }
 }
 
 /**********************************************************/
@@ -208,6 +239,20 @@ BOOL HTTSDo::create( VOID * db )
 	const CHAR* npth=NULL;
 	DOUBLE d=0;
 
+	/* con una base de datos externa, el idioma, el metodo y el diccionario
+	son los suyos; si no, creamos una propia con la configuracion actual */
+	if (db) {
+		this->db=(HTTS_DB*)db;
+		this->db->ref();
+		localdb=FALSE;
+		lang=this->db->getLang();
+		smethod=this->db->getMethod();
+		hdicdbname=this->db->getHDicDBName();
+	}
+	else {
+		this->db=new HTTS_DB(lang,smethod,hdicdbname);
+		localdb=TRUE;
+	}
 
 	ok=FALSE;
 #ifdef HTTS_LANG_EU
@@ -261,7 +306,10 @@ BOOL HTTSDo::create( VOID * db )
 	if (!t2u->create((UttWS*)utt,hdic))  {numerror=17;goto error;}
 
 #ifdef HTTS_METHOD_HTS
-	if (!strcmp(smethod,"HTS")) if (! ((HTS_U2W*)u2w)->create(lingp->get("Lang")))  {numerror=32;goto error;} //INAKI
+	if (!strcmp(smethod,"HTS")) {
+		if (! ((HTS_U2W*)u2w)->create(lingp->get("Lang")))  {numerror=32;goto error;} //INAKI
+		((HTS_U2W*)u2w)->setDB(this->db);
+	}
 #endif
 
 /* Configurar pitch nominal si es posible, si no, pitch 100Hz */
@@ -324,16 +372,10 @@ error:
 
 VOID *HTTSDo::getDB(VOID)
 {
-#ifdef HTTS_THREADSAFE
-	// si no se puede obtener el modo o es distinto de Preload, no es thread-safe
-		//const CHAR *s=dphdb->get("DBLoadMode");
-		//if (!s || strcmp(s,"Preload")) return NULL;
-
-#endif
-		//return (VOID*)dphdb;
-	//}
-	// si es de formantes o no esta creada la base de datos, NULL
-	return NULL;
+	assert(created);
+	// los modelos se cargan en la primera sintesis de cualquiera de los modulos
+	// que la comparten; el resto de la base de datos no cambia tras el create()
+	return (VOID*)db;
 }
 
 /**********************************************************/
@@ -519,6 +561,18 @@ INT HTTSDo::get_timeev( VOID )
 
 BOOL HTTSDo::set( const CHAR* param, const CHAR* val )
 {
+	if (!strcmp(param,"Pipeline")) {  // frases analizadas por delante en otro thread (0: en serie)
+		INT n = atoi(val);
+		if (n < 0) n = 0;
+		pipeline_sync();
+		if (pcount) return FALSE;  // aun quedan frases analizadas en la cola actual
+		delete [] plabels;
+		plabels = (n > 0) ? new String[n] : NULL;
+		pipeline = n;
+		phead = 0;
+		return TRUE;
+	}
+
 	if (!strcmp(param,"Lang")) {
 		if (created) return FALSE;
 		lang= val;
@@ -689,30 +743,321 @@ const CHAR* HTTSDo::get( const CHAR* param )
 /**********************************************************/
 //inaki
 //devuelve número de muestras sintetizadas y las almacena en short **samples
+//(0 si no quedan frases). Envoltorio de synthesize_do_next_sentence_stream()
+//que recoge la frase entera en un buffer que el llamador libera con free()
+//(con vocoder_frames la frase llega en varios trozos, que se van añadiendo)
+struct CollectSentence {
+	short *samples;
+	INT n;
+};
+
+static BOOL collect_sentence( const short *s16, const float *, INT n, VOID *user )
+{
+	CollectSentence *c = (CollectSentence *)user;
+	c->samples = (short *)realloc(c->samples, sizeof(short) * (c->n + n));
+	memcpy(c->samples + c->n, s16, sizeof(short) * n);
+	c->n += n;
+	return TRUE;
+}
+
 int HTTSDo::synthesize_do_next_sentence( const CHAR *lang, short **samples){
+	CollectSentence c = { NULL, 0 };
+	int num_muestras = synthesize_do_next_sentence_stream(lang, collect_sentence, &c, 0, HTTS_SAMPLES_S16);
+	*samples = c.samples;
+	if (num_muestras < 0) {  // cancelada: el texto pendiente ya esta descartado
+		free(c.samples);
+		*samples = NULL;
+		return 0;
+	}
+	if (num_muestras > 0 && *samples == NULL)  // frase sin muestras: el sink no se llama
+		*samples = (short *)malloc(sizeof(short));
+	return num_muestras;
+}
+
+/**********************************************************/
+/**********************************************************/
+//procesa la siguiente frase pendiente y entrega sus muestras a {sink} en trozos
+//de como mucho {chunk_ms} milisegundos (0: la frase entera). {devuelve} el
+//numero de muestras de la frase, 0 si no quedan frases o -1 si {sink} pidio parar
+int HTTSDo::synthesize_do_next_sentence_stream( const CHAR *lang, HTTSSink sink, VOID *user, INT chunk_ms, INT format){
 	String labels_string="";
-	int num_muestras=0;
 	Utt* u=NULL;
 	BOOL flush=FALSE;
+	INT n;
+	if (pdiscard)
+		pipeline_sync();
+	if (cancelreq)
+		return synthesize_do_cancelled();
+	// en cadena: las etiquetas ya las ha preparado (o las esta preparando) el thread del analisis
+	if (pipeline > 0 && !prunning)
+		pipeline_start();
+	if (prunning || pcount > 0) {
+		pipeline_lock();
+		while (prunning && pcount == 0 && !pend && !cancelreq)
+			pipeline_wait();
+		if (cancelreq) {
+			pipeline_unlock();
+			return synthesize_do_cancelled();
+		}
+		if (pcount == 0) {  // final del texto
+			pipeline_unlock();
+			pipeline_stop();
+			return 0;
+		}
+		labels_string = plabels[phead];
+		phead = (phead + 1) % pipeline;
+		pcount--;
+		pipeline_signal();
+		pipeline_unlock();
+		n = ((HTS_U2W*)u2w)->xinput_labels_stream(labels_string, sink, user, chunk_ms, format);
+		if (n < 0 && cancelreq)
+			return synthesize_do_cancelled();
+		return n;
+	}
 	u = t2u->output(&flush);
-	if (u) {  // estupendo, obtuvimos una utt
-		ackpending = TRUE;
-		lingp->utt_lingp(u);  // la procesamos
+	if (!u)
+		return 0;
+	ackpending = TRUE;
+	lingp->utt_lingp(u);  // la procesamos
+	if (cancelreq) {
+		t2u->outack();
+		return synthesize_do_cancelled();
+	}
+	((HTS_U2W*)u2w)->pho2hts((UttPh*)u, labels_string, TRUE);	//convertimos a labels
+	t2u->outack();
+	n = ((HTS_U2W*)u2w)->xinput_labels_stream(labels_string, sink, user, chunk_ms, format);
+	if (n < 0 && cancelreq)
+		return synthesize_do_cancelled();
+	return n;
+}
 
+/**********************************************************/
+/**********************************************************/
+//salta la siguiente frase pendiente sin sintetizarla: T2U solo la normaliza,
+//no pasa por LingP ni acustica. {devuelve} FALSE si no quedan frases
+BOOL HTTSDo::synthesize_do_skip_sentence( VOID ){
+	Utt *u;
+	BOOL flush=FALSE;
+	pipeline_sync();
+	if (pcount > 0) {  // ya analizada en cadena
+		phead = (phead + 1) % pipeline;
+		pcount--;
+		return TRUE;
+	}
+	u = t2u->output(&flush);
+	if (!u)
+		return FALSE;
+	t2u->outack();
+	return TRUE;
+}
 
-		//String labels_string_tmp;
-		((HTS_U2W*)u2w)->pho2hts((UttPh*)u, labels_string, TRUE);	//convertimos a labels
-		//labels_string+=labels_string_tmp;
+/**********************************************************/
+/**********************************************************/
+//descarta las frases pendientes sin sintetizarlas (el sink pidio parar o
+//se ha cancelado). T2U solo las normaliza, no pasan por LingP ni acustica
+VOID HTTSDo::synthesize_do_discard( VOID ){
+	Utt *u;
+	BOOL flush=FALSE;
+	if (prunning) {
+		// en cadena no se espera a que el thread del analisis acabe su frase:
+		// se le pide que pare y el descarte se completa al volver a usar T2U
+		pipeline_lock();
+		pstop = TRUE;
+		pipeline_signal();
+		pipeline_unlock();
+		pdiscard = TRUE;
+		return;
+	}
+	pdiscard = FALSE;
+	pcount = 0;  // lo ya analizado tambien se descarta
+	while ((u = t2u->output(&flush)) != NULL || flush) {
 		t2u->outack();
-		//	u = t2u->output(&flush);
-		*samples=((HTS_U2W*)u2w)->xinput_labels(labels_string, &num_muestras);
+		if (!u)
+			break;  // el flush marca el final del texto
+	}
+}
 
+/**********************************************************/
+/**********************************************************/
+//fin de una sintesis cancelada: descarta el texto pendiente y retira la
+//cancelacion, para que la siguiente llamada empiece de cero. {devuelve} -1
+INT HTTSDo::synthesize_do_cancelled( VOID ){
+	synthesize_do_discard();
+	cancel(FALSE);
+	return -1;
+}
 
+/**********************************************************/
+/**********************************************************/
+//pide ({on}=TRUE) o retira la cancelacion. Se puede llamar desde otro thread
+//mientras este esta sintetizando: se mira entre modulos (T2U, LingP,
+//acustica) y, dentro de la acustica, en sstream, MLPG y el vocoder
+VOID HTTSDo::cancel( BOOL on ){
+	cancelreq = on;
+	if (on) {  // despierta a los threads de la sintesis en cadena que esten esperando
+		pipeline_lock();
+		pipeline_signal();
+		pipeline_unlock();
 	}
-	return num_muestras;
-	//*out=strdup(Silabificado);
-	
+#ifdef HTTS_METHOD_HTS
+	if (created && !strcmp(smethod,"HTS"))
+		((HTS_U2W*)u2w)->cancel(on);
+#endif
+}
+
+/**********************************************************/
+/**********************************************************/
+//texto completo: input + todas las frases hacia {sink}
+INT HTTSDo::synthesize_do_stream( const CHAR *str, const CHAR *lang, const CHAR *data_path, HTTSSink sink, VOID *user, INT chunk_ms, INT format){
+	INT n, total=0;
+	if (!synthesize_do_input(str, lang, FALSE, data_path))
+		return -1;
+	while ((n = synthesize_do_next_sentence_stream(lang, sink, user, chunk_ms, format)) > 0)
+		total += n;
+	if (n < 0) {
+		synthesize_do_discard();
+		return -1;
+	}
+	return total;
+}
+/**********************************************************/
+/**********************************************************/
+//sintesis en cadena: sincronizacion entre el thread del analisis y el de la
+//acustica (el que llama a synthesize_do_next_sentence_stream)
+VOID HTTSDo::pipeline_lock( VOID ){
+#ifdef __OS_UNIX__
+	pthread_mutex_lock(&pmutex);
+#endif
+#ifdef __OS_WINDOWS__
+	EnterCriticalSection(&pmutex);
+#endif
+}
+
+VOID HTTSDo::pipeline_unlock( VOID ){
+#ifdef __OS_UNIX__
+	pthread_mutex_unlock(&pmutex);
+#endif
+#ifdef __OS_WINDOWS__
+	LeaveCriticalSection(&pmutex);
+#endif
+}
+
+VOID HTTSDo::pipeline_wait( VOID ){
+#ifdef __OS_UNIX__
+	pthread_cond_wait(&pcond, &pmutex);
+#endif
+#ifdef __OS_WINDOWS__
+	SleepConditionVariableCS(&pcond, &pmutex, INFINITE);
+#endif
+}
+
+VOID HTTSDo::pipeline_signal( VOID ){
+#ifdef __OS_UNIX__
+	pthread_cond_broadcast(&pcond);
+#endif
+#ifdef __OS_WINDOWS__
+	WakeAllConditionVariable(&pcond);
+#endif
+}
+
+#ifdef __OS_UNIX__
+VOID *HTTSDo::pipeline_main( VOID *me ){
+	((HTTSDo *)me)->pipeline_front();
+	return NULL;
+}
+#endif
+#ifdef __OS_WINDOWS__
+DWORD WINAPI HTTSDo::pipeline_main( LPVOID me ){
+	((HTTSDo *)me)->pipeline_front();
+	return 0;
+}
+#endif
+
+/**********************************************************/
+/**********************************************************/
+//thread del analisis: saca las frases de T2U, las pasa por LingP y deja sus
+//etiquetas en la cola, esperando mientras este llena. Termina al final del
+//texto (pend), cuando se le pide (pstop) o si se cancela la sintesis
+VOID HTTSDo::pipeline_front( VOID ){
+	Utt *u;
+	BOOL flush=FALSE;
+	String labels;
+	pipeline_lock();
+	for (;;) {
+		while (pcount == pipeline && !pstop && !cancelreq)
+			pipeline_wait();
+		if (pstop || cancelreq)
+			break;
+		pipeline_unlock();
+		u = t2u->output(&flush);
+		if (u) {
+			ackpending = TRUE;
+			lingp->utt_lingp(u);
+			if (!cancelreq)
+				((HTS_U2W*)u2w)->pho2hts((UttPh*)u, labels, TRUE);
+			t2u->outack();
+		}
+		pipeline_lock();
+		if (!u) {
+			pend = TRUE;
+			pipeline_signal();
+			break;
+		}
+		if (cancelreq)
+			break;
+		plabels[(phead + pcount) % pipeline] = labels;
+		pcount++;
+		pipeline_signal();
+	}
+	pipeline_unlock();
+}
+
+/**********************************************************/
+/**********************************************************/
+//lanza el thread del analisis (si no se puede, se sigue en serie)
+VOID HTTSDo::pipeline_start( VOID ){
+	pstop = FALSE;
+	pend = FALSE;
+#ifdef __OS_UNIX__
+	prunning = (pthread_create(&pthread, NULL, pipeline_main, this) == 0);
+#endif
+#ifdef __OS_WINDOWS__
+	pthread = CreateThread(NULL, 0, pipeline_main, this, 0, NULL);
+	prunning = (pthread != NULL);
+#endif
+}
+
+/**********************************************************/
+/**********************************************************/
+//para el thread del analisis, si esta lanzado, en cuanto acabe la frase que
+//tenga entre manos. Lo ya analizado se queda en la cola
+VOID HTTSDo::pipeline_stop( VOID ){
+	if (!prunning)
+		return;
+	pipeline_lock();
+	pstop = TRUE;
+	pipeline_signal();
+	pipeline_unlock();
+#ifdef __OS_UNIX__
+	pthread_join(pthread, NULL);
+#endif
+#ifdef __OS_WINDOWS__
+	WaitForSingleObject(pthread, INFINITE);
+	CloseHandle(pthread);
+#endif
+	prunning = FALSE;
+	pstop = FALSE;
 }
+
+/**********************************************************/
+/**********************************************************/
+//para el thread del analisis y completa el descarte que hubiera pendiente
+VOID HTTSDo::pipeline_sync( VOID ){
+	pipeline_stop();
+	if (pdiscard)
+		synthesize_do_discard();
+}
+
 /**********************************************************/
 /**********************************************************/
 //inaki
@@ -720,6 +1065,7 @@ BOOL HTTSDo::synthesize_do_input( const CHAR *str, const CHAR *lang , BOOL Input
 
 	assert(created);
 	strcpy(DataPath, data_path);
+	pipeline_sync();  // el thread del analisis no puede usar T2U a la vez; lo analizado sigue en la cola
 	//para euskera y castellano usamos código ahoTTS
 	
 		assert(t2u);
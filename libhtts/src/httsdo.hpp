@@ -70,6 +70,10 @@ Codificacion................. Borja Etxebarria
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.0.7	 16/10/26  Jonny     synthesize_do_skip_sentence
+1.0.6	 16/10/26  Jonny     sintesis en cadena: analisis de la frase siguiente en otro thread
+1.0.5	 16/10/26  Jonny     synthesize_do_next_sentence_stream, synthesize_do_stream
+1.0.4	 16/10/26  Jonny     HTTS_DB real, compartida y con cuenta de referencias
 1.0.3	 02/10/11  Inaki     add synthesize API
 1.0.1	 15/12/10  Inaki     Añadir Metodo HTS
 1.0.1	 03/10/07  Inaki     Añadir Metodo Corpus
@@ -89,6 +93,15 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 
 #include "lingp.hpp"
 #include "u2w.hpp"
+#include "httsdb.hpp"
+#include "htts.hpp"
+
+#ifdef __OS_UNIX__
+#include <pthread.h>
+#endif
+#ifdef __OS_WINDOWS__
+#include <windows.h>
+#endif
 
 #ifdef HTTS_INTERFACE_WAVEMARKS
 #include "mark.hpp"
@@ -137,7 +150,8 @@ private:
 	LingP * lingp;
 	Utt2Wav * u2w;
 	Utt * utt;
-	BOOL localdb;
+	HTTS_DB * db;  // datos compartidos, con una referencia nuestra
+	BOOL localdb;  // TRUE si {db} la hemos creado nosotros
 #ifdef HTTS_DIPHONE
 	Ph2Dph * p2d;
 	DphDB * dphdb;
@@ -170,6 +184,38 @@ private:
 	String modelpau;
 
 	BOOL ackpending;
+	volatile BOOL cancelreq;	// cancel() desde otro thread
+
+	// sintesis en cadena (set("Pipeline","N")): un thread hace el analisis de
+	// las frases siguientes (T2U, LingP y etiquetas) mientras la acustica
+	// sintetiza la actual. Se comunican por una cola de etiquetas de N frases
+	INT pipeline;	// frases que se pueden analizar por delante (0: todo en serie)
+	String *plabels;	// cola circular de etiquetas
+	INT phead, pcount;	// primera frase de la cola y numero de frases en ella
+	BOOL prunning;	// el thread del analisis esta lanzado
+	BOOL pend;	// el thread ha llegado al final del texto
+	BOOL pstop;	// el thread debe terminar en cuanto acabe la frase actual
+	BOOL pdiscard;	// descarte del texto pendiente a completar cuando el thread termine
+#ifdef __OS_UNIX__
+	pthread_t pthread;
+	pthread_mutex_t pmutex;
+	pthread_cond_t pcond;	// cambio en la cola o en los flags, en cualquier sentido
+	static VOID *pipeline_main( VOID *me );
+#endif
+#ifdef __OS_WINDOWS__
+	HANDLE pthread;
+	CRITICAL_SECTION pmutex;
+	CONDITION_VARIABLE pcond;
+	static DWORD WINAPI pipeline_main( LPVOID me );
+#endif
+	VOID pipeline_lock( VOID );
+	VOID pipeline_unlock( VOID );
+	VOID pipeline_wait( VOID );
+	VOID pipeline_signal( VOID );
+	VOID pipeline_front( VOID );
+	VOID pipeline_start( VOID );
+	VOID pipeline_stop( VOID );
+	VOID pipeline_sync( VOID );
 
 	BOOL advance( VOID );
 	VOID destroy( VOID );
@@ -191,6 +237,12 @@ public:
 	//inaki
 	BOOL synthesize_do_input( const CHAR *str, const CHAR *lang , BOOL InputIsFile, const CHAR *data_path);
 	int synthesize_do_next_sentence(  const CHAR *lang , short **samples);//procesa frase
+	int synthesize_do_next_sentence_stream( const CHAR *lang, HTTSSink sink, VOID *user, INT chunk_ms, INT format );
+	INT synthesize_do_stream( const CHAR *str, const CHAR *lang, const CHAR *data_path, HTTSSink sink, VOID *user, INT chunk_ms, INT format );
+	BOOL synthesize_do_skip_sentence( VOID );
+	VOID synthesize_do_discard( VOID );
+	INT synthesize_do_cancelled( VOID );
+	VOID cancel( BOOL on );
 #ifdef HTTS_LANG_FEST
 	int str2num(const char * cadena);
 	char *num2str(int num);
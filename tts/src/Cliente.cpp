@@ -57,6 +57,9 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.4.0	 16/10/26  Jonny      Opcion Deadline, muestra la espera en cola del servidor
+1.3.0	 16/10/26  Jonny      Opcion Protocol=2, varias peticiones por una conexion
+1.2.0	 16/10/26  Jonny      Opcion Stream, recibe el audio frase a frase
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0, KVStrList
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
@@ -67,20 +70,100 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 #include "Socket_Cliente.hpp"
 #include "strl.hpp"
 #include "string.hpp"
+#include "caudio.hpp"
 
 //#define SERVER "localhost"
 //#define SERVICE "ahotts"
 /*
 void usage (void);
 */
+
+/*Guarda en el wav de salida cada bloque de audio recibido en modo streaming*/
+static int SaveBlock(const char *block, int block_len, void *user)
+{
+	CAudioFile *fout=(CAudioFile*)user;
+	fout->setBlk((short*)block, block_len/sizeof(short));
+	return 0;
+}
+
+/*Guarda en el fichero de salida el wav recibido con el protocolo v2*/
+static int WriteBlock(const char *block, int block_len, void *user)
+{
+	FILE *fout=(FILE*)user;
+	return fwrite(block,1,block_len,fout)==(size_t)block_len?0:-1;
+}
+
+/*Lee el fichero de texto completo en memoria (se libera con free)*/
+static char* ReadText(const char *inputfile, int *len)
+{
+	FILE *fp=fopen(inputfile,"rb");
+	if(fp==NULL)
+		return NULL;
+	fseek(fp,0,SEEK_END);
+	*len=ftell(fp);
+	fseek(fp,0,SEEK_SET);
+	char *text=(char*)malloc(*len+1);
+	if(text!=NULL && fread(text,1,*len,fp)!=(size_t)*len){
+		free(text);
+		text=NULL;
+	}
+	fclose(fp);
+	if(text!=NULL)
+		text[*len]='\0';
+	return text;
+}
+
+/*
+* Protocolo v2: manda de golpe una peticion por cada fichero de entrada
+* y despues recoge las respuestas, que llegan en el mismo orden
+*/
+static int RequestFrames(ClientConnection *cliente, int ninputs, const char **inputs, const char **outputs, bool stream)
+{
+	int i;
+	for(i=0;i<ninputs;i++){
+		int len=0;
+		char *text=ReadText(inputs[i],&len);
+		if(text==NULL){
+			fprintf(stderr,"Please check that the %s file exists\n", inputs[i]);
+			return -1;
+		}
+		int aux=cliente->SendRequest(i,text,len);
+		free(text);
+		if(aux<0)
+			return -1;
+	}
+	fprintf(stderr,"Sent %d requests, receiving synthesized files\n",ninputs);
+	for(i=0;i<ninputs;i++){
+		int aux;
+		if(stream){
+			CAudioFile fout;
+			fout.open(outputs[i],"w", "SRate=16000.0 NChan=1 FFormat=Wav");
+			aux=cliente->ReceiveReply(i,SaveBlock,&fout);
+			fout.close();
+		}else{
+			FILE *fout=fopen(outputs[i],"wb");
+			if(fout==NULL){
+				fprintf(stderr,"Unable to open %s\n",outputs[i]);
+				return -1;
+			}
+			aux=cliente->ReceiveReply(i,WriteBlock,fout);
+			fclose(fout);
+		}
+		if(aux<0)
+			return -1;
+		fprintf(stderr,"%s: %d bytes, %d ms in the server queue\n",outputs[i],aux,cliente->ObtainQueueWait());
+	}
+	return 0;
+}
+
 int main (int argc, char* argv[])
 {
 	
-	KVStrList pro("InputFile=input.txt Lang=eu OutputFile=output.wav Speed=100 IP=NULL Port=0 SetDur=n");
+	KVStrList pro("InputFile=input.txt Lang=eu OutputFile=output.wav Speed=100 IP=NULL Port=0 SetDur=n Stream=n Protocol=1 Deadline=0");
 	StrList files;
 
 	clargs2props(argc, argv, pro, files,
-			"InputFile=s Lang={es|eu} OutputFile=s Speed=s IP=s Port=i SetDur=b");
+			"InputFile=s Lang={es|eu} OutputFile=s Speed=s IP=s Port=i SetDur=b Stream=b Protocol={1|2} Deadline=i", "MyFiles=y");
 	
 	
 	const char *lang = pro.val("Lang");
@@ -91,6 +174,9 @@ int main (int argc, char* argv[])
 	const char *ip=pro.val("IP");
 	const int puerto=pro.ival("Port");
 	bool setdur=pro.bbval("SetDur");
+	bool stream=pro.bbval("Stream");
+	const int protocol=pro.ival("Protocol");
+	const int deadline=pro.ival("Deadline");
 
 	if (!strcmp(ip,"NULL")){
 		fprintf(stderr,"IP direction is mandatory\n");
@@ -111,6 +197,8 @@ int main (int argc, char* argv[])
 	//strcpy(op.gender,gender);
 	
 	ClientConnection *cliente = new ClientConnection (op);
+	cliente->SetStreaming(stream);
+	cliente->SetDeadline(deadline);
 	
 	//if(!strcmp(argv[2],"cat")||!strcmp(argv[2],"gl")||!strcmp(argv[2],"es")||!strcmp(argv[2],"eu")){
 	//	strcpy(lang,argv[2]);}
@@ -125,6 +213,33 @@ int main (int argc, char* argv[])
 		exit(-1);
 	}
 
+	if(protocol==2){
+		/*
+		* Con el protocolo v2 los ficheros que se pasen ademas de InputFile
+		* se sintetizan por la misma conexion, cada uno en <fichero>.wav
+		*/
+		int ninputs=1+files.length();
+		const char **inputs=new const char*[ninputs];
+		const char **outputs=new const char*[ninputs];
+		String *names=new String[ninputs];
+		inputs[0]=inputfile;
+		outputs[0]=outputfile;
+		Lix p=files.first();
+		for(int i=1;i<ninputs;i++,p=files.next(p)){
+			inputs[i]=files.item(p);
+			names[i]=inputs[i];
+			names[i]+=".wav";
+			outputs[i]=names[i];
+		}
+		aux=RequestFrames(cliente,ninputs,inputs,outputs,stream);
+		delete []names;
+		delete []outputs;
+		delete []inputs;
+		cliente->CloseConnection();
+		delete (cliente);
+		return aux<0?-1:0;
+	}
+
 	FILE *fp=NULL;
 	fp=fopen(inputfile,"r");
 	if(fp!=NULL){
@@ -146,7 +261,13 @@ int main (int argc, char* argv[])
 	//fd=fopen("out.wav","wb");
 	//if(fd!=NULL){
 	fprintf(stderr,"Receiving synthesized file\n");
-	cliente->ReceiveFile(outputfile,cliente->ObtainSSocket());
+	if(stream){
+		CAudioFile fout;
+		fout.open(outputfile,"w", "SRate=16000.0 NChan=1 FFormat=Wav");
+		cliente->ReceiveAudioStream(SaveBlock,&fout,cliente->ObtainSSocket());
+		fout.close();
+	}else
+		cliente->ReceiveFile(outputfile,cliente->ObtainSSocket());
 	//	}
 	//fclose(fd);
 	
@@ -0,0 +1,235 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.1	 16/10/26  Jonny      Con un error del servidor la conexion se reutiliza y no se repite la peticion
+1.1.0	 16/10/26  Jonny      Request con modo streaming
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: pool de conexiones v2 a tts_server
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+
+#include "Connection_Pool.hpp"
+
+ConnectionPool::ConnectionPool(const char *ip, int port, const Options op, int size)
+{
+	this->ip=ip;
+	this->port=port;
+	this->op=op;
+	this->size=size<1?1:size;
+	open=0;
+	hits=misses=reconnects=waits=0;
+	pthread_mutex_init(&lock,NULL);
+	pthread_cond_init(&released,NULL);
+}
+
+/* Solo se cierran las conexiones ociosas: no debe quedar ninguna en uso */
+ConnectionPool::~ConnectionPool()
+{
+	while(!idle.empty()){
+		idle.front()->CloseConnection();
+		delete idle.front();
+		idle.pop_front();
+	}
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&released);
+}
+
+/* Abre una conexion nueva con el servidor, o NULL si no se puede */
+ClientConnection* ConnectionPool::Open(void)
+{
+	ClientConnection *cliente=new ClientConnection(op);
+	if(cliente->OpenInetConnection(ip,port)==-1){
+		fprintf(stderr,"Unable to establish server connection with %s:%d\n",ip,port);
+		cliente->CloseConnection();
+		delete cliente;
+		return NULL;
+	}
+	return cliente;
+}
+
+/*
+* Una conexion ociosa no deberia tener nada que leer: si el descriptor
+* esta listo para leer es que el servidor la ha cerrado (KeepAlive
+* vencido, reinicio...) o que ha quedado basura de una peticion anterior.
+*/
+bool ConnectionPool::Alive(ClientConnection *cliente)
+{
+	struct pollfd pfd;
+	pfd.fd=cliente->ObtainSSocket();
+	pfd.events=POLLIN;
+	pfd.revents=0;
+	return poll(&pfd,1,0)==0;
+}
+
+ClientConnection* ConnectionPool::Checkout(void)
+{
+	ClientConnection *cliente=NULL;
+	bool waited=false;
+
+	pthread_mutex_lock(&lock);
+	while(cliente==NULL){
+		while(!idle.empty()){
+			cliente=idle.front();
+			idle.pop_front();
+			if(Alive(cliente))
+				break;
+			cliente->CloseConnection();
+			delete cliente;
+			cliente=NULL;
+			open--;
+			reconnects++;
+		}
+		if(cliente!=NULL){
+			hits++;
+			break;
+		}
+		if(open<size){
+			//Se reserva el hueco y se conecta fuera del mutex
+			open++;
+			misses++;
+			pthread_mutex_unlock(&lock);
+			cliente=Open();
+			pthread_mutex_lock(&lock);
+			if(cliente==NULL){
+				open--;
+				pthread_cond_signal(&released);
+				break;
+			}
+			break;
+		}
+		if(!waited){
+			waits++;
+			waited=true;
+		}
+		pthread_cond_wait(&released,&lock);
+	}
+	pthread_mutex_unlock(&lock);
+	return cliente;
+}
+
+void ConnectionPool::Return(ClientConnection *cliente, bool healthy)
+{
+	if(!healthy){
+		cliente->CloseConnection();
+		delete cliente;
+	}
+	pthread_mutex_lock(&lock);
+	if(healthy)
+		idle.push_back(cliente);
+	else
+		open--;
+	pthread_cond_signal(&released);
+	pthread_mutex_unlock(&lock);
+}
+
+/* Cuenta los bytes que llegan al callback del llamante */
+struct CountingSink{
+	AudioBlockFunc callback;
+	void *user;
+	int received;
+};
+
+static int CountBlock(const char *block, int block_len, void *user)
+{
+	CountingSink *sink=(CountingSink*)user;
+	sink->received+=block_len;
+	return sink->callback(block,block_len,sink->user);
+}
+
+int ConnectionPool::Request(unsigned int id, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user)
+{
+	CountingSink sink;
+	int attempt;
+
+	sink.callback=callback;
+	sink.user=user;
+	for(attempt=0;attempt<2;attempt++){
+		ClientConnection *cliente=Checkout();
+		if(cliente==NULL)
+			return -1;
+		sink.received=0;
+		cliente->SetStreaming(streaming);
+		int ret=cliente->SendRequest(id,text,len);
+		if(ret!=-1)
+			ret=cliente->ReceiveReply(id,CountBlock,&sink);
+		//Con un error del servidor la respuesta ha terminado bien: la
+		//conexion se reutiliza y no se repite la peticion
+		Return(cliente,ret!=-1);
+		if(ret==REPLY_SERVER_ERROR)
+			return -1;
+		if(ret!=-1)
+			return ret;
+		//Solo se reintenta si el llamante todavia no ha recibido nada
+		if(sink.received>0)
+			break;
+	}
+	return -1;
+}
+
+void ConnectionPool::ObtainStats(long *hits, long *misses, long *reconnects, long *waits)
+{
+	pthread_mutex_lock(&lock);
+	*hits=this->hits;
+	*misses=this->misses;
+	*reconnects=this->reconnects;
+	*waits=this->waits;
+	pthread_mutex_unlock(&lock);
+}
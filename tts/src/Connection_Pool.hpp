@@ -0,0 +1,120 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      Request con modo streaming
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: pool de conexiones v2 a tts_server
+*/
+
+#ifndef _CONNECTION_POOL_H
+#define _CONNECTION_POOL_H
+
+#include <pthread.h>
+
+#include <deque>
+
+#include "Socket_Cliente.hpp"
+
+/*
+* Pool de conexiones persistentes (protocolo v2) a un tts_server. Se
+* puede usar desde varios threads: cada peticion toma una conexion con
+* Checkout(), la usa en exclusiva y la devuelve con Return().
+* Nunca hay mas de {size} conexiones abiertas a la vez; si estan todas
+* en uso Checkout() espera a que se devuelva alguna.
+* Las conexiones ociosas se comprueban antes de reutilizarlas (el
+* servidor las cierra pasado su KeepAlive) y las caidas se reabren sin
+* que se entere el llamante.
+*/
+class ConnectionPool{
+	public:
+		ConnectionPool(const char *ip, int port, const Options op, int size);
+		~ConnectionPool();
+		/* Devuelve una conexion abierta o NULL si no se puede conectar */
+		ClientConnection* Checkout(void);
+		/* Devuelve al pool la conexion {cliente}. Con {healthy}=false
+		 * (error a mitad de peticion) se cierra en lugar de reutilizarla */
+		void Return(ClientConnection *cliente, bool healthy);
+		/* Checkout, peticion v2 completa y Return. Con {streaming} el
+		 * audio llega frase a frase (PCM) en lugar de un unico wav. Si
+		 * falla una conexion reutilizada antes de recibir audio se repite
+		 * con una nueva; un error del servidor no se repite. Devuelve los
+		 * bytes recibidos o -1 */
+		int Request(unsigned int id, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user);
+		int ObtainSize(void){return size;}
+		/* Checkouts servidos con una conexion ya abierta (hits) o que han
+		 * tenido que abrir una nueva (misses); reconnects cuenta las
+		 * conexiones ociosas descartadas por estar cerradas, y waits los
+		 * checkouts que han tenido que esperar con el pool lleno */
+		void ObtainStats(long *hits, long *misses, long *reconnects, long *waits);
+	private:
+		ClientConnection* Open(void);
+		static bool Alive(ClientConnection *cliente);
+
+		const char *ip;
+		int port;
+		Options op;
+		int size;
+		int open; //conexiones abiertas, ociosas o en uso
+		std::deque<ClientConnection*> idle;
+		long hits, misses, reconnects, waits;
+		pthread_mutex_t lock;
+		pthread_cond_t released;
+};
+
+
+#endif
@@ -0,0 +1,797 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.2.1	 16/10/26  Jonny      Con la cola llena se siguen viendo FRAME_CANCEL y el cierre del cliente
+1.2.0	 16/10/26  Jonny      Cancelacion de peticiones: FRAME_CANCEL, cierre v2, motor en sintesis
+1.1.0	 16/10/26  Jonny      Peticiones largas en trozos de frases, plazos y espera en cola
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: servidor de eventos con epoll
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "Event_Server.hpp"
+
+#define EVENT_LISTEN 0		//data.u64 del socket servidor
+#define EVENT_WAKEUP 1		//data.u64 del eventfd de los workers
+#define MAX_EVENTS 256
+#define READ_CHUNK 65536
+#define MAX_PIPELINE 16		//peticiones encoladas por conexion antes de dejar de crear mas
+#define MAX_PENDING_IN (16*READ_CHUNK)	//bytes sin procesar de una conexion con la cola llena antes de dejar de leer
+
+/*
+* Estado de una conexion de cliente
+*/
+struct EventConn{
+	int fd;
+	unsigned long id;
+	int protocol;		//0 sin decidir, 1 antiguo, 2 v2
+	std::string in;		//bytes recibidos aun sin procesar
+	std::string out;	//bytes pendientes de mandar desde out_pos
+	size_t out_pos;
+	std::deque<SynthRequest*> requests;	//recibidas, esperando worker
+	SynthRequest *active;	//en sintesis
+	bool eof;		//no se lee mas: el cliente ha cerrado o ya no se esperan peticiones
+	bool closing;		//se cierra en cuanto no quede nada por hacer
+	bool blocked;
+	unsigned int events;	//eventos registrados en epoll
+	time_t last;		//ultima actividad, para KeepAlive
+};
+
+static int SetNonBlocking(int fd)
+{
+	int flags=fcntl(fd,F_GETFL,0);
+	if(flags==-1)
+		return -1;
+	return fcntl(fd,F_SETFL,flags|O_NONBLOCK);
+}
+
+/*
+* La conexion tiene MAX_PENDING_IN bytes sin procesar que empiezan por una
+* trama completa: la cola esta llena y no se lee mas de ella hasta que se
+* vacie algo. Si la primera trama esta a medias se sigue leyendo
+*/
+static bool Saturated(EventConn *c)
+{
+	FrameHeader header;
+
+	if(c->protocol!=2 || c->in.size()<MAX_PENDING_IN)
+		return false;
+	if(UnpackFrameHeader((const unsigned char*)c->in.data(),&header)==-1)
+		return false;
+	return c->in.size()>=FRAME_HEADER_SIZE+header.length;
+}
+
+EventServer::EventServer(int listen_fd, SynthPool *pool, int keepalive, int split_chars)
+{
+	this->split_chars=split_chars;
+	this->listen_fd=listen_fd;
+	this->pool=pool;
+	this->keepalive=keepalive;
+	epoll_fd=-1;
+	event_fd=-1;
+	accepting=true;
+	next_conn=EVENT_WAKEUP+1;
+	pthread_mutex_init(&lock,NULL);
+}
+
+EventServer::~EventServer()
+{
+	while(!conns.empty())
+		Close(conns.begin()->second);
+	if(epoll_fd!=-1) close(epoll_fd);
+	if(event_fd!=-1) close(event_fd);
+	pthread_mutex_destroy(&lock);
+}
+
+/*
+* Prepara epoll con el socket servidor y el eventfd por el que avisan
+* los workers. Devuelve 0 si todo va bien o -1 si hay problemas.
+*/
+int EventServer::Create(void)
+{
+	struct epoll_event ev;
+
+	if(SetNonBlocking(listen_fd)==-1)
+		return -1;
+	epoll_fd=epoll_create1(EPOLL_CLOEXEC);
+	event_fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+	if(epoll_fd==-1 || event_fd==-1){
+		fprintf(stderr,"Error creating epoll: %s\n",strerror(errno));
+		return -1;
+	}
+	ev.events=EPOLLIN;
+	ev.data.u64=EVENT_LISTEN;
+	if(epoll_ctl(epoll_fd,EPOLL_CTL_ADD,listen_fd,&ev)==-1)
+		return -1;
+	ev.events=EPOLLIN;
+	ev.data.u64=EVENT_WAKEUP;
+	if(epoll_ctl(epoll_fd,EPOLL_CTL_ADD,event_fd,&ev)==-1)
+		return -1;
+	return 0;
+}
+
+int EventServer::Run(void)
+{
+	struct epoll_event events[MAX_EVENTS];
+	time_t last_sweep=time(NULL);
+
+	while(1){
+		int n=epoll_wait(epoll_fd,events,MAX_EVENTS,1000);
+		if(n==-1){
+			if(errno==EINTR) continue;
+			fprintf(stderr,"Error in epoll_wait: %s\n",strerror(errno));
+			return -1;
+		}
+		for(int i=0;i<n;i++){
+			unsigned long key=events[i].data.u64;
+			if(key==EVENT_LISTEN){
+				Accept();
+				continue;
+			}
+			if(key==EVENT_WAKEUP){
+				uint64_t count;
+				while(read(event_fd,&count,sizeof(count))>0);
+				Deliver();
+				continue;
+			}
+			std::map<unsigned long, EventConn*>::iterator it=conns.find(key);
+			if(it==conns.end())
+				continue; //cerrada por un evento anterior de esta misma tanda
+			EventConn *c=it->second;
+			if(events[i].events&(EPOLLERR|EPOLLHUP|EPOLLRDHUP) && !(events[i].events&EPOLLIN)){
+				Close(c);
+				continue;
+			}
+			if(events[i].events&EPOLLIN)
+				Read(c);
+			if(conns.count(key) && events[i].events&EPOLLOUT)
+				Write(c);
+		}
+		time_t now=time(NULL);
+		if(now!=last_sweep){
+			Sweep(now);
+			last_sweep=now;
+		}
+	}
+	return 0;
+}
+
+void EventServer::Accept(void)
+{
+	while(1){
+		int fd=accept4(listen_fd,NULL,NULL,SOCK_NONBLOCK|SOCK_CLOEXEC);
+		if(fd==-1){
+			if(errno==EINTR || errno==ECONNABORTED)
+				continue;
+			if(errno==EMFILE || errno==ENFILE){
+				//Sin descriptores: se deja de aceptar hasta que se cierre alguna conexion
+				fprintf(stderr,"Too many open connections (%lu), not accepting for now\n",(unsigned long)conns.size());
+				epoll_ctl(epoll_fd,EPOLL_CTL_DEL,listen_fd,NULL);
+				accepting=false;
+			}
+			return;
+		}
+		//Las tramas pequenias (fin de peticion) no deben esperar a Nagle
+		int one=1;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+
+		EventConn *c=new EventConn;
+		c->fd=fd;
+		c->id=next_conn++;
+		c->protocol=0;
+		c->out_pos=0;
+		c->active=NULL;
+		c->eof=false;
+		c->closing=false;
+		c->blocked=false;
+		c->events=EPOLLIN;
+		c->last=time(NULL);
+
+		struct epoll_event ev;
+		ev.events=c->events;
+		ev.data.u64=c->id;
+		if(epoll_ctl(epoll_fd,EPOLL_CTL_ADD,fd,&ev)==-1){
+			close(fd);
+			delete c;
+			continue;
+		}
+		conns[c->id]=c;
+	}
+}
+
+void EventServer::Read(EventConn *c)
+{
+	char buf[READ_CHUNK];
+	size_t got=0;	//como mucho MAX_PENDING_IN por vez: se procesa antes de seguir leyendo
+
+	while(!c->eof && !Saturated(c) && got<MAX_PENDING_IN){
+		ssize_t n=read(c->fd,buf,sizeof(buf));
+		if(n>0){
+			c->in.append(buf,n);
+			got+=n;
+			c->last=time(NULL);
+			if((size_t)n<sizeof(buf))
+				break;
+			continue;
+		}
+		if(n==0){
+			if(c->protocol==2){
+				//En v2 el cliente cierra cuando ya no quiere nada mas
+				//(barge-in): se cancela lo que quede y se libera el worker
+				Close(c);
+				return;
+			}
+			//El cliente no manda mas: se termina lo pendiente y se cierra
+			c->eof=true;
+			c->closing=true;
+			break;
+		}
+		if(errno==EINTR)
+			continue;
+		if(errno==EAGAIN || errno==EWOULDBLOCK)
+			break;
+		Close(c);
+		return;
+	}
+	if(Parse(c)==-1){
+		Close(c);
+		return;
+	}
+	Dispatch(c);
+	Update(c);
+}
+
+/*
+* Saca de c->in las peticiones completas. Devuelve -1 si el cliente
+* no habla ninguno de los dos protocolos.
+*/
+int EventServer::Parse(EventConn *c)
+{
+	if(c->protocol==0){
+		if(c->in.size()<4)
+			return 0;
+		c->protocol=memcmp(c->in.data(),FRAME_MAGIC,4)?1:2;
+	}
+	if(c->protocol==1)
+		return ParseLegacy(c);
+	return ParseFrames(c);
+}
+
+/*
+* Peticion nueva de la conexion {c} para {text_len} bytes de {text}
+*/
+SynthRequest* EventServer::NewRequest(EventConn *c, const char *text, int text_len)
+{
+	SynthRequest *req=new SynthRequest;
+	req->server=this;
+	req->conn=c->id;
+	req->id=0;
+	req->text=new char[text_len+1];
+	memcpy(req->text,text,text_len);
+	req->text[text_len]='\0';
+	req->text_len=text_len;
+	SplitSentences(req->text,text_len,split_chars,req->cuts);
+	req->part=0;
+	req->wav=NULL;
+	req->arrival=SynthClockMs();
+	req->deadline=0;
+	req->queue_wait=0;
+	req->failed=false;
+	req->cancelled=false;
+	req->tts=NULL;
+	return req;
+}
+
+/*
+* Protocolo antiguo: Options, tamanio del texto (SizeFile) y el texto.
+* Una unica peticion por conexion.
+*/
+int EventServer::ParseLegacy(EventConn *c)
+{
+	Options op;
+	SizeFile size;
+	int text_len=0;
+	size_t need=sizeof(Options)+sizeof(SizeFile);
+
+	if(c->in.size()<need)
+		return 0;
+	memcpy(&op,c->in.data(),sizeof(Options));
+	memcpy(&size,c->in.data()+sizeof(Options),sizeof(SizeFile));
+	size.size[sizeof(SizeFile)-1]='\0';
+	if(sscanf(size.size,"%d",&text_len)!=1 || text_len<0 || text_len>FRAME_MAX_PAYLOAD)
+		return -1;
+	if(c->in.size()<need+text_len)
+		return 0;
+
+	SynthRequest *req=NewRequest(c,c->in.data()+need,text_len);
+	req->legacy=true;
+	op.language[sizeof(op.language)-1]='\0';
+	op.speed[sizeof(op.speed)-1]='\0';
+	strcpy(req->lang,op.language);
+	strcpy(req->speed,op.speed);
+	req->setdur=op.setdur;
+	req->streaming=!strncmp(op.mode,OPTIONS_MODE_STREAM,sizeof(op.mode));
+	if(!req->streaming && req->cuts.size()>2)
+		req->wav=new WavBuffer;
+	c->requests.push_back(req);
+
+	//No se esperan mas peticiones: se cierra al mandar la respuesta
+	c->in.clear();
+	c->eof=true;
+	c->closing=true;
+	return 0;
+}
+
+/*
+* Fin de la ultima trama FRAME_CANCEL completa de c->in a partir de {pos},
+* o {pos} si no hay ninguna
+*/
+static size_t LastCancelEnd(EventConn *c, size_t pos)
+{
+	size_t end=pos;
+
+	while(c->in.size()-pos>=FRAME_HEADER_SIZE){
+		FrameHeader header;
+		if(UnpackFrameHeader((const unsigned char*)c->in.data()+pos,&header)==-1)
+			break;
+		if(header.type==FRAME_CANCEL && header.length==0){
+			pos+=FRAME_HEADER_SIZE;
+			end=pos;
+			continue;
+		}
+		if(c->in.size()-pos<FRAME_HEADER_SIZE+header.length)
+			break;
+		pos+=FRAME_HEADER_SIZE+header.length;
+	}
+	return end;
+}
+
+/*
+* Protocolo v2: tantas tramas FRAME_REQUEST y FRAME_CANCEL como haya
+* completas. Con MAX_PIPELINE peticiones en cola no se crean mas, salvo
+* las que preceden a una FRAME_CANCEL ya recibida, que tambien las cancela
+* a ellas; asi la cancelacion llega al momento aunque la cola este llena.
+*/
+int EventServer::ParseFrames(EventConn *c)
+{
+	size_t pos=0;
+	size_t cancel_end=0;	//con la cola llena, hasta donde se siguen creando peticiones
+	bool scanned=false;
+
+	while(c->in.size()-pos>=FRAME_HEADER_SIZE){
+		FrameHeader header;
+		if(UnpackFrameHeader((const unsigned char*)c->in.data()+pos,&header)==-1)
+			return -1;
+		if(header.type==FRAME_CANCEL && header.length==0){
+			CancelFrame(c,header.id,header.flags&FRAME_FLAG_ALL);
+			pos+=FRAME_HEADER_SIZE;
+			continue;
+		}
+		if(header.type!=FRAME_REQUEST)
+			return -1;
+		if(c->in.size()-pos<FRAME_HEADER_SIZE+header.length)
+			break;
+		if(c->requests.size()>=MAX_PIPELINE){
+			if(!scanned){
+				cancel_end=LastCancelEnd(c,pos);
+				scanned=true;
+			}
+			if(pos>=cancel_end)
+				break;
+		}
+
+		SynthRequest *req=NewRequest(c,c->in.data()+pos+FRAME_HEADER_SIZE,header.length);
+		const char *lang=FrameLangName(header.lang);
+		req->legacy=false;
+		req->id=header.id;
+		strcpy(req->lang,lang?lang:"");
+		snprintf(req->speed,sizeof(req->speed),"%d",header.speed);
+		req->setdur=header.flags&FRAME_FLAG_SETDUR;
+		req->streaming=header.flags&FRAME_FLAG_STREAM;
+		if(header.msec>0)
+			req->deadline=req->arrival+header.msec;
+		if(!req->streaming && req->cuts.size()>2)
+			req->wav=new WavBuffer;
+		c->requests.push_back(req);
+		pos+=FRAME_HEADER_SIZE+header.length;
+	}
+	c->in.erase(0,pos);
+	return 0;
+}
+
+/*
+* FRAME_CANCEL de la peticion {id} de {c}, o de todas con {all}. La que
+* esta en sintesis se corta en el worker; las que esperan se marcan y se
+* contestan al llegarles el turno en Dispatch(), para mantener el orden
+* de las respuestas.
+*/
+void EventServer::CancelFrame(EventConn *c, unsigned int id, bool all)
+{
+	if(c->active!=NULL && (all || c->active->id==id))
+		Cancel(c->active);
+	for(size_t i=0;i<c->requests.size();i++)
+		if(all || c->requests[i]->id==id)
+			c->requests[i]->cancelled=true;
+}
+
+/*
+* Cancela {req}. Si un worker la esta sintetizando se cancela tambien su
+* motor, que deja la frase en curso en milisegundos.
+*/
+void EventServer::Cancel(SynthRequest *req)
+{
+	pthread_mutex_lock(&lock);
+	req->cancelled=true;
+	if(req->tts!=NULL)
+		req->tts->cancel();
+	pthread_mutex_unlock(&lock);
+}
+
+bool EventServer::Attach(SynthRequest *req, HTTS *tts)
+{
+	pthread_mutex_lock(&lock);
+	bool ok=!req->cancelled;
+	if(ok)
+		req->tts=tts;
+	pthread_mutex_unlock(&lock);
+	return ok;
+}
+
+void EventServer::Detach(SynthRequest *req)
+{
+	pthread_mutex_lock(&lock);
+	if(req->tts!=NULL)
+		req->tts->cancel(FALSE);
+	req->tts=NULL;
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+* Pasa al pool la siguiente peticion de la conexion si no tiene ninguna
+* en sintesis. Con la cola llena la conexion espera en {blocked}.
+* Las canceladas antes de empezar se contestan aqui sin pasar por el pool.
+*/
+void EventServer::Dispatch(EventConn *c)
+{
+	while(c->active==NULL && !c->requests.empty() && c->requests.front()->cancelled){
+		SynthRequest *req=c->requests.front();
+		c->requests.pop_front();
+		EndMessage(req,"cancelled",c->out);
+		DeleteRequest(req);
+	}
+	if(c->active!=NULL || c->requests.empty())
+		return;
+	SynthRequest *req=c->requests.front();
+	SynthJobInfo info;
+	info.cost=EstimateCost(req->text+req->cuts[req->part],req->cuts[req->part+1]-req->cuts[req->part]);
+	info.arrival=req->arrival;
+	info.deadline=req->deadline;
+	if(!pool->Submit(req,info)){
+		if(!c->blocked){
+			c->blocked=true;
+			blocked.push_back(c->id);
+		}
+		return;
+	}
+	c->requests.pop_front();
+	c->active=req;
+}
+
+void EventServer::Write(EventConn *c)
+{
+	while(c->out_pos<c->out.size()){
+		ssize_t n=send(c->fd,c->out.data()+c->out_pos,c->out.size()-c->out_pos,MSG_NOSIGNAL);
+		if(n>0){
+			c->out_pos+=n;
+			c->last=time(NULL);
+			continue;
+		}
+		if(n==-1 && errno==EINTR)
+			continue;
+		if(n==-1 && (errno==EAGAIN || errno==EWOULDBLOCK))
+			break;
+		Close(c);
+		return;
+	}
+	if(c->out_pos==c->out.size()){
+		c->out.clear();
+		c->out_pos=0;
+	}else if(c->out_pos>READ_CHUNK && c->out_pos*2>c->out.size()){
+		c->out.erase(0,c->out_pos);
+		c->out_pos=0;
+	}
+	Update(c);
+}
+
+/*
+* Ajusta los eventos de epoll al estado de la conexion, o la cierra si
+* ya no queda nada que hacer con ella
+*/
+void EventServer::Update(EventConn *c)
+{
+	bool pending_out=c->out_pos<c->out.size();
+
+	if(c->closing && !pending_out && c->active==NULL && c->requests.empty()){
+		Close(c);
+		return;
+	}
+
+	//Con la cola llena se sigue leyendo para ver FRAME_CANCEL y el cierre
+	//del cliente; si ademas hay demasiado sin procesar, solo el cierre
+	unsigned int events=0;
+	if(!c->eof)
+		events|=Saturated(c)?EPOLLRDHUP:EPOLLIN;
+	if(pending_out)
+		events|=EPOLLOUT;
+	if(events!=c->events){
+		struct epoll_event ev;
+		ev.events=events;
+		ev.data.u64=c->id;
+		epoll_ctl(epoll_fd,EPOLL_CTL_MOD,c->fd,&ev);
+		c->events=events;
+	}
+}
+
+void EventServer::Close(EventConn *c)
+{
+	epoll_ctl(epoll_fd,EPOLL_CTL_DEL,c->fd,NULL);
+	close(c->fd);
+	while(!c->requests.empty()){
+		DeleteRequest(c->requests.front());
+		c->requests.pop_front();
+	}
+	//La peticion en sintesis se cancela y la libera Deliver() cuando el
+	//worker la deje
+	if(c->active!=NULL)
+		Cancel(c->active);
+	conns.erase(c->id);
+	delete c;
+
+	if(!accepting){
+		struct epoll_event ev;
+		ev.events=EPOLLIN;
+		ev.data.u64=EVENT_LISTEN;
+		if(epoll_ctl(epoll_fd,EPOLL_CTL_ADD,listen_fd,&ev)==0)
+			accepting=true;
+	}
+}
+
+/*
+* Reparte a sus conexiones el audio que han dejado los workers y
+* libera las peticiones terminadas
+*/
+void EventServer::Deliver(void)
+{
+	std::deque<Outgoing> ready;
+
+	pthread_mutex_lock(&lock);
+	ready.swap(outbox);
+	pthread_mutex_unlock(&lock);
+
+	while(!ready.empty()){
+		Outgoing &out=ready.front();
+		std::map<unsigned long, EventConn*>::iterator it=conns.find(out.conn);
+		EventConn *c=it==conns.end()?NULL:it->second;
+		if(c!=NULL){
+			if(c->out_pos==c->out.size()){
+				c->out.swap(out.data);
+				c->out_pos=0;
+			}else
+				c->out.append(out.data);
+		}
+		if(out.done!=NULL){
+			SynthRequest *req=out.done;
+			if(c!=NULL && !req->failed && req->part+2<(int)req->cuts.size()){
+				//Queda otro trozo: vuelve a la cola del pool por delante
+				//de las peticiones encadenadas de la conexion
+				req->part++;
+				c->requests.push_front(req);
+			}else
+				DeleteRequest(req);
+			if(c!=NULL){
+				c->active=NULL;
+				//Puede haber peticiones encadenadas sin procesar en c->in
+				if(Parse(c)==-1){
+					Close(c);
+					ready.pop_front();
+					continue;
+				}
+				Dispatch(c);
+			}
+		}
+		if(c!=NULL)
+			Write(c);
+		ready.pop_front();
+	}
+
+	//Ha quedado hueco en la cola del pool
+	size_t n=blocked.size();
+	while(n-->0){
+		unsigned long id=blocked.front();
+		blocked.pop_front();
+		std::map<unsigned long, EventConn*>::iterator it=conns.find(id);
+		if(it==conns.end())
+			continue;
+		EventConn *c=it->second;
+		c->blocked=false;
+		Dispatch(c);
+		Update(c);
+	}
+}
+
+/*
+* Cierra las conexiones sin peticion en curso que llevan {keepalive}
+* segundos sin actividad: clientes ociosos o que no leen la respuesta
+*/
+void EventServer::Sweep(time_t now)
+{
+	std::map<unsigned long, EventConn*>::iterator it=conns.begin();
+	while(it!=conns.end()){
+		EventConn *c=it->second;
+		++it;
+		if(c->active==NULL && c->requests.empty() && now-c->last>=keepalive)
+			Close(c);
+	}
+}
+
+void EventServer::Post(Outgoing &out)
+{
+	uint64_t one=1;
+
+	pthread_mutex_lock(&lock);
+	outbox.push_back(Outgoing());
+	outbox.back().conn=out.conn;
+	outbox.back().data.swap(out.data);
+	outbox.back().done=out.done;
+	pthread_mutex_unlock(&lock);
+	if(write(event_fd,&one,sizeof(one))<0 && errno!=EAGAIN)
+		fprintf(stderr,"Error waking up the event loop: %s\n",strerror(errno));
+}
+
+int EventServer::Reply(SynthRequest *req, const char *block, int block_len)
+{
+	Outgoing out;
+
+	if(req->cancelled)
+		return -1;
+	out.conn=req->conn;
+	out.done=NULL;
+	if(req->legacy){
+		SizeFile size;
+		memset(size.size,0,sizeof(SizeFile));
+		snprintf(size.size,sizeof(SizeFile),"%d",block_len);
+		out.data.reserve(sizeof(SizeFile)+block_len);
+		out.data.append(size.size,sizeof(SizeFile));
+	}else{
+		FrameHeader header;
+		unsigned char hdr[FRAME_HEADER_SIZE];
+		memset(&header,0,sizeof(FrameHeader));
+		header.type=FRAME_AUDIO;
+		header.id=req->id;
+		header.length=block_len;
+		PackFrameHeader(&header,hdr);
+		out.data.reserve(FRAME_HEADER_SIZE+block_len);
+		out.data.append((const char*)hdr,FRAME_HEADER_SIZE);
+	}
+	out.data.append(block,block_len);
+	Post(out);
+	return 0;
+}
+
+void EventServer::Finish(SynthRequest *req, const char *error)
+{
+	Outgoing out;
+
+	out.conn=req->conn;
+	out.done=req;
+	req->failed=error!=NULL;
+	if(error==NULL && req->part+2<(int)req->cuts.size()){
+		//Fin de un trozo intermedio: no se manda nada todavia
+		Post(out);
+		return;
+	}
+	EndMessage(req,error,out.data);
+	Post(out);
+}
+
+/*
+* Anyade a {data} el mensaje final de {req}: fin de audio o, con
+* {error}!=NULL, error
+*/
+void EventServer::EndMessage(SynthRequest *req, const char *error, std::string &data)
+{
+	if(req->legacy){
+		//El protocolo antiguo no tiene mensaje de error: solo se cierra
+		if(error==NULL && req->streaming){
+			SizeFile size;
+			memset(size.size,0,sizeof(SizeFile));
+			strcpy(size.size,"0"); //marca de fin
+			data.append(size.size,sizeof(SizeFile));
+		}
+	}else{
+		FrameHeader header;
+		unsigned char hdr[FRAME_HEADER_SIZE];
+		memset(&header,0,sizeof(FrameHeader));
+		header.type=error?FRAME_ERROR:FRAME_END;
+		header.id=req->id;
+		header.msec=req->queue_wait>65535?65535:req->queue_wait;
+		header.length=error?strlen(error):0;
+		PackFrameHeader(&header,hdr);
+		data.append((const char*)hdr,FRAME_HEADER_SIZE);
+		if(error)
+			data.append(error);
+	}
+}
+
+void EventServer::DeleteRequest(SynthRequest *req)
+{
+	delete []req->text;
+	delete req->wav;
+	delete req;
+}
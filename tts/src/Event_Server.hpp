@@ -0,0 +1,184 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.2.0	 16/10/26  Jonny      Cancelacion de peticiones: FRAME_CANCEL, cierre v2, motor en sintesis
+1.1.0	 16/10/26  Jonny      Peticiones largas en trozos de frases, plazos y espera en cola
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: servidor de eventos con epoll
+*/
+
+#ifndef _EVENT_SERVER_H
+#define _EVENT_SERVER_H
+
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Socket.hpp"
+#include "Synth_Pool.hpp"
+
+class EventServer;
+struct EventConn;
+
+/*
+* Peticion de sintesis ya recibida entera. La crea el thread de red, la
+* atiende un worker del SynthPool, que entrega el audio con Reply() y
+* termina con Finish(), y la libera el thread de red.
+* Un texto largo se parte en trozos de frases enteras ({cuts}) que se
+* encolan de uno en uno: entre trozo y trozo pueden pasar delante
+* peticiones mas cortas de otras conexiones.
+*/
+struct SynthRequest{
+	EventServer *server;
+	unsigned long conn;	//conexion por la que ha llegado
+	bool legacy;		//protocolo antiguo o v2
+	unsigned int id;	//id de la peticion (v2)
+	char lang[4];
+	char speed[8];
+	bool setdur;
+	bool streaming;
+	char *text;
+	int text_len;
+	std::vector<int> cuts;	//limites de los trozos en {text}
+	int part;		//trozo que toca sintetizar
+	WavBuffer *wav;		//wav de todos los trozos, si hay varios y no es streaming
+	long long arrival;	//SynthClockMs() de llegada
+	long long deadline;	//plazo, 0 si no tiene
+	long queue_wait;	//ms en la cola del pool, sumando todos los trozos
+	bool failed;
+	std::atomic<bool> cancelled;	//el cliente la ha cancelado o ha cerrado la conexion
+	HTTS *tts;		//motor que la esta sintetizando, bajo el lock del servidor
+};
+
+/*
+* Capa de red de tts_server. Un unico thread atiende con epoll todas
+* las conexiones, con sockets no bloqueantes y buffers de entrada y
+* salida por conexion: acepta, lee las peticiones (protocolo antiguo o
+* v2), las pasa a la cola acotada del SynthPool y manda el audio que
+* van entregando los workers. Los workers nunca tocan un socket, asi que
+* un cliente lento o parado no retiene ningun thread de sintesis.
+* Cada conexion tiene como mucho una peticion en sintesis; las que
+* llegan encadenadas esperan su turno y se responden en orden.
+*/
+class EventServer{
+	public:
+		EventServer(int listen_fd, SynthPool *pool, int keepalive, int split_chars);
+		~EventServer();
+		int Create(void);
+		/* Bucle de eventos, no vuelve salvo error de epoll */
+		int Run(void);
+
+		/* Llamadas desde los workers */
+		/* Encola un bloque de audio de {req} para su cliente. Devuelve -1
+		 * si la conexion ya se ha cerrado (no merece la pena seguir) */
+		int Reply(SynthRequest *req, const char *block, int block_len);
+		/* Fin de {req}; con {error}!=NULL la peticion ha fallado */
+		void Finish(SynthRequest *req, const char *error);
+		/* El worker empieza a sintetizar {req} con {tts}, que desde ese
+		 * momento se cancela si se cancela la peticion. Devuelve false,
+		 * sin asociarlo, si ya estaba cancelada */
+		bool Attach(SynthRequest *req, HTTS *tts);
+		/* Fin de la sintesis de {req}: retira el motor y una posible
+		 * cancelacion llegada tarde, que no debe cortar la siguiente */
+		void Detach(SynthRequest *req);
+	private:
+		struct Outgoing{
+			unsigned long conn;
+			std::string data;
+			SynthRequest *done;	//!=NULL en el ultimo mensaje de la peticion
+		};
+
+		void Accept(void);
+		void Read(EventConn *c);
+		int Parse(EventConn *c);
+		int ParseLegacy(EventConn *c);
+		int ParseFrames(EventConn *c);
+		SynthRequest* NewRequest(EventConn *c, const char *text, int text_len);
+		void Dispatch(EventConn *c);
+		void Write(EventConn *c);
+		void Update(EventConn *c);
+		void Close(EventConn *c);
+		void Deliver(void);
+		void Sweep(time_t now);
+		void Post(Outgoing &out);
+		void Cancel(SynthRequest *req);
+		void CancelFrame(EventConn *c, unsigned int id, bool all);
+		static void EndMessage(SynthRequest *req, const char *error, std::string &data);
+		static void DeleteRequest(SynthRequest *req);
+
+		int listen_fd;
+		int epoll_fd;
+		int event_fd;
+		bool accepting;
+		SynthPool *pool;
+		int keepalive;
+		int split_chars;
+		unsigned long next_conn;
+		std::map<unsigned long, EventConn*> conns;
+		std::deque<unsigned long> blocked;	//conexiones esperando hueco en la cola
+		std::deque<Outgoing> outbox;		//de los workers al thread de red
+		pthread_mutex_t lock;
+};
+
+
+#endif
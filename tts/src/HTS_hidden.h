@@ -53,6 +53,12 @@
 #define HTS_HIDDEN_H_END
 #endif                          /* __CPLUSPLUS */
 
+#ifdef _WIN32
+#include <windows.h>            /* for CreateThread(),SRWLOCK,CONDITION_VARIABLE */
+#else
+#include <pthread.h>            /* for pthread_create(),pthread_mutex_t,pthread_cond_t */
+#endif                          /* _WIN32 */
+
 HTS_HIDDEN_H_START;
 
 /* hts_engine libraries */
@@ -87,6 +93,9 @@ HTS_Boolean HTS_get_token(HTS_File * fp, char *buff);
 /* HTS_get_token_from_string: get token from string (separator are space,tab,line break) */
 HTS_Boolean HTS_get_token_from_string(char *string, int *index, char *buff);
 
+/* HTS_fwrite: wrapper for fwrite */
+size_t HTS_fwrite(const void *buf, size_t size, size_t n, HTS_File * fp);
+
 /* HTS_fwrite_little_endian: fwrite with byteswap */
 int HTS_fwrite_little_endian(void *p, const int size, const int num, HTS_File * fp);
 
@@ -108,6 +117,64 @@ void HTS_free_matrix(double **p, const int x);
 /* HTS_Free: wrapper for free */
 void HTS_free(void *p);
 
+/* HTS_ARENA_ALIGN: alignment of the buffers of HTS_Arena */
+#define HTS_ARENA_ALIGN 16
+
+/* HTS_ARENA_BLOCK: minimum size of the blocks of HTS_Arena */
+#define HTS_ARENA_BLOCK 65536
+
+/* HTS_ARENA_SHRINK: utterances in a row using a quarter of the block before it is shrunk */
+#define HTS_ARENA_SHRINK 8
+
+/* HTS_Arena_alloc: get zeroed buffer from the arena, valid until HTS_Arena_reset */
+void *HTS_Arena_alloc(HTS_Arena * arena, const size_t num, const size_t size);
+
+/* HTS_Arena_alloc_matrix: get zeroed double matrix from the arena, its rows one after another */
+double **HTS_Arena_alloc_matrix(HTS_Arena * arena, const int x, const int y);
+
+/* HTS_map_file: map a whole file read only (NULL: cannot be mapped) */
+const void *HTS_map_file(const char *name, size_t * size);
+
+/* HTS_unmap_file: unmap file mapped by HTS_map_file */
+void HTS_unmap_file(const void *data, size_t size);
+
+/*  -------------------------- model ------------------------------  */
+
+/* voice image: native byte order, arrays aligned to HTS_IMAGE_ALIGN bytes */
+#define HTS_IMAGE_MAGIC   "HTSVIMG"     /* 8 bytes with the '\0' */
+#define HTS_IMAGE_VERSION 1
+#define HTS_IMAGE_ALIGN   8
+
+/*  -------------------------- threads ----------------------------  */
+
+#ifdef _WIN32
+typedef HANDLE HTS_Thread;
+typedef SRWLOCK HTS_Mutex;
+typedef CONDITION_VARIABLE HTS_Cond;
+#define HTS_MUTEX_INITIALIZER      SRWLOCK_INIT
+#define HTS_mutex_init(m)          InitializeSRWLock(m)
+#define HTS_mutex_destroy(m)
+#define HTS_mutex_lock(m)          AcquireSRWLockExclusive(m)
+#define HTS_mutex_unlock(m)        ReleaseSRWLockExclusive(m)
+#define HTS_cond_init(c)           InitializeConditionVariable(c)
+#define HTS_cond_destroy(c)
+#define HTS_cond_wait(c, m)        SleepConditionVariableSRW(c, m, INFINITE, 0)
+#define HTS_cond_broadcast(c)      WakeAllConditionVariable(c)
+#else
+typedef pthread_t HTS_Thread;
+typedef pthread_mutex_t HTS_Mutex;
+typedef pthread_cond_t HTS_Cond;
+#define HTS_MUTEX_INITIALIZER      PTHREAD_MUTEX_INITIALIZER
+#define HTS_mutex_init(m)          pthread_mutex_init(m, NULL)
+#define HTS_mutex_destroy(m)       pthread_mutex_destroy(m)
+#define HTS_mutex_lock(m)          pthread_mutex_lock(m)
+#define HTS_mutex_unlock(m)        pthread_mutex_unlock(m)
+#define HTS_cond_init(c)           pthread_cond_init(c, NULL)
+#define HTS_cond_destroy(c)        pthread_cond_destroy(c)
+#define HTS_cond_wait(c, m)        pthread_cond_wait(c, m)
+#define HTS_cond_broadcast(c)      pthread_cond_broadcast(c)
+#endif                          /* _WIN32 */
+
 /*  -------------------------- pstream ----------------------------  */
 
 /* check variance in finv() */
@@ -124,6 +191,9 @@ void HTS_free(void *p);
 #define W2       1.0
 #define GV_MAX_ITERATION 5
 
+/* parallel parameter generation */
+#define MLPG_TASKS_PER_THREAD 2
+
 /*  -------------------------- vocoder ----------------------------  */
 
 #ifndef PI
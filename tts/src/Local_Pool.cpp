@@ -0,0 +1,202 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.1	 16/10/26  Jonny      Sintesis con SynthEngine::Synthesize
+1.1.0	 16/10/26  Jonny      Cache de indices de pdf por etiqueta en la voz (label_cache)
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: motores de sintesis dentro del proceso
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "Local_Pool.hpp"
+
+LocalPool::LocalPool(const char *data_path, const Options op, int size, int label_cache)
+{
+	this->data_path=data_path;
+	this->op=op;
+	this->size=size<1?1:size;
+	this->label_cache=label_cache;
+	served=waits=0;
+	pthread_mutex_init(&lock,NULL);
+	pthread_cond_init(&released,NULL);
+}
+
+/* No debe quedar ningun motor en uso */
+LocalPool::~LocalPool()
+{
+	for(size_t i=engines.size();i>0;i--)
+		delete engines[i-1];
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&released);
+}
+
+int LocalPool::Create(void)
+{
+	for(int i=0;i<size;i++){
+		SynthEngine *engine=new SynthEngine(data_path, label_cache);
+		if(engine->Create(i?engines[0]:NULL)==-1){
+			fprintf(stderr,"Unable to load the synthesis engines %d\n",i);
+			delete engine;
+			return -1;
+		}
+		engines.push_back(engine);
+		idle.push_back(engine);
+	}
+	return 0;
+}
+
+SynthEngine* LocalPool::Checkout(void)
+{
+	SynthEngine *engine;
+	bool waited=false;
+
+	pthread_mutex_lock(&lock);
+	while(idle.empty()){
+		if(!waited){
+			waits++;
+			waited=true;
+		}
+		pthread_cond_wait(&released,&lock);
+	}
+	engine=idle.front();
+	idle.pop_front();
+	pthread_mutex_unlock(&lock);
+	return engine;
+}
+
+/* Un Cancel() que llegue cuando ya ha terminado la sintesis se retira
+ * aqui, para que no corte la siguiente peticion del motor */
+void LocalPool::Return(SynthEngine *engine)
+{
+	HTTS *tts=ObtainEngine(engine);
+	if(tts!=NULL)
+		tts->cancel(FALSE);
+	pthread_mutex_lock(&lock);
+	idle.push_back(engine);
+	served++;
+	pthread_cond_signal(&released);
+	pthread_mutex_unlock(&lock);
+}
+
+HTTS* LocalPool::ObtainEngine(SynthEngine *engine)
+{
+	return engine->ObtainEngine(op.language);
+}
+
+/*
+* Con SynthEngine::Synthesize(), como tts_server: si {callback} falla o se
+* cancela se descartan las frases que quedan y el motor queda vacio para
+* la siguiente peticion
+*/
+int LocalPool::Synthesize(SynthEngine *engine, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user)
+{
+	HTTS *tts=ObtainEngine(engine);
+	if(tts==NULL){
+		fprintf(stderr,"Language %s not supported\n",op.language);
+		return -1;
+	}
+	engine->SetRequestOptions(tts,op.speed,op.setdur);
+
+	WavBuffer *wav=engine->ObtainWavBuffer();
+	wav->Reset();
+	std::string str(text,len);
+	return engine->Synthesize(tts,op.language,str.c_str(),streaming,wav,true,callback,user);
+}
+
+void LocalPool::Cancel(SynthEngine *engine)
+{
+	HTTS *tts=ObtainEngine(engine);
+	if(tts!=NULL)
+		tts->cancel();
+}
+
+int LocalPool::Request(unsigned int id, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user)
+{
+	SynthEngine *engine=Checkout();
+	int ret=Synthesize(engine,text,len,streaming,callback,user);
+	Return(engine);
+	if(ret==-1)
+		fprintf(stderr,"Request %u not synthesized\n",id);
+	return ret;
+}
+
+void LocalPool::ObtainStats(long *served, long *waits)
+{
+	pthread_mutex_lock(&lock);
+	*served=this->served;
+	*waits=this->waits;
+	pthread_mutex_unlock(&lock);
+}
+
+/* La cadena de stats es del primer motor: se lee y se copia con el lock */
+bool LocalPool::ObtainLabelCacheStats(std::string &stats)
+{
+	bool ok=false;
+	pthread_mutex_lock(&lock);
+	const char *str=engines.empty()?NULL:engines[0]->ObtainLabelCacheStats(op.language);
+	if(str!=NULL){
+		stats=str;
+		ok=true;
+	}
+	pthread_mutex_unlock(&lock);
+	return ok;
+}
@@ -0,0 +1,126 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      Cache de indices de pdf por etiqueta en la voz (label_cache)
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: motores de sintesis dentro del proceso
+*/
+
+#ifndef _LOCAL_POOL_H
+#define _LOCAL_POOL_H
+
+#include <pthread.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Socket.hpp"
+#include "Synth_Pool.hpp"
+
+/*
+* Pool de motores de sintesis dentro del propio proceso, alternativa a
+* ConnectionPool cuando no hace falta un tts_server aparte: el texto no
+* pasa por ningun socket y el audio sale directamente del vocoder.
+* Se crean {size} SynthEngine al arrancar (el primero carga los modelos,
+* los demas los comparten a traves de HTTS_DB). Cada peticion toma un
+* motor con Checkout(), lo usa en exclusiva y lo devuelve con Return();
+* si estan todos en uso Checkout() espera a que se devuelva alguno.
+*/
+class LocalPool{
+	public:
+		/* {label_cache}: kB de la cache de etiquetas de la voz, 0 sin cache */
+		LocalPool(const char *data_path, const Options op, int size, int label_cache=0);
+		~LocalPool();
+		/* Crea y calienta los motores. Devuelve 0 o -1 si falla alguno */
+		int Create(void);
+		SynthEngine* Checkout(void);
+		void Return(SynthEngine *engine);
+		/* Sintetiza {text} con {engine}. Con {streaming} el audio se pasa
+		 * a {callback} frase a frase (PCM), si no como un unico wav.
+		 * Devuelve los bytes pasados o -1 si {callback} ha fallado o se
+		 * ha cancelado */
+		int Synthesize(SynthEngine *engine, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user);
+		/* Corta desde otro thread la sintesis en curso de {engine} */
+		void Cancel(SynthEngine *engine);
+		/* Checkout, Synthesize y Return, con la misma forma que
+		 * ConnectionPool::Request ({id} solo se usa en los mensajes) */
+		int Request(unsigned int id, const char *text, int len, bool streaming, AudioBlockFunc callback, void *user);
+		int ObtainSize(void){return size;}
+		/* Peticiones servidas y checkouts que han tenido que esperar con
+		 * todos los motores en uso */
+		void ObtainStats(long *served, long *waits);
+		/* Copia en {stats} las cuentas de la cache de etiquetas de la voz
+		 * compartida por todos los motores. Devuelve false si no hay */
+		bool ObtainLabelCacheStats(std::string &stats);
+	private:
+		HTTS* ObtainEngine(SynthEngine *engine);
+
+		const char *data_path;
+		Options op;
+		int size;
+		int label_cache;
+		std::vector<SynthEngine*> engines;
+		std::deque<SynthEngine*> idle;
+		long served, waits;
+		pthread_mutex_t lock;
+		pthread_cond_t released;
+};
+
+
+#endif
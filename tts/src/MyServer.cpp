@@ -58,14 +58,28 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.8.0	 16/10/26  Jonny      LabelCache: cache de indices de pdf por etiqueta, en /pool_stats
+1.7.0	 16/10/26  Jonny      Backend=local: motores de sintesis en el propio proceso
+1.6.0	 16/10/26  Jonny      Respuesta con el audio en binario o multipart, base64 sin copias
+1.5.0	 16/10/26  Jonny      Endpoint /speech_pipeline: sintesis frase a frase mientras ChatGPT genera
+1.4.0	 16/10/26  Jonny      Endpoint /speech_stream: audio por chunks HTTP segun se sintetiza
+1.3.0	 16/10/26  Jonny      Pool de conexiones persistentes a tts_server
+1.2.0	 16/10/26  Jonny      Peticiones a tts_server con el protocolo v2
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0, KVStrList
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include "Socket_Cliente.hpp"
+#include "Connection_Pool.hpp"
+#include "Local_Pool.hpp"
+#include "Speech_Pipeline.hpp"
+#include "Wav_Buffer.hpp"
 #include "strl.hpp"
 #include "string.hpp"
 #include "httplib.h"  // Include cpp-httplib header
@@ -75,25 +89,146 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 
 using namespace std;
 
+// Appends each audio frame received from the synthesis backend to a std::string
+static int AppendAudio(const char *block, int block_len, void *user) {
+    ((std::string*)user)->append(block, block_len);
+    return 0;
+}
+
+// Synthesizes text with the selected backend: the connections to
+// tts_server (pool) or the engines loaded in this process (local)
+static int Synthesize(ConnectionPool *pool, LocalPool *local, unsigned int id, const std::string &text, bool streaming, AudioBlockFunc callback, void *user) {
+    if (local != NULL)
+        return local->Request(id, text.c_str(), text.length(), streaming, callback, user);
+    return pool->Request(id, text.c_str(), text.length(), streaming, callback, user);
+}
+
+// Builds the ChatGPT request from the client JSON input, which must hold a
+// non-empty "messages" array and may set "model", "temperature" and
+// "max_tokens". On invalid input fills error_json and returns false
+static bool BuildChatRequest(const std::string &input, openai::Json &chat_request, openai::Json &error_json) {
+    openai::Json input_json;
+
+    try {
+        // Try to parse the input as JSON
+        input_json = openai::json_parse(input);
+        cout << "Parsed input as JSON" << endl;
+    } catch (const std::exception& e) {
+        // Return an error for invalid JSON
+        cout << "Error: Input is not valid JSON" << endl;
+        error_json["error"] = "Invalid JSON input";
+        error_json["details"] = e.what();
+        return false;
+    }
+
+    // Validate that the JSON contains a messages array
+    if (!input_json.contains("messages") || !input_json["messages"].is_array() || input_json["messages"].empty()) {
+        cout << "Error: JSON must contain a non-empty 'messages' array" << endl;
+        error_json["error"] = "Invalid input format";
+        error_json["details"] = "JSON must contain a non-empty 'messages' array";
+        return false;
+    }
+
+    // Set up the ChatGPT request
+    chat_request["model"] = "gpt-3.5-turbo";
+    chat_request["messages"] = input_json["messages"];
+
+    // Copy other parameters if they exist
+    if (input_json.contains("model")) {
+        chat_request["model"] = input_json["model"];
+    }
+    if (input_json.contains("temperature")) {
+        chat_request["temperature"] = input_json["temperature"];
+    } else {
+        chat_request["temperature"] = 0.7;
+    }
+    if (input_json.contains("max_tokens")) {
+        chat_request["max_tokens"] = input_json["max_tokens"];
+    }
+    return true;
+}
+
+// Writes each sentence received from the synthesis backend as an HTTP chunk
+static int WriteChunk(const char *block, int block_len, void *user) {
+    httplib::DataSink *sink = (httplib::DataSink*)user;
+    return sink->write(block, block_len) ? 0 : -1;
+}
+
+// Builds the JSON answer {"audio": ..., "audio_format": "wav", "text": ...},
+// in the key order nlohmann::json would dump it. The audio is base64 encoded
+// straight into the body instead of going through a JSON string value.
+// Without audio only the text is returned
+static std::string AudioJson(const std::string &text, const std::string &audio) {
+    std::string text_json = openai::Json(text).dump();
+    if (audio.empty())
+        return "{\"text\":" + text_json + "}";
+
+    static const char prefix[] = "{\"audio\":\"";
+    std::string suffix = "\",\"audio_format\":\"wav\",\"text\":" + text_json + "}";
+    size_t encoded = base64_encoded_length(audio.size());
+    std::string body;
+    body.resize(sizeof(prefix) - 1 + encoded + suffix.size());
+    memcpy(&body[0], prefix, sizeof(prefix) - 1);
+    base64_encode((const unsigned char*)audio.data(), audio.size(), &body[sizeof(prefix) - 1]);
+    memcpy(&body[sizeof(prefix) - 1 + encoded], suffix.data(), suffix.size());
+    return body;
+}
+
+// Answers with a multipart/mixed body: a JSON part with the text and an
+// audio/wav part. The audio buffer is moved into the response and written
+// from there, without copying it into the body
+static void SetMultipartContent(httplib::Response &res, const std::string &text, std::string &&audio) {
+    struct Parts {
+        std::string head, audio, tail;
+    };
+    std::string boundary = httplib::detail::make_multipart_data_boundary();
+    std::shared_ptr<Parts> parts = std::make_shared<Parts>();
+    parts->head = "--" + boundary + "\r\n"
+        "Content-Type: application/json\r\n\r\n" +
+        openai::Json({{"text", text}}).dump() + "\r\n"
+        "--" + boundary + "\r\n"
+        "Content-Type: audio/wav\r\n\r\n";
+    parts->audio = std::move(audio);
+    parts->tail = "\r\n--" + boundary + "--\r\n";
+
+    size_t length = parts->head.size() + parts->audio.size() + parts->tail.size();
+    res.set_content_provider(length, "multipart/mixed; boundary=" + boundary,
+        [parts](size_t offset, size_t length, httplib::DataSink &sink) {
+            for (const std::string *part : {&parts->head, &parts->audio, &parts->tail}) {
+                if (offset < part->size())
+                    return sink.write(part->data() + offset, std::min(length, part->size() - offset));
+                offset -= part->size();
+            }
+            return false;
+        });
+}
+
 // HTTP
 int main(int argc, char *argv[]) {
-    KVStrList pro("InputFile=input.txt Lang=eu OutputFile=output.wav Speed=100 SocketIP=NULL IP=NULL Port=0 SocketPort=0 SetDur=n OpenAIKey=NULL");
+    KVStrList pro("InputFile=input.txt Lang=eu OutputFile=output.wav Speed=100 SocketIP=NULL IP=NULL Port=0 SocketPort=0 SetDur=n OpenAIKey=NULL SocketConnections=4 SentenceMaxChars=400 FirstClauseChars=30 Backend=socket DataPath=data_tts Engines=2 LabelCache=0");
     StrList files;
 
     clargs2props(argc, argv, pro, files,
-            "InputFile=s Lang={es|eu} OutputFile=s Speed=s SocketIP=s IP=s Port=i SocketPort=i SetDur=b OpenAIKey=s");
+            "InputFile=s Lang={es|eu} OutputFile=s Speed=s SocketIP=s IP=s Port=i SocketPort=i SetDur=b OpenAIKey=s SocketConnections=i SentenceMaxChars=i FirstClauseChars=i Backend={socket|local} DataPath=s Engines=i LabelCache=i");
 
     httplib::Server svr;
 
     const char *lang = pro.val("Lang");
-    const char *inputfile = pro.val("InputFile");
-    const char *outputfile = pro.val("OutputFile");
     const char *speed = pro.val("Speed");
     const char *ip=pro.val("IP");
     const char *ip_socket=pro.val("SocketIP");
     const int puerto=pro.ival("Port");
     const int puerto_socket=pro.ival("SocketPort");
     const char *openai_key=pro.val("OpenAIKey");
+    const int socket_connections=pro.ival("SocketConnections");
+    const int sentence_max_chars=pro.ival("SentenceMaxChars");
+    const int first_clause_chars=pro.ival("FirstClauseChars");
+    // socket: synthesis in a separate tts_server; local: in this process
+    const bool in_process=!strcmp(pro.val("Backend"),"local");
+    const char *data_path=pro.val("DataPath");
+    const int engines=pro.ival("Engines");
+    // kB of the label -> pdf indices cache of the voice (Backend=local), 0: none
+    const int label_cache=pro.ival("LabelCache");
     cout << "Puerto: " << puerto << endl;
     cout << "Puerto socket: " << puerto_socket << endl;
     bool setdur=pro.bbval("SetDur");
@@ -114,7 +249,7 @@ int main(int argc, char *argv[]) {
         exit (-1);
     }
 
-    if (!strcmp(ip_socket,"NULL")){
+    if (!in_process && !strcmp(ip_socket,"NULL")){
         fprintf(stderr,"Socket IP direction is mandatory\n");
         exit (-1);
     }
@@ -124,16 +259,44 @@ int main(int argc, char *argv[]) {
         exit (-1);
     }
 
-    if(puerto_socket<1024 || puerto_socket>65535){
+    if(!in_process && (puerto_socket<1024 || puerto_socket>65535)){
         fprintf(stderr,"The socket port must be between 1024 and 65535 (WellKnown ports are forbidden)\n");
         exit (-1);
     }
 
+    if(in_process && engines<1){
+        fprintf(stderr,"Engines must be at least 1\n");
+        exit (-1);
+    }
+
+    if(!in_process && socket_connections<1){
+        fprintf(stderr,"SocketConnections must be at least 1\n");
+        exit (-1);
+    }
+
+    // Ids tag each protocol v2 request so replies can be matched
+    std::atomic<unsigned int> next_request_id(0);
+
     Options op;
     strcpy(op.language,lang);
     strcpy(op.speed,speed);
     op.setdur=setdur;
 
+    // Persistent connections to tts_server shared by all the httplib worker
+    // threads or, with Backend=local, synthesis engines preloaded in this
+    // process, with no socket, no second process and no WAV round-trip
+    ConnectionPool *pool = NULL;
+    LocalPool *local = NULL;
+    if (in_process) {
+        local = new LocalPool(data_path, op, engines, label_cache);
+        cout << "Loading " << engines << " synthesis engines from " << data_path << endl;
+        if (local->Create() == -1) {
+            fprintf(stderr,"Unable to load the synthesis engines\n");
+            exit (-1);
+        }
+    } else
+        pool = new ConnectionPool(ip_socket, puerto_socket, op, socket_connections);
+
 
     cout << "Hello" << endl;
     svr.Get("/hi", [](const httplib::Request &, httplib::Response &res) {
@@ -142,6 +305,43 @@ int main(int argc, char *argv[]) {
     });
 
 
+    // Pool counters, to size SocketConnections (or Engines)
+    svr.Get("/pool_stats", [&](const httplib::Request &, httplib::Response &res) {
+        openai::Json stats;
+        if (local != NULL) {
+            long served, waits;
+            local->ObtainStats(&served, &waits);
+            stats["backend"] = "local";
+            stats["size"] = local->ObtainSize();
+            stats["served"] = served;
+            stats["waits"] = waits;
+            std::string cache_stats;
+            unsigned long hits, misses, evictions, bytes;
+            int entries;
+            if (local->ObtainLabelCacheStats(cache_stats) &&
+                sscanf(cache_stats.c_str(), "hits=%lu misses=%lu evictions=%lu entries=%d bytes=%lu",
+                       &hits, &misses, &evictions, &entries, &bytes) == 5) {
+                openai::Json cache;
+                cache["hits"] = hits;
+                cache["misses"] = misses;
+                cache["evictions"] = evictions;
+                cache["entries"] = entries;
+                cache["bytes"] = bytes;
+                stats["label_cache"] = cache;
+            }
+        } else {
+            long hits, misses, reconnects, waits;
+            pool->ObtainStats(&hits, &misses, &reconnects, &waits);
+            stats["backend"] = "socket";
+            stats["size"] = pool->ObtainSize();
+            stats["hits"] = hits;
+            stats["misses"] = misses;
+            stats["reconnects"] = reconnects;
+            stats["waits"] = waits;
+        }
+        res.set_content(stats.dump(), "application/json");
+    });
+
     svr.Options(R"(\*)", [](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Allow", "GET, POST, HEAD, OPTIONS");
     });
@@ -160,6 +360,135 @@ int main(int argc, char *argv[]) {
         }
     });
 
+    // Streams the synthesized answer while it is produced, one HTTP chunk per
+    // sentence, so playback can start before the whole answer is synthesized.
+    // The ChatGPT text goes percent-encoded in the X-Response-Text header.
+    // The body is a WAV with a streaming header (unknown length), or raw
+    // 16 bit 16 kHz mono PCM with ?format=pcm
+    svr.Post("/speech_stream", [&](const httplib::Request &req, httplib::Response &res) {
+        res.set_header("Access-Control-Allow-Origin", "*"); // Allow all origins
+        res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE"); // Allow methods
+        res.set_header("Access-Control-Allow-Headers", "Content-Type"); // Allow headers
+        res.set_header("Access-Control-Expose-Headers", "X-Response-Text");
+
+        openai::Json chat_request;
+        openai::Json error_json;
+        if (!BuildChatRequest(req.body, chat_request, error_json)) {
+            res.status = 400;
+            res.set_content(error_json.dump(), "application/json");
+            return;
+        }
+
+        std::string chatgpt_response;
+        try {
+            cout << "Sending request to ChatGPT API with " << chat_request["messages"].size() << " messages" << endl;
+            openai::Json chat_response = openai::chat().create(chat_request);
+            chatgpt_response = chat_response["choices"][0]["message"]["content"];
+        } catch (const std::exception& e) {
+            cout << "OpenAI API error: " << e.what() << endl;
+            error_json["error"] = "OpenAI API error";
+            error_json["details"] = e.what();
+            res.status = 502;
+            res.set_content(error_json.dump(), "application/json");
+            return;
+        }
+        cout << "ChatGPT response: " << chatgpt_response << endl;
+
+        bool wav = req.get_param_value("format") != "pcm";
+        unsigned int request_id = next_request_id++;
+        res.set_header("X-Response-Text", httplib::detail::encode_query_param(chatgpt_response));
+        res.set_chunked_content_provider(wav ? "audio/wav" : "audio/L16;rate=16000;channels=1",
+            [pool, local, chatgpt_response, wav, request_id](size_t, httplib::DataSink &sink) {
+                if (wav) {
+                    char header[WavBuffer::WAV_HEADER_SIZE];
+                    WavBuffer::StreamHeader(header);
+                    if (!sink.write(header, sizeof(header)))
+                        return false;
+                }
+                if (Synthesize(pool, local, request_id, chatgpt_response, true, WriteChunk, &sink) == -1) {
+                    // Abort the chunked response so the client sees it is truncated
+                    fprintf(stderr,"Unable to stream the synthesized response\n");
+                    return false;
+                }
+                sink.done();
+                return true;
+            });
+    });
+
+    // Like /speech_stream, but the answer is requested in streaming mode and
+    // each sentence is sent to tts_server as soon as ChatGPT finishes it, so
+    // the first audio arrives before the whole answer is generated. The
+    // answer text goes in the X-Response-Text trailer
+    svr.Post("/speech_pipeline", [&](const httplib::Request &req, httplib::Response &res) {
+        res.set_header("Access-Control-Allow-Origin", "*"); // Allow all origins
+        res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE"); // Allow methods
+        res.set_header("Access-Control-Allow-Headers", "Content-Type"); // Allow headers
+        res.set_header("Access-Control-Expose-Headers", "X-Response-Text");
+
+        openai::Json chat_request;
+        openai::Json error_json;
+        if (!BuildChatRequest(req.body, chat_request, error_json)) {
+            res.status = 400;
+            res.set_content(error_json.dump(), "application/json");
+            return;
+        }
+
+        bool wav = req.get_param_value("format") != "pcm";
+        res.set_header("Trailer", "X-Response-Text");
+        res.set_chunked_content_provider(wav ? "audio/wav" : "audio/L16;rate=16000;channels=1",
+            [pool, local, chat_request, wav, sentence_max_chars, first_clause_chars](size_t, httplib::DataSink &sink) {
+                std::unique_ptr<SpeechPipeline> backend(local != NULL ?
+                    new SpeechPipeline(local, sentence_max_chars, first_clause_chars) :
+                    new SpeechPipeline(pool, sentence_max_chars, first_clause_chars));
+                SpeechPipeline &pipeline = *backend;
+
+                // The answer is generated in this thread while the audio is
+                // read back in order in the httplib one
+                std::thread producer([&pipeline, &chat_request]() {
+                    bool ok = true;
+                    try {
+                        cout << "Sending streaming request to ChatGPT API with " << chat_request["messages"].size() << " messages" << endl;
+                        openai::chat().create_stream(chat_request, [&pipeline](const std::string &delta) {
+                            return pipeline.Feed(delta.data(), delta.length()) != -1;
+                        });
+                    } catch (const std::exception& e) {
+                        cout << "OpenAI API error: " << e.what() << endl;
+                        ok = false;
+                    }
+                    pipeline.Finish(ok);
+                });
+
+                bool ok = true;
+                if (wav) {
+                    char header[WavBuffer::WAV_HEADER_SIZE];
+                    WavBuffer::StreamHeader(header);
+                    ok = sink.write(header, sizeof(header));
+                }
+                if (ok && pipeline.Receive(WriteChunk, &sink) == -1)
+                    ok = false;
+                if (!ok)
+                    pipeline.Cancel();
+                producer.join();
+
+                std::string answer = pipeline.ObtainText();
+                cout << "ChatGPT response: " << answer << endl;
+                cout << "Sentences: " << pipeline.ObtainSentences() << ", first audio after " << pipeline.ObtainFirstAudio() << " ms" << endl;
+                if (!ok) {
+                    // Abort the chunked response so the client sees it is truncated
+                    fprintf(stderr,"Unable to stream the synthesized response\n");
+                    return false;
+                }
+                httplib::Headers trailer;
+                trailer.emplace("X-Response-Text", httplib::detail::encode_query_param(answer));
+                sink.done_with_trailer(trailer);
+                return true;
+            });
+    });
+
+    // Answers with the ChatGPT text and its synthesized audio. By default a
+    // JSON with the WAV in base64; ?format=wav returns the WAV as the body
+    // (text in X-Response-Text) and ?format=multipart a JSON part with the
+    // text followed by an audio/wav part, both without base64
     svr.Post("/content_receiver",
   [&](const httplib::Request &req, httplib::Response &res, const httplib::ContentReader &content_reader) {
 
@@ -176,53 +505,15 @@ int main(int argc, char *argv[]) {
 
             // Send the text to ChatGPT API
             try {
-                // Parse the input as JSON
+                // Parse the input as JSON and set up the ChatGPT request
                 openai::Json chat_request;
-                openai::Json input_json;
-
-                try {
-                    // Try to parse the input as JSON
-                    input_json = openai::json_parse(std::string(data, data_length));
-                    cout << "Parsed input as JSON" << endl;
-                } catch (const std::exception& e) {
-                    // Return an error for invalid JSON
-                    cout << "Error: Input is not valid JSON" << endl;
-                    openai::Json error_json;
-                    error_json["error"] = "Invalid JSON input";
-                    error_json["details"] = e.what();
+                openai::Json error_json;
+                if (!BuildChatRequest(std::string(data, data_length), chat_request, error_json)) {
                     res.set_header("Content-Type", "application/json");
                     res.set_content(error_json.dump(), "application/json");
                     return true;
                 }
 
-                // Validate that the JSON contains a messages array
-                if (!input_json.contains("messages") || !input_json["messages"].is_array() || input_json["messages"].empty()) {
-                    cout << "Error: JSON must contain a non-empty 'messages' array" << endl;
-                    openai::Json error_json;
-                    error_json["error"] = "Invalid input format";
-                    error_json["details"] = "JSON must contain a non-empty 'messages' array";
-                    res.set_header("Content-Type", "application/json");
-                    res.set_content(error_json.dump(), "application/json");
-                    return true;
-                }
-
-                // Set up the ChatGPT request
-                chat_request["model"] = "gpt-3.5-turbo";
-                chat_request["messages"] = input_json["messages"];
-
-                // Copy other parameters if they exist
-                if (input_json.contains("model")) {
-                    chat_request["model"] = input_json["model"];
-                }
-                if (input_json.contains("temperature")) {
-                    chat_request["temperature"] = input_json["temperature"];
-                } else {
-                    chat_request["temperature"] = 0.7;
-                }
-                if (input_json.contains("max_tokens")) {
-                    chat_request["max_tokens"] = input_json["max_tokens"];
-                }
-
                 cout << "Sending request to ChatGPT API with " << chat_request["messages"].size() << " messages" << endl;
 
                 // Make the request to ChatGPT API
@@ -232,56 +523,31 @@ int main(int argc, char *argv[]) {
                 std::string chatgpt_response = chat_response["choices"][0]["message"]["content"];
                 cout << "ChatGPT response: " << chatgpt_response << endl;
 
-                // Create a JSON response with both text and audio
-                openai::Json response_json;
-                response_json["text"] = chatgpt_response;
-
-                // Now process the ChatGPT response with TTS to get audio
-                ClientConnection *cliente = new ClientConnection (op);
-
-                int aux;
-                cout << "IP socket: " << ip_socket << endl;
-                cout << "Port socket: " << puerto_socket << endl;
-                aux=cliente->OpenInetConnection(ip_socket,puerto_socket);
-                if(aux==-1) {
-                    fprintf(stderr,"Unable to establish server connection\n");
-                    // Don't exit, just return the text response without audio
-                    res.set_header("Content-Type", "application/json");
-                    res.set_content(response_json.dump(), "application/json");
-                    return true;
-                }
-
-                cliente->SendOptions();
+                // Now process the ChatGPT response with TTS to get audio,
+                // over a warm connection (or engine) taken from the pool
                 fprintf(stderr,"Sending ChatGPT response to synthesize\n");
                 cout << "ChatGPT response length: " << chatgpt_response.length() << endl;
-                cliente->SendText(chatgpt_response.c_str(), chatgpt_response.length(), cliente->ObtainSSocket());
-
-                fprintf(stderr,"Receiving synthesized file\n");
-
-                int out_size = 1024 * 10;
-                char **outputAudio = (char**) malloc(sizeof (char**));
-                *outputAudio = (char*)malloc(out_size * sizeof(char*));
-                cout << "First malloc" << endl;
-                cliente->ReceiveAudio(outputAudio, &out_size, cliente->ObtainSSocket());
-                cout << "This is the output size of the new audio: " << out_size << endl;
-
-                cliente->CloseConnection();
-                delete (cliente);
-
-                // Encode audio data to base64
-                std::string base64_audio = base64_encode((const unsigned char*)*outputAudio, out_size);
-
-                // Add audio to JSON response
-                response_json["audio"] = base64_audio;
-                response_json["audio_format"] = "wav";
-
-                // Return the JSON response
-                res.set_header("Content-Type", "application/json");
-                res.set_content(response_json.dump(), "application/json");
-
-                // Free the audio memory
-                free(*outputAudio);
-                free(outputAudio);
+                std::string audio;
+                unsigned int request_id = next_request_id++;
+                if (Synthesize(pool, local, request_id, chatgpt_response, false, AppendAudio, &audio) == -1) {
+                    // Don't fail, just return the text response without audio
+                    fprintf(stderr,"Unable to synthesize the response\n");
+                    audio.clear();
+                }
+                cout << "This is the output size of the new audio: " << audio.size() << endl;
+
+                std::string format = req.get_param_value("format");
+                if (format == "wav" && !audio.empty()) {
+                    // The WAV itself is the body, the text goes percent-encoded in a header
+                    res.set_header("Access-Control-Expose-Headers", "X-Response-Text");
+                    res.set_header("X-Response-Text", httplib::detail::encode_query_param(chatgpt_response));
+                    res.set_content(std::move(audio), "audio/wav");
+                } else if (format == "multipart" && !audio.empty()) {
+                    SetMultipartContent(res, chatgpt_response, std::move(audio));
+                } else {
+                    // Return the JSON response, with the audio in base64
+                    res.set_content(AudioJson(chatgpt_response, audio), "application/json");
+                }
 
                 return true;
             } catch (const std::exception& e) {
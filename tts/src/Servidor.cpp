@@ -57,6 +57,16 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.10.1	 16/10/26  Jonny      La sintesis de cada trozo pasa a SynthEngine::Synthesize
+1.10.0	 16/10/26  Jonny      LabelCache: cache de indices de pdf por etiqueta en la voz
+1.9.0	 16/10/26  Jonny      Peticiones canceladas: se corta el motor y se libera el worker
+1.8.0	 16/10/26  Jonny      Audio por la API de streaming de HTTS, sin buffer por frase
+1.7.0	 16/10/26  Jonny      Planificador con plazos, textos largos por trozos, espera en cola
+1.6.0	 16/10/26  Jonny      Red con epoll (EventServer) y cola acotada hacia los workers
+1.5.0	 16/10/26  Jonny      Protocolo v2: conexion persistente con peticiones encadenadas
+1.4.0	 16/10/26  Jonny      Modo streaming: cada frase se manda en cuanto se sintetiza
+1.3.0	 16/10/26  Jonny      Texto y wav en memoria, sin ficheros txt/ y wav/ intermedios
+1.2.0	 16/10/26  Jonny      Pool fijo de workers con motores precargados, sin fork por peticion
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
@@ -65,24 +75,105 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
-#include <time.h>
+
+#include <string>
 
 #include "htts.hpp"
 #include "strl.hpp"
-#include "caudio.hpp"
+#include "Synth_Pool.hpp"
+#include "Wav_Buffer.hpp"
+#include "Event_Server.hpp"
 //#define SERVICE "ahotts"
 
+/*
+* Cada bloque de audio sale hacia el thread de red, que lo manda al
+* cliente con el formato de su protocolo
+*/
+static int SendBlock(const char *block, int block_len, void *user)
+{
+	SynthRequest *req=(SynthRequest*)user;
+	return req->server->Reply(req,block,block_len);
+}
+
+/*
+* Atiende en el worker {worker}, con sus motores ya cargados, el trozo
+* que toca de una peticion recibida entera por el EventServer, tras
+* {wait} ms en la cola. Todo se hace en memoria, sin ficheros
+* intermedios ni E/S de red.
+*/
+static void AttendRequest(void *job, SynthEngine *engine, int worker, long wait)
+{
+	SynthRequest *req=(SynthRequest*)job;
+	int nparts=req->cuts.size()-1;
+	int part=req->part;
+	bool last=part==nparts-1;
+
+	req->queue_wait+=wait;
+	HTTS *tts=engine->ObtainEngine(req->lang);
+	if(tts==NULL){
+		fprintf(stderr,"Language %s not supported\n",req->lang);
+		req->server->Finish(req,"language not supported");
+		return;
+	}
+	if(!req->server->Attach(req,tts)){
+		fprintf(stderr,"Request %u cancelled before synthesis (worker %d)\n",req->id,worker);
+		req->server->Finish(req,"cancelled");
+		return;
+	}
+	engine->SetRequestOptions(tts,req->speed,req->setdur);
+
+	//Con un solo trozo basta el wav del worker
+	WavBuffer *wav=req->wav?req->wav:engine->ObtainWavBuffer();
+	if(part==0)
+		wav->Reset();
+	if(nparts==1)
+		engine->Synthesize(tts,req->lang,req->text,req->streaming,wav,true,SendBlock,req);
+	else{
+		std::string text(req->text+req->cuts[part],req->cuts[part+1]-req->cuts[part]);
+		engine->Synthesize(tts,req->lang,text.c_str(),req->streaming,wav,last,SendBlock,req);
+	}
+	req->server->Detach(req);
+	if(req->cancelled){
+		//Barge-in o conexion cerrada: el worker queda libre al momento
+		fprintf(stderr,"Request %u cancelled (worker %d)\n",req->id,worker);
+		req->server->Finish(req,"cancelled");
+		return;
+	}
+
+	//{req} deja de ser del worker en cuanto se llama a Finish()
+	unsigned int id=req->id;
+	long queue_wait=req->queue_wait;
+	long long late=req->deadline>0?SynthClockMs()-req->deadline:0;
+	if(last)
+		engine->RequestServed();
+	req->server->Finish(req,NULL);
+
+	if(!last)
+		fprintf(stderr,"Request %u part %d/%d done (worker %d, queue wait %ld ms)\n",id,part+1,nparts,worker,wait);
+	else{
+		fprintf(stderr,"Request %u finished (worker %d, warm engine, %d requests served, queue wait %ld ms)\n",id,worker,engine->ObtainServed(),queue_wait);
+		if(late>0)
+			fprintf(stderr,"Request %u missed its deadline by %lld ms\n",id,late);
+	}
+}
+
 int main (int argc, char* argv[])
 {
 
-	KVStrList pro("IP=NULL Port=0 DataPath=data_tts");
+	KVStrList pro("IP=NULL Port=0 DataPath=data_tts Workers=2 Queue=64 KeepAlive=30 SplitChars=600 LabelCache=0");
 	StrList files;
 
-	clargs2props(argc, argv, pro, files, "IP=s Port=i");
+	clargs2props(argc, argv, pro, files, "IP=s Port=i DataPath=s Workers=i Queue=i KeepAlive=i SplitChars=i LabelCache=i");
 
 	const int puerto=pro.ival("Port");
 	const char* ip=pro.val("IP");
+	const int nworkers=pro.ival("Workers");
 	const char* data_path=pro.val("DataPath");
+	const int queue=pro.ival("Queue");
+	const int keepalive=pro.ival("KeepAlive");
+	const int split_chars=pro.ival("SplitChars");
+	//kB de la cache etiqueta -> indices de pdf de cada voz, 0 sin cache
+	const int label_cache=pro.ival("LabelCache");
 
 	if (!strcmp(ip,"NULL")){
 		fprintf(stderr,"IP direction is mandatory\n");
@@ -92,6 +183,33 @@ int main (int argc, char* argv[])
 		fprintf(stderr,"The port must be between 1024 and 65535 (WellKnown ports are forbidden)\n");
 		exit (-1);
 	}
+	if(nworkers<1){
+		fprintf(stderr,"The number of workers must be at least 1\n");
+		exit (-1);
+	}
+	if(queue<1){
+		fprintf(stderr,"The synthesis queue must hold at least 1 request\n");
+		exit (-1);
+	}
+	if(keepalive<1){
+		fprintf(stderr,"KeepAlive must be at least 1 second\n");
+		exit (-1);
+	}
+
+	//Un cliente que cierra antes de tiempo no debe tirar el servidor
+	signal(SIGPIPE, SIG_IGN);
+
+	/*
+	* Se cargan los motores de todos los workers antes de aceptar
+	* conexiones: diccionarios y modelos se leen una unica vez
+	*/
+	fprintf(stderr,"Loading synthesis engines for %d workers\n",nworkers);
+	SynthPool *pool = new SynthPool(data_path, nworkers, queue, AttendRequest, label_cache);
+	if(pool->Create()==-1)
+	{
+		fprintf (stderr,"Unable to create the synthesis workers\n");
+		exit (-1);
+	}
 
 	ServerConnection *servidor = new ServerConnection;
 	/*
@@ -103,168 +221,23 @@ int main (int argc, char* argv[])
 		fprintf (stderr,"Unable to open server socket\n");
 		exit (-1);
 	}
-	printf("Service open\n");
 	/*
-	* Se espera un cliente que quiera conectarse
+	* Todas las conexiones las atiende el EventServer en este thread; las
+	* peticiones recibidas pasan a la cola del pool de workers
 	*/
-	while(1){
-		int pid; //identificador del proceso para el fork
-		if(servidor->AcceptClientConnection()==-1)
-		{
-			fprintf (stderr,"Unable to open client socket\n");
-			exit (-1);
-		}
-		//printf("Conexión aceptada\n");
-		pid=fork();
-		if(pid<0){
-			fprintf(stderr,"FORK error\n");
-			exit(-1);
-		}
-		system("mkdir -p txt");
-		system("mkdir -p wav");
-		if(pid==0){
-			//printf("Proceso hijo\n");
-			//proceso hijo
-				fprintf(stderr,"Attending request\n");
-				time_t tiempo;
-				time(&tiempo);
-				char *fecha=ctime(&tiempo);
-
-				char archivotxt[128]="txt/";
-				char archivowav[128]="wav/";
-				strncat(archivotxt,fecha,24);strcat(archivotxt,".txt");
-				strncat(archivowav,fecha,24);strcat(archivowav,".wav");
-
-				//servidor->ReadLanguage();
-				servidor->ReadOptions();
-				//fprintf(stderr,"Guardando el archivo recibido en: %s",archivotxt);
-				servidor->ReceiveFile(archivotxt,servidor->ObtainCSocket());
-
-				//servidor->Show();
-
-				char *out=NULL;
-				HTTS *tts = new HTTS;
-				char* lang=servidor->ObtainLanguage();
-//				char* data_path=servidor->ObtainDataPath();
-				char tmp_string_dic[1024];
-
-				if(!strcmp("eu",lang)||!strcmp("cat",lang)||!strcmp("gl",lang)||!strcmp("en",lang)){
-					tts->set("Lang", "eu");
-					sprintf(tmp_string_dic, "%s/dicts/eu_dicc", data_path);
-					tts->set("HDicDBName",tmp_string_dic);}
-				else if(!strcmp("es",lang)){
-					tts->set("Lang", "es");
-					sprintf(tmp_string_dic, "%s/dicts/es_dicc", data_path);
-					tts->set("HDicDBName",tmp_string_dic);}
-				tts->set("PthModel", "Pth1");
-				tts->set("Method", "HTS");
-				if (!tts->create()) {
-					delete tts;
-					return 0;
-				}
-				char tmp_string_voice[1024];
-				//char *gender=servidor->ObtainGender();
-				if(!strcmp("eu",lang)){
-					//if(!strcmp(gender,"F"))
-						sprintf(tmp_string_voice, "%s/voices/aholab_eu_female/", data_path);
-					//else
-					//	sprintf(tmp_string_voice, "%s/voices/aholab_eu_male/", data_path);
-				}
-				else if (!strcmp("es",lang)){
-					//if(!strcmp(gender,"F"))
-						sprintf(tmp_string_voice, "%s/voices/aholab_es_female/", data_path);	
-					//else
-					//	sprintf(tmp_string_voice, "%s/voices/aholab_es_male/", data_path);
-				}
-				
-				tts->set("voice_path", tmp_string_voice);
-
-				bool setdur=servidor->ObtainSetDur();
-				char* speed=servidor->ObtainSpeed();
-				if(setdur)
-					tts->set("vp","yes");
-				else if(strcmp(speed,"100")&&speed!=NULL){
-					int f;
-					sscanf(speed,"%d",&f);
-					if(f>=SPEED_MIN && f<=SPEED_MAX){
-						char *tmp_speed = new char [5];
-						sprintf(tmp_speed, "%.2f", f/100.0);
-							tts->set("r",tmp_speed);
-						delete []tmp_speed;
-					}else{fprintf(stderr,"WARNING: parametro -Speed=%d ignorado, valor entero entre %d y %d\n",f,SPEED_MIN,SPEED_MAX);}
-
-				}
-
-
-				//Cambia el nombre de salida del archivo de audio a algo controlable (ej:fecha y hora más número aleatorio)
-			//	tts->set("ow",archivowav);
-
-				//fprintf(stderr,"Sintetizando...");
-				char *str;
-				//abrir fichero wav de salida
-				CAudioFile fout;
-				fout.open(archivowav,"w", "SRate=16000.0 NChan=1 FFormat=Wav");
-				
-					FILE *fp=NULL;
-					fp=fopen(archivotxt,"r");
-					if(fp!=NULL)
-					{
-						int tamanio=0;
-						fseek(fp,0,SEEK_END);
-						tamanio=ftell(fp);
-						rewind(fp);
-						str=new char [tamanio];
-						fread(str,1,tamanio,fp);
-						fclose(fp);
-					}else{
-						fprintf(stderr,"Problem with text file\n");
-						exit(-1);
-					}
-					if(tts->input_multilingual(str, lang, data_path, FALSE)){
-						short *samples;
-						int len=0;
-						while((len = tts->output_multilingual(lang, &samples)) != 0){
-							fout.setBlk(samples, len);
-							free(samples);
-						}
-					}
-				
-				fout.close();
-
-				//tts->trans(str, &out, lang,1);
-				//fprintf(stderr,"... sintetizado\n");
-				//fprintf(stderr,"trans= %s\n", out);
-				//free(out);
-				delete []str;
-				//Hay que liberar el espacio del objeto tts ahora porque si no el tamanio del archivo .wav
-				// se calcula erroneamente
-				delete tts;
-
-				//FILE* fd;
-				//fd=fopen("out.wav","rb");
-				//if(fd!=NULL){
-				servidor->SendFile(archivowav,servidor->ObtainCSocket());
-				//}
-				//fclose(fd);
-				/*El  hijo cierra el descriptor de cliente y servidor*/
-				servidor->CloseClientConnection();
-				servidor->CloseConnection();
-				fprintf(stderr,"Request finished\n");
-				exit(0);
-			}else{
-				//fprintf(stderr,"Proceso padre ");
-				//proceso padre
-				//El proceso padre cierra el descriptor de cliente
-				servidor->CloseClientConnection();
-				signal(SIGCHLD, SIG_IGN);
-				//fprintf(stderr,"Cerrada la conexion\n");
-			}
-
+	EventServer *eventos = new EventServer(servidor->ObtainDescriptor(), pool, keepalive, split_chars);
+	if(eventos->Create()==-1)
+	{
+		fprintf (stderr,"Unable to start the event loop\n");
+		exit (-1);
 	}
+	printf("Service open\n");
+	eventos->Run();
 
+	delete (eventos);
 	servidor->CloseConnection();
 	delete (servidor);
+	delete (pool);
 
 	return 0;
 }
-
@@ -13,6 +13,12 @@
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.7.0	 16/10/26  Jonny      Quitado ReceiveText, sin uso desde el protocolo v2
+1.6.0	 16/10/26  Jonny      Campo msec de las tramas
+1.5.0	 16/10/26  Jonny      PackFrameHeader/UnpackFrameHeader
+1.4.0	 16/10/26  Jonny      Protocolo v2: SendFrame/ReceiveFrame
+1.3.0	 16/10/26  Jonny      Modo streaming: ReceiveAudioStream, SendBuffer con writev
+1.2.0	 16/10/26  Jonny      SendBuffer/ReceiveText, peticiones sin ficheros intermedios
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0, funciones generales
 * 								Send/ReceiveFile
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
@@ -20,9 +26,11 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 
 
 #include "Socket.hpp"
+#include <sys/uio.h>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 /*
@@ -97,6 +105,36 @@ int Lee_Socket (int fd, char *Datos, int Longitud)
 	return Leido;
 }
 
+/*
+* Escribe en el socket los {niov} bloques de {iov} con writev, reintentando
+* las escrituras parciales (modifica {iov}). Devuelve 0 o -1 si hay error.
+*/
+static int Escribe_Vector (int fd, struct iovec *iov, int niov)
+{
+	while(niov>0){
+		ssize_t aux=writev(fd,iov,niov);
+		if(aux<0){
+			if(errno==EINTR) continue;
+			return -1;
+		}
+		//Escritura parcial: se avanza sobre los iovec ya mandados
+		struct iovec *v=iov;
+		int n=niov;
+		while(n>0 && (size_t)aux>=v->iov_len){
+			aux-=v->iov_len;
+			v++;
+			n--;
+		}
+		if(n>0){
+			v->iov_base=(char*)v->iov_base+aux;
+			v->iov_len-=aux;
+		}
+		if(v!=iov) memmove(iov,v,n*sizeof(struct iovec));
+		niov=n;
+	}
+	return 0;
+}
+
 /*
 * Escribe dato en el socket cliente. Devuelve numero de bytes escritos,
 * o -1 si hay error.
@@ -150,34 +188,37 @@ int Escribe_Socket (int fd, char *Datos, int Longitud)
 
 int Connection::SendText(const char* text, int text_len, int fildes)
 {
-	// fprintf(stderr,"Mandando archivo %s por conexion %d",filename,fildes);
-	int longitud=text_len;
-	int result=0,aux=0,tamanio=0;
+	return SendBuffer(text, text_len, fildes);
+}
 
+/*
+ * Manda {buffer_len} bytes de {buffer} precedidos de su tamanio, con el
+ * mismo formato que SendFile pero desde memoria. Tamanio y contenido van
+ * en un unico writev para no partir el bloque en dos segmentos TCP (en
+ * modo streaming cada frase es un bloque). Con {buffer_len}=0 solo se
+ * manda el tamanio, que es la marca de fin del streaming.
+ * Devuelve 0 si todo va bien o -1 si hay error.
+ * */
+int Connection::SendBuffer(const char* buffer, int buffer_len, int fildes)
+{
 	SizeFile file;
-
-	snprintf(file.size,sizeof(SizeFile),"%d", text_len);
-
-	if(write(fildes,&file.size,sizeof(SizeFile))<0){
-		printf("\tError sending the file size\n");
-		return -1;
+	struct iovec iov[2];
+	int niov=1;
+
+	memset(file.size,0,sizeof(SizeFile));
+	snprintf(file.size,sizeof(SizeFile),"%d", buffer_len);
+
+	iov[0].iov_base=file.size;
+	iov[0].iov_len=sizeof(SizeFile);
+	if(buffer_len>0){
+		iov[1].iov_base=(void*)buffer;
+		iov[1].iov_len=buffer_len;
+		niov=2;
 	}
 
-	result=0;
-	while(result<text_len){
-		aux=write(fildes,text+result,text_len-result);
-		
-		if(aux>0){//Se ha conseguido escribir algo
-			result+=aux;
-		}else{
-			if(aux==0){//Se ha acabado de escribir
-			//return result;
-			}else{//Error
-				printf("Error sendint the content\n");
-				return -1;
-			}
-		}
-		//El ultimo tramo puede ser menos de 1024
+	if(Escribe_Vector(fildes,iov,niov)<0){
+		printf("Error sendint the content\n");
+		return -1;
 	}
 
 	return 0;
@@ -325,11 +366,6 @@ int Connection::ReceiveFile(const char * filename, int fildes)
 	return 0;
 }
 
-
-
-
-
-
 int Connection::ReceiveAudio(char **output_file, int *output_file_len, int fildes)
 {
 	//fprintf(stderr,"Recibiendo archivo\n");
@@ -417,5 +453,160 @@ int Connection::ReceiveAudio(char **output_file, int *output_file_len, int filde
 }
 
 
+/*
+ * Recibe la respuesta del servidor en modo streaming (OPTIONS_MODE_STREAM):
+ * una secuencia de bloques SizeFile + PCM terminada con un bloque de
+ * tamanio 0. Cada bloque se pasa a {callback} en cuanto se ha leido
+ * entero, sin esperar al resto del audio.
+ * Devuelve el numero total de bytes de audio recibidos o -1 si hay error
+ * o si {callback} pide abortar.
+ * */
+int Connection::ReceiveAudioStream(AudioBlockFunc callback, void *user, int fildes)
+{
+	SizeFile file;
+	int total=0;
+	int capacity=0;
+	char *buff=NULL;
+
+	while(1){
+		int tamanio=0;
+		if(Lee_Socket(fildes,file.size,sizeof(SizeFile))!=sizeof(SizeFile)){
+			printf("Error receiving the block size\n");
+			break;
+		}
+		file.size[sizeof(SizeFile)-1]='\0';
+		if(sscanf(file.size,"%d",&tamanio)!=1 || tamanio<0){
+			printf("Error receiving the block size\n");
+			break;
+		}
+		if(tamanio==0){ //marca de fin
+			free(buff);
+			return total;
+		}
+		if(tamanio>capacity){
+			char *aux=(char*)realloc(buff,tamanio);
+			if(aux==NULL) break;
+			buff=aux;
+			capacity=tamanio;
+		}
+		if(Lee_Socket(fildes,buff,tamanio)!=tamanio){
+			printf("Error receiving an audio block\n");
+			break;
+		}
+		total+=tamanio;
+		if(callback(buff,tamanio,user)==-1)
+			break;
+	}
+	free(buff);
+	return -1;
+}
+
+
+static const char *frame_langs[]={"eu","es","cat","gl","en",NULL};
+
+int FrameLangCode(const char *lang)
+{
+	int i;
+	for(i=0;frame_langs[i]!=NULL;i++)
+		if(!strcmp(lang,frame_langs[i]))
+			return i;
+	return -1;
+}
+
+const char* FrameLangName(int code)
+{
+	if(code<0 || code>FRAME_LANG_EN)
+		return NULL;
+	return frame_langs[code];
+}
+
+void PackFrameHeader(const FrameHeader *header, unsigned char *buf)
+{
+	unsigned int aux32;
+	unsigned short aux16;
+
+	memcpy(buf,FRAME_MAGIC,4);
+	buf[4]=FRAME_VERSION;
+	buf[5]=header->type;
+	buf[6]=header->lang;
+	buf[7]=header->flags;
+	aux32=htonl(header->id); memcpy(buf+8,&aux32,4);
+	aux16=htons(header->speed); memcpy(buf+12,&aux16,2);
+	aux16=htons(header->msec); memcpy(buf+14,&aux16,2);
+	aux32=htonl(header->length); memcpy(buf+16,&aux32,4);
+}
+
+int UnpackFrameHeader(const unsigned char *buf, FrameHeader *header)
+{
+	unsigned int aux32;
+	unsigned short aux16;
+
+	if(memcmp(buf,FRAME_MAGIC,4) || buf[4]!=FRAME_VERSION)
+		return -1;
+	header->type=buf[5];
+	header->lang=buf[6];
+	header->flags=buf[7];
+	memcpy(&aux32,buf+8,4); header->id=ntohl(aux32);
+	memcpy(&aux16,buf+12,2); header->speed=ntohs(aux16);
+	memcpy(&aux16,buf+14,2); header->msec=ntohs(aux16);
+	memcpy(&aux32,buf+16,4); header->length=ntohl(aux32);
+	if(header->length>FRAME_MAX_PAYLOAD)
+		return -1;
+	return 0;
+}
+
+/*
+ * Manda una trama del protocolo v2: cabecera {header} y, si
+ * header->length>0, los header->length bytes de {payload}. Cabecera y
+ * carga van en un unico writev.
+ * Devuelve 0 si todo va bien o -1 si hay error.
+ * */
+int Connection::SendFrame(const FrameHeader *header, const char *payload, int fildes)
+{
+	unsigned char hdr[FRAME_HEADER_SIZE];
+	struct iovec iov[2];
+	int niov=1;
+
+	PackFrameHeader(header,hdr);
+
+	iov[0].iov_base=hdr;
+	iov[0].iov_len=FRAME_HEADER_SIZE;
+	if(header->length>0){
+		iov[1].iov_base=(void*)payload;
+		iov[1].iov_len=header->length;
+		niov=2;
+	}
+	return Escribe_Vector(fildes,iov,niov);
+}
+
+/*
+ * Lee una trama del protocolo v2. La carga se deja en {*payload}, un
+ * buffer de {*capacity} bytes reservado con malloc que se agranda si hace
+ * falta y que se puede reutilizar entre llamadas (lo libera el llamante).
+ * Si hay carga se termina con '\0' (sin contarlo en header->length).
+ * Devuelve 0 si todo va bien, 1 si el otro extremo ha cerrado la conexion
+ * entre dos tramas, o -1 si hay error o la trama no es valida.
+ * */
+int Connection::ReceiveFrame(FrameHeader *header, char **payload, int *capacity, int fildes)
+{
+	unsigned char hdr[FRAME_HEADER_SIZE];
+	int leido;
 
+	leido=Lee_Socket(fildes,(char*)hdr,FRAME_HEADER_SIZE);
+	if(leido==0)
+		return 1;
+	if(leido!=FRAME_HEADER_SIZE || UnpackFrameHeader(hdr,header)<0)
+		return -1;
 
+	if((int)header->length+1>*capacity){
+		char *aux=(char*)realloc(*payload,header->length+1);
+		if(aux==NULL)
+			return -1;
+		*payload=aux;
+		*capacity=header->length+1;
+	}
+	if(header->length>0 && Lee_Socket(fildes,*payload,header->length)!=(int)header->length)
+		return -1;
+	(*payload)[header->length]='\0';
+	return 0;
+}
@@ -57,6 +57,13 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.8.0	 16/10/26  Jonny      Quitado ReceiveText, sin uso desde el protocolo v2
+1.7.0	 16/10/26  Jonny      Trama FRAME_CANCEL y cancelacion al cerrar la conexion v2
+1.6.0	 16/10/26  Jonny      Campo msec de las tramas: plazo de la peticion / espera en cola
+1.5.0	 16/10/26  Jonny      PackFrameHeader/UnpackFrameHeader para el servidor con epoll
+1.4.0	 16/10/26  Jonny      Protocolo v2: tramas binarias con id, conexion persistente
+1.3.0	 16/10/26  Jonny      Modo streaming: audio frase a frase con marca de fin
+1.2.0	 16/10/26  Jonny      SendBuffer/ReceiveText, peticiones sin ficheros intermedios
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0, funciones generales
 * 								Send/ReceiveFile
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
@@ -81,16 +88,78 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 #define	SPEED_MAX 300 //Valores máximos y mínimos para cambiar la velocidad de lectura
 #define	SPEED_MIN 25
 
-//Estas dos funciones sobran, las dejo por ahora para referencia
+//Leen/escriben exactamente {Longitud} bytes, reintentando las operaciones parciales
 int Lee_Socket (int fd, char *Datos, int Longitud);
 int Escribe_Socket (int fd, char *Datos, int Longitud);
 
+/*
+* Callback de ReceiveAudioStream: recibe cada bloque de audio (PCM de 16
+* bits, mono, 16kHz) en cuanto llega. {user} es el puntero que se paso a
+* ReceiveAudioStream. Debe devolver 0 para seguir o -1 para abortar.
+*/
+typedef int (*AudioBlockFunc)(const char *block, int block_len, void *user);
+
+/*
+* Protocolo v2. Cada mensaje es una trama con una cabecera binaria fija
+* de FRAME_HEADER_SIZE bytes (enteros en orden de red) seguida de
+* {length} bytes de carga:
+*   magic[4]="AHT2" version(1) type(1) lang(1) flags(1)
+*   id(4) speed(2) msec(2) length(4)
+* El cliente manda tramas FRAME_REQUEST (carga = texto) por una conexion
+* persistente, sin esperar respuesta entre una y otra. El servidor las
+* atiende en orden y responde a cada una con tramas FRAME_AUDIO (un wav,
+* o una por frase con FRAME_FLAG_STREAM) y una FRAME_END vacia, o con
+* una FRAME_ERROR (carga = mensaje), todas con el {id} de la peticion.
+* {msec} son milisegundos: en FRAME_REQUEST el plazo para terminar la
+* peticion desde que llega (0 sin plazo) y en FRAME_END lo que ha
+* esperado en la cola del servidor (saturado a 65535).
+* Una trama FRAME_CANCEL vacia cancela la peticion {id} (o todas las de
+* la conexion con FRAME_FLAG_ALL): si se esta sintetizando se corta al
+* momento y libera su worker, y tanto esta como las que aun esperan se
+* responden en su turno con FRAME_ERROR "cancelled". Cerrar la conexion
+* (aunque sea solo en escritura) cancela todas sus peticiones.
+* Si los primeros bytes de una conexion no son el magic, el servidor
+* sigue usando el protocolo antiguo (Options + SizeFile).
+*/
+#define FRAME_MAGIC "AHT2"
+#define FRAME_VERSION 2
+#define FRAME_HEADER_SIZE 20
+#define FRAME_MAX_PAYLOAD (64*1024*1024)
+
+enum { FRAME_REQUEST=1, FRAME_AUDIO=2, FRAME_END=3, FRAME_ERROR=4, FRAME_CANCEL=5 };
+enum { FRAME_FLAG_STREAM=1, FRAME_FLAG_SETDUR=2, FRAME_FLAG_ALL=4 };
+enum { FRAME_LANG_EU=0, FRAME_LANG_ES=1, FRAME_LANG_CAT=2, FRAME_LANG_GL=3, FRAME_LANG_EN=4 };
+
+typedef struct{
+	unsigned char type;
+	unsigned char lang;
+	unsigned char flags;
+	unsigned int id;
+	unsigned short speed;
+	unsigned short msec;
+	unsigned int length;
+} FrameHeader;
+
+/* Cabecera de trama en/desde {buf} (FRAME_HEADER_SIZE bytes). Unpack
+ * devuelve -1 si el magic, la version o la longitud no son validos */
+void PackFrameHeader(const FrameHeader *header, unsigned char *buf);
+int UnpackFrameHeader(const unsigned char *buf, FrameHeader *header);
+
+//Conversion entre el codigo de idioma de las tramas y su nombre ("eu", "es"...)
+int FrameLangCode(const char *lang);
+const char* FrameLangName(int code);
+
 class Connection{
 public:
 	int SendFile (const char* filename, int fildes);
 	int SendText (const char* text, int text_len, int fildes);
+	int SendBuffer (const char* buffer, int buffer_len, int fildes);
 	int ReceiveFile(const char * filename, int fildes);
 	int ReceiveAudio(char **output_file, int *output_file_len, int fildes);
+	int ReceiveAudioStream(AudioBlockFunc callback, void *user, int fildes);
+	//protocolo v2
+	int SendFrame(const FrameHeader *header, const char *payload, int fildes);
+	int ReceiveFrame(FrameHeader *header, char **payload, int *capacity, int fildes);
 };
 /*
 typedef struct {
@@ -113,9 +182,18 @@ typedef struct{
 	char language [4];
 	char gender [4];
 	char speed [4];
-	char data_path[1024];
+	char data_path[1020];
+	char mode [4]; //OPTIONS_MODE_WAV o OPTIONS_MODE_STREAM, antes parte de data_path
 	bool setdur;
 } Options;
 
+/* Modos de respuesta del servidor. Con OPTIONS_MODE_WAV se manda un
+ * unico wav al terminar. Con OPTIONS_MODE_STREAM se manda cada frase en
+ * cuanto se sintetiza como un bloque PCM (SizeFile + muestras) y al final
+ * un bloque de tamanio 0 como marca de fin. Cualquier otro valor (los
+ * clientes antiguos no inicializan este campo) se trata como WAV */
+#define OPTIONS_MODE_WAV "WAV"
+#define OPTIONS_MODE_STREAM "STR"
+
 
 #endif
@@ -57,10 +57,15 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.5.0	 16/10/26  Jonny      ReceiveReply distingue los errores del servidor (REPLY_SERVER_ERROR)
+1.4.0	 16/10/26  Jonny      Plazo por peticion y espera en cola del servidor
+1.3.0	 16/10/26  Jonny      Protocolo v2: SendRequest/ReceiveReply
+1.2.0	 16/10/26  Jonny      SetStreaming, respuesta frase a frase
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
 #include "Socket_Cliente.hpp"
+#include <string.h>
 
 /*
 / Conecta con un servidor remoto a traves de socket INET
@@ -251,8 +256,82 @@ void ClientConnection::CloseConnection()
 	close(socket_server);
 }
 
+void ClientConnection::SetStreaming(bool stream)
+{
+	strcpy(opciones.mode,stream?OPTIONS_MODE_STREAM:OPTIONS_MODE_WAV);
+}
+
+int ClientConnection::SendRequest(unsigned int id, const char *text, int len)
+{
+	FrameHeader header;
+	int lang, speed=100;
+
+	lang=FrameLangCode(opciones.language);
+	if(lang<0){
+		fprintf(stderr,"Error: language %s not supported by protocol v2\n",opciones.language);
+		return -1;
+	}
+	sscanf(opciones.speed,"%d",&speed);
+
+	memset(&header,0,sizeof(FrameHeader));
+	header.type=FRAME_REQUEST;
+	header.lang=lang;
+	if(!strncmp(opciones.mode,OPTIONS_MODE_STREAM,sizeof(opciones.mode)))
+		header.flags|=FRAME_FLAG_STREAM;
+	if(opciones.setdur)
+		header.flags|=FRAME_FLAG_SETDUR;
+	header.id=id;
+	header.speed=speed;
+	header.msec=deadline;
+	header.length=len;
+	if(SendFrame(&header,text,socket_server)<0){
+		printf("Error al mandar la peticion\n");
+		return -1;
+	}
+	return 0;
+}
+
+int ClientConnection::ReceiveReply(unsigned int id, AudioBlockFunc callback, void *user)
+{
+	FrameHeader header;
+	char *payload=NULL;
+	int capacity=0, total=0;
+
+	while(true){
+		if(ReceiveFrame(&header,&payload,&capacity,socket_server)!=0){
+			printf("Error al recibir la respuesta\n");
+			break;
+		}
+		if(header.id!=id){
+			fprintf(stderr,"Error: reply for request %u while waiting for %u\n",header.id,id);
+			break;
+		}
+		if(header.type==FRAME_END){
+			queue_wait=header.msec;
+			free(payload);
+			return total;
+		}
+		if(header.type==FRAME_ERROR){
+			fprintf(stderr,"Server error: %s\n",payload);
+			free(payload);
+			return REPLY_SERVER_ERROR;
+		}
+		if(header.type!=FRAME_AUDIO)
+			break;
+		if(header.length>0 && callback(payload,header.length,user)<0)
+			break;
+		total+=header.length;
+	}
+	free(payload);
+	return -1;
+}
+
 ClientConnection::ClientConnection()
 {
+	memset(&opciones,0,sizeof(Options));
+	strcpy(opciones.mode,OPTIONS_MODE_WAV);
+	deadline=0;
+	queue_wait=0;
 	strcpy(opciones.language,"eu");
 	strcpy(opciones.speed,"100");
 	strcpy(opciones.gender,"F");
@@ -261,6 +340,10 @@ ClientConnection::ClientConnection()
 
 ClientConnection::ClientConnection(const Options op)
 {
+	memset(&opciones,0,sizeof(Options));
+	strcpy(opciones.mode,OPTIONS_MODE_WAV);
+	deadline=0;
+	queue_wait=0;
 	strcpy(opciones.language,op.language);
 	strcpy(opciones.gender,op.gender);
 //	strcpy(opciones.data_path,op.data_path);
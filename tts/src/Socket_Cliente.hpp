@@ -57,6 +57,10 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.5.0	 16/10/26  Jonny      ReceiveReply distingue los errores del servidor (REPLY_SERVER_ERROR)
+1.4.0	 16/10/26  Jonny      Plazo por peticion y espera en cola del servidor
+1.3.0	 16/10/26  Jonny      Protocolo v2: SendRequest/ReceiveReply
+1.2.0	 16/10/26  Jonny      SetStreaming, respuesta frase a frase
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
@@ -79,6 +83,9 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 
 #include "Socket.hpp"
 
+/* ReceiveReply: el servidor ha contestado con FRAME_ERROR; la conexion
+ * sigue lista para otra peticion */
+#define REPLY_SERVER_ERROR -2
 
 
 class ClientConnection : public Connection{
@@ -90,12 +97,31 @@ class ClientConnection : public Connection{
 		//int SendLanguage(const char *lan);
 		int SendOptions();
 		void WriteOptions(const Options op);
+		/* Pide al servidor el audio frase a frase (ReceiveAudioStream)
+		 * en lugar de un unico wav */
+		void SetStreaming(bool stream);
+		/* Protocolo v2: manda el texto como trama FRAME_REQUEST con las
+		 * opciones actuales y el identificador {id}. Se pueden mandar
+		 * varias peticiones seguidas por la misma conexion y leer despues
+		 * las respuestas, que llegan en el mismo orden */
+		int SendRequest(unsigned int id, const char *text, int len);
+		/* Lee la respuesta v2 a la peticion {id} pasando cada bloque de
+		 * audio a {callback}. Devuelve los bytes recibidos,
+		 * REPLY_SERVER_ERROR si el servidor contesta con un error o -1 si
+		 * falla la conexion o {callback} */
+		int ReceiveReply(unsigned int id, AudioBlockFunc callback, void *user);
+		/* Plazo en ms para las siguientes peticiones v2 (0 sin plazo) */
+		void SetDeadline(int msec){deadline=msec<0?0:(msec>65535?65535:msec);}
+		/* Espera en la cola del servidor de la ultima respuesta v2, en ms */
+		int ObtainQueueWait(void){return queue_wait;}
 		//int ReadFile(FILE* fd);
 		void CloseConnection();
 		int ObtainSSocket(void){return socket_server;}
 	private:	
 		int socket_server;
 		Options opciones;
+		int deadline;
+		int queue_wait;
 
 
 };
@@ -57,13 +57,34 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.4.0	 16/10/26  Jonny      Cola de listen SOMAXCONN
+1.3.0	 16/10/26  Jonny      Modo de respuesta streaming, constructor para el pool de workers
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
 
 #include <Socket_Servidor.hpp>
 
-#define MAXQUEUE 5 /*Tamanio maximo de la cola*/
+#define MAXQUEUE SOMAXCONN /*Tamanio maximo de la cola*/
+
+ServerConnection::ServerConnection()
+{
+	memset(&opciones,0,sizeof(Options));
+	descriptor=-1;
+	socket_client=-1;
+}
+
+/*
+* Conexion sobre un socket de cliente ya aceptado por otro
+* ServerConnection. La usan los workers del pool para atender la
+* peticion sin tocar el socket servidor.
+*/
+ServerConnection::ServerConnection(const int csocket)
+{
+	memset(&opciones,0,sizeof(Options));
+	descriptor=-1;
+	socket_client=csocket;
+}
 
 /*
 * Se le pasa un socket de servidor y acepta en el una conexion de cliente.
@@ -205,6 +226,7 @@ int ServerConnection::ReadOptions()
 	strcpy(opciones.language,opaux.language);
 	strcpy(opciones.gender,opaux.gender);
 	strcpy(opciones.speed,opaux.speed);
+	memcpy(opciones.mode,opaux.mode,sizeof(opciones.mode));
 	opciones.setdur=opaux.setdur;
 	//fprintf(stderr,"Idioma recibido %s, velocidad de lectura: %s\n",opciones.language,opciones.speed);
 	return aux;
@@ -57,6 +57,8 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.4.0	 16/10/26  Jonny      ObtainDescriptor para el bucle de eventos
+1.3.0	 16/10/26  Jonny      Modo de respuesta streaming, constructor para el pool de workers
 1.1.0	 03/05/12  Agustin    Implementación del tts64 version 1.2.0
 1.0.0  	 20/01/12  Agustin	  Codificación inicial
 */
@@ -76,11 +78,14 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 #include <errno.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "Socket.hpp"
 
 class ServerConnection : public Connection{
 	public:
+		ServerConnection();
+		ServerConnection(const int csocket);
 		//~ServerConnection();
 		int OpenInetConnection(const char *IPServidor, const int PuertoServicio);
 		int AcceptClientConnection();
@@ -93,11 +98,13 @@ class ServerConnection : public Connection{
 		//void Show();
 		//char* utt;
 		int ObtainCSocket(void){return socket_client;}
+		int ObtainDescriptor(void){return descriptor;}
 		//char* ObtainLanguage(void){return language;}
 		char* ObtainLanguage(void){return opciones.language;}
 		char* ObtainSpeed(void){return opciones.speed;}
 		char* ObtainGender(void){return opciones.gender;}
 		bool ObtainSetDur(void){return opciones.setdur;}
+		bool ObtainStreaming(void){return !strncmp(opciones.mode,OPTIONS_MODE_STREAM,sizeof(opciones.mode));}
 	private:
 		Options opciones;
 		//char* language;
@@ -0,0 +1,376 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      Sintesis con los motores del propio proceso (LocalPool)
+1.0.1	 16/10/26  Jonny      Cancel() cancela tambien la sintesis en tts_server
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: frases y audio segun llega el texto del chat
+*/
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "Speech_Pipeline.hpp"
+
+static long long ClockMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000+ts.tv_nsec/1000000;
+}
+
+SentenceStream::SentenceStream(int max_chars, int first_clause)
+{
+	this->max_chars=max_chars;
+	this->first_clause=first_clause;
+	emitted=0;
+	Reset();
+}
+
+void SentenceStream::Reset(void)
+{
+	scan=0;
+	word=false;
+	eou=false;
+	pause=false;
+	space=false;
+	clause=0;
+	blank=0;
+}
+
+void SentenceStream::Append(const char *text, int len)
+{
+	pending.append(text,len);
+}
+
+/* Letras y cifras; los bytes de UTF-8 cuentan como letras */
+static bool IsText(unsigned char c)
+{
+	return isalnum(c) || c>=0x80;
+}
+
+/* Saca los {end} primeros bytes, si tienen algo que leer, y vuelve a
+ * examinar lo que queda */
+bool SentenceStream::Cut(int end, std::string &sentence)
+{
+	bool text=false;
+
+	for(int i=0;i<end && !text;i++)
+		text=IsText(pending[i]);
+	if(text){
+		sentence=pending.substr(0,end);
+		emitted++;
+	}
+	pending.erase(0,end);
+	Reset();
+	return text;
+}
+
+bool SentenceStream::Next(std::string &sentence)
+{
+	while(scan<(int)pending.size()){
+		unsigned char c=pending[scan];
+
+		if(c==0xC2){	//"¿" y "¡" en UTF-8
+			if(scan+1==(int)pending.size())
+				return false;	//falta el segundo byte
+			unsigned char c2=pending[scan+1];
+			if(c2==0xBF || c2==0xA1){
+				//abren frase: la anterior acaba antes del signo
+				if(space && word){
+					if(Cut(scan,sentence))
+						return true;
+					continue;
+				}
+				space=false;
+				scan+=2;
+				continue;
+			}
+		}
+		scan++;
+		if(isspace(c)){
+			blank=scan;
+			if(pause)
+				clause=scan;
+			if(eou && word){	//fin de frase, con su espacio
+				if(Cut(scan,sentence))
+					return true;
+				continue;
+			}
+			space=true;
+		}
+		else{
+			space=false;
+			if(strchr(".:;!?",c))
+				eou=true;
+			else if(strchr(",()-",c))
+				pause=word;
+			else if(IsText(c)){
+				word=true;
+				eou=false;
+				pause=false;
+			}
+		}
+		//primera frase: basta con una pausa
+		if(emitted==0 && first_clause>0 && clause>=first_clause){
+			if(Cut(clause,sentence))
+				return true;
+			continue;
+		}
+		//frase demasiado larga: se corta en la ultima pausa o espacio
+		if(max_chars>0 && scan>max_chars && (clause || blank)){
+			if(Cut(clause?clause:blank,sentence))
+				return true;
+			continue;
+		}
+	}
+	return false;
+}
+
+bool SentenceStream::Flush(std::string &sentence)
+{
+	if(Next(sentence))
+		return true;
+	return Cut(pending.size(),sentence);
+}
+
+void SpeechPipeline::Init(void)
+{
+	pool=NULL;
+	cliente=NULL;
+	local=NULL;
+	engine=NULL;
+	sent=0;
+	received=0;
+	finished=false;
+	complete=false;
+	broken=false;
+	cancelled=false;
+	start=ClockMs();
+	first_audio=-1;
+	callback=NULL;
+	user=NULL;
+	pthread_mutex_init(&lock,NULL);
+	pthread_cond_init(&changed,NULL);
+}
+
+SpeechPipeline::SpeechPipeline(ConnectionPool *pool, int max_chars, int first_clause)
+	: splitter(max_chars,first_clause)
+{
+	Init();
+	this->pool=pool;
+	cliente=pool->Checkout();
+	if(cliente==NULL)
+		broken=true;
+	else
+		cliente->SetStreaming(true);
+}
+
+SpeechPipeline::SpeechPipeline(LocalPool *local, int max_chars, int first_clause)
+	: splitter(max_chars,first_clause)
+{
+	Init();
+	this->local=local;
+	engine=local->Checkout();
+}
+
+/* Productor y consumidor deben haber terminado. La conexion solo vuelve
+ * al pool para reutilizarla si se han leido todas las respuestas */
+SpeechPipeline::~SpeechPipeline()
+{
+	if(cliente!=NULL)
+		pool->Return(cliente,!broken && !cancelled && received==sent);
+	if(engine!=NULL)
+		local->Return(engine);
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&changed);
+}
+
+/* Manda la frase siguiente como peticion v2; su id es su numero de orden.
+ * Con motores del proceso solo se encola para el consumidor */
+int SpeechPipeline::Send(const std::string &sentence)
+{
+	int ret=0;
+
+	if(local==NULL)
+		ret=cliente->SendRequest(sent,sentence.data(),sentence.size());
+	pthread_mutex_lock(&lock);
+	if(local!=NULL)
+		queue.push_back(sentence);
+	if(ret==-1)
+		broken=true;
+	else
+		sent++;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+	return ret;
+}
+
+int SpeechPipeline::Feed(const char *text, int len)
+{
+	std::string sentence;
+
+	pthread_mutex_lock(&lock);
+	if(broken || cancelled){
+		pthread_mutex_unlock(&lock);
+		return -1;
+	}
+	this->text.append(text,len);
+	pthread_mutex_unlock(&lock);
+	splitter.Append(text,len);
+	while(splitter.Next(sentence))
+		if(Send(sentence)==-1)
+			return -1;
+	return 0;
+}
+
+void SpeechPipeline::Finish(bool ok)
+{
+	std::string sentence;
+
+	pthread_mutex_lock(&lock);
+	ok=ok && !broken && !cancelled;
+	pthread_mutex_unlock(&lock);
+	if(ok)
+		while(splitter.Flush(sentence))
+			if(Send(sentence)==-1)
+				break;
+	pthread_mutex_lock(&lock);
+	finished=true;
+	complete=ok && !broken;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+}
+
+int SpeechPipeline::CountBlock(const char *block, int len, void *user)
+{
+	SpeechPipeline *pipeline=(SpeechPipeline*)user;
+
+	if(pipeline->first_audio<0)
+		pipeline->first_audio=ClockMs()-pipeline->start;
+	return pipeline->callback(block,len,pipeline->user);
+}
+
+/*
+* Las respuestas de la conexion solo las lee este thread, asi que se leen
+* sin el cerrojo mientras el productor sigue mandando frases. Con motores
+* del proceso es este thread el que sintetiza cada frase encolada.
+*/
+int SpeechPipeline::Receive(AudioBlockFunc callback, void *user)
+{
+	int total=0;
+
+	this->callback=callback;
+	this->user=user;
+	pthread_mutex_lock(&lock);
+	while(true){
+		while(received==sent && !finished && !broken && !cancelled)
+			pthread_cond_wait(&changed,&lock);
+		if(broken || cancelled || received==sent)
+			break;
+		unsigned int id=received;
+		std::string sentence;
+		if(local!=NULL){
+			sentence.swap(queue.front());
+			queue.pop_front();
+		}
+		pthread_mutex_unlock(&lock);
+		int ret;
+		if(local!=NULL)
+			ret=local->Synthesize(engine,sentence.data(),sentence.size(),true,CountBlock,this);
+		else
+			ret=cliente->ReceiveReply(id,CountBlock,this);
+		if(ret<0){
+			Cancel();
+			pthread_mutex_lock(&lock);
+			broken=true;
+			break;
+		}
+		total+=ret;
+		pthread_mutex_lock(&lock);
+		received++;
+	}
+	bool ok=complete && received==sent;
+	pthread_mutex_unlock(&lock);
+	return ok?total:-1;
+}
+
+/* Cierra la conexion para desbloquear al productor si estaba mandando.
+ * Al ver el cierre tts_server cancela las frases que quedan, tambien la
+ * que este sintetizando. Con motores del proceso se corta la sintesis */
+void SpeechPipeline::Cancel(void)
+{
+	pthread_mutex_lock(&lock);
+	cancelled=true;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+	if(cliente!=NULL)
+		shutdown(cliente->ObtainSSocket(),SHUT_RDWR);
+	if(engine!=NULL)
+		local->Cancel(engine);
+}
+
+std::string SpeechPipeline::ObtainText(void)
+{
+	pthread_mutex_lock(&lock);
+	std::string copy=text;
+	pthread_mutex_unlock(&lock);
+	return copy;
+}
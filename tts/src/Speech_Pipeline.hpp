@@ -0,0 +1,171 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      Sintesis con los motores del propio proceso (LocalPool)
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: frases y audio segun llega el texto del chat
+*/
+
+#ifndef _SPEECH_PIPELINE_H
+#define _SPEECH_PIPELINE_H
+
+#include <pthread.h>
+
+#include <deque>
+#include <string>
+
+#include "Connection_Pool.hpp"
+#include "Local_Pool.hpp"
+
+/*
+* Corta en frases un texto que llega a trozos (los tokens de un chat en
+* streaming) sin esperar al final. Usa los signos de T2ULst::selectpunc:
+* una frase termina con ".:;!?" seguido de un espacio, o antes de un
+* "¿"/"¡" que abre una nueva tras un espacio. Un numero como "3.5" no se
+* corta porque tras el punto no hay espacio. El texto es UTF-8.
+* Si la frase pasa de {max_chars} se corta en la ultima pausa (",()-")
+* o en el ultimo espacio. Con {first_clause}>0 la primera frase se puede
+* cortar ya en una pausa en cuanto tenga esos caracteres, para empezar
+* antes a sintetizar.
+*/
+class SentenceStream{
+	public:
+		SentenceStream(int max_chars, int first_clause);
+		/* Anyade texto recibido */
+		void Append(const char *text, int len);
+		/* Saca en {sentence} la siguiente frase completa; false si aun
+		 * no hay ninguna */
+		bool Next(std::string &sentence);
+		/* Fin del texto: saca lo que quede pendiente como ultima frase;
+		 * false si no queda nada que leer */
+		bool Flush(std::string &sentence);
+	private:
+		void Reset(void);
+		bool Cut(int end, std::string &sentence);
+
+		std::string pending;
+		int scan;	//siguiente byte de {pending} por examinar
+		bool word;	//hay alguna letra o cifra antes de {scan}
+		bool eou;	//fin de frase tras la ultima palabra
+		bool pause;	//pausa tras la ultima palabra
+		bool space;	//el ultimo byte examinado es un espacio
+		int clause;	//fin de la ultima pausa (con su espacio), o 0
+		int blank;	//fin del ultimo espacio, o 0
+		int max_chars;
+		int first_clause;
+		int emitted;	//frases sacadas
+};
+
+/*
+* Sintesis en paralelo con la generacion del texto. Un productor va
+* pasando el texto con Feed() y cada frase completa se manda al momento
+* a tts_server por una conexion v2 del pool, sin esperar respuesta. Un
+* consumidor, en otro thread, lee con Receive() el audio de las frases en
+* orden. Si el consumidor falla (el cliente HTTP se ha ido) Feed()
+* devuelve -1 para que el productor deje de generar.
+* Con un LocalPool las frases se encolan y el consumidor las sintetiza
+* una tras otra con un motor del proceso, que toma al crearse.
+*/
+class SpeechPipeline{
+	public:
+		SpeechPipeline(ConnectionPool *pool, int max_chars, int first_clause);
+		SpeechPipeline(LocalPool *local, int max_chars, int first_clause);
+		~SpeechPipeline();
+		/* Productor: texto nuevo. Devuelve -1 si hay que abandonar */
+		int Feed(const char *text, int len);
+		/* Productor: fin del texto ({ok}=false si la generacion fallo) */
+		void Finish(bool ok);
+		/* Consumidor: pasa a {callback} el audio de cada frase (PCM) segun
+		 * se sintetiza, hasta el fin del texto. Devuelve los bytes
+		 * recibidos o -1 */
+		int Receive(AudioBlockFunc callback, void *user);
+		/* Consumidor: abandona (no se seguira leyendo) */
+		void Cancel(void);
+		/* Texto completo recibido hasta ahora */
+		std::string ObtainText(void);
+		/* Frases mandadas y ms desde la creacion hasta el primer audio
+		 * (-1 si no ha llegado) */
+		int ObtainSentences(void){return sent;}
+		long ObtainFirstAudio(void){return first_audio;}
+	private:
+		void Init(void);
+		int Send(const std::string &sentence);
+		static int CountBlock(const char *block, int len, void *user);
+
+		ConnectionPool *pool;
+		ClientConnection *cliente;
+		LocalPool *local;
+		SynthEngine *engine;
+		std::deque<std::string> queue;	//frases mandadas a {local} y aun sin sintetizar
+		SentenceStream splitter;
+		std::string text;
+		int sent;	//frases mandadas
+		int received;	//frases con el audio ya leido
+		bool finished;	//el productor ha terminado
+		bool complete;	//y ha terminado sin errores
+		bool broken;	//error en la conexion
+		bool cancelled;	//el consumidor ha abandonado
+		long long start;
+		long first_audio;
+		AudioBlockFunc callback;
+		void *user;
+		pthread_mutex_t lock;
+		pthread_cond_t changed;
+};
+
+#endif
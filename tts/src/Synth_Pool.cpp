@@ -0,0 +1,421 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.5.0	 16/10/26  Jonny      SynthEngine::Synthesize, comun a tts_server y a los motores de my_server
+1.4.0	 16/10/26  Jonny      Cache de indices de pdf por etiqueta en la voz (label_cache)
+1.3.0	 16/10/26  Jonny      Los workers comparten los modelos a traves de HTTS_DB
+1.2.0	 16/10/26  Jonny      Planificador: menor coste primero con envejecimiento y plazos
+1.1.0	 16/10/26  Jonny      Cola acotada de peticiones en lugar de conexiones
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: pool de workers con motores precargados
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Synth_Pool.hpp"
+#include "Socket.hpp"
+
+/* Frases con las que se calienta cada motor al crearlo */
+#define WARMUP_EU "Kaixo."
+#define WARMUP_ES "Hola."
+
+SynthEngine::SynthEngine(const char *data_path, int label_cache)
+{
+	this->data_path=data_path;
+	this->label_cache=label_cache;
+	tts_eu=NULL;
+	tts_es=NULL;
+	served=0;
+}
+
+SynthEngine::~SynthEngine()
+{
+	if(tts_eu) delete tts_eu;
+	if(tts_es) delete tts_es;
+}
+
+/*
+* Crea y configura un HTTS para {lang} ("eu" o "es") y lo calienta
+* sintetizando una frase corta, que es cuando HTS_U2W carga los modelos.
+* Si {shared} no es NULL se crea con su HTTS_DB y los modelos no se
+* vuelven a cargar. Devuelve NULL si hay problemas.
+*/
+HTTS* SynthEngine::CreateLanguage(const char *lang, HTTS *shared)
+{
+	char tmp_string[1024];
+	HTTS *tts = new HTTS;
+	BOOL ok;
+
+	tts->set("Lang", lang);
+	sprintf(tmp_string, "%s/dicts/%s_dicc", data_path, lang);
+	tts->set("HDicDBName",tmp_string);
+	tts->set("PthModel", "Pth1");
+	tts->set("Method", "HTS");
+	if(shared)
+		ok=tts->create(shared->getDB());
+	else
+		ok=tts->create();
+	if (!ok) {
+		delete tts;
+		return NULL;
+	}
+	sprintf(tmp_string, "%s/voices/aholab_%s_female/", data_path, lang);
+	tts->set("voice_path", tmp_string);
+	if(!shared && label_cache>0)
+		tts->set("label_cache", label_cache);
+
+	if(tts->input_multilingual(strcmp(lang,"es")?WARMUP_EU:WARMUP_ES, lang, data_path, FALSE)){
+		short *samples;
+		while(tts->output_multilingual(lang, &samples) != 0)
+			free(samples);
+	}
+	return tts;
+}
+
+const char* SynthEngine::ObtainLabelCacheStats(const char *lang)
+{
+	HTTS *tts=ObtainEngine(lang);
+	if(tts==NULL)
+		return NULL;
+	return tts->get("label_cache_stats");
+}
+
+/* Devuelve 0 si se han creado los dos motores, -1 si no */
+int SynthEngine::Create(SynthEngine *shared)
+{
+	tts_eu=CreateLanguage("eu", shared?shared->tts_eu:NULL);
+	tts_es=CreateLanguage("es", shared?shared->tts_es:NULL);
+	if(!tts_eu || !tts_es)
+		return -1;
+	return 0;
+}
+
+HTTS* SynthEngine::ObtainEngine(const char *lang)
+{
+	if(!strcmp("eu",lang)||!strcmp("cat",lang)||!strcmp("gl",lang)||!strcmp("en",lang))
+		return tts_eu;
+	if(!strcmp("es",lang))
+		return tts_es;
+	return NULL;
+}
+
+struct SynthSink{
+	bool streaming;
+	WavBuffer *wav;
+	AudioBlockFunc callback;
+	void *user;
+	int bytes;
+	int error;
+};
+
+/*
+* Recibe el audio de cada frase directamente del buffer del vocoder y lo
+* acumula en el wav o, en streaming, lo pasa al llamante. Si el llamante
+* falla se para la sintesis
+*/
+static BOOL SynthesizeSink(const short *s16, const float *, INT n, VOID *user)
+{
+	SynthSink *ss=(SynthSink*)user;
+	if(!ss->streaming)
+		ss->error=ss->wav->AddSamples(s16,n);
+	else{
+		ss->error=ss->callback((const char*)s16,n*sizeof(short),ss->user);
+		ss->bytes+=n*sizeof(short);
+	}
+	return ss->error>=0;
+}
+
+int SynthEngine::Synthesize(HTTS *tts, const char *lang, const char *text, bool streaming, WavBuffer *wav, bool send_wav, AudioBlockFunc callback, void *user)
+{
+	SynthSink ss={streaming,wav,callback,user,0,0};
+
+	if(tts->synthesize_stream(text,lang,data_path,SynthesizeSink,&ss)<0 && !ss.error)
+		ss.error=-1; //cancelada
+	if(!streaming && send_wav && !ss.error){
+		ss.error=callback(wav->ObtainData(),wav->ObtainSize(),user);
+		ss.bytes=wav->ObtainSize();
+	}
+	return ss.error<0?-1:ss.bytes;
+}
+
+void SynthEngine::SetRequestOptions(HTTS *tts, const char *speed, bool setdur)
+{
+	tts->set("vp", setdur?"yes":"no");
+	tts->set("r", "1.00");
+	if(!setdur && speed!=NULL && strcmp(speed,"100")){
+		int f;
+		if(sscanf(speed,"%d",&f)!=1) f=0;
+		if(f>=SPEED_MIN && f<=SPEED_MAX){
+			char tmp_speed[16];
+			sprintf(tmp_speed, "%.2f", f/100.0);
+			tts->set("r",tmp_speed);
+		}else{fprintf(stderr,"WARNING: parametro -Speed=%d ignorado, valor entero entre %d y %d\n",f,SPEED_MIN,SPEED_MAX);}
+	}
+}
+
+/**********************************************************/
+
+#define AGING 1.0		//ms de prioridad que se ganan por ms de espera
+#define MS_PER_COST 0.5		//estimacion inicial, antes de medir nada
+#define COST_EWMA 0.2		//peso de cada medida nueva
+
+long long SynthClockMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000+ts.tv_nsec/1000000;
+}
+
+int SentenceEnd(const char *text, int len, int pos)
+{
+	char c=text[pos];
+	if(c!='.' && c!='!' && c!='?' && c!=';')
+		return -1;
+	int i=pos+1;
+	//Puntuacion repetida y cierres: "...", "?!", ".)", ".\""
+	while(i<len && text[i]!='\0' && strchr(".!?)]\"'",text[i]))
+		i++;
+	if(i>=len)
+		return len;
+	if(text[i]!=' ' && text[i]!='\t' && text[i]!='\n' && text[i]!='\r')
+		return -1;
+	bool newline=false;
+	while(i<len && (text[i]==' ' || text[i]=='\t' || text[i]=='\n' || text[i]=='\r')){
+		if(text[i]=='\n') newline=true;
+		i++;
+	}
+	if(i>=len)
+		return len;
+	unsigned char n=text[i];
+	//Las mayusculas acentuadas de latin-1 tambien abren frase
+	if(newline || (n>='A' && n<='Z') || (n>='0' && n<='9') || (n>=0xC0 && n<=0xDE) || (n!='\0' && strchr("(\"'\xA1\xBF",n)))
+		return i;
+	return -1;
+}
+
+long EstimateCost(const char *text, int len)
+{
+	long sentences=1;
+	for(int i=0;i<len;i++){
+		int next=SentenceEnd(text,len,i);
+		if(next>0){
+			sentences++;
+			i=next-1;
+		}
+	}
+	return len+SENTENCE_COST*sentences;
+}
+
+void SplitSentences(const char *text, int len, int max_chars, std::vector<int> &cuts)
+{
+	int start=0;
+	cuts.clear();
+	cuts.push_back(0);
+	if(max_chars>0){
+		for(int i=0;i<len;i++){
+			if(i-start<max_chars)
+				continue;
+			int next=SentenceEnd(text,len,i);
+			//Un resto muy corto se queda con el trozo anterior
+			if(next>0 && len-next>=max_chars/2){
+				cuts.push_back(next);
+				start=next;
+				i=next-1;
+			}
+		}
+	}
+	cuts.push_back(len);
+}
+
+/**********************************************************/
+
+struct WorkerArg{
+	SynthPool *pool;
+	int worker;
+};
+
+SynthPool::SynthPool(const char *data_path, int nworkers, int capacity, AttendFunc attend, int label_cache)
+{
+	this->data_path=data_path;
+	this->nworkers=nworkers<1?1:nworkers;
+	this->capacity=capacity<1?1:capacity;
+	ms_per_cost=MS_PER_COST;
+	this->attend=attend;
+	this->label_cache=label_cache;
+	pthread_mutex_init(&lock,NULL);
+	pthread_cond_init(&ready,NULL);
+}
+
+/* Los workers no terminan nunca: el pool vive lo mismo que el servidor */
+SynthPool::~SynthPool()
+{
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&ready);
+}
+
+/*
+* Carga los motores de todos los workers y arranca los threads.
+* Devuelve 0 si todo va bien o -1 si hay problemas.
+*/
+int SynthPool::Create(void)
+{
+	int i;
+	for(i=0;i<nworkers;i++){
+		SynthEngine *engine=new SynthEngine(data_path, label_cache);
+		if(engine->Create(i?engines[0]:NULL)==-1){
+			fprintf(stderr,"Unable to load the synthesis engines of worker %d\n",i);
+			delete engine;
+			return -1;
+		}
+		engines.push_back(engine);
+	}
+	for(i=0;i<nworkers;i++){
+		pthread_t th;
+		WorkerArg *arg=new WorkerArg;
+		arg->pool=this;
+		arg->worker=i;
+		if(pthread_create(&th,NULL,WorkerMain,arg)!=0){
+			fprintf(stderr,"Unable to start worker %d\n",i);
+			delete arg;
+			return -1;
+		}
+		threads.push_back(th);
+	}
+	return 0;
+}
+
+/* Encola una peticion para el primer worker libre */
+bool SynthPool::Submit(void *job, const SynthJobInfo &info)
+{
+	bool queued=false;
+	pthread_mutex_lock(&lock);
+	if((int)pending.size()<capacity){
+		Pending p;
+		p.job=job;
+		p.info=info;
+		p.queued=SynthClockMs();
+		pending.push_back(p);
+		pthread_cond_signal(&ready);
+		queued=true;
+	}
+	pthread_mutex_unlock(&lock);
+	return queued;
+}
+
+void* SynthPool::WorkerMain(void *arg)
+{
+	WorkerArg *warg=(WorkerArg*)arg;
+	SynthPool *pool=warg->pool;
+	int worker=warg->worker;
+	delete warg;
+	pool->Work(worker);
+	return NULL;
+}
+
+/*
+* Indice en {pending} del trabajo con menor prioridad en {now}. Las
+* prioridades cambian con el tiempo, asi que se recorre la cola entera
+* (es corta: como mucho {capacity}). Se llama con el mutex cogido.
+*/
+int SynthPool::Next(long long now)
+{
+	int best=0;
+	double best_key=0;
+	for(int i=0;i<(int)pending.size();i++){
+		const SynthJobInfo &info=pending[i].info;
+		double cost=info.cost*ms_per_cost;
+		double key=cost-AGING*(now-info.arrival);
+		if(info.deadline>0){
+			double slack=info.deadline-now-cost;
+			if(slack<key)
+				key=slack;
+		}
+		if(i==0 || key<best_key){
+			best=i;
+			best_key=key;
+		}
+	}
+	return best;
+}
+
+void SynthPool::Work(int worker)
+{
+	while(1){
+		Pending p;
+		pthread_mutex_lock(&lock);
+		while(pending.empty())
+			pthread_cond_wait(&ready,&lock);
+		long long start=SynthClockMs();
+		int i=Next(start);
+		p=pending[i];
+		pending.erase(pending.begin()+i);
+		pthread_mutex_unlock(&lock);
+
+		attend(p.job, engines[worker], worker, start-p.queued);
+
+		//Se ajusta el coste por unidad con lo que ha tardado de verdad
+		long long took=SynthClockMs()-start;
+		if(p.info.cost>0){
+			pthread_mutex_lock(&lock);
+			ms_per_cost=(1-COST_EWMA)*ms_per_cost+COST_EWMA*((double)took/p.info.cost);
+			pthread_mutex_unlock(&lock);
+		}
+	}
+}
@@ -0,0 +1,216 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.6.0	 16/10/26  Jonny      SynthEngine::Synthesize, comun a tts_server y a los motores de my_server
+1.5.0	 16/10/26  Jonny      Cache de indices de pdf por etiqueta en la voz (label_cache)
+1.4.0	 16/10/26  Jonny      Los workers comparten los modelos a traves de HTTS_DB
+1.3.0	 16/10/26  Jonny      Planificador: menor coste primero con envejecimiento y plazos
+1.2.0	 16/10/26  Jonny      Cola acotada de peticiones en lugar de conexiones
+1.1.0  	 16/10/26  Jonny	  Wav en memoria reutilizable por worker
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: pool de workers con motores precargados
+*/
+
+#ifndef _SYNTH_POOL_H
+#define _SYNTH_POOL_H
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "htts.hpp"
+#include "Socket.hpp"
+#include "Wav_Buffer.hpp"
+
+/*
+* Motores de sintesis de un worker: un objeto HTTS por idioma, creados
+* y "calentados" una unica vez al arrancar el servidor. Tras create()
+* el diccionario y todos los modelos de la voz (arboles, pdfs, ventanas,
+* GV) estan ya cargados, de modo que cada peticion empieza a sintetizar
+* directamente. Los motores de los demas workers se crean a partir de la
+* HTTS_DB del primero: comparten los modelos (solo lectura) y cada uno
+* tiene unicamente su estado de sintesis.
+*/
+class SynthEngine{
+	public:
+		/* {label_cache}: kB de la cache etiqueta -> indices de pdf de
+		 * cada voz, 0 sin cache. Solo cuenta en el motor que carga los
+		 * modelos: los que los comparten usan tambien su cache */
+		SynthEngine(const char *data_path, int label_cache=0);
+		~SynthEngine();
+		/* {shared}: motores ya creados cuyos modelos se comparten, o NULL */
+		int Create(SynthEngine *shared=NULL);
+		/* Devuelve el motor del idioma pedido, o NULL si no esta soportado.
+		 * "cat", "gl" y "en" usan el motor de euskera, como hasta ahora */
+		HTTS* ObtainEngine(const char *lang);
+		/* Velocidad y alineamiento por fonema, se fijan en cada peticion
+		 * porque el motor se reutiliza entre peticiones */
+		void SetRequestOptions(HTTS *tts, const char *speed, bool setdur);
+		/* Sintetiza {text} con el motor {tts} del idioma {lang}, ya
+		 * configurado, y pasa el audio a {callback}: cada frase segun sale
+		 * si {streaming}, o si no las acumula en {wav} y, con {send_wav},
+		 * lo manda entero al final. Si {callback} falla o se cancela el
+		 * motor se descartan las frases que quedan sin sintetizarlas, y el
+		 * motor queda vacio para la siguiente peticion. Lo usan tts_server
+		 * y los motores de my_server. Devuelve los bytes entregados a
+		 * {callback} o -1 si ha fallado o se ha cancelado */
+		int Synthesize(HTTS *tts, const char *lang, const char *text, bool streaming, WavBuffer *wav, bool send_wav, AudioBlockFunc callback, void *user);
+		/* Aciertos, fallos, etc. de la cache de etiquetas de la voz de
+		 * {lang} como los da HTTS::get("label_cache_stats"), o NULL si
+		 * no hay cache. La cadena es del motor: no llamar a la vez desde
+		 * varios threads */
+		const char* ObtainLabelCacheStats(const char *lang);
+		/* Wav en memoria del worker, se reutiliza de una peticion a otra */
+		WavBuffer* ObtainWavBuffer(void){return &wav;}
+		int ObtainServed(void){return served;}
+		void RequestServed(void){served++;}
+	private:
+		HTTS* CreateLanguage(const char *lang, HTTS *shared);
+		const char *data_path;
+		int label_cache;
+		HTTS *tts_eu;
+		HTTS *tts_es;
+		WavBuffer wav;
+		int served;
+};
+
+/*
+* Funcion que atiende una peticion ya recibida entera. La llama el
+* worker {worker} con su propio juego de motores {engine}; {wait} son
+* los ms que ha pasado {job} en la cola. No debe hacer E/S de red
+* bloqueante: el audio se entrega al servidor de eventos.
+*/
+typedef void (*AttendFunc)(void *job, SynthEngine *engine, int worker, long wait);
+
+/* Reloj monotono en ms para los tiempos de planificacion */
+long long SynthClockMs(void);
+
+/*
+* Coste estimado de sintetizar {len} caracteres de {text}: los
+* caracteres mas SENTENCE_COST por cada frase, que es la unidad con la
+* que trabaja el motor. Las frases se cuentan con SentenceEnd().
+*/
+#define SENTENCE_COST 40
+long EstimateCost(const char *text, int len);
+
+/*
+* Si en {text}[pos] termina una frase devuelve la posicion donde empieza
+* la siguiente, si no -1. Es una aproximacion barata del corte de T2U
+* (selectpunc) sin cargar el motor: puntuacion final seguida de blancos
+* y de una mayuscula, un digito, una apertura o un salto de linea.
+*/
+int SentenceEnd(const char *text, int len, int pos);
+
+/*
+* Posiciones de {text} donde se puede partir en trozos de al menos
+* {max_chars} caracteres sin romper frases. {cuts} empieza en 0 y
+* termina en {len}; con un solo trozo queda {0, len}.
+*/
+void SplitSentences(const char *text, int len, int max_chars, std::vector<int> &cuts);
+
+/* Datos de planificacion de un trabajo, tiempos de SynthClockMs() */
+struct SynthJobInfo{
+	long cost;		//EstimateCost() del texto
+	long long arrival;	//llegada de la peticion, para el envejecimiento
+	long long deadline;	//plazo para terminarla, 0 si no tiene
+};
+
+/*
+* Pool fijo de workers de sintesis. Cada worker es un thread de larga
+* duracion con su propio SynthEngine. Las peticiones se encolan con
+* Submit() y la cola admite como mucho {capacity} pendientes.
+* Cada worker libre toma la de menor prioridad:
+*   coste estimado en ms - AGING * ms esperando desde su llegada
+* (la mas corta primero, pero una larga acaba pasando delante). Si tiene
+* plazo la prioridad es como mucho su holgura, plazo - ahora - coste, de
+* modo que las que van justas pasan delante de todo.
+* Los ms por unidad de coste se aprenden de las peticiones ya servidas.
+*/
+class SynthPool{
+	public:
+		SynthPool(const char *data_path, int nworkers, int capacity, AttendFunc attend, int label_cache=0);
+		~SynthPool();
+		int Create(void);
+		/* Devuelve false, sin encolar, si la cola esta llena */
+		bool Submit(void *job, const SynthJobInfo &info);
+		int ObtainNWorkers(void){return nworkers;}
+	private:
+		struct Pending{
+			void *job;
+			SynthJobInfo info;
+			long long queued;
+		};
+		static void* WorkerMain(void *arg);
+		void Work(int worker);
+		int Next(long long now);
+
+		const char *data_path;
+		int nworkers;
+		int capacity;
+		AttendFunc attend;
+		int label_cache;
+		std::vector<SynthEngine*> engines;
+		std::vector<pthread_t> threads;
+		std::vector<Pending> pending;
+		double ms_per_cost;
+		pthread_mutex_t lock;
+		pthread_cond_t ready;
+};
+
+
+#endif
@@ -0,0 +1,146 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      StreamHeader: cabecera para wav de longitud desconocida
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: wav en memoria para el servidor
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "Wav_Buffer.hpp"
+
+/* Espacio inicial: un segundo de audio a 16kHz */
+#define WAV_INITIAL_CAPACITY (WAV_HEADER_SIZE+32000)
+
+/* Escribe {val} en little endian, como manda el formato RIFF */
+static void PutLE(char *p, unsigned int val, int nbytes)
+{
+	int i;
+	for(i=0;i<nbytes;i++){
+		p[i]=(char)(val&0xff);
+		val>>=8;
+	}
+}
+
+WavBuffer::WavBuffer(const int srate)
+{
+	this->srate=srate;
+	capacity=WAV_INITIAL_CAPACITY;
+	data=(char*)malloc(capacity);
+	size=WAV_HEADER_SIZE;
+}
+
+WavBuffer::~WavBuffer()
+{
+	free(data);
+}
+
+void WavBuffer::Reset(void)
+{
+	size=WAV_HEADER_SIZE;
+}
+
+/*
+* Anyade {len} muestras al final del wav. Devuelve 0 si todo va bien
+* o -1 si no hay memoria.
+* Las muestras se copian tal cual: se asume una maquina little endian.
+*/
+int WavBuffer::AddSamples(const short *samples, const int len)
+{
+	int nbytes=len*(int)sizeof(short);
+	if(size+nbytes>capacity){
+		int newcap=capacity*2;
+		while(newcap<size+nbytes) newcap*=2;
+		char *aux=(char*)realloc(data,newcap);
+		if(aux==NULL)
+			return -1;
+		data=aux;
+		capacity=newcap;
+	}
+	memcpy(data+size,samples,nbytes);
+	size+=nbytes;
+	return 0;
+}
+
+void WavBuffer::WriteHeader(char *header, int srate, unsigned int riffsize, unsigned int datasize)
+{
+	memcpy(header,"RIFF",4);
+	PutLE(header+4,riffsize,4);
+	memcpy(header+8,"WAVEfmt ",8);
+	PutLE(header+16,16,4);		//tamanio del chunk fmt
+	PutLE(header+20,1,2);		//PCM
+	PutLE(header+22,1,2);		//mono
+	PutLE(header+24,srate,4);
+	PutLE(header+28,srate*2,4);	//bytes por segundo
+	PutLE(header+32,2,2);		//bytes por muestra
+	PutLE(header+34,16,2);		//bits por muestra
+	memcpy(header+36,"data",4);
+	PutLE(header+40,datasize,4);
+}
+
+void WavBuffer::StreamHeader(char *header, const int srate)
+{
+	WriteHeader(header,srate,0xFFFFFFFF,0xFFFFFFFF);
+}
+
+const char* WavBuffer::ObtainData(void)
+{
+	WriteHeader(data,srate,size-8,size-WAV_HEADER_SIZE);
+	return data;
+}
@@ -0,0 +1,100 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+*Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+''AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	*1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    	''2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	*GPL-3.0+
+	''Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*****************************************************************************/
+/*                                                                           */
+/*                                \m/(-.-)\m/                                */
+/*                                                                           */
+/*****************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+1.1.0	 16/10/26  Jonny      StreamHeader: cabecera para wav de longitud desconocida
+1.0.0  	 16/10/26  Jonny	  Codificación inicial: wav en memoria para el servidor
+*/
+
+#ifndef _WAV_BUFFER_H
+#define _WAV_BUFFER_H
+
+/*
+* Fichero wav (PCM 16 bits, mono) construido en memoria. Las muestras
+* se van anyadiendo frase a frase y la cabecera RIFF se completa al
+* pedir los datos, de modo que el resultado es identico byte a byte al
+* que escribe CAudioFile con "SRate=16000.0 NChan=1 FFormat=Wav", pero
+* sin pasar por disco.
+*/
+class WavBuffer{
+	public:
+		WavBuffer(const int srate=16000);
+		~WavBuffer();
+		int AddSamples(const short *samples, const int len);
+		/* Datos del wav completo (cabecera incluida) y su tamanio en bytes.
+		 * El puntero es valido hasta el siguiente AddSamples() o Reset() */
+		const char* ObtainData(void);
+		int ObtainSize(void){return size;}
+		int ObtainNSamples(void){return (size-WAV_HEADER_SIZE)/2;}
+		void Reset(void);
+		/* Cabecera de un wav que se manda mientras se sintetiza, sin
+		 * saber su longitud: los tamanios van a 0xFFFFFFFF, como hacen
+		 * los servidores de audio en streaming */
+		static void StreamHeader(char *header, const int srate=16000);
+
+		enum { WAV_HEADER_SIZE=44 };
+	private:
+		static void WriteHeader(char *header, int srate, unsigned int riffsize, unsigned int datasize);
+		char *data;
+		int size;
+		int capacity;
+		int srate;
+};
+
+
+#endif
@@ -1,45 +1,85 @@
 #include "base64.hpp"
 
-std::string base64_encode(const unsigned char* bytes, int length) {
-    static const char* base64_chars = 
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-    
-    std::string base64_string;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    
-    while (length--) {
-        char_array_3[i++] = *(bytes++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-            
-            for (i = 0; i < 4; i++)
-                base64_string += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static const char* base64_chars = 
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+// Encodes whole 3 byte groups and the padded tail
+static size_t base64_encode_scalar(const unsigned char* bytes, size_t length, char* out) {
+    char* p = out;
+
+    for (; length >= 3; length -= 3, bytes += 3) {
+        unsigned int group = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+        p[0] = base64_chars[(group >> 18) & 0x3f];
+        p[1] = base64_chars[(group >> 12) & 0x3f];
+        p[2] = base64_chars[(group >> 6) & 0x3f];
+        p[3] = base64_chars[group & 0x3f];
+        p += 4;
     }
-    
-    if (i) {
-        for (j = i; j < 3; j++)
-            char_array_3[j] = '\0';
-        
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        
-        for (j = 0; j < i + 1; j++)
-            base64_string += base64_chars[char_array_4[j]];
-        
-        while (i++ < 3)
-            base64_string += '=';
+
+    if (length) {
+        unsigned int group = bytes[0] << 16;
+        if (length == 2)
+            group |= bytes[1] << 8;
+        p[0] = base64_chars[(group >> 18) & 0x3f];
+        p[1] = base64_chars[(group >> 12) & 0x3f];
+        p[2] = length == 2 ? base64_chars[(group >> 6) & 0x3f] : '=';
+        p[3] = '=';
+        p += 4;
     }
-    
+
+    return p - out;
+}
+
+#ifdef BASE64_SSSE3
+// 12 input bytes to 16 output characters per step: the bytes are
+// shuffled so that every 32 bit lane holds one 3 byte group, the four
+// 6 bit fields are moved to their own byte with two multiplies, and the
+// 0..63 values are turned into ASCII adding a per-range offset looked up
+// with pshufb
+__attribute__((target("ssse3")))
+static size_t base64_encode_ssse3(const unsigned char* bytes, size_t length, char* out) {
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    char* p = out;
+
+    // Each load reads 16 bytes but only consumes 12
+    for (; length >= 16; length -= 12, bytes += 12) {
+        __m128i in = _mm_loadu_si128((const __m128i*)bytes);
+        in = _mm_shuffle_epi8(in, shuffle);
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i values = _mm_or_si128(t1, t3);
+
+        __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+        index = _mm_sub_epi8(index, _mm_cmpgt_epi8(values, _mm_set1_epi8(25)));
+        _mm_storeu_si128((__m128i*)p, _mm_add_epi8(values, _mm_shuffle_epi8(offsets, index)));
+        p += 16;
+    }
+
+    return (p - out) + base64_encode_scalar(bytes, length, p);
+}
+#endif
+
+size_t base64_encode(const unsigned char* bytes, size_t length, char* out) {
+#ifdef BASE64_SSSE3
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if (ssse3)
+        return base64_encode_ssse3(bytes, length, out);
+#endif
+    return base64_encode_scalar(bytes, length, out);
+}
+
+std::string base64_encode(const unsigned char* bytes, int length) {
+    std::string base64_string(base64_encoded_length(length), '\0');
+    base64_encode(bytes, length, &base64_string[0]);
     return base64_string;
 }
@@ -1,8 +1,28 @@
 #ifndef BASE64_HPP
 #define BASE64_HPP
 
+#include <stddef.h>
 #include <string>
 
+/**
+ * @brief Size of the base64 encoding of length bytes, padding included
+ */
+inline size_t base64_encoded_length(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+/**
+ * @brief Encodes binary data to base64 into a caller provided buffer
+ *
+ * Uses SSSE3 when the CPU supports it. No terminating '\0' is written.
+ *
+ * @param bytes Pointer to the binary data
+ * @param length Length of the binary data in bytes
+ * @param out Output buffer of at least base64_encoded_length(length) bytes
+ * @return size_t Number of characters written
+ */
+size_t base64_encode(const unsigned char* bytes, size_t length, char* out);
+
 /**
  * @brief Encodes binary data to base64 string
  * 
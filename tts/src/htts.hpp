@@ -70,6 +70,8 @@ Codificacion................. Borja Etxebarria
 
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.2.1    16/10/26  Jonny     skip_sentence, para repartir las frases de un texto entre varios HTTS
+1.2.0    16/10/26  Jonny     API de streaming: HTTSSink, synthesize_stream, output_stream
 1.1.0    02/10/11  inaki     add transcription API
 1.0.0    31/01/00  borja     codefreeze aHoTTS v1.0
 0.0.0    06/02/98  borja     Codificacion inicial.
@@ -108,6 +110,15 @@ extern BOOL __htts_lang_eu;
 
 enum { HTTS_CB_NOCALL=0, HTTS_CB_CALL1=1, HTTS_CB_BLOCKCALL=-1 };
 
+/* Formato de las muestras entregadas por synthesize_stream()/output_stream() */
+enum { HTTS_SAMPLES_S16=0, HTTS_SAMPLES_F32=1 };
+
+/* Receptor de audio de la interfaz de streaming. Recibe {n} muestras
+contiguas en {s16} (HTTS_SAMPLES_S16) o en {f32} (HTTS_SAMPLES_F32, en
+[-1,1)); el otro puntero es NULL. Las muestras solo son validas durante la
+llamada. {devuelve} FALSE para detener la sintesis */
+typedef BOOL (*HTTSSink)( const short *s16, const float *f32, INT n, VOID *user );
+
 /**********************************************************/
 
 class HTTSDo;
@@ -134,6 +145,10 @@ public:
 	//inaki
 	INT input_multilingual( const CHAR * str, const CHAR *lang , const CHAR *data_path, BOOL InputIsFile = FALSE );
 	int output_multilingual(const CHAR *lang, short **samples);
+	INT synthesize_stream( const CHAR *str, const CHAR *lang, const CHAR *data_path, HTTSSink sink, VOID *user, INT chunk_ms = 0, INT format = HTTS_SAMPLES_S16 );
+	INT output_stream( const CHAR *lang, HTTSSink sink, VOID *user, INT chunk_ms = 0, INT format = HTTS_SAMPLES_S16 );
+	BOOL skip_sentence( VOID );
+	VOID cancel( BOOL on = TRUE );
 	//const DOUBLE * output_multilingual();
 	//BOOL outack_multilingual();
 	/***********/
@@ -0,0 +1,151 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+*AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    *2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	GPL-3.0+
+	*GPL-3.0+
+	'Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+#ifndef __HTTSDB_HPP__
+#define __HTTSDB_HPP__
+
+/**********************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/*
+(C) 1997 TSR/Aholab - ETSII/IT Bilbao (UPV/EHU)
+
+Nombre fuente................ httsdb.hpp
+Nombre paquete............... aHoTTS
+Lenguaje fuente.............. C++
+Estado....................... -
+Dependencia Hard/OS.......... pthreads (UNIX) / mutex Win32
+Codigo condicional........... HTTS_METHOD_HTS
+
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+0.0.0    16/10/26  Jonny     Codificacion inicial.
+
+======================== Contenido ========================
+<DOC>
+Base de datos compartida entre varios modulos HTTS.
+
+Guarda lo que no cambia de una sesion a otra: el idioma, el
+metodo, el nombre del diccionario y, sobre todo, el conjunto
+de modelos HTS (arboles, pdfs, ventanas y GV) de la voz, que
+se carga una sola vez y despues solo se lee. Cada HTTS que la
+usa tiene una referencia; la ultima en liberarse la borra.
+
+El diccionario HDicDB no se comparte: es un fichero con estado
+de busqueda por objeto, asi que cada sesion abre el suyo con
+el nombre guardado aqui.
+</DOC>
+===========================================================
+*/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/**********************************************************/
+
+#include "tdef.h"
+#include "htts_cfg.h"
+#include "string.hpp"
+
+#ifdef __OS_UNIX__
+#include <pthread.h>
+#endif
+#ifdef __OS_WINDOWS__
+#include <windows.h>
+#endif
+
+#ifdef HTTS_METHOD_HTS
+extern "C"{
+#include "HTS_engine.h"
+}
+class HTS_U2W;
+#endif
+
+/**********************************************************/
+
+class HTTS_DB {
+private:
+	INT refs;
+#ifdef __OS_UNIX__
+	pthread_mutex_t mutex;
+#endif
+#ifdef __OS_WINDOWS__
+	HANDLE mutex;
+#endif
+
+	String lang;
+	String smethod;
+	String hdicdbname;
+
+#ifdef HTTS_METHOD_HTS
+	HTS_Engine voice;  // modelos de la voz, solo lectura una vez cargados
+	BOOL voiceloaded;
+	String voicekey;  // ficheros de los que se ha cargado {voice}
+#endif
+
+	VOID lock( VOID );
+	VOID unlock( VOID );
+	~HTTS_DB();
+
+public:
+	HTTS_DB( const CHAR *lang, const CHAR *smethod, const CHAR *hdicdbname );
+
+	VOID ref( VOID );
+	VOID unref( VOID );
+
+	const CHAR *getLang( VOID ) { return lang; }
+	const CHAR *getMethod( VOID ) { return smethod; }
+	const CHAR *getHDicDBName( VOID ) { return hdicdbname; }
+
+#ifdef HTTS_METHOD_HTS
+	HTS_Engine *getVoice( const CHAR *key, HTS_U2W *loader );
+#endif
+};
+
+/**********************************************************/
+
+#endif
@@ -54,6 +54,8 @@ GPL-3.0+
 /*
 Version  dd/mm/aa  Autor     Proposito de la edicion
 -------  --------  --------  -----------------------
+1.3.0	 16/10/26  Jonny     Modo documento: las frases se sintetizan en paralelo en
+* 							 varias sesiones (-Threads) y se escriben en orden.
 1.2.0	 20/04/12  Agustin   cambiada la forma de pasar los parametros usando la clase
 * 								KVStrList, soporte gallego con voz de vigo.
 1.1.0    30/03/12  Agustin   Soporte para inglés, nuevo parametro nombre del
@@ -66,29 +68,160 @@ Version  dd/mm/aa  Autor     Proposito de la edicion
 #include <stdio.h>
 #include <stdlib.h>
 #include <malloc.h>
+#include <pthread.h>
 
 #include "htts.hpp"
 #include "strl.hpp"
 #include "caudio.hpp"
 
+///////////////////////////////////////////
+// DOCUMENT MODE
+// Every session gets the whole text and takes the sentences handed out by
+// Document, skipping the others with skip_sentence(), so the cuts are the
+// T2U ones and each sentence sounds as in a single session (its pauses
+// included). The finished sentences wait in a ring of InFlight slots until
+// the main thread writes them in order, which bounds the memory used.
+
+struct DocSentence{
+	short *samples;
+	int len;
+	bool done;
+};
+
+struct Document{
+	const char *str;
+	const char *lang;
+	const char *data_path;
+	int inflight;		//sentences handed out and not written yet, at most
+	DocSentence *ring;	//inflight slots, sentence i goes to ring[i%inflight]
+	int next;		//next sentence to hand out
+	int written;		//sentences already written
+	int total;		//number of sentences, -1 until a session reaches the end
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+struct DocWorker{
+	Document *doc;
+	HTTS *tts;
+};
+
+static void *document_worker(void *arg){
+	Document *doc=((DocWorker*)arg)->doc;
+	HTTS *tts=((DocWorker*)arg)->tts;
+	int pos=0; //next sentence of this session
+	tts->input_multilingual(doc->str, doc->lang, doc->data_path, FALSE);
+	pthread_mutex_lock(&doc->lock);
+	for(;;){
+		while(doc->next-doc->written>=doc->inflight && (doc->total<0 || doc->next<doc->total))
+			pthread_cond_wait(&doc->cond,&doc->lock);
+		if(doc->total>=0 && doc->next>=doc->total)
+			break;
+		int i=doc->next++;
+		pthread_mutex_unlock(&doc->lock);
+		short *samples=NULL;
+		int len=0;
+		while(pos<i && tts->skip_sentence())
+			pos++;
+		if(pos==i){
+			len=tts->output_multilingual(doc->lang, &samples);
+			if(len>0)
+				pos++;
+		}
+		pthread_mutex_lock(&doc->lock);
+		if(len==0){ //end of the text: sentences 0..pos-1
+			if(doc->total<0 || pos<doc->total)
+				doc->total=pos;
+		}else{
+			doc->ring[i%doc->inflight].samples=samples;
+			doc->ring[i%doc->inflight].len=len;
+			doc->ring[i%doc->inflight].done=true;
+		}
+		pthread_cond_broadcast(&doc->cond);
+	}
+	pthread_cond_broadcast(&doc->cond);
+	pthread_mutex_unlock(&doc->lock);
+	return NULL;
+}
+
+/* Synthesizes {str} with the {n} sessions of {tts}, one thread each, and
+writes the sentences to {fout} in order. Returns false, without writing
+anything, if no thread can be started */
+static bool synthesize_document(HTTS **tts, int n, int inflight, const char *str,
+		const char *lang, const char *data_path, CAudioFile &fout){
+	Document doc;
+	doc.str=str;
+	doc.lang=lang;
+	doc.data_path=data_path;
+	doc.inflight=inflight;
+	doc.ring=new DocSentence[inflight];
+	for(int i=0;i<inflight;i++)
+		doc.ring[i].done=false;
+	doc.next=doc.written=0;
+	doc.total=-1;
+	pthread_mutex_init(&doc.lock,NULL);
+	pthread_cond_init(&doc.cond,NULL);
+
+	DocWorker *workers=new DocWorker[n];
+	pthread_t *threads=new pthread_t[n];
+	int started=0;
+	for(int i=0;i<n;i++){
+		workers[i].doc=&doc;
+		workers[i].tts=tts[i];
+		if(pthread_create(&threads[started],NULL,document_worker,&workers[i])!=0){
+			fprintf(stderr,"WARNING: only %d synthesis threads\n",started);
+			break;
+		}
+		started++;
+	}
+
+	pthread_mutex_lock(&doc.lock);
+	for(;started;){
+		DocSentence *s=&doc.ring[doc.written%inflight];
+		while(!s->done && (doc.total<0 || doc.written<doc.total))
+			pthread_cond_wait(&doc.cond,&doc.lock);
+		if(!s->done)
+			break;
+		pthread_mutex_unlock(&doc.lock);
+		fout.setBlk(s->samples, s->len);
+		free(s->samples);
+		pthread_mutex_lock(&doc.lock);
+		s->done=false;
+		doc.written++;
+		pthread_cond_broadcast(&doc.cond);
+	}
+	pthread_mutex_unlock(&doc.lock);
+
+	for(int i=0;i<started;i++)
+		pthread_join(threads[i],NULL);
+	pthread_mutex_destroy(&doc.lock);
+	pthread_cond_destroy(&doc.cond);
+	delete[] threads;
+	delete[] workers;
+	delete[] doc.ring;
+	return started>0;
+}
+
 int main(int argc, char * argv[]){
 
 ///////////////////////////////////////////
 // READ INPUT ARGUMENTS
 
 	//define the input defaults arguments
-	KVStrList pro("InputFile=input.txt Lang=eu OutputFile=Output.wav DataPath=data_tts Speed=100 SetDur=n help=n");
+	KVStrList pro("InputFile=input.txt Lang=eu OutputFile=Output.wav DataPath=data_tts Speed=100 SetDur=n Threads=1 InFlight=0 help=n");
 	StrList files;
 
 	//define the type of each argument
 	//InputFile=s --> string
 	//Lang=selection
 	clargs2props(argc, argv, pro, files,
-			"InputFile=s Lang={es|eu} OutputFile=s  DataPath=s Speed=s help=b SetDur=b");
+			"InputFile=s Lang={es|eu} OutputFile=s  DataPath=s Speed=s help=b SetDur=b Threads=s InFlight=s");
 
 	//Read the values of the input arguments
 	if (pro.bval("help")){
-		printf("usage: ./tts -InputFile=input.txt -Lang={eu|es} -OutputFile=Output.wav -DataPath=data_tts -Speed=100\n");
+		printf("usage: ./tts -InputFile=input.txt -Lang={eu|es} -OutputFile=Output.wav -DataPath=data_tts -Speed=100 -Threads=1 -InFlight=0\n");
+		printf("\tThreads: sessions synthesizing sentences of the text in parallel, sharing the models\n");
+		printf("\tInFlight: with Threads>1, sentences synthesized ahead of the one being written (0: 2*Threads)\n");
 		return -1;
 	}
 	const char *input_file = pro.val("InputFile");
@@ -97,6 +230,12 @@ int main(int argc, char * argv[]){
 	const char *speed=pro.val("Speed");
 	const char *data_path=pro.val("DataPath");
 	bool SetDur=pro.bbval("SetDur");
+	int threads=atoi(pro.val("Threads"));
+	int inflight=atoi(pro.val("InFlight"));
+	if(threads<1) threads=1;
+	if(inflight<1) inflight=2*threads;
+	char dic_path[1024];
+	char rate[16]="";
 	
 ///////////////////////////////////////////
 
@@ -112,7 +251,6 @@ int main(int argc, char * argv[]){
 // Language (Lang) must be set before creating the tts (see below)
 	if (!strcmp(lang,"es")){
 		tts->set("Lang", "es");
-		char dic_path[1024];
 		sprintf(dic_path, "%s/dicts/es_dicc", data_path);
 		tts->set("HDicDBName",dic_path);
 	}
@@ -120,7 +258,6 @@ int main(int argc, char * argv[]){
 		//Catalan, english and galician languages use Basque Lang to create the TTS
 		//...the actual language is set with "input_multilingual" function
 		tts->set("Lang", "eu");
-		char dic_path[1024];
 		sprintf(dic_path, "%s/dicts/eu_dicc", data_path);
 		tts->set("HDicDBName",dic_path);
 	}else
@@ -171,12 +308,39 @@ int main(int argc, char * argv[]){
 			char *tmp_speed = new char [5];
 			sprintf(tmp_speed, "%.2f", f/100.0);
 				tts->set("r",tmp_speed);
+				strcpy(rate,tmp_speed);
 			//}
 			delete []tmp_speed;
 		}else{fprintf(stderr,"WARNING: parametro -Speed=%d ignored\n\tits value must be an integer between 25 and 300\n",f);}
 	}
 //////////////////////////////////
 
+///////////////////////////////////////////
+// MORE SESSIONS FOR THE DOCUMENT MODE
+// created from the HTTS_DB of the first one: the dictionary and the voice
+// models are loaded once and shared, each session only has its synthesis state
+	HTTS **sessions=new HTTS*[threads];
+	sessions[0]=tts;
+	for(int i=1;i<threads;i++){
+		sessions[i]=new HTTS;
+		sessions[i]->set("PthModel", "Pth1");
+		sessions[i]->set("Method", "HTS");
+		sessions[i]->set("Lang", strcmp(lang,"es")?"eu":"es");
+		sessions[i]->set("HDicDBName", dic_path);
+		if(!sessions[i]->create(tts->getDB())){
+			delete sessions[i];
+			fprintf(stderr,"WARNING: only %d synthesis sessions\n",i);
+			threads=i;
+			break;
+		}
+		sessions[i]->set("voice_path", voice_path);
+		if(SetDur)
+			sessions[i]->set("vp", "yes");
+		else if(rate[0])
+			sessions[i]->set("r", rate);
+	}
+///////////////////////////////////////////
+
 	char *str; //To read the input file
 	int tamanio; //size of the input file
 
@@ -207,7 +371,9 @@ int main(int argc, char * argv[]){
 		}
 	///////////////////////////////////////////
 	// INSERT TEXT IN THE TTS OBJECT
-		if(tts->input_multilingual(str, lang, data_path, FALSE)){ //FALSE => str contains the input text
+		if(threads>1 && synthesize_document(sessions, threads, inflight, str, lang, data_path, fout))
+			; //document mode, already written
+		else if(tts->input_multilingual(str, lang, data_path, FALSE)){ //FALSE => str contains the input text
 			short *samples;
 			int len=0;
 			//PROCESS A SENTENCE FROM THE TEXT AND GET "len" samples
@@ -227,8 +393,10 @@ int main(int argc, char * argv[]){
 
 	if(str!=NULL)delete[]str;
 
-	//DELETE THE TTS OBJECT
-	delete tts;
+	//DELETE THE TTS OBJECTS
+	for(int i=threads-1;i>=0;i--)
+		delete sessions[i];
+	delete[] sessions;
 	return 1;
 }
 
@@ -0,0 +1,241 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+*AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    *2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	GPL-3.0+
+	*GPL-3.0+
+	'Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+0.0.0    16/10/26  Jonny     Codificacion inicial.
+
+Compara la generacion de parametros en streaming (mlpg_lookahead) con la
+de la frase entera sobre un corpus: sintetiza el texto una vez por cada
+lookahead, guarda los parametros generados y mide su distancia a los de
+referencia (distorsion mel-cepstral, error de f0 en cents, acuerdo
+sonoro/sordo y error del tercer stream), ademas del tiempo hasta la
+primera muestra de cada frase y el tiempo total.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+#include "htts.hpp"
+#include "strl.hpp"
+
+#define LZERO_FLOAT -1.0e+09f   // por debajo, trama sorda en el fichero de lf0
+
+static double msnow(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+struct Timing {
+	double start;	// inicio de la frase
+	double first;	// hasta la primera muestra (<0: aun no)
+};
+
+static BOOL first_sample(const short *, const float *, INT, VOID *user) {
+	Timing *t = (Timing *)user;
+	if (t->first < 0)
+		t->first = msnow() - t->start;
+	return TRUE;
+}
+
+static std::vector<float> load(const char *fname) {
+	std::vector<float> v;
+	FILE *f = fopen(fname, "rb");
+	float x;
+	if (!f)
+		return v;
+	while (fread(&x, sizeof(float), 1, f) == 1)
+		v.push_back(x);
+	fclose(f);
+	return v;
+}
+
+/* Sintetiza {text} con el lookahead {la}, dejando los parametros en
+{prefix}.<la>.{mgc,lf0,str}. Devuelve FALSE si no se puede crear el tts */
+static BOOL run(const char *text, const char *lang, const char *data_path, const char *prefix, int la,
+		double *first, double *total, int *nsent) {
+	char fname[1024], val[32];
+	HTTS *tts = new HTTS;
+	Timing t;
+	tts->set("PthModel", "Pth1");
+	tts->set("Method", "HTS");
+	tts->set("Lang", lang);
+	sprintf(fname, "%s/dicts/%s_dicc", data_path, lang);
+	tts->set("HDicDBName", fname);
+	if (!tts->create()) {
+		delete tts;
+		return FALSE;
+	}
+	sprintf(fname, "%s/voices/aholab_%s_female/", data_path, lang);
+	tts->set("voice_path", fname);
+	sprintf(val, "%d", la);
+	tts->set("mlpg_lookahead", val);
+	tts->set("vocoder_frames", "4");
+	sprintf(fname, "%s.%d.mgc", prefix, la);
+	tts->set("om", fname);
+	sprintf(fname, "%s.%d.lf0", prefix, la);
+	tts->set("of", fname);
+	sprintf(fname, "%s.%d.str", prefix, la);
+	tts->set("oe", fname);
+
+	*first = 0.0;
+	*nsent = 0;
+	*total = msnow();
+	tts->input_multilingual(text, lang, data_path, FALSE);
+	for (;;) {
+		t.start = msnow();
+		t.first = -1.0;
+		if (tts->output_stream(lang, first_sample, &t) == 0)
+			break;
+		*first += t.first;
+		(*nsent)++;
+	}
+	*total = msnow() - *total;
+	delete tts;  // cierra los ficheros de parametros
+	return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+	KVStrList pro("InputFile=input.txt Lang=eu DataPath=data_tts OutputPrefix=mlpg_compare Lookahead=10,20,30,40 help=n");
+	StrList files;
+	clargs2props(argc, argv, pro, files, "InputFile=s Lang={es|eu} DataPath=s OutputPrefix=s Lookahead=s help=b");
+	if (pro.bval("help")) {
+		printf("usage: ./mlpg_compare -InputFile=corpus.txt -Lang={eu|es} -DataPath=data_tts -OutputPrefix=mlpg_compare -Lookahead=10,20,30,40\n");
+		return -1;
+	}
+	const char *lang = pro.val("Lang");
+	const char *data_path = pro.val("DataPath");
+	const char *prefix = pro.val("OutputPrefix");
+
+	// texto del corpus
+	FILE *f = fopen(pro.val("InputFile"), "rb");
+	if (!f) {
+		fprintf(stderr, "ERROR: can't open %s\n", pro.cval("InputFile"));
+		return -1;
+	}
+	std::vector<char> text;
+	int c;
+	while ((c = fgetc(f)) != EOF)
+		text.push_back((char)c);
+	text.push_back('\0');
+	fclose(f);
+
+	// lookaheads: primero la referencia (0, frase entera)
+	std::vector<int> las(1, 0);
+	const char *p = pro.val("Lookahead");
+	while (*p) {
+		int la = atoi(p);
+		if (la > 0)
+			las.push_back(la);
+		while (*p && *p != ',')
+			p++;
+		if (*p)
+			p++;
+	}
+
+	char fname[1024];
+	std::vector<float> rmgc, rlf0, rstr;
+	int frames = 0, dmgc = 0, dstr = 0;
+	printf("lookahead  sentences  first(ms)  total(ms)   MCD(dB)  F0(cents)  V/UV(%%)  str3 RMSE\n");
+	for (size_t i = 0; i < las.size(); i++) {
+		double first, total;
+		int nsent;
+		if (!run(&text[0], lang, data_path, prefix, las[i], &first, &total, &nsent)) {
+			fprintf(stderr, "ERROR: can't create the tts\n");
+			return -1;
+		}
+		sprintf(fname, "%s.%d.mgc", prefix, las[i]);
+		std::vector<float> mgc = load(fname);
+		sprintf(fname, "%s.%d.lf0", prefix, las[i]);
+		std::vector<float> lf0 = load(fname);
+		sprintf(fname, "%s.%d.str", prefix, las[i]);
+		std::vector<float> str = load(fname);
+		if (i == 0) {
+			rmgc = mgc; rlf0 = lf0; rstr = str;
+			frames = (int)lf0.size();
+			dmgc = frames ? (int)(mgc.size() / frames) : 0;
+			dstr = frames ? (int)(str.size() / frames) : 0;
+			printf("%9s  %9d  %9.1f  %9.1f\n", "whole", nsent, nsent ? first / nsent : 0.0, total);
+			continue;
+		}
+		if ((int)lf0.size() != frames || mgc.size() != rmgc.size() || str.size() != rstr.size()) {
+			printf("%9d  frame count differs from the reference\n", las[i]);
+			continue;
+		}
+		// distorsion mel-cepstral por trama (sin c0) y errores de f0 (tramas sonoras en ambas) y del tercer stream
+		double mcd = 0.0, cents = 0.0, sstr = 0.0;
+		int voiced = 0, vuv = 0;
+		for (int t = 0; t < frames; t++) {
+			double d = 0.0;
+			for (int k = 1; k < dmgc; k++)
+				d += (mgc[t * dmgc + k] - rmgc[t * dmgc + k]) * (mgc[t * dmgc + k] - rmgc[t * dmgc + k]);
+			mcd += 10.0 / log(10.0) * sqrt(2.0 * d);
+			if ((lf0[t] > LZERO_FLOAT) != (rlf0[t] > LZERO_FLOAT))
+				vuv++;
+			else if (lf0[t] > LZERO_FLOAT) {
+				cents += (1200.0 / log(2.0) * (lf0[t] - rlf0[t])) * (1200.0 / log(2.0) * (lf0[t] - rlf0[t]));
+				voiced++;
+			}
+			for (int k = 0; k < dstr; k++)
+				sstr += (str[t * dstr + k] - rstr[t * dstr + k]) * (str[t * dstr + k] - rstr[t * dstr + k]);
+		}
+		printf("%9d  %9d  %9.1f  %9.1f  %8.3f  %9.2f  %7.2f  %9.4f\n", las[i], nsent, nsent ? first / nsent : 0.0, total,
+				frames ? mcd / frames : 0.0, voiced ? sqrt(cents / voiced) : 0.0, frames ? 100.0 * vuv / frames : 0.0,
+				frames && dstr ? sqrt(sstr / (frames * dstr)) : 0.0);
+	}
+	return 0;
+}
@@ -23,6 +23,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <curl/curl.h>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -244,6 +245,61 @@ inline Response make_request(const std::string& method, const std::string& url,
     return {static_cast<int>(status_code), response_string, response_headers};
 }
 
+// Like make_request("POST", ...) but hands the body to on_data as it is
+// received instead of returning it; on_data returns false to abort the
+// transfer. on_data runs inside libcurl, so it must not throw: the caller
+// keeps its own errors and reports them once this returns (an exception that
+// still gets here only aborts the transfer). text is empty on success or
+// holds the curl error
+inline size_t stream_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* on_data = static_cast<std::function<bool(const char*, size_t)>*>(userdata);
+    size_t real_size = size * nmemb;
+    try {
+        return (*on_data)(ptr, real_size) ? real_size : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+inline Response make_stream_request(const std::string& url, const std::string& api_key,
+                                   const std::string& organization, const std::string& data,
+                                   std::function<bool(const char*, size_t)> on_data) {
+    CurlWrapper curl_wrapper;
+    CURL* curl = curl_wrapper.get();
+    if (!curl) {
+        return {-1, "Failed to initialize curl", {}};
+    }
+
+    Headers response_headers;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &on_data);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
+
+    struct curl_slist* curl_headers = nullptr;
+    curl_headers = curl_slist_append(curl_headers, ("Authorization: Bearer " + api_key).c_str());
+    if (!organization.empty()) {
+        curl_headers = curl_slist_append(curl_headers, ("OpenAI-Organization: " + organization).c_str());
+    }
+    curl_headers = curl_slist_append(curl_headers, "Content-Type: application/json");
+    curl_headers = curl_slist_append(curl_headers, "Accept: text/event-stream");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, curl_headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+
+    CURLcode res = curl_easy_perform(curl);
+    long status_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
+    curl_slist_free_all(curl_headers);
+
+    if (res != CURLE_OK) {
+        return {static_cast<int>(status_code), "curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)), response_headers};
+    }
+    return {static_cast<int>(status_code), "", response_headers};
+}
+
 OPENAI_IMPL_NS_END
 
 namespace openai {
@@ -347,6 +403,10 @@ public:
     Chat(OpenAI& openai) : openai_(openai) {}
 
     Json create(const Json& params);
+    // Streaming completion: calls on_delta with each piece of the answer
+    // text as it is generated; on_delta returns false to stop. Returns false
+    // if stopped by on_delta
+    bool create_stream(const Json& params, const std::function<bool(const std::string&)>& on_delta);
 
 private:
     OpenAI& openai_;
@@ -375,14 +435,16 @@ private:
 
 class OpenAI {
 public:
-    OpenAI() : api_key_(_impl::get_env("OPENAI_API_KEY")), organization_(_impl::get_env("OPENAI_ORGANIZATION")),
-               model(*this), completion(*this), edit(*this), image(*this), embedding(*this),
-               file(*this), fine_tune(*this), chat(*this), audio(*this), moderation(*this) {}
+    OpenAI() : model(*this), completion(*this), edit(*this), image(*this), embedding(*this),
+               file(*this), fine_tune(*this), chat(*this), audio(*this), moderation(*this),
+               api_key_(_impl::get_env("OPENAI_API_KEY")), organization_(_impl::get_env("OPENAI_ORGANIZATION")),
+               base_url_(_impl::get_env_else("OPENAI_API_BASE", "https://api.openai.com/v1")) {}
 
     OpenAI(const std::string& api_key, const std::string& organization = "")
-        : api_key_(api_key), organization_(organization),
-          model(*this), completion(*this), edit(*this), image(*this), embedding(*this),
-          file(*this), fine_tune(*this), chat(*this), audio(*this), moderation(*this) {}
+        : model(*this), completion(*this), edit(*this), image(*this), embedding(*this),
+          file(*this), fine_tune(*this), chat(*this), audio(*this), moderation(*this),
+          api_key_(api_key), organization_(organization),
+          base_url_(_impl::get_env_else("OPENAI_API_BASE", "https://api.openai.com/v1")) {}
 
     void set_api_key(const std::string& api_key) {
         api_key_ = api_key;
@@ -392,6 +454,11 @@ public:
         organization_ = organization;
     }
 
+    // Base URL of the API, e.g. a local server speaking the same protocol
+    void set_base_url(const std::string& base_url) {
+        base_url_ = base_url;
+    }
+
     void set_throw_exception(bool throw_exception) {
         throw_exception_ = throw_exception;
     }
@@ -408,8 +475,12 @@ public:
         return throw_exception_;
     }
 
+    std::string get_base_url() const {
+        return base_url_;
+    }
+
     Json post(const std::string& path, const Json& payload) {
-        std::string url = "https://api.openai.com/v1" + path;
+        std::string url = base_url_ + path;
         std::string data = payload.dump();
 #ifdef OPENAI_VERBOSE_OUTPUT
         std::cout << ">> request: " << url << "  " << data << std::endl;
@@ -427,7 +498,7 @@ public:
     }
 
     Json get(const std::string& path) {
-        std::string url = "https://api.openai.com/v1" + path;
+        std::string url = base_url_ + path;
 #ifdef OPENAI_VERBOSE_OUTPUT
         std::cout << ">> request: " << url << std::endl;
 #endif
@@ -444,7 +515,7 @@ public:
     }
 
     Json delete_req(const std::string& path) {
-        std::string url = "https://api.openai.com/v1" + path;
+        std::string url = base_url_ + path;
 #ifdef OPENAI_VERBOSE_OUTPUT
         std::cout << ">> request: " << url << std::endl;
 #endif
@@ -460,6 +531,81 @@ public:
         return json_parse(response.text);
     }
 
+    // POST that answers with server-sent events ("stream": true). Each
+    // "data:" event is parsed and passed to on_event as it arrives; on_event
+    // returns false to stop reading. Returns false if the stream was stopped
+    // by on_event. A malformed event or an exception from on_event stops the
+    // transfer and is thrown (or reported) here, outside libcurl
+    bool post_stream(const std::string& path, const Json& payload, const std::function<bool(const Json&)>& on_event) {
+        std::string url = base_url_ + path;
+        std::string data = payload.dump();
+#ifdef OPENAI_VERBOSE_OUTPUT
+        std::cout << ">> stream request: " << url << "  " << data << std::endl;
+#endif
+        std::string line;
+        std::string other;  // Anything that is not an event, e.g. an error body
+        bool stopped = false;
+        std::exception_ptr failure;  // Thrown while reading the stream, kept out of libcurl
+        // Splits the body into lines and hands the "data:" events to on_event
+        auto parse_events = [&](const char* ptr, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                if (ptr[i] != '\n') {
+                    line += ptr[i];
+                    continue;
+                }
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.compare(0, 5, "data:") == 0) {
+                    size_t start = line.find_first_not_of(' ', 5);
+                    std::string event = start == std::string::npos ? "" : line.substr(start);
+                    if (!event.empty() && event != "[DONE]" && !on_event(json_parse(event))) {
+                        stopped = true;
+                        return false;
+                    }
+                } else {
+                    other += line + "\n";
+                }
+                line.clear();
+            }
+            return true;
+        };
+        auto on_data = [&](const char* ptr, size_t size) {
+            try {
+                return parse_events(ptr, size);
+            } catch (...) {
+                failure = std::current_exception();
+                return false;
+            }
+        };
+        _impl::Response response = _impl::make_stream_request(url, api_key_, organization_, data, on_data);
+        if (failure) {
+            if (throw_exception_) {
+                std::rethrow_exception(failure);
+            }
+            try {
+                std::rethrow_exception(failure);
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: stream error: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Warning: stream error" << std::endl;
+            }
+            return true;
+        }
+        if (stopped) {
+            return false;
+        }
+        if (response.status_code < 200 || response.status_code >= 300 || !response.text.empty()) {
+            std::string error = response.text.empty() ? other + line : response.text;
+            if (throw_exception_) {
+                throw std::runtime_error("HTTP error " + std::to_string(response.status_code) + ": " + error);
+            } else {
+                std::cerr << "Warning: HTTP error " << response.status_code << ": " << error << std::endl;
+            }
+        }
+        return true;
+    }
+
     Model model;
     Completion completion;
     Edit edit;
@@ -474,6 +620,7 @@ public:
 private:
     std::string api_key_;
     std::string organization_;
+    std::string base_url_;
     bool throw_exception_ = true;
 };
 
@@ -560,6 +707,21 @@ inline Json Chat::create(const Json& params) {
     return openai_.post("/chat/completions", params);
 }
 
+inline bool Chat::create_stream(const Json& params, const std::function<bool(const std::string&)>& on_delta) {
+    Json stream_params = params;
+    stream_params["stream"] = true;
+    return openai_.post_stream("/chat/completions", stream_params, [&on_delta](const Json& event) {
+        if (!event.contains("choices") || !event["choices"].is_array() || event["choices"].empty()) {
+            return true;
+        }
+        const Json& delta = event["choices"][0]["delta"];
+        if (delta.is_object() && delta.contains("content") && delta["content"].is_string()) {
+            return on_delta(delta["content"].get<std::string>());
+        }
+        return true;
+    });
+}
+
 inline Json Audio::transcribe(const Json& params) {
     return openai_.post("/audio/transcriptions", params);
 }
@@ -0,0 +1,272 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+*AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    *2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	GPL-3.0+
+	*GPL-3.0+
+	'Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+0.1.0    16/10/26  Jonny     Preguntas evaluadas y reutilizadas por etiqueta
+0.0.0    16/10/26  Jonny     Codificacion inicial.
+
+Mide el tiempo de busqueda en los arboles de decision por etiqueta: sintetiza
+el corpus guardando las etiquetas (od), carga los modelos de la voz y recorre
+para cada etiqueta los arboles de duracion, de cada estado y stream y del GV
+switch, primero con el emparejamiento generico de patrones y despues con las
+preguntas compiladas (HTS_ModelSet_match_label), que responden cada pregunta
+una sola vez por etiqueta. Cuenta las preguntas evaluadas y las respuestas
+reutilizadas por etiqueta y comprueba que los indices de pdf coinciden.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include "htts.hpp"
+#include "strl.hpp"
+#include "HTS_engine.h"
+
+static double msnow(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static BOOL ignore(const short *, const float *, INT, VOID *) {
+	return TRUE;
+}
+
+/* Sintetiza {text} y devuelve en {labels} las etiquetas de contexto de todas
+las frases, guardadas en {lab_fname}. Devuelve FALSE si no se puede crear el tts */
+static BOOL get_labels(const char *text, const char *lang, const char *data_path, const char *lab_fname,
+		std::vector<std::string> &labels) {
+	char dicc[1024], voice[1024], line[4096], label[4096];
+	if ((size_t)snprintf(dicc, sizeof(dicc), "%s/dicts/%s_dicc", data_path, lang) >= sizeof(dicc) ||
+			(size_t)snprintf(voice, sizeof(voice), "%s/voices/aholab_%s_female/", data_path, lang) >= sizeof(voice))
+		return FALSE;
+	HTTS *tts = new HTTS;
+	tts->set("PthModel", "Pth1");
+	tts->set("Method", "HTS");
+	tts->set("Lang", lang);
+	tts->set("HDicDBName", dicc);
+	if (!tts->create()) {
+		delete tts;
+		return FALSE;
+	}
+	tts->set("voice_path", voice);
+	tts->set("od", lab_fname);
+	tts->synthesize_stream(text, lang, data_path, ignore, NULL);
+	delete tts;  // cierra el fichero de etiquetas
+
+	FILE *f = fopen(lab_fname, "rt");
+	if (!f)
+		return FALSE;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "%*s %*s %s", label) == 1)
+			labels.push_back(label);
+	fclose(f);
+	return TRUE;
+}
+
+/* Carga los modelos de la voz como HTS_U2W::loadModels() */
+static BOOL load_voice(HTS_Engine *e, const char *data_path, const char *lang) {
+	char dir[1024 - 32], fn[32][1024];
+	char *pdf[1], *tree[1], *win[3];
+	const char *names[] = { "mgc", "lf0", "bap" };
+	BOOL ok = TRUE;
+	int i, k, nstream;
+	FILE *f;
+
+	if ((size_t)snprintf(dir, sizeof(dir), "%s/voices/aholab_%s_female/", data_path, lang) >= sizeof(dir))
+		return FALSE;
+	snprintf(fn[0], sizeof(fn[0]), "%stree-bap.inf", dir);
+	f = fopen(fn[0], "rb");
+	nstream = f ? 3 : 2;
+	if (f)
+		fclose(f);
+	HTS_Engine_initialize(e, nstream);
+	snprintf(fn[0], sizeof(fn[0]), "%sdur.pdf", dir); pdf[0] = fn[0];
+	snprintf(fn[1], sizeof(fn[1]), "%stree-dur.inf", dir); tree[0] = fn[1];
+	ok = HTS_Engine_load_duration_from_fn(e, pdf, tree, 1);
+	for (i = 0; ok && i < nstream; i++) {
+		snprintf(fn[0], sizeof(fn[0]), "%s%s.pdf", dir, names[i]); pdf[0] = fn[0];
+		snprintf(fn[1], sizeof(fn[1]), "%stree-%s.inf", dir, names[i]); tree[0] = fn[1];
+		for (k = 0; k < 3; k++) {
+			snprintf(fn[2 + k], sizeof(fn[2 + k]), "%s%s.win%d", dir, names[i], k + 1);
+			win[k] = fn[2 + k];
+		}
+		ok = HTS_Engine_load_parameter_from_fn(e, pdf, tree, win, i, i == 1, 3, 1);
+		if (!ok)
+			break;
+		snprintf(fn[0], sizeof(fn[0]), "%sgv-%s.pdf", dir, names[i]); pdf[0] = fn[0];
+		snprintf(fn[1], sizeof(fn[1]), "%stree-gv-%s.inf", dir, names[i]); tree[0] = fn[1];
+		HTS_Engine_load_gv_from_fn(e, pdf, tree, i, 1);
+	}
+	snprintf(fn[0], sizeof(fn[0]), "%sgv-switch.inf", dir);
+	if (ok)
+		HTS_Engine_load_gv_switch_from_fn(e, fn[0]);
+	return ok;
+}
+
+/* Busca en todos los arboles la etiqueta {label} y anota los indices de pdf en {pdfs} */
+static void lookup(HTS_ModelSet *ms, HTS_LabelMatch *label, std::vector<int> &pdfs) {
+	int i, j, k, tree, pdf;
+	for (i = 0; i < HTS_ModelSet_get_duration_interpolation_size(ms); i++) {
+		HTS_ModelSet_get_duration_index(ms, label, &tree, &pdf, i);
+		pdfs.push_back(pdf);
+	}
+	for (j = 2; j <= HTS_ModelSet_get_nstate(ms) + 1; j++)
+		for (k = 0; k < HTS_ModelSet_get_nstream(ms); k++)
+			for (i = 0; i < HTS_ModelSet_get_parameter_interpolation_size(ms, k); i++) {
+				HTS_ModelSet_get_parameter_index(ms, label, &tree, &pdf, k, j, i);
+				pdfs.push_back(pdf);
+			}
+	if (HTS_ModelSet_have_gv_switch(ms))
+		pdfs.push_back(HTS_ModelSet_get_gv_switch(ms, label));
+}
+
+/* Recorre {repeat} veces los arboles para todas las etiquetas, con las preguntas
+compiladas o con el emparejamiento generico. Devuelve los ms empleados y en
+{evaluated} y {reused} las preguntas evaluadas y reutilizadas de la ultima pasada */
+static double run(HTS_ModelSet *ms, const std::vector<std::string> &labels, int repeat, BOOL compiled,
+		std::vector<int> &pdfs, long *evaluated, long *reused) {
+	HTS_LabelMatch match;
+	double t = msnow();
+	for (int r = 0; r < repeat; r++) {
+		pdfs.clear();
+		*evaluated = *reused = 0;
+		for (size_t i = 0; i < labels.size(); i++) {
+			if (compiled)
+				HTS_ModelSet_match_label(ms, labels[i].c_str(), &match);
+			else
+				HTS_LabelMatch_initialize(&match, labels[i].c_str());
+			lookup(ms, &match, pdfs);
+			*evaluated += match.evaluated;
+			*reused += match.reused;
+			HTS_LabelMatch_clear(&match);
+		}
+	}
+	return msnow() - t;
+}
+
+int main(int argc, char *argv[]) {
+	KVStrList pro("InputFile=input.txt Lang=eu DataPath=data_tts OutputPrefix=tree_bench Repeat=20 help=n");
+	StrList files;
+	clargs2props(argc, argv, pro, files, "InputFile=s Lang={es|eu} DataPath=s OutputPrefix=s Repeat=i help=b");
+	if (pro.bval("help")) {
+		printf("usage: ./tree_bench -InputFile=corpus.txt -Lang={eu|es} -DataPath=data_tts -OutputPrefix=tree_bench -Repeat=20\n");
+		return -1;
+	}
+	const char *lang = pro.val("Lang");
+	const char *data_path = pro.val("DataPath");
+	int repeat = pro.ival("Repeat");
+	if (repeat < 1)
+		repeat = 1;
+
+	// texto del corpus
+	FILE *f = fopen(pro.val("InputFile"), "rb");
+	if (!f) {
+		fprintf(stderr, "ERROR: can't open %s\n", pro.cval("InputFile"));
+		return -1;
+	}
+	std::vector<char> text;
+	int c;
+	while ((c = fgetc(f)) != EOF)
+		text.push_back((char)c);
+	text.push_back('\0');
+	fclose(f);
+
+	char fname[1024];
+	std::vector<std::string> labels;
+	if ((size_t)snprintf(fname, sizeof(fname), "%s.lab", pro.cval("OutputPrefix")) >= sizeof(fname)) {
+		fprintf(stderr, "ERROR: OutputPrefix too long\n");
+		return -1;
+	}
+	if (!get_labels(&text[0], lang, data_path, fname, labels)) {
+		fprintf(stderr, "ERROR: can't create the tts\n");
+		return -1;
+	}
+	if (labels.empty()) {
+		fprintf(stderr, "ERROR: no labels in %s\n", fname);
+		return -1;
+	}
+
+	HTS_Engine engine;
+	if (!load_voice(&engine, data_path, lang)) {
+		fprintf(stderr, "ERROR: can't load the voice\n");
+		return -1;
+	}
+	HTS_ModelSet *ms = &engine.ms;
+
+	std::vector<int> generic_pdfs, compiled_pdfs;
+	long generic_evaluated, generic_reused, compiled_evaluated, compiled_reused;
+	double generic = run(ms, labels, repeat, FALSE, generic_pdfs, &generic_evaluated, &generic_reused);
+	double compiled = run(ms, labels, repeat, TRUE, compiled_pdfs, &compiled_evaluated, &compiled_reused);
+	double n = (double)labels.size() * repeat;
+	double nl = (double)labels.size();
+
+	printf("labels %d  lookups/label %d  repeat %d  substrings %d  questions %d\n", (int)labels.size(),
+			(int)(generic_pdfs.size() / labels.size()), repeat, ms->matcher ? ms->matcher->nliteral : 0,
+			ms->matcher ? ms->matcher->nquestion : 0);
+	printf("matcher    us/label  evaluated/label  reused/label\n");
+	printf("generic   %9.2f  %15.1f  %12.1f\n", 1000.0 * generic / n, generic_evaluated / nl, generic_reused / nl);
+	printf("compiled  %9.2f  %15.1f  %12.1f  (x%.1f)\n", 1000.0 * compiled / n, compiled_evaluated / nl,
+			compiled_reused / nl, compiled > 0.0 ? generic / compiled : 0.0);
+	if (generic_pdfs != compiled_pdfs) {
+		printf("ERROR: pdf indices differ\n");
+		HTS_Engine_clear(&engine);
+		return -1;
+	}
+	printf("pdf indices identical\n");
+	HTS_Engine_clear(&engine);
+	return 0;
+}
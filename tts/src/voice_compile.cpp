@@ -0,0 +1,187 @@
+/******************************************************************************/
+/*/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/
+
+AhoTTS: A Text-To-Speech system for Basque* and Spanish*,
+developed by Aholab Signal Processing Laboratory at the
+University of the Basque Country (UPV/EHU). Its acoustic engine is based on
+hts_engine' and it uses AhoCoder* as vocoder.
+(Read COPYRIGHT_and_LICENSE_code.txt for more details)
+--------------------------------------------------------------------------------
+
+Linguistic processing for Basque and Spanish, Vocoder (Ahocoder) and
+integration by Aholab UPV/EHU.
+
+*AhoCoder is an HNM-based vocoder for Statistical Synthesizers
+http://aholab.ehu.es/ahocoder/
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Copyrights:
+	1997-2015  Aholab Signal Processing Laboratory, University of the Basque
+	 Country (UPV/EHU)
+    *2011-2015 Aholab Signal Processing Laboratory, University of the Basque
+	  Country (UPV/EHU)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+Licenses:
+	GPL-3.0+
+	*GPL-3.0+
+	'Modified BSD (Compatible with GNU GPL)
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GPL-3.0+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ .
+ This package is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ .
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+ .
+ On Debian systems, the complete text of the GNU General
+ Public License version 3 can be found in /usr/share/common-licenses/GPL-3.
+
+//\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\/\*/
+/******************************************************************************/
+/*
+Version  dd/mm/aa  Autor     Proposito de la edicion
+-------  --------  --------  -----------------------
+0.0.0    16/10/26  Jonny     Codificacion inicial.
+
+Compila una voz (los ficheros .pdf, .inf y .win del directorio de la voz) en
+una imagen binaria que el motor proyecta en memoria de solo lectura
+(HTS_Engine_load_image_from_fn): arboles aplanados en vectores de nodos,
+preguntas ya separadas en patrones y tablas de pdf contiguas. La imagen es
+propia de la maquina que la genera (orden de bytes y tamanos de int y double)
+y se vuelve a generar cuando cambia algun fichero de la voz. Tras escribirla
+la carga de nuevo y compara los tiempos de carga.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "htts.hpp"
+#include "strl.hpp"
+#include "HTS_engine.h"
+
+static double msnow(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* Carga los modelos de la voz del directorio {dir} como HTS_U2W::loadModelFiles() */
+static BOOL load_voice(HTS_Engine *e, const char *dir) {
+	char fn[32][1024];
+	char *pdf[1], *tree[1], *win[3];
+	const char *names[] = { "mgc", "lf0", "bap" };
+	BOOL ok = TRUE;
+	int i, k, nstream;
+	FILE *f;
+
+	snprintf(fn[0], sizeof(fn[0]), "%stree-bap.inf", dir);
+	f = fopen(fn[0], "rb");
+	nstream = f ? 3 : 2;
+	if (f)
+		fclose(f);
+	HTS_Engine_initialize(e, nstream);
+	snprintf(fn[0], sizeof(fn[0]), "%sdur.pdf", dir); pdf[0] = fn[0];
+	snprintf(fn[1], sizeof(fn[1]), "%stree-dur.inf", dir); tree[0] = fn[1];
+	ok = HTS_Engine_load_duration_from_fn(e, pdf, tree, 1);
+	for (i = 0; ok && i < nstream; i++) {
+		snprintf(fn[0], sizeof(fn[0]), "%s%s.pdf", dir, names[i]); pdf[0] = fn[0];
+		snprintf(fn[1], sizeof(fn[1]), "%stree-%s.inf", dir, names[i]); tree[0] = fn[1];
+		for (k = 0; k < 3; k++) {
+			snprintf(fn[2 + k], sizeof(fn[2 + k]), "%s%s.win%d", dir, names[i], k + 1);
+			win[k] = fn[2 + k];
+		}
+		ok = HTS_Engine_load_parameter_from_fn(e, pdf, tree, win, i, i == 1, 3, 1);
+		if (!ok)
+			break;
+		snprintf(fn[0], sizeof(fn[0]), "%sgv-%s.pdf", dir, names[i]); pdf[0] = fn[0];
+		snprintf(fn[1], sizeof(fn[1]), "%stree-gv-%s.inf", dir, names[i]); tree[0] = fn[1];
+		HTS_Engine_load_gv_from_fn(e, pdf, tree, i, 1);
+	}
+	snprintf(fn[0], sizeof(fn[0]), "%sgv-switch.inf", dir);
+	if (ok)
+		HTS_Engine_load_gv_switch_from_fn(e, fn[0]);
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	KVStrList pro("VoicePath=voice/ OutputFile= help=n");
+	StrList files;
+	clargs2props(argc, argv, pro, files, "VoicePath=s OutputFile=s help=b");
+	if (pro.bval("help")) {
+		printf("usage: ./voice_compile -VoicePath=data_tts/voices/aholab_eu_female/ [-OutputFile=voice.htsimg]\n");
+		printf("  the default output is {VoicePath}voice.htsimg, the image HTS_U2W loads first\n");
+		return -1;
+	}
+	/* dejamos sitio en dir para los nombres de fichero de la voz (load_voice) */
+	char dir[1024 - 32], out[1024];
+	const char *vp = pro.cval("VoicePath");
+	if ((size_t)snprintf(dir, sizeof(dir), "%s%s", vp, vp[0] && vp[strlen(vp) - 1] != '/' ? "/" : "") >= sizeof(dir)) {
+		fprintf(stderr, "ERROR: VoicePath too long\n");
+		return -1;
+	}
+	int n;
+	if (pro.val("OutputFile")[0])
+		n = snprintf(out, sizeof(out), "%s", pro.cval("OutputFile"));
+	else
+		n = snprintf(out, sizeof(out), "%svoice.htsimg", dir);
+	if ((size_t)n >= sizeof(out)) {
+		fprintf(stderr, "ERROR: OutputFile too long\n");
+		return -1;
+	}
+
+	HTS_Engine engine;
+	double t = msnow();
+	if (!load_voice(&engine, dir)) {
+		fprintf(stderr, "ERROR: can't load the voice in %s\n", dir);
+		return -1;
+	}
+	double text_ms = msnow() - t;
+
+	HTS_File *fp = HTS_fopen(out, "wb");
+	if (!fp) {
+		fprintf(stderr, "ERROR: can't create %s\n", out);
+		HTS_Engine_clear(&engine);
+		return -1;
+	}
+	BOOL ok = HTS_Engine_save_image(&engine, fp);
+	HTS_fclose(fp);
+	int nstream = HTS_ModelSet_get_nstream(&engine.ms);
+	HTS_Engine_clear(&engine);
+	if (!ok) {
+		fprintf(stderr, "ERROR: can't write %s\n", out);
+		remove(out);
+		return -1;
+	}
+
+	// comprueba que la imagen se puede cargar
+	if (HTS_Engine_get_image_nstream(out) != nstream) {
+		fprintf(stderr, "ERROR: %s is not a valid voice image\n", out);
+		return -1;
+	}
+	t = msnow();
+	HTS_Engine_initialize(&engine, nstream);
+	ok = HTS_Engine_load_image_from_fn(&engine, out);
+	double image_ms = msnow() - t;
+	size_t size = engine.ms.image_size;
+	HTS_Engine_clear(&engine);
+	if (!ok) {
+		fprintf(stderr, "ERROR: can't load %s\n", out);
+		return -1;
+	}
+	printf("%s: %d streams, %lu bytes\n", out, nstream, (unsigned long)size);
+	printf("load: text files %.1f ms, image %.1f ms\n", text_ms, image_ms);
+	return 0;
+}
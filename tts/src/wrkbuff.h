@@ -96,9 +96,11 @@ extern "C" {
 
 /**********************************************************/
 
-/* definir NOWRKBUFF para NO utilizar un buffer global */
+/* definir NOWRKBUFF para NO utilizar un buffer global. El buffer
+global no es thread-safe: el servidor sintetiza con varios objetos
+HTTS en threads distintos, asi que usamos buffers en pila. */
 
-#define NOWRKBUFFxx
+#define NOWRKBUFF
 
 /**********************************************************/
 